@@ -5,11 +5,28 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
-static float s_cameraRotation = 75.0f;
-static float s_camearLookAtEyeY = 1.6f;
-static float s_camearLookAtEyeZ = 0.8f;
-static float s_camearLookAtCentreZ = 0.2f;
-static float s_camearFieldOfView = 45.0f;
+#include <cmath>
+
+struct PkCameraState
+{
+    float rotation = 75.0f;
+    float lookAtEyeY = 1.6f;
+    float lookAtEyeZ = 0.8f;
+    float lookAtCentreZ = 0.2f;
+    float fieldOfView = 45.0f;
+};
+
+// The controls are only read by the simulation, which keeps its last two steps to draw between.
+static PkCameraState s_cameraControls;
+static PkCameraState s_previousCamera;
+static PkCameraState s_currentCamera;
+
+// Takes the short way round, so a rotation across 0 degrees doesn't spin back through 180.
+static float mixDegrees(float from, float to, float t)
+{
+    float delta = std::fmod(to - from + 540.0f, 360.0f) - 180.0f;
+    return from + delta * t;
+}
 
 static void ShowCameraUi(bool* p_open)
 {
@@ -30,26 +47,39 @@ static void ShowCameraUi(bool* p_open)
     {
         static ImGuiSliderFlags sliderFlags = ImGuiSliderFlags_None;
 
-        ImGui::SliderFloat("Camera look-at Eye Y", &s_camearLookAtEyeY, 0.0f, 3.0f, "%.3f", sliderFlags);
-        ImGui::SliderFloat("Camera look-at Eye Z", &s_camearLookAtEyeZ, 0.0f, 3.0f, "%.3f", sliderFlags);
-        ImGui::SliderFloat("Camera look-at Centre Y", &s_camearLookAtCentreZ, 0.0f, 3.0f, "%.3f", sliderFlags);
-        ImGui::SliderFloat("Camera field of view", &s_camearFieldOfView, 0.0f, 100.0f, "%.3f", sliderFlags);
-        ImGui::SliderFloat("Camera rotation", &s_cameraRotation, 0.0f, 360.0f, "%.3f", sliderFlags);
+        ImGui::SliderFloat("Camera look-at Eye Y", &s_cameraControls.lookAtEyeY, 0.0f, 3.0f, "%.3f", sliderFlags);
+        ImGui::SliderFloat("Camera look-at Eye Z", &s_cameraControls.lookAtEyeZ, 0.0f, 3.0f, "%.3f", sliderFlags);
+        ImGui::SliderFloat("Camera look-at Centre Y", &s_cameraControls.lookAtCentreZ, 0.0f, 3.0f, "%.3f", sliderFlags);
+        ImGui::SliderFloat("Camera field of view", &s_cameraControls.fieldOfView, 0.0f, 100.0f, "%.3f", sliderFlags);
+        ImGui::SliderFloat("Camera rotation", &s_cameraControls.rotation, 0.0f, 360.0f, "%.3f", sliderFlags);
     }
     ImGui::End();
 }
 
-void pkCamera_Update(float dt)
+void pkCamera_Simulate(float stepTime)
 {
-	//s_cameraRotation += dt * 10.0f;
+	//s_cameraControls.rotation = std::fmod(s_cameraControls.rotation + stepTime * 10.0f, 360.0f);
+
+    s_previousCamera = s_currentCamera;
+    s_currentCamera = s_cameraControls;
+}
 
+void pkCamera_Update(float interpolation)
+{
     static bool show_camera_ui = true;
     ShowCameraUi(&show_camera_ui);
 
-    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(s_cameraRotation), glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4 lookat = glm::lookAt(glm::vec3(0.0f, s_camearLookAtEyeY, s_camearLookAtEyeZ), glm::vec3(0.0f, 0.0f, s_camearLookAtCentreZ), glm::vec3(0.0f, 0.0f, 1.0f));
+    PkCameraState camera;
+    camera.rotation = mixDegrees(s_previousCamera.rotation, s_currentCamera.rotation, interpolation);
+    camera.lookAtEyeY = glm::mix(s_previousCamera.lookAtEyeY, s_currentCamera.lookAtEyeY, interpolation);
+    camera.lookAtEyeZ = glm::mix(s_previousCamera.lookAtEyeZ, s_currentCamera.lookAtEyeZ, interpolation);
+    camera.lookAtCentreZ = glm::mix(s_previousCamera.lookAtCentreZ, s_currentCamera.lookAtCentreZ, interpolation);
+    camera.fieldOfView = glm::mix(s_previousCamera.fieldOfView, s_currentCamera.fieldOfView, interpolation);
+
+    glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(camera.rotation), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 lookat = glm::lookAt(glm::vec3(0.0f, camera.lookAtEyeY, camera.lookAtEyeZ), glm::vec3(0.0f, 0.0f, camera.lookAtCentreZ), glm::vec3(0.0f, 0.0f, 1.0f));
     glm::mat4 view = lookat * rotation;
 
     PkGraphics::SetViewMatrix(view);
-    PkGraphics::SetFieldOfView(s_camearFieldOfView);
+    PkGraphics::SetFieldOfView(camera.fieldOfView);
 }
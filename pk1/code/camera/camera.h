@@ -1,3 +1,7 @@
 #pragma once
 
-void pkCamera_Update(float dt);
+// Advances the camera one fixed simulation step.
+void pkCamera_Simulate(float stepTime);
+
+// Shows the camera controls and sets the view part way between the camera's last two steps.
+void pkCamera_Update(float interpolation);
@@ -5,27 +5,86 @@
 #include "graphics/graphics.h"
 #include "camera/camera.h"
 #include "imgui/imgui.h"
+#include "jobs/jobSystem.h"
 
 #include <GLFW/glfw3.h>
 
 #include <stdio.h>
 #include <chrono>
+#include <cmath>
 
 static const char* GAME_NAME = "zodquad";
 static const uint32_t VERSION_MAJOR_NUMBER = 0;
 static const uint32_t VERSION_MINOR_NUMBER = 0;
 static const uint32_t VERSION_PATCH_NUMBER = 1;
 
+// The simulation always advances in steps of this length, whatever the frame rate.
+static const uint32_t SIMULATION_STEPS_PER_SECOND = 120;
+static const float SIMULATION_STEP_TIME = 1.0f / SIMULATION_STEPS_PER_SECOND;
+
+// Past this many steps in one frame the simulation drops time rather than making each frame slower to catch up.
+static const uint32_t MAX_SIMULATION_STEPS_PER_FRAME = 8;
+
 struct GameData
 {
 	std::chrono::time_point<std::chrono::high_resolution_clock> currentTime;
 	std::chrono::time_point<std::chrono::high_resolution_clock> lastTime;
+
+	// Real time not yet simulated; always less than a step once the frame's steps have run.
+	float accumulatedTime = 0.0f;
+	uint64_t simulationStepCount = 0;
+	uint32_t frameStepCount = 0;
+	float droppedTime = 0.0f;
 };
 
 static GameData* s_pData = nullptr;
 
+static void simulateGame()
+{
+	s_pData->frameStepCount = 0;
+
+	while (s_pData->accumulatedTime >= SIMULATION_STEP_TIME && s_pData->frameStepCount < MAX_SIMULATION_STEPS_PER_FRAME)
+	{
+		pkCamera_Simulate(SIMULATION_STEP_TIME);
+		PkGraphics::SimulateScene(SIMULATION_STEP_TIME);
+
+		s_pData->accumulatedTime -= SIMULATION_STEP_TIME;
+		s_pData->simulationStepCount++;
+		s_pData->frameStepCount++;
+	}
+
+	if (s_pData->accumulatedTime >= SIMULATION_STEP_TIME)
+	{
+		const float remainingTime = std::fmod(s_pData->accumulatedTime, SIMULATION_STEP_TIME);
+		s_pData->droppedTime += s_pData->accumulatedTime - remainingTime;
+		s_pData->accumulatedTime = remainingTime;
+	}
+}
+
+static void showSimulationUi()
+{
+	if (ImGui::Begin("Simulation"))
+	{
+		ImGui::Text("%u steps per second, %u this frame", SIMULATION_STEPS_PER_SECOND, s_pData->frameStepCount);
+		ImGui::Text("Steps: %llu, dropped: %.2f s", static_cast<unsigned long long>(s_pData->simulationStepCount), s_pData->droppedTime);
+	}
+	ImGui::End();
+}
+
 static void updateGame()
 {
+	// Rendering also runs jobs, so the benchmark waits for the render thread to have nothing left to do.
+	if (PkJobSystem::IsBenchmarkRequested())
+	{
+		PkGraphics::WaitForRenderThread();
+		PkJobSystem::RunBenchmark();
+
+		// The time the benchmark took isn't simulated.
+		s_pData->currentTime = std::chrono::high_resolution_clock::now();
+	}
+
+	PkGraphics::BeginFrame();
+
 	PkGraphics::BeginImguiFrame();
 	{
 		s_pData->lastTime = s_pData->currentTime;
@@ -34,8 +93,17 @@ static void updateGame()
 
 		glfwPollEvents();
 
+		// Fast frames run no steps at all and just draw further between the last two.
+		s_pData->accumulatedTime += dt;
+		simulateGame();
+
 		//ImGui::ShowDemoWindow();
-		pkCamera_Update(dt);
+		const float interpolation = s_pData->accumulatedTime / SIMULATION_STEP_TIME;
+		pkCamera_Update(interpolation);
+		PkGraphics::UpdateScene(interpolation);
+		showSimulationUi();
+		PkGraphics::ShowDebugUi();
+		PkJobSystem::ShowDebugUi();
 	}
 	PkGraphics::EndImguiFrame();
 
@@ -49,16 +117,19 @@ static void initialiseGame()
 	char windowName[128];
 	sprintf_s(windowName, "%s version %d.%d.%d", GAME_NAME, VERSION_MAJOR_NUMBER, VERSION_MINOR_NUMBER, VERSION_PATCH_NUMBER);
 
-	s_pData->currentTime = std::chrono::high_resolution_clock::now();
-
 	glfwInit();
 
+	PkJobSystem::InitialiseJobSystem();
 	PkGraphics::InitialiseGraphics(windowName);
+
+	// Started last, so the first frame doesn't try to catch up on the time spent loading.
+	s_pData->currentTime = std::chrono::high_resolution_clock::now();
 }
 
 static void cleanupGame()
 {
 	PkGraphics::CleanupGraphics();
+	PkJobSystem::CleanupJobSystem();
 
 	glfwTerminate();
 
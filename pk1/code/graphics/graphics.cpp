@@ -1,118 +1,154 @@
 #include "graphics.h"
 
 #include "graphics/graphicsCore.h"
+#include "graphics/graphicsFrameSync.h"
+#include "graphics/graphicsLatency.h"
+#include "graphics/graphicsLayoutCache.h"
+#include "graphics/graphicsPipelineLibrary.h"
+#include "graphics/graphicsRenderGraph.h"
 #include "graphics/graphicsRenderPassImgui.h"
 #include "graphics/graphicsRenderPassScene.h"
+#include "graphics/graphicsRenderThread.h"
+#include "graphics/graphicsShaders.h"
 #include "graphics/graphicsSwapChain.h"
 
+#include "imgui/imgui.h"
+
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include <iostream>
 #include <vector>
 
-#define MAX_FRAMES_IN_FLIGHT 2
+// Set to 0 to render each frame on the game thread as it is submitted.
+#define RENDER_THREAD_ENABLED 1
 
 struct PkGraphicsData
 {
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
-    size_t currentFrame = 0;
+    bool bPipelineCacheReported = false;
+
+    // Game thread only: the packet being filled between BeginFrame and RenderAndPresentFrame.
+    PkGraphicsFramePacket* pPacket = nullptr;
 };
 
 static PkGraphicsData* s_pData = nullptr;
 
-static void onSwapChainCreate()
+static void createRenderGraph()
 {
-    PkGraphicsRenderPassScene::OnSwapChainCreate();
-    PkGraphicsRenderPassImgui::OnSwapChainCreate();
+    PkGraphicsRenderPassScene::AddRenderGraphPasses();
+    PkGraphicsRenderGraph::Compile();
+    PkGraphicsRenderPassScene::OnRenderGraphCompiled();
 }
 
-static void onSwapChainDestroy()
+static void destroyRenderGraph()
 {
-    PkGraphicsRenderPassImgui::OnSwapChainDestroy();
-    PkGraphicsRenderPassScene::OnSwapChainDestroy();
+    PkGraphicsRenderPassScene::OnRenderGraphDestroy();
+    PkGraphicsRenderGraph::Reset();
 }
 
-static void getCommandBuffers(uint32_t imageIndex, std::vector<VkCommandBuffer>& buffers)
+static void recreateSwapChain()
 {
-    buffers.resize(2);
-    buffers[0] = PkGraphicsRenderPassScene::GetCommandBuffer(imageIndex);
-    buffers[1] = PkGraphicsRenderPassImgui::GetCommandBuffer(imageIndex);
-}
+    // The game thread doesn't send frames while the window is minimised, so this only happens as it closes.
+    const VkExtent2D framebufferExtent = PkGraphicsCore::GetFramebufferExtent();
+    if (framebufferExtent.width == 0 || framebufferExtent.height == 0)
+    {
+        return;
+    }
 
-void createSyncObjects()
-{
-    s_pData->imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    s_pData->renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    s_pData->inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    s_pData->imagesInFlight.resize(PkGraphicsSwapChain::GetNumSwapChainImages(), VK_NULL_HANDLE);
+    // Only the frames already submitted need to finish; presents to the old swap chain can carry on while it is retired.
+    PkGraphicsFrameSync::WaitForAllFrames();
+
+    destroyRenderGraph();
 
-    VkSemaphoreCreateInfo semaphoreInfo{};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    const uint32_t oldImageCount = PkGraphicsSwapChain::GetNumSwapChainImages();
+    const VkFormat oldImageFormat = PkGraphicsSwapChain::GetSwapChainImageFormat();
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    PkGraphicsSwapChain::RecreateGraphicsSwapChain(PkGraphicsFrameSync::GetFrameNumber());
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    // A plain resize keeps pipelines, descriptor sets and per-image buffers; only the size-dependent images are rebuilt.
+    const bool bImageCountChanged = PkGraphicsSwapChain::GetNumSwapChainImages() != oldImageCount;
+    const bool bFormatChanged = PkGraphicsSwapChain::GetSwapChainImageFormat() != oldImageFormat;
+
+    if (bImageCountChanged)
     {
-        if (vkCreateSemaphore(PkGraphicsCore::GetDevice(), &semaphoreInfo, nullptr, &s_pData->imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(PkGraphicsCore::GetDevice(), &semaphoreInfo, nullptr, &s_pData->renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(PkGraphicsCore::GetDevice(), &fenceInfo, nullptr, &s_pData->inFlightFences[i]) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to create synchronization objects for a frame!");
-        }
+        PkGraphicsRenderGraph::OnSwapChainDestroy();
+        PkGraphicsRenderPassScene::OnSwapChainImagesDestroy();
+        PkGraphicsRenderPassScene::OnSwapChainImagesCreate();
+        PkGraphicsRenderGraph::OnSwapChainCreate();
     }
-}
 
-void destroySyncObjects()
-{
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    // The UI is drawn into the scene's render pass or rendering scope, so its pipeline follows the new format too.
+    if (bFormatChanged)
     {
-        vkDestroySemaphore(PkGraphicsCore::GetDevice(), s_pData->renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(PkGraphicsCore::GetDevice(), s_pData->imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(PkGraphicsCore::GetDevice(), s_pData->inFlightFences[i], nullptr);
+        PkGraphicsRenderPassScene::OnSwapChainFormatDestroy();
+        PkGraphicsRenderPassScene::OnSwapChainFormatCreate();
+        PkGraphicsRenderPassImgui::SetTarget(PkGraphicsRenderPassScene::GetUiTarget());
     }
+
+    PkGraphicsFrameSync::OnSwapChainCreate(PkGraphicsSwapChain::GetNumSwapChainImages());
+
+    createRenderGraph();
 }
 
-static void recreateSwapChain()
+static void applyFramePacket(const PkGraphicsFramePacket& rPacket)
 {
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(PkGraphicsCore::GetWindow(), &width, &height);
-
-    while (width == 0 || height == 0)
+    // Settings changed by the game thread go first, so the frame they were made in is the first to show them.
+    for (const PkGraphicsCommand& rCommand : rPacket.commands)
     {
-        glfwGetFramebufferSize(PkGraphicsCore::GetWindow(), &width, &height);
-        glfwWaitEvents();
+        rCommand();
     }
 
-    vkDeviceWaitIdle(PkGraphicsCore::GetDevice());
+    PkGraphicsCore::SetFramebufferExtent(rPacket.framebufferExtent);
+    PkGraphicsCore::SetViewMatrix(rPacket.viewMatrix);
+    PkGraphicsCore::SetFieldOfView(rPacket.fieldOfView);
+    PkGraphicsRenderPassImgui::SetDrawData(rPacket.uiDrawData);
 
+    for (uint32_t i = 0; i < rPacket.simulationStepCount; i++)
     {
-        onSwapChainDestroy();
-        PkGraphicsSwapChain::CleanupGraphicsSwapChain();
+        PkGraphicsRenderPassScene::Simulate(rPacket.simulationStepTime);
     }
+    PkGraphicsRenderPassScene::Update(rPacket.interpolation);
 
-    {
-        PkGraphicsSwapChain::InitialiseGraphicsSwapChain();
-        onSwapChainCreate();
-    }
+    // The camera is final, so culling can run while this thread waits for a free frame.
+    PkGraphicsRenderPassScene::BeginCulling();
 }
 
-/*static*/ bool PkGraphics::WindowShouldClose()
+static void renderFrame(const PkGraphicsFramePacket& rPacket)
 {
-    return glfwWindowShouldClose(PkGraphicsCore::GetWindow());
-}
+    applyFramePacket(rPacket);
+    PkGraphicsFrameSync::ApplyFramesInFlight();
 
-/*static*/ void PkGraphics::RenderAndPresentFrame()
-{
-    vkWaitForFences(PkGraphicsCore::GetDevice(), 1, &s_pData->inFlightFences[s_pData->currentFrame], VK_TRUE, UINT64_MAX);
+    PkGraphicsFrameSync::BeginFrame();
+
+    PkGraphicsLatency::SetInputTime(rPacket.inputTime);
+
+    const uint64_t frameNumber = PkGraphicsFrameSync::GetFrameNumber();
+    const uint32_t framesInFlight = PkGraphicsFrameSync::GetFramesInFlight();
+
+    PkGraphicsLatency::Update();
+
+    // Pipelines retired on a frame were last used by the frame before it, which the GPU reports on exactly.
+    PkGraphicsPipelineLibrary::DestroyRetiredPipelines(PkGraphicsFrameSync::GetCompletedFrameCount());
+
+    // Core Vulkan can't wait on a present, so for a swap chain it is a judgement: every frame slot has since been
+    // rendered and presented on its replacement.
+    if (frameNumber > framesInFlight)
+    {
+        PkGraphicsSwapChain::DestroyRetiredSwapChains(frameNumber - framesInFlight - 1);
+    }
+
+    // Edited shaders are rebuilt in the background; the pipelines using them are swapped in once they are ready.
+    PkGraphicsPipelineLibrary::Reload(PkGraphicsShaders::PollChangedSources());
+    PkGraphicsPipelineLibrary::PromoteReloadedPipelines(frameNumber);
+
+    // A minimised window has nothing to present to; the packet has still moved the scene on.
+    if (rPacket.framebufferExtent.width == 0 || rPacket.framebufferExtent.height == 0)
+    {
+        return;
+    }
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(PkGraphicsCore::GetDevice(), PkGraphicsSwapChain::GetSwapChain(), UINT64_MAX, s_pData->imageAvailableSemaphores[s_pData->currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = vkAcquireNextImageKHR(PkGraphicsCore::GetDevice(), PkGraphicsSwapChain::GetSwapChain(), UINT64_MAX, PkGraphicsFrameSync::GetImageAvailableSemaphore(), VK_NULL_HANDLE, &imageIndex);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
@@ -124,38 +160,40 @@ static void recreateSwapChain()
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
-    PkGraphicsRenderPassScene::UpdateResourceDescriptors(imageIndex);
+    PkGraphicsFrameSync::BeginImage(imageIndex);
 
-    if (s_pData->imagesInFlight[imageIndex] != VK_NULL_HANDLE)
-    {
-        vkWaitForFences(PkGraphicsCore::GetDevice(), 1, &s_pData->imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    s_pData->imagesInFlight[imageIndex] = s_pData->inFlightFences[s_pData->currentFrame];
+    // Per-image buffers may only be rewritten once the last frame that used this image has finished.
+    PkGraphicsRenderPassScene::UpdateResourceDescriptors(imageIndex);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = { s_pData->imageAvailableSemaphores[s_pData->currentFrame] };
+    VkSemaphore waitSemaphores[] = { PkGraphicsFrameSync::GetImageAvailableSemaphore() };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
     submitInfo.waitSemaphoreCount = 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    std::vector<VkCommandBuffer> buffers;
-    getCommandBuffers(imageIndex, buffers);
-    submitInfo.commandBufferCount = static_cast<uint32_t>(buffers.size());
-    submitInfo.pCommandBuffers = buffers.data();
+    PkGraphicsRenderPassScene::PrepareFrame(imageIndex);
+    VkCommandBuffer commandBuffer = PkGraphicsRenderGraph::Execute(imageIndex);
+
+    // Pipelines compile in the background, so the cache is only reported once the startup ones have all finished.
+    if (!s_pData->bPipelineCacheReported && PkGraphicsPipelineLibrary::GetPendingCount() == 0)
+    {
+        PkGraphicsCore::ReportPipelineCacheStats();
+        s_pData->bPipelineCacheReported = true;
+    }
+
+    VkCommandBuffer commandBuffers[] = { PkGraphicsLatency::GetFrameStartCommandBuffer(), commandBuffer, PkGraphicsLatency::GetFrameEndCommandBuffer() };
+    submitInfo.commandBufferCount = 3;
+    submitInfo.pCommandBuffers = commandBuffers;
 
-    VkSemaphore signalSemaphores[] = { s_pData->renderFinishedSemaphores[s_pData->currentFrame] };
+    VkSemaphore signalSemaphores[] = { PkGraphicsFrameSync::GetRenderFinishedSemaphore() };
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(PkGraphicsCore::GetDevice(), 1, &s_pData->inFlightFences[s_pData->currentFrame]);
-
-    if (vkQueueSubmit(PkGraphicsCore::GetGraphicsQueue(), 1, &submitInfo, s_pData->inFlightFences[s_pData->currentFrame]) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to submit draw command buffer!");
-    }
+    PkGraphicsFrameSync::Submit(PkGraphicsCore::GetGraphicsQueue(), submitInfo);
+    PkGraphicsLatency::OnSubmit();
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -169,9 +207,27 @@ static void recreateSwapChain()
 
     presentInfo.pImageIndices = &imageIndex;
 
+    const uint64_t presentIdValue = PkGraphicsLatency::GetPresentId();
+
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    presentId.pPresentIds = &presentIdValue;
+
+    if (PkGraphicsCore::IsPresentWaitEnabled())
+    {
+        presentInfo.pNext = &presentId;
+    }
+
     result = vkQueuePresentKHR(PkGraphicsCore::GetPresentQueue(), &presentInfo);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || PkGraphicsCore::HasWindowBeenResized())
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+    {
+        PkGraphicsLatency::OnPresent(swapChains[0]);
+    }
+
+    // Present mode and image count changes from the debug UI are also applied by recreating the swap chain.
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || PkGraphicsCore::HasWindowBeenResized() || PkGraphicsSwapChain::IsRecreationRequested())
     {
         PkGraphicsCore::ResetWindowResizedFlag();
         recreateSwapChain();
@@ -181,7 +237,69 @@ static void recreateSwapChain()
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    s_pData->currentFrame = (s_pData->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    PkGraphicsFrameSync::EndFrame();
+
+    // In low-latency mode the game thread waits for this to return before it samples input for the next packet.
+    PkGraphicsLatency::SleepBeforeInput();
+}
+
+// Runs on the render thread. The debug UI only ever sees renderer state through what is captured here.
+static void renderFramePacket(PkGraphicsFramePacket& rPacket)
+{
+    renderFrame(rPacket);
+
+    // A minimised or out-of-date frame returns before PrepareFrame has waited for its culling jobs.
+    PkGraphicsRenderPassScene::FinishCulling();
+
+    PkGraphicsDebugState& rState = rPacket.debugState;
+    PkGraphicsFrameSync::GetDebugState(rState.frameSync);
+    PkGraphicsLatency::GetDebugState(rState.latency);
+    PkGraphicsRenderGraph::GetDebugState(rState.renderGraph);
+    PkGraphicsRenderPassScene::GetDebugState(rState.scene);
+}
+
+/*static*/ bool PkGraphics::WindowShouldClose()
+{
+    return glfwWindowShouldClose(PkGraphicsCore::GetWindow());
+}
+
+/*static*/ void PkGraphics::BeginFrame()
+{
+    PkGraphicsFramePacket& rPacket = PkGraphicsRenderThread::AcquirePacket(PkGraphicsLatency::IsSleepEnabled());
+
+    // The render thread ran the last commands sent in this packet before rendering it.
+    rPacket.commands.clear();
+
+    // GLFW may only be used on this thread, so the window size is sampled here for the renderer. A minimised window
+    // has nothing to render to, so this waits until it is restored.
+    GLFWwindow* pWindow = PkGraphicsCore::GetWindow();
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(pWindow, &width, &height);
+
+    while ((width == 0 || height == 0) && !glfwWindowShouldClose(pWindow))
+    {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(pWindow, &width, &height);
+    }
+
+    rPacket.inputTime = std::chrono::high_resolution_clock::now();
+    rPacket.framebufferExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    rPacket.simulationStepCount = 0;
+    rPacket.simulationStepTime = 0.0f;
+    rPacket.interpolation = 0.0f;
+
+    s_pData->pPacket = &rPacket;
+}
+
+/*static*/ void PkGraphics::RenderAndPresentFrame()
+{
+    PkGraphicsRenderThread::SubmitPacket();
+    s_pData->pPacket = nullptr;
+}
+
+/*static*/ void PkGraphics::WaitForRenderThread()
+{
+    PkGraphicsRenderThread::WaitUntilIdle();
 }
 
 /*static*/ void PkGraphics::BeginImguiFrame()
@@ -192,16 +310,60 @@ static void recreateSwapChain()
 /*static*/ void PkGraphics::EndImguiFrame()
 {
     PkGraphicsRenderPassImgui::EndImguiFrame();
+    PkGraphicsRenderPassImgui::CopyDrawData(s_pData->pPacket->uiDrawData);
+}
+
+/*static*/ void PkGraphics::SimulateScene(const float stepTime)
+{
+    s_pData->pPacket->simulationStepCount++;
+    s_pData->pPacket->simulationStepTime = stepTime;
+}
+
+/*static*/ void PkGraphics::UpdateScene(const float interpolation)
+{
+    s_pData->pPacket->interpolation = interpolation;
+}
+
+/*static*/ void PkGraphics::ShowDebugUi()
+{
+    // Renderer state is read from what the render thread captured in this packet last time it had it, and changes
+    // are sent back as commands in it. The remaining modules guard their own state.
+    const PkGraphicsDebugState& rState = s_pData->pPacket->debugState;
+    PkGraphicsCommandList& rCommands = s_pData->pPacket->commands;
+
+    if (ImGui::Begin("Graphics"))
+    {
+        ImGui::Text("Rendering with %s", PkGraphicsCore::IsDynamicRenderingEnabled() ? "VK_KHR_dynamic_rendering" : "render pass objects");
+        ImGui::Text("Latency: %.1f ms", rState.latency.latencyMilliseconds);
+        PkGraphicsRenderThread::ShowDebugUi();
+        PkGraphicsFrameSync::ShowDebugUi(rState.frameSync, rCommands);
+        PkGraphicsLatency::ShowDebugUi(rState.latency, rCommands);
+        PkGraphicsRenderPassScene::ShowDebugUi(rState.scene, rCommands);
+        PkGraphicsRenderGraph::ShowDebugUi(rState.renderGraph);
+        PkGraphicsPipelineLibrary::ShowDebugUi();
+        PkGraphicsShaders::ShowDebugUi();
+        PkGraphicsLayoutCache::ShowDebugUi();
+
+        if (ImGui::CollapsingHeader("Pipeline cache"))
+        {
+            const PkGraphicsPipelineCacheStats& rStats = PkGraphicsCore::GetPipelineCacheStats();
+
+            ImGui::Text("Startup: %s, %u bytes in %.2f ms", rStats.pLoadStatus, static_cast<uint32_t>(rStats.loadedBytes), rStats.loadMilliseconds);
+            ImGui::Text("Pipelines: %u in %.2f ms", rStats.pipelinesCreated, rStats.creationMilliseconds);
+            ImGui::Text("Hits: %u, misses: %u, unreported: %u", rStats.hits, rStats.misses, rStats.unreported);
+        }
+    }
+    ImGui::End();
 }
 
 /*static*/ void PkGraphics::SetViewMatrix(const glm::mat4& rMat)
 {
-    PkGraphicsCore::SetViewMatrix(rMat);
+    s_pData->pPacket->viewMatrix = rMat;
 }
 
 /*static*/ void PkGraphics::SetFieldOfView(const float fov)
 {
-    PkGraphicsCore::SetFieldOfView(fov);
+    s_pData->pPacket->fieldOfView = fov;
 }
 
 /*static*/ void PkGraphics::InitialiseGraphics(const char* pWindowName)
@@ -210,21 +372,41 @@ static void recreateSwapChain()
 
     PkGraphicsCore::InitialiseGraphicsCore(pWindowName);
     PkGraphicsSwapChain::InitialiseGraphicsSwapChain();
+    PkGraphicsShaders::InitialiseGraphicsShaders();
+    PkGraphicsLayoutCache::InitialiseGraphicsLayoutCache();
+    PkGraphicsPipelineLibrary::InitialiseGraphicsPipelineLibrary();
 
     PkGraphicsRenderPassScene::InitialiseGraphicsRenderPassScene();
-    PkGraphicsRenderPassImgui::InitialiseGraphicsRenderPassImgui();
+    PkGraphicsRenderPassImgui::InitialiseGraphicsRenderPassImgui(PkGraphicsRenderPassScene::GetUiTarget());
+
+    PkGraphicsRenderGraph::InitialiseGraphicsRenderGraph();
+    PkGraphicsRenderGraph::OnSwapChainCreate();
+    createRenderGraph();
 
-    createSyncObjects();
+    PkGraphicsFrameSync::InitialiseGraphicsFrameSync(PkGraphicsSwapChain::GetNumSwapChainImages());
+    PkGraphicsLatency::InitialiseGraphicsLatency();
+
+    PkGraphicsRenderThread::InitialiseGraphicsRenderThread(RENDER_THREAD_ENABLED != 0, renderFramePacket);
 }
 
 /*static*/ void PkGraphics::CleanupGraphics()
 {
+    PkGraphicsRenderThread::CleanupGraphicsRenderThread();
+
     vkDeviceWaitIdle(PkGraphicsCore::GetDevice());
 
-    destroySyncObjects();
+    PkGraphicsLatency::CleanupGraphicsLatency();
+    PkGraphicsFrameSync::CleanupGraphicsFrameSync();
+
+    destroyRenderGraph();
+    PkGraphicsRenderGraph::OnSwapChainDestroy();
+    PkGraphicsRenderGraph::CleanupGraphicsRenderGraph();
 
     PkGraphicsRenderPassImgui::CleanupGraphicsRenderPassImgui();
     PkGraphicsRenderPassScene::CleanupGraphicsRenderPassScene();
+    PkGraphicsPipelineLibrary::CleanupGraphicsPipelineLibrary();
+    PkGraphicsLayoutCache::CleanupGraphicsLayoutCache();
+    PkGraphicsShaders::CleanupGraphicsShaders();
 
     PkGraphicsSwapChain::CleanupGraphicsSwapChain();
     PkGraphicsCore::CleanupGraphicsCore();
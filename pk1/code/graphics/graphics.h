@@ -9,11 +9,24 @@ public:
     PkGraphics() = delete;
 
     static bool WindowShouldClose();
+
+    // Frames are built between these and rendered on the render thread while the next is built. Call BeginFrame just
+    // before sampling input; in low-latency mode it holds the game back so the frame isn't queued behind others.
+    static void BeginFrame();
     static void RenderAndPresentFrame();
 
+    // Waits for the render thread to finish every frame sent to it; call between RenderAndPresentFrame and BeginFrame.
+    static void WaitForRenderThread();
+
+    // SimulateScene advances the scene one fixed step; UpdateScene then shows it part way between its last two steps.
+    static void SimulateScene(const float stepTime);
+    static void UpdateScene(const float interpolation);
+
     static void BeginImguiFrame();
     static void EndImguiFrame();
 
+    static void ShowDebugUi();
+
     static void SetViewMatrix(const glm::mat4& rMat);
     static void SetFieldOfView(const float fov);
 
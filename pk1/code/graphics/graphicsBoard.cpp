@@ -0,0 +1,623 @@
+#include "graphicsBoard.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsFrameSync.h"
+#include "graphics/graphicsFrustum.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include "imgui/imgui.h"
+#include "jobs/jobSystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+static const float TILE_SIZE = 1.5f;
+static const float MAX_TILE_HEIGHT = 1.0f;
+static const float CHUNK_EXTENT = TILE_SIZE * PK_BOARD_CHUNK_DIMENSIONS;
+static const float TWO_PI = 6.28318530718f;
+// A quarter of the 16-bit rotation range.
+static const uint16_t QUARTER_TURN = 16384;
+
+static const uint32_t TILES_PER_CHUNK = PK_BOARD_CHUNK_DIMENSIONS * PK_BOARD_CHUNK_DIMENSIONS;
+
+// Changed chunks copied to the GPU per frame; at 8 bytes a tile this is 512 KiB.
+static const uint32_t MAX_CHUNK_UPLOADS_PER_FRAME = 64;
+
+// Rows of the animated column worked on per job batch; below two batches the column is animated on the calling thread.
+static const uint32_t ANIMATED_ROWS_PER_BATCH = 128;
+
+static const uint32_t BOARD_SIZE_OPTIONS[] = { 0, 16, 64, 256, 1024 };
+static const char* BOARD_SIZE_NAMES[] = { "None", "16 x 16", "64 x 64", "256 x 256", "1024 x 1024" };
+
+struct PkGraphicsBoardChunk
+{
+    uint32_t firstTile = 0;
+    uint32_t columns = 0;
+    uint32_t rows = 0;
+
+    // Corner of the chunk in board space, which the quantised tile positions are relative to.
+    glm::vec3 origin = glm::vec3(0.0f);
+
+    // Board space centre in xyz, radius in w. Only the height range changes after the board is built.
+    glm::vec4 bounds = glm::vec4(0.0f);
+
+    bool bBoundsDirty = true;
+    bool bUploadPending = false;
+};
+
+struct PkGraphicsBoardStaging
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+};
+
+// A tile buffer replaced by a resize, kept until the frames before the resize have finished drawing from it.
+struct PkGraphicsRetiredTileBuffer
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    uint64_t retiredFrameNumber = 0;
+};
+
+struct PkGraphicsBoardData
+{
+    PkGraphicsModel* pModel = nullptr;
+
+    uint32_t dimensions = 0;
+    uint32_t chunksPerSide = 0;
+    glm::mat4 matrix = glm::mat4(1.0f);
+
+    // Chunk by chunk, so each chunk's tiles are one range of the buffer.
+    std::vector<PkGraphicsBoardTile> tiles;
+    std::vector<PkGraphicsBoardChunk> chunks;
+
+    VkBuffer tileBuffer = VK_NULL_HANDLE;
+    VmaAllocation tileBufferAllocation = VK_NULL_HANDLE;
+    std::vector<PkGraphicsRetiredTileBuffer> retiredTileBuffers;
+
+    // Set by SetDimensions and applied by BeginFrame on the render thread.
+    bool bResizePending = false;
+    uint32_t pendingDimensions = 0;
+
+    // The scan resumes from uploadCursor so a budget-limited frame does not starve the later chunks.
+    uint32_t uploadCursor = 0;
+    uint32_t pendingChunkCount = 0;
+    uint32_t uploadedChunkCount = 0;
+    std::vector<PkGraphicsBoardStaging> staging;
+    std::vector<VkBufferCopy> copyRegions;
+
+    // Tiles turned by something other than a whole number of quarter turns.
+    uint32_t freeRotationCount = 0;
+
+    std::vector<PkGraphicsBoardDraw> draws;
+    float lodDistance = 40.0f;
+    PkGraphicsBoardStats stats;
+
+    // Rolls a wave across the board one column of chunks per frame, to exercise chunk uploads.
+    bool bAnimate = false;
+    float animationTime = 0.0f;
+    uint32_t animatedChunkColumn = 0;
+};
+
+static PkGraphicsBoardData* s_pData = nullptr;
+
+static uint16_t quantise(const float value, const float range)
+{
+    const float normalised = std::min(std::max(value / range, 0.0f), 1.0f);
+    return static_cast<uint16_t>(std::lround(normalised * 65535.0f));
+}
+
+static uint16_t quantiseRotation(const float rotation)
+{
+    // One full turn is 65536 steps, so the angle wraps in the conversion to 16 bits.
+    return static_cast<uint16_t>(static_cast<int64_t>(std::floor(rotation / TWO_PI * 65536.0f + 0.5f)) & 0xffff);
+}
+
+static float getMaxScale(const glm::mat4& rMatrix)
+{
+    return std::sqrt(std::max({ glm::dot(glm::vec3(rMatrix[0]), glm::vec3(rMatrix[0])), glm::dot(glm::vec3(rMatrix[1]), glm::vec3(rMatrix[1])), glm::dot(glm::vec3(rMatrix[2]), glm::vec3(rMatrix[2])) }));
+}
+
+static bool isQuarterTurn(const uint16_t rotation)
+{
+    return (rotation & (QUARTER_TURN - 1)) == 0;
+}
+
+static PkGraphicsBoardTile& getTile(const uint32_t x, const uint32_t y)
+{
+    const PkGraphicsBoardChunk& rChunk = s_pData->chunks[(y / PK_BOARD_CHUNK_DIMENSIONS) * s_pData->chunksPerSide + x / PK_BOARD_CHUNK_DIMENSIONS];
+    return s_pData->tiles[rChunk.firstTile + (y % PK_BOARD_CHUNK_DIMENSIONS) * rChunk.columns + x % PK_BOARD_CHUNK_DIMENSIONS];
+}
+
+static void markChunkDirty(PkGraphicsBoardChunk& rChunk)
+{
+    rChunk.bBoundsDirty = true;
+
+    if (!rChunk.bUploadPending)
+    {
+        rChunk.bUploadPending = true;
+        s_pData->pendingChunkCount++;
+    }
+}
+
+static void updateChunkBounds(PkGraphicsBoardChunk& rChunk)
+{
+    uint16_t minHeight = 0xffff;
+    uint16_t maxHeight = 0;
+
+    for (uint32_t i = 0; i < rChunk.columns * rChunk.rows; i++)
+    {
+        minHeight = std::min(minHeight, s_pData->tiles[rChunk.firstTile + i].height);
+        maxHeight = std::max(maxHeight, s_pData->tiles[rChunk.firstTile + i].height);
+    }
+
+    const glm::vec3 halfExtent = glm::vec3(rChunk.columns * TILE_SIZE, rChunk.rows * TILE_SIZE, (maxHeight - minHeight) * MAX_TILE_HEIGHT / 65535.0f) * 0.5f;
+    const glm::vec3 centre = rChunk.origin + glm::vec3(halfExtent.x, halfExtent.y, minHeight * MAX_TILE_HEIGHT / 65535.0f + halfExtent.z);
+
+    // Tiles turn about their centre, so any rotation of the mesh's sphere stays within its offset plus its radius.
+    const glm::vec4& rMeshBounds = s_pData->pModel->GetBoundingSphere();
+    const float meshRadius = glm::length(glm::vec3(rMeshBounds)) + rMeshBounds.w;
+
+    rChunk.bounds = glm::vec4(centre, glm::length(halfExtent) + meshRadius);
+    rChunk.bBoundsDirty = false;
+}
+
+static void createStagingBuffers()
+{
+    s_pData->staging.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+
+    for (PkGraphicsBoardStaging& rStaging : s_pData->staging)
+    {
+        PkGraphicsUtils::CreateBuffer
+        (
+            PkGraphicsCore::GetAllocator(),
+            sizeof(PkGraphicsBoardTile) * TILES_PER_CHUNK * MAX_CHUNK_UPLOADS_PER_FRAME,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &rStaging.buffer,
+            &rStaging.allocation
+        );
+    }
+}
+
+static void destroyStagingBuffers()
+{
+    for (PkGraphicsBoardStaging& rStaging : s_pData->staging)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rStaging.buffer, rStaging.allocation);
+    }
+
+    s_pData->staging.clear();
+}
+
+static void destroyTileBuffer()
+{
+    if (s_pData->tileBuffer != VK_NULL_HANDLE)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->tileBuffer, s_pData->tileBufferAllocation);
+        s_pData->tileBuffer = VK_NULL_HANDLE;
+    }
+}
+
+// The frame being recorded draws from the new buffer, so the old one was last used by the frame before it.
+static void retireTileBuffer(const uint64_t frameNumber)
+{
+    if (s_pData->tileBuffer != VK_NULL_HANDLE)
+    {
+        s_pData->retiredTileBuffers.push_back(PkGraphicsRetiredTileBuffer{ s_pData->tileBuffer, s_pData->tileBufferAllocation, frameNumber });
+        s_pData->tileBuffer = VK_NULL_HANDLE;
+    }
+}
+
+static void destroyRetiredTileBuffers(const uint64_t completedFrameNumber)
+{
+    auto it = s_pData->retiredTileBuffers.begin();
+
+    while (it != s_pData->retiredTileBuffers.end())
+    {
+        if (it->retiredFrameNumber <= completedFrameNumber)
+        {
+            vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), it->buffer, it->allocation);
+            it = s_pData->retiredTileBuffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+static void createBoard(const uint32_t dimensions)
+{
+    s_pData->dimensions = dimensions;
+    s_pData->chunksPerSide = (dimensions + PK_BOARD_CHUNK_DIMENSIONS - 1) / PK_BOARD_CHUNK_DIMENSIONS;
+    s_pData->chunks.assign(s_pData->chunksPerSide * s_pData->chunksPerSide, PkGraphicsBoardChunk());
+    s_pData->tiles.resize(dimensions * dimensions);
+    s_pData->uploadCursor = 0;
+    s_pData->pendingChunkCount = 0;
+    s_pData->animatedChunkColumn = 0;
+    s_pData->freeRotationCount = 0;
+    s_pData->draws.clear();
+
+    // Centred on the board's origin like a model's board, so tile (x, y) sits at TILE_SIZE * x - boardOffset.
+    const float boardOffset = TILE_SIZE * (static_cast<float>(dimensions) - 1.0f) * 0.5f;
+
+    uint32_t firstTile = 0;
+
+    for (uint32_t chunkY = 0; chunkY < s_pData->chunksPerSide; chunkY++)
+    {
+        for (uint32_t chunkX = 0; chunkX < s_pData->chunksPerSide; chunkX++)
+        {
+            PkGraphicsBoardChunk& rChunk = s_pData->chunks[chunkY * s_pData->chunksPerSide + chunkX];
+            rChunk.firstTile = firstTile;
+            rChunk.columns = std::min(PK_BOARD_CHUNK_DIMENSIONS, dimensions - chunkX * PK_BOARD_CHUNK_DIMENSIONS);
+            rChunk.rows = std::min(PK_BOARD_CHUNK_DIMENSIONS, dimensions - chunkY * PK_BOARD_CHUNK_DIMENSIONS);
+            rChunk.origin = glm::vec3(CHUNK_EXTENT * chunkX - boardOffset - TILE_SIZE * 0.5f, CHUNK_EXTENT * chunkY - boardOffset - TILE_SIZE * 0.5f, 0.0f);
+
+            firstTile += rChunk.columns * rChunk.rows;
+        }
+    }
+
+    for (uint32_t y = 0; y < dimensions; y++)
+    {
+        for (uint32_t x = 0; x < dimensions; x++)
+        {
+            PkGraphicsBoardTile& rTile = getTile(x, y);
+            rTile.x = quantise(((x % PK_BOARD_CHUNK_DIMENSIONS) + 0.5f) * TILE_SIZE, CHUNK_EXTENT);
+            rTile.y = quantise(((y % PK_BOARD_CHUNK_DIMENSIONS) + 0.5f) * TILE_SIZE, CHUNK_EXTENT);
+            rTile.height = 0;
+            // Each tile turned a quarter more than the last, as on a model's board.
+            rTile.rotation = static_cast<uint16_t>(((y * dimensions + x) % 4) * QUARTER_TURN);
+        }
+    }
+
+    if (!s_pData->tiles.empty())
+    {
+        PkGraphicsUtils::CreateDeviceLocalBuffer
+        (
+            PkGraphicsCore::GetDevice(),
+            PkGraphicsCore::GetAllocator(),
+            PkGraphicsCore::GetGraphicsQueue(),
+            PkGraphicsCore::GetCommandPool(),
+            s_pData->tiles.data(),
+            sizeof(PkGraphicsBoardTile) * s_pData->tiles.size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            &s_pData->tileBuffer,
+            &s_pData->tileBufferAllocation
+        );
+    }
+}
+
+static void animateBoard(const float deltaTime)
+{
+    if (s_pData->chunksPerSide == 0)
+    {
+        return;
+    }
+
+    s_pData->animationTime += deltaTime;
+
+    const uint32_t firstX = s_pData->animatedChunkColumn * PK_BOARD_CHUNK_DIMENSIONS;
+    const uint32_t endX = std::min(firstX + PK_BOARD_CHUNK_DIMENSIONS, s_pData->dimensions);
+
+    const float animationTime = s_pData->animationTime;
+
+    // Rows are independent, so large boards split them between workers.
+    PkJobSystem::ParallelFor(s_pData->dimensions, ANIMATED_ROWS_PER_BATCH, [firstX, endX, animationTime](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            for (uint32_t x = firstX; x < endX; x++)
+            {
+                const float wave = 0.5f + 0.5f * std::sin(animationTime * 2.0f + (x + y) * 0.1f);
+                getTile(x, y).height = quantise(wave * MAX_TILE_HEIGHT, MAX_TILE_HEIGHT);
+            }
+        }
+    });
+
+    for (uint32_t chunkY = 0; chunkY < s_pData->chunksPerSide; chunkY++)
+    {
+        markChunkDirty(s_pData->chunks[chunkY * s_pData->chunksPerSide + s_pData->animatedChunkColumn]);
+    }
+
+    s_pData->animatedChunkColumn = (s_pData->animatedChunkColumn + 1) % s_pData->chunksPerSide;
+}
+
+/*static*/ void PkGraphicsBoard::SetDimensions(const uint32_t dimensions)
+{
+    if (dimensions > PK_BOARD_MAX_DIMENSIONS)
+    {
+        throw std::runtime_error("board dimensions too large!");
+    }
+
+    s_pData->pendingDimensions = dimensions;
+    s_pData->bResizePending = true;
+}
+
+/*static*/ uint32_t PkGraphicsBoard::GetDimensions()
+{
+    return s_pData->dimensions;
+}
+
+/*static*/ void PkGraphicsBoard::SetMatrix(const glm::mat4& rMatrix)
+{
+    s_pData->matrix = rMatrix;
+}
+
+/*static*/ void PkGraphicsBoard::SetTile(const uint32_t x, const uint32_t y, const float height, const float rotation)
+{
+    PkGraphicsBoardTile& rTile = getTile(x, y);
+    const uint16_t quantisedRotation = quantiseRotation(rotation);
+
+    s_pData->freeRotationCount -= isQuarterTurn(rTile.rotation) ? 0 : 1;
+    s_pData->freeRotationCount += isQuarterTurn(quantisedRotation) ? 0 : 1;
+
+    rTile.height = quantise(height, MAX_TILE_HEIGHT);
+    rTile.rotation = quantisedRotation;
+
+    markChunkDirty(s_pData->chunks[(y / PK_BOARD_CHUNK_DIMENSIONS) * s_pData->chunksPerSide + x / PK_BOARD_CHUNK_DIMENSIONS]);
+}
+
+/*static*/ PkGraphicsBoardTileRotation PkGraphicsBoard::GetTileRotation()
+{
+    return s_pData->freeRotationCount == 0 ? PK_BOARD_TILE_ROTATION_QUARTER_TURNS : PK_BOARD_TILE_ROTATION_ANY;
+}
+
+/*static*/ std::vector<PkGraphicsVertexStream> PkGraphicsBoard::GetVertexStreams()
+{
+    return {
+        PkGraphicsVertexLayout::GetStream<Vertex>(VK_VERTEX_INPUT_RATE_VERTEX),
+        PkGraphicsVertexLayout::GetStream<PkGraphicsBoardTile>(VK_VERTEX_INPUT_RATE_INSTANCE)
+    };
+}
+
+/*static*/ void PkGraphicsBoard::Cull(const glm::mat4& rViewProjection, const glm::vec3& rCameraPosition)
+{
+    s_pData->draws.clear();
+    s_pData->stats = PkGraphicsBoardStats();
+
+    const PkGraphicsFrustum frustum = PkGraphicsFrustum::FromViewProjection(rViewProjection);
+    const float scale = getMaxScale(s_pData->matrix);
+    const uint32_t lodCount = s_pData->pModel->GetLodCount();
+
+    for (PkGraphicsBoardChunk& rChunk : s_pData->chunks)
+    {
+        if (rChunk.bBoundsDirty)
+        {
+            updateChunkBounds(rChunk);
+        }
+
+        const glm::vec3 centre = glm::vec3(s_pData->matrix * glm::vec4(glm::vec3(rChunk.bounds), 1.0f));
+        const float radius = rChunk.bounds.w * scale;
+
+        if (!frustum.IsSphereVisible(centre, radius))
+        {
+            continue;
+        }
+
+        // Each level of detail covers three times the distance of the one before.
+        const float distance = std::max(glm::length(centre - rCameraPosition) - radius, 0.0f);
+        uint32_t lod = 0;
+        for (float lodEnd = s_pData->lodDistance; lod + 1 < lodCount && distance >= lodEnd; lodEnd *= 3.0f)
+        {
+            lod++;
+        }
+
+        PkGraphicsBoardDraw draw;
+        draw.constants.matrix = glm::translate(s_pData->matrix, rChunk.origin);
+        draw.constants.dequantise = glm::vec4(CHUNK_EXTENT, CHUNK_EXTENT, MAX_TILE_HEIGHT, TWO_PI * 65535.0f / 65536.0f);
+        draw.lod = lod;
+        draw.firstTile = rChunk.firstTile;
+        draw.tileCount = rChunk.columns * rChunk.rows;
+        s_pData->draws.push_back(draw);
+
+        s_pData->stats.visibleChunks++;
+        s_pData->stats.visibleTiles += draw.tileCount;
+        s_pData->stats.lodChunks[lod]++;
+    }
+}
+
+/*static*/ const std::vector<PkGraphicsBoardDraw>& PkGraphicsBoard::GetDraws()
+{
+    return s_pData->draws;
+}
+
+/*static*/ const PkGraphicsModel* PkGraphicsBoard::GetModel()
+{
+    return s_pData->pModel;
+}
+
+/*static*/ VkBuffer PkGraphicsBoard::GetTileBuffer()
+{
+    return s_pData->tileBuffer;
+}
+
+/*static*/ void PkGraphicsBoard::BeginFrame()
+{
+    const uint64_t frameNumber = PkGraphicsFrameSync::GetFrameNumber();
+
+    if (s_pData->bResizePending)
+    {
+        retireTileBuffer(frameNumber);
+        createBoard(s_pData->pendingDimensions);
+        s_pData->bResizePending = false;
+    }
+
+    destroyRetiredTileBuffers(PkGraphicsFrameSync::GetCompletedFrameCount());
+}
+
+/*static*/ void PkGraphicsBoard::RecordUpload(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+{
+    s_pData->uploadedChunkCount = 0;
+
+    if (s_pData->pendingChunkCount == 0)
+    {
+        return;
+    }
+
+    // Safe to overwrite for the same reason as the instance stream's staging; see PkGraphicsInstanceStream::RecordUpload.
+    const PkGraphicsBoardStaging& rStaging = s_pData->staging[imageIndex];
+    const VkDeviceSize stride = sizeof(PkGraphicsBoardTile);
+
+    std::vector<VkBufferCopy>& rRegions = s_pData->copyRegions;
+    rRegions.clear();
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), rStaging.allocation, &data);
+
+    const uint32_t chunkCount = static_cast<uint32_t>(s_pData->chunks.size());
+    VkDeviceSize stagedSize = 0;
+    uint32_t chunkIndex = s_pData->uploadCursor;
+
+    for (uint32_t visited = 0; visited < chunkCount && s_pData->uploadedChunkCount < MAX_CHUNK_UPLOADS_PER_FRAME; visited++)
+    {
+        chunkIndex = (s_pData->uploadCursor + visited) % chunkCount;
+
+        PkGraphicsBoardChunk& rChunk = s_pData->chunks[chunkIndex];
+        if (!rChunk.bUploadPending)
+        {
+            continue;
+        }
+
+        rChunk.bUploadPending = false;
+
+        const VkDeviceSize size = stride * rChunk.columns * rChunk.rows;
+        const VkDeviceSize dstOffset = stride * rChunk.firstTile;
+
+        memcpy(static_cast<char*>(data) + stagedSize, &s_pData->tiles[rChunk.firstTile], static_cast<size_t>(size));
+
+        // Neighbouring chunks are neighbours in the buffer too, so a changed row of chunks is a single copy.
+        if (!rRegions.empty() && rRegions.back().dstOffset + rRegions.back().size == dstOffset)
+        {
+            rRegions.back().size += size;
+        }
+        else
+        {
+            VkBufferCopy region{};
+            region.srcOffset = stagedSize;
+            region.dstOffset = dstOffset;
+            region.size = size;
+            rRegions.push_back(region);
+        }
+
+        stagedSize += size;
+        s_pData->uploadedChunkCount++;
+    }
+
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), rStaging.allocation);
+
+    s_pData->uploadCursor = chunkIndex;
+    s_pData->pendingChunkCount -= s_pData->uploadedChunkCount;
+
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = s_pData->tileBuffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+
+    // Earlier frames may still be drawing from the buffer, so the copy waits for their reads to finish.
+    bufferBarrier.srcAccessMask = 0;
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, rStaging.buffer, s_pData->tileBuffer, static_cast<uint32_t>(rRegions.size()), rRegions.data());
+
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+/*static*/ void PkGraphicsBoard::Update(const float deltaTime)
+{
+    if (s_pData->bAnimate)
+    {
+        animateBoard(deltaTime);
+    }
+}
+
+/*static*/ void PkGraphicsBoard::GetDebugState(PkGraphicsBoardDebugState& rState)
+{
+    rState.dimensions = s_pData->bResizePending ? s_pData->pendingDimensions : s_pData->dimensions;
+    rState.lodDistance = s_pData->lodDistance;
+    rState.bAnimate = s_pData->bAnimate;
+
+    rState.tileCount = static_cast<uint32_t>(s_pData->tiles.size());
+    rState.chunkCount = static_cast<uint32_t>(s_pData->chunks.size());
+    rState.tileRotation = GetTileRotation();
+    rState.freeRotationCount = s_pData->freeRotationCount;
+    rState.stats = s_pData->stats;
+    rState.uploadedChunkCount = s_pData->uploadedChunkCount;
+    rState.pendingChunkCount = s_pData->pendingChunkCount;
+}
+
+/*static*/ void PkGraphicsBoard::ShowDebugUi(const PkGraphicsBoardDebugState& rState, PkGraphicsCommandList& rCommands)
+{
+    if (ImGui::CollapsingHeader("Board", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        int sizeOption = static_cast<int>(std::find(std::begin(BOARD_SIZE_OPTIONS), std::end(BOARD_SIZE_OPTIONS), rState.dimensions) - std::begin(BOARD_SIZE_OPTIONS));
+        if (ImGui::Combo("Size", &sizeOption, BOARD_SIZE_NAMES, IM_ARRAYSIZE(BOARD_SIZE_NAMES)))
+        {
+            const uint32_t dimensions = BOARD_SIZE_OPTIONS[sizeOption];
+            rCommands.push_back([dimensions] { SetDimensions(dimensions); });
+        }
+
+        float lodDistance = rState.lodDistance;
+        if (ImGui::SliderFloat("LOD distance", &lodDistance, 5.0f, 200.0f))
+        {
+            rCommands.push_back([lodDistance] { s_pData->lodDistance = lodDistance; });
+        }
+
+        bool bAnimate = rState.bAnimate;
+        if (ImGui::Checkbox("Animate board", &bAnimate))
+        {
+            rCommands.push_back([bAnimate] { s_pData->bAnimate = bAnimate; });
+        }
+
+        ImGui::Text("Tiles: %u in %u chunks", rState.tileCount, rState.chunkCount);
+        ImGui::Text("Rotation: %s (%u tiles off quarter turns)", rState.tileRotation == PK_BOARD_TILE_ROTATION_QUARTER_TURNS ? "quarter turns" : "any angle", rState.freeRotationCount);
+        ImGui::Text("Visible: %u tiles in %u chunks", rState.stats.visibleTiles, rState.stats.visibleChunks);
+        ImGui::Text("Chunks per LOD: %u", rState.stats.lodChunks[0]);
+        for (uint32_t lod = 1; lod < PK_MAX_MESH_LODS; lod++)
+        {
+            ImGui::SameLine();
+            ImGui::Text("/ %u", rState.stats.lodChunks[lod]);
+        }
+        ImGui::Text("Chunks uploaded: %u (%u still dirty)", rState.uploadedChunkCount, rState.pendingChunkCount);
+    }
+}
+
+/*static*/ void PkGraphicsBoard::OnSwapChainCreate()
+{
+    createStagingBuffers();
+}
+
+/*static*/ void PkGraphicsBoard::OnSwapChainDestroy()
+{
+    destroyStagingBuffers();
+}
+
+/*static*/ void PkGraphicsBoard::InitialiseGraphicsBoard(VkCommandPool commandPool, VkDescriptorSetLayout materialDescriptorSetLayout)
+{
+    s_pData = new PkGraphicsBoardData();
+
+    // Shares its mesh and material with the scene's models through the model caches; the tiles stand in for its instances.
+    s_pData->pModel = new PkGraphicsModel(commandPool, materialDescriptorSetLayout, "data/models/viking_room.obj", "data/textures/viking_room.png", 0);
+    s_pData->matrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+
+    createBoard(64);
+}
+
+/*static*/ void PkGraphicsBoard::CleanupGraphicsBoard()
+{
+    destroyRetiredTileBuffers(UINT64_MAX);
+    destroyTileBuffer();
+    delete s_pData->pModel;
+
+    delete s_pData;
+}
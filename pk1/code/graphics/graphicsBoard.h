@@ -0,0 +1,126 @@
+#pragma once
+
+#include "graphics/graphicsCommands.h"
+#include "graphics/graphicsModel.h"
+
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+static const uint32_t PK_BOARD_MAX_DIMENSIONS = 1024;
+static const uint32_t PK_BOARD_CHUNK_DIMENSIONS = 32;
+
+// One tile in 16-bit fixed point, read by board.vert as R16G16B16A16_UNORM. x and y are the tile centre relative to
+// its chunk's corner, spanning the chunk; height spans the board's height range and rotation one full turn.
+struct PkGraphicsBoardTile
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t height;
+    uint16_t rotation;
+};
+
+PK_VERTEX_LAYOUT_PACKED(PkGraphicsBoardTile, VK_FORMAT_R16G16B16A16_UNORM);
+
+// Push constants for board.vert, set once per chunk.
+struct PkGraphicsBoardChunkConstants
+{
+    glm::mat4 matrix;
+    // Chunk width, chunk depth, height range, and the angle of one rotation step times 65535.
+    glm::vec4 dequantise;
+};
+
+// How board.vert turns tiles, as its TILE_ROTATION specialization constant. Quarter turns need no sin or cos.
+enum PkGraphicsBoardTileRotation : uint32_t
+{
+    PK_BOARD_TILE_ROTATION_QUARTER_TURNS = 0,
+    PK_BOARD_TILE_ROTATION_ANY,
+    PK_BOARD_TILE_ROTATION_COUNT
+};
+
+// A visible chunk: one instanced draw of its tiles at the level of detail picked for its distance.
+struct PkGraphicsBoardDraw
+{
+    PkGraphicsBoardChunkConstants constants;
+    uint32_t lod;
+    uint32_t firstTile;
+    uint32_t tileCount;
+};
+
+struct PkGraphicsBoardStats
+{
+    uint32_t visibleChunks = 0;
+    uint32_t visibleTiles = 0;
+    uint32_t lodChunks[PK_MAX_MESH_LODS] = {};
+};
+
+struct PkGraphicsBoardDebugState
+{
+    // Includes a resize that has been queued but not yet applied.
+    uint32_t dimensions = 0;
+    float lodDistance = 0.0f;
+    bool bAnimate = false;
+
+    uint32_t tileCount = 0;
+    uint32_t chunkCount = 0;
+    PkGraphicsBoardTileRotation tileRotation = PK_BOARD_TILE_ROTATION_QUARTER_TURNS;
+    uint32_t freeRotationCount = 0;
+    PkGraphicsBoardStats stats;
+    uint32_t uploadedChunkCount = 0;
+    uint32_t pendingChunkCount = 0;
+};
+
+// A square board of tiles, all the same model, split into chunks of PK_BOARD_CHUNK_DIMENSIONS square. Each chunk owns
+// a contiguous range of the tile buffer, is culled and given a level of detail as a whole, and is uploaded again only
+// when one of its tiles changes.
+class PkGraphicsBoard
+{
+public:
+    PkGraphicsBoard() = delete;
+
+    // Rebuilds the board with dimensions x dimensions tiles, up to PK_BOARD_MAX_DIMENSIONS; 0 removes it. The render
+    // thread applies it at its next BeginFrame; until then the board, and GetDimensions, keep the old size.
+    static void SetDimensions(const uint32_t dimensions);
+    static uint32_t GetDimensions();
+
+    static void SetMatrix(const glm::mat4& rMatrix);
+
+    // Height is clamped to the board's height range; rotation is in radians.
+    static void SetTile(const uint32_t x, const uint32_t y, const float height, const float rotation);
+
+    // The cheapest rotation mode that still places every tile correctly.
+    static PkGraphicsBoardTileRotation GetTileRotation();
+
+    // Vertices, then tiles, for board.vert.
+    static std::vector<PkGraphicsVertexStream> GetVertexStreams();
+
+    // Picks the visible chunks and their level of detail for this frame.
+    static void Cull(const glm::mat4& rViewProjection, const glm::vec3& rCameraPosition);
+    static const std::vector<PkGraphicsBoardDraw>& GetDraws();
+
+    static const PkGraphicsModel* GetModel();
+    static VkBuffer GetTileBuffer();
+
+    // Applies a resize queued by SetDimensions and destroys old tile buffers once no frame in flight reads them. Call
+    // on the render thread each frame, before Cull.
+    static void BeginFrame();
+
+    // Copies changed chunks, up to a fixed number per frame, into the tile buffer. Record outside a render pass.
+    static void RecordUpload(VkCommandBuffer commandBuffer, const uint32_t imageIndex);
+
+    // Called once per simulation step. Tiles are quantised GPU data, so they show the latest step rather than blending.
+    static void Update(const float deltaTime);
+
+    // The first is called on the render thread; the second draws what it captured and queues any changes made.
+    static void GetDebugState(PkGraphicsBoardDebugState& rState);
+    static void ShowDebugUi(const PkGraphicsBoardDebugState& rState, PkGraphicsCommandList& rCommands);
+
+    static void OnSwapChainCreate();
+    static void OnSwapChainDestroy();
+
+    static void InitialiseGraphicsBoard(VkCommandPool commandPool, VkDescriptorSetLayout materialDescriptorSetLayout);
+    static void CleanupGraphicsBoard();
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+// A change to renderer state queued on the game thread, like a setting from the debug UI. Commands travel in the frame
+// packet and are run on the render thread before it renders the packet, so neither thread needs a lock to make them.
+typedef std::function<void()> PkGraphicsCommand;
+typedef std::vector<PkGraphicsCommand> PkGraphicsCommandList;
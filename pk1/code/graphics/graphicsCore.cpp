@@ -4,7 +4,12 @@
 
 #include <GLFW/glfw3.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <set>
 
 #ifdef _DEBUG
@@ -13,13 +18,37 @@
 #define VULKAN_VALIDATION_ENABLED 0
 #endif //_DEBUG
 
+// Set to 0 to keep render pass objects even on devices with VK_KHR_dynamic_rendering.
+#define DYNAMIC_RENDERING_ALLOWED 1
+
+// Set to 0 to pace frames with fences even on devices with VK_KHR_timeline_semaphore.
+#define TIMELINE_SEMAPHORE_ALLOWED 1
+
+// Set to 0 to estimate latency from GPU completion even on devices with VK_KHR_present_wait.
+#define PRESENT_WAIT_ALLOWED 1
+
 static const uint32_t WINDOW_WIDTH = 1280;
 static const uint32_t WINDOW_HEIGHT = 720;
 
+static const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+static const char* PIPELINE_CACHE_TEMP_PATH = "pipeline_cache.bin.tmp";
+
+// The header every driver writes at the start of its cache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE).
+struct PkGraphicsPipelineCacheHeader
+{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
 struct PkGraphicsCoreData
 {
     GLFWwindow* pWindow = nullptr;
-    bool windowResized = false;
+    // Set by GLFW on the main thread and cleared by whichever thread renders.
+    std::atomic<bool> windowResized{ false };
+    VkExtent2D framebufferExtent{ 0, 0 };
 
     VkInstance instance = VK_NULL_HANDLE;
     VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -27,12 +56,22 @@ struct PkGraphicsCoreData
     VkDevice device = VK_NULL_HANDLE;
     VmaAllocator allocator = VK_NULL_HANDLE;
     VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    PkGraphicsPipelineCacheStats pipelineCacheStats;
+    std::mutex pipelineCacheStatsMutex;
 
     VkQueue graphicsQueue = VK_NULL_HANDLE;
     VkQueue presentQueue = VK_NULL_HANDLE;
 
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    std::vector<const char*> enabledDeviceExtensions;
+    bool bPhysicalDeviceProperties2Enabled = false;
+    bool bDynamicRenderingEnabled = false;
+    bool bTimelineSemaphoreEnabled = false;
+    bool bPresentWaitEnabled = false;
+
     glm::mat4 viewMatrix = glm::mat4(1.0f);
     float fieldOfView = 45.0f;
     float nearViewPlane = 0.1f;
@@ -43,6 +82,23 @@ struct PkGraphicsCoreData
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    // Enabled when the device has them; callers check IsDeviceExtensionEnabled() before using them.
+    const std::vector<const char*> optionalDeviceExtensions =
+    {
+        VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+        VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME
+    };
+
+    // VK_KHR_dynamic_rendering and what it depends on under Vulkan 1.0; enabled together or not at all.
+    const std::vector<const char*> dynamicRenderingDeviceExtensions =
+    {
+        VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+        VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+        VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+        VK_KHR_MULTIVIEW_EXTENSION_NAME,
+        VK_KHR_MAINTENANCE2_EXTENSION_NAME
+    };
+
 #if VULKAN_VALIDATION_ENABLED
     VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 
@@ -135,6 +191,25 @@ static void setupDebugMessenger()
 }
 #endif //VULKAN_VALIDATION_ENABLED
 
+static bool isInstanceExtensionAvailable(const char* pExtensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (strcmp(pExtensionName, extension.extensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static std::vector<const char*> getRequiredExtensions()
 {
     uint32_t glfwExtensionCount = 0;
@@ -143,6 +218,13 @@ static std::vector<const char*> getRequiredExtensions()
 
     std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
 
+    // Needed to query extended device features, such as dynamic rendering.
+    s_pData->bPhysicalDeviceProperties2Enabled = isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (s_pData->bPhysicalDeviceProperties2Enabled)
+    {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
+
 #if VULKAN_VALIDATION_ENABLED
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif //VULKAN_VALIDATION_ENABLED
@@ -161,6 +243,10 @@ static void createWindow(const char* pWindowName)
 
     s_pData->pWindow = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, pWindowName, nullptr, nullptr);
     glfwSetFramebufferSizeCallback(s_pData->pWindow, windowResizeCallback);
+
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(s_pData->pWindow, &width, &height);
+    s_pData->framebufferExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 }
 
 static void createInstance()
@@ -234,6 +320,147 @@ static bool checkDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
     return requiredExtensions.empty();
 }
 
+static bool isDeviceExtensionAvailable(const std::vector<VkExtensionProperties>& rAvailableExtensions, const char* pExtensionName)
+{
+    for (const auto& extension : rAvailableExtensions)
+    {
+        if (strcmp(pExtensionName, extension.extensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool supportsDynamicRendering(VkPhysicalDevice physicalDevice, const std::vector<VkExtensionProperties>& rAvailableExtensions)
+{
+    if (!DYNAMIC_RENDERING_ALLOWED || !s_pData->bPhysicalDeviceProperties2Enabled)
+    {
+        return false;
+    }
+
+    for (const char* pExtensionName : s_pData->dynamicRenderingDeviceExtensions)
+    {
+        if (!isDeviceExtensionAvailable(rAvailableExtensions, pExtensionName))
+        {
+            return false;
+        }
+    }
+
+    auto pfnGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(s_pData->instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (pfnGetPhysicalDeviceFeatures2 == nullptr)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &dynamicRenderingFeatures;
+
+    pfnGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+}
+
+static bool supportsTimelineSemaphore(VkPhysicalDevice physicalDevice, const std::vector<VkExtensionProperties>& rAvailableExtensions)
+{
+    if (!TIMELINE_SEMAPHORE_ALLOWED || !s_pData->bPhysicalDeviceProperties2Enabled || !isDeviceExtensionAvailable(rAvailableExtensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+    {
+        return false;
+    }
+
+    auto pfnGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(s_pData->instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (pfnGetPhysicalDeviceFeatures2 == nullptr)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &timelineSemaphoreFeatures;
+
+    pfnGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE;
+}
+
+static bool supportsPresentWait(VkPhysicalDevice physicalDevice, const std::vector<VkExtensionProperties>& rAvailableExtensions)
+{
+    if (!PRESENT_WAIT_ALLOWED || !s_pData->bPhysicalDeviceProperties2Enabled ||
+        !isDeviceExtensionAvailable(rAvailableExtensions, VK_KHR_PRESENT_ID_EXTENSION_NAME) || !isDeviceExtensionAvailable(rAvailableExtensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+    {
+        return false;
+    }
+
+    auto pfnGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(s_pData->instance, "vkGetPhysicalDeviceFeatures2KHR");
+    if (pfnGetPhysicalDeviceFeatures2 == nullptr)
+    {
+        return false;
+    }
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &presentIdFeatures;
+
+    pfnGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+    return presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+}
+
+static std::vector<const char*> getEnabledDeviceExtensions(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    std::vector<const char*> extensions(s_pData->deviceExtensions.begin(), s_pData->deviceExtensions.end());
+
+    for (const char* pExtensionName : s_pData->optionalDeviceExtensions)
+    {
+        if (isDeviceExtensionAvailable(availableExtensions, pExtensionName))
+        {
+            extensions.push_back(pExtensionName);
+        }
+    }
+
+    s_pData->bDynamicRenderingEnabled = supportsDynamicRendering(physicalDevice, availableExtensions);
+    if (s_pData->bDynamicRenderingEnabled)
+    {
+        extensions.insert(extensions.end(), s_pData->dynamicRenderingDeviceExtensions.begin(), s_pData->dynamicRenderingDeviceExtensions.end());
+    }
+
+    s_pData->bTimelineSemaphoreEnabled = supportsTimelineSemaphore(physicalDevice, availableExtensions);
+    if (s_pData->bTimelineSemaphoreEnabled)
+    {
+        extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+
+    s_pData->bPresentWaitEnabled = supportsPresentWait(physicalDevice, availableExtensions);
+    if (s_pData->bPresentWaitEnabled)
+    {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    return extensions;
+}
+
 static bool isDeviceSuitable(VkPhysicalDevice physicalDevice)
 {
     PkGraphicsQueueFamilyIndices indices = PkGraphicsUtils::FindQueueFamilies(physicalDevice, PkGraphicsCore::GetSurface());
@@ -316,8 +543,15 @@ static void createLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(s_pData->physicalDevice, &supportedFeatures);
+
+    VkPhysicalDeviceFeatures& deviceFeatures = s_pData->enabledFeatures;
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+    s_pData->enabledDeviceExtensions = getEnabledDeviceExtensions(s_pData->physicalDevice);
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -327,8 +561,48 @@ static void createLogicalDevice()
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(s_pData->deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = s_pData->deviceExtensions.data();
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+
+    // Each enabled feature struct is pushed onto the front of the chain.
+    void* pFeatures = nullptr;
+
+    if (s_pData->bDynamicRenderingEnabled)
+    {
+        dynamicRenderingFeatures.pNext = pFeatures;
+        pFeatures = &dynamicRenderingFeatures;
+    }
+
+    if (s_pData->bTimelineSemaphoreEnabled)
+    {
+        timelineSemaphoreFeatures.pNext = pFeatures;
+        pFeatures = &timelineSemaphoreFeatures;
+    }
+
+    if (s_pData->bPresentWaitEnabled)
+    {
+        presentIdFeatures.pNext = pFeatures;
+        presentWaitFeatures.pNext = &presentIdFeatures;
+        pFeatures = &presentWaitFeatures;
+    }
+
+    createInfo.pNext = pFeatures;
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(s_pData->enabledDeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = s_pData->enabledDeviceExtensions.data();
 
 #if VULKAN_VALIDATION_ENABLED
     createInfo.enabledLayerCount = static_cast<uint32_t>(s_pData->validationLayers.size());
@@ -374,6 +648,143 @@ static void createCommandPool()
     }
 }
 
+// Cache data written by another driver or GPU is no use and may not be safe to hand to this one, so anything whose
+// header does not match the current device is dropped.
+static const char* validatePipelineCacheData(const std::vector<char>& rData)
+{
+    if (rData.size() < sizeof(PkGraphicsPipelineCacheHeader))
+    {
+        return "too small";
+    }
+
+    PkGraphicsPipelineCacheHeader header;
+    memcpy(&header, rData.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(s_pData->physicalDevice, &properties);
+
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.headerSize < sizeof(header) || header.headerSize > rData.size())
+    {
+        return "unknown header";
+    }
+
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID)
+    {
+        return "different device";
+    }
+
+    if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        return "different driver";
+    }
+
+    return nullptr;
+}
+
+static void createPipelineCache()
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    PkGraphicsPipelineCacheStats& rStats = s_pData->pipelineCacheStats;
+
+    std::vector<char> data;
+    std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+
+    if (file.is_open())
+    {
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(data.data(), data.size());
+
+        rStats.pLoadStatus = validatePipelineCacheData(data);
+        if (rStats.pLoadStatus != nullptr)
+        {
+            data.clear();
+        }
+        else
+        {
+            rStats.pLoadStatus = "loaded";
+            rStats.loadedBytes = data.size();
+        }
+    }
+    else
+    {
+        rStats.pLoadStatus = "no file";
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(s_pData->device, &cacheInfo, nullptr, &s_pData->pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    rStats.loadMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+// Written to a temporary file first, so a crash part way through never leaves a truncated cache behind.
+static void savePipelineCache()
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(s_pData->device, s_pData->pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    {
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(s_pData->device, s_pData->pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    {
+        std::ofstream file(PIPELINE_CACHE_TEMP_PATH, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return;
+        }
+
+        file.write(data.data(), dataSize);
+        if (!file.good())
+        {
+            return;
+        }
+    }
+
+    std::remove(PIPELINE_CACHE_PATH);
+    std::rename(PIPELINE_CACHE_TEMP_PATH, PIPELINE_CACHE_PATH);
+}
+
+static void destroyPipelineCache()
+{
+    savePipelineCache();
+    vkDestroyPipelineCache(s_pData->device, s_pData->pipelineCache, nullptr);
+}
+
+static void recordPipelineCreation(const VkPipelineCreationFeedbackEXT& rFeedback, const std::chrono::high_resolution_clock::time_point startTime)
+{
+    std::lock_guard<std::mutex> lock(s_pData->pipelineCacheStatsMutex);
+    PkGraphicsPipelineCacheStats& rStats = s_pData->pipelineCacheStats;
+
+    rStats.pipelinesCreated++;
+    rStats.creationMilliseconds += std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    if ((rFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) == 0)
+    {
+        rStats.unreported++;
+    }
+    else if ((rFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0)
+    {
+        rStats.hits++;
+    }
+    else
+    {
+        rStats.misses++;
+    }
+}
+
 /*static*/ GLFWwindow* PkGraphicsCore::GetWindow()
 {
     return s_pData->pWindow;
@@ -389,6 +800,16 @@ static void createCommandPool()
     s_pData->windowResized = false;
 }
 
+/*static*/ VkExtent2D PkGraphicsCore::GetFramebufferExtent()
+{
+    return s_pData->framebufferExtent;
+}
+
+/*static*/ void PkGraphicsCore::SetFramebufferExtent(const VkExtent2D& rExtent)
+{
+    s_pData->framebufferExtent = rExtent;
+}
+
 /*static*/ VkInstance PkGraphicsCore::GetInstance()
 {
     return s_pData->instance;
@@ -419,6 +840,78 @@ static void createCommandPool()
     return s_pData->commandPool;
 }
 
+/*static*/ VkPipelineCache PkGraphicsCore::GetPipelineCache()
+{
+    return s_pData->pipelineCache;
+}
+
+/*static*/ VkResult PkGraphicsCore::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& rCreateInfo, VkPipeline* pPipeline)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    VkPipelineCreationFeedbackEXT feedback{};
+    std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(rCreateInfo.stageCount);
+
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+    feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackInfo.pNext = rCreateInfo.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+    feedbackInfo.pipelineStageCreationFeedbackCount = rCreateInfo.stageCount;
+    feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+
+    VkGraphicsPipelineCreateInfo createInfo = rCreateInfo;
+    if (IsDeviceExtensionEnabled(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+    {
+        createInfo.pNext = &feedbackInfo;
+    }
+
+    const VkResult result = vkCreateGraphicsPipelines(s_pData->device, s_pData->pipelineCache, 1, &createInfo, nullptr, pPipeline);
+    recordPipelineCreation(feedback, startTime);
+
+    return result;
+}
+
+/*static*/ VkResult PkGraphicsCore::CreateComputePipeline(const VkComputePipelineCreateInfo& rCreateInfo, VkPipeline* pPipeline)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    VkPipelineCreationFeedbackEXT feedback{};
+    VkPipelineCreationFeedbackEXT stageFeedback{};
+
+    VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+    feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+    feedbackInfo.pNext = rCreateInfo.pNext;
+    feedbackInfo.pPipelineCreationFeedback = &feedback;
+    feedbackInfo.pipelineStageCreationFeedbackCount = 1;
+    feedbackInfo.pPipelineStageCreationFeedbacks = &stageFeedback;
+
+    VkComputePipelineCreateInfo createInfo = rCreateInfo;
+    if (IsDeviceExtensionEnabled(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+    {
+        createInfo.pNext = &feedbackInfo;
+    }
+
+    const VkResult result = vkCreateComputePipelines(s_pData->device, s_pData->pipelineCache, 1, &createInfo, nullptr, pPipeline);
+    recordPipelineCreation(feedback, startTime);
+
+    return result;
+}
+
+/*static*/ PkGraphicsPipelineCacheStats PkGraphicsCore::GetPipelineCacheStats()
+{
+    std::lock_guard<std::mutex> lock(s_pData->pipelineCacheStatsMutex);
+    return s_pData->pipelineCacheStats;
+}
+
+/*static*/ void PkGraphicsCore::ReportPipelineCacheStats()
+{
+    const PkGraphicsPipelineCacheStats stats = GetPipelineCacheStats();
+
+    std::cout << "pipeline cache: " << stats.pLoadStatus << " (" << stats.loadedBytes << " bytes, " << stats.loadMilliseconds << " ms), "
+        << stats.pipelinesCreated << " pipelines in " << stats.creationMilliseconds << " ms, "
+        << stats.hits << " hits, " << stats.misses << " misses, " << stats.unreported << " unreported" << std::endl;
+}
+
 /*static*/ VkQueue PkGraphicsCore::GetGraphicsQueue()
 {
     return s_pData->graphicsQueue;
@@ -439,6 +932,39 @@ static void createCommandPool()
     vkGetPhysicalDeviceFormatProperties(s_pData->physicalDevice, imageFormat, formatProperties);
 }
 
+/*static*/ const VkPhysicalDeviceFeatures& PkGraphicsCore::GetEnabledFeatures()
+{
+    return s_pData->enabledFeatures;
+}
+
+/*static*/ bool PkGraphicsCore::IsDeviceExtensionEnabled(const char* pExtensionName)
+{
+    for (const char* pEnabledExtensionName : s_pData->enabledDeviceExtensions)
+    {
+        if (strcmp(pExtensionName, pEnabledExtensionName) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*static*/ bool PkGraphicsCore::IsDynamicRenderingEnabled()
+{
+    return s_pData->bDynamicRenderingEnabled;
+}
+
+/*static*/ bool PkGraphicsCore::IsTimelineSemaphoreEnabled()
+{
+    return s_pData->bTimelineSemaphoreEnabled;
+}
+
+/*static*/ bool PkGraphicsCore::IsPresentWaitEnabled()
+{
+    return s_pData->bPresentWaitEnabled;
+}
+
 /*static*/ VkSampleCountFlagBits PkGraphicsCore::GetMaxMsaaSampleCount()
 {
     return s_pData->msaaSamples;
@@ -490,10 +1016,12 @@ static void createCommandPool()
     createLogicalDevice();
     createAllocator();
     createCommandPool();
+    createPipelineCache();
 }
 
 /*static*/ void PkGraphicsCore::CleanupGraphicsCore()
 {
+    destroyPipelineCache();
     vkDestroyCommandPool(s_pData->device, s_pData->commandPool, nullptr);
     vmaDestroyAllocator(s_pData->allocator);
     vkDestroyDevice(s_pData->device, nullptr);
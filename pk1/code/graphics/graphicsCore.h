@@ -6,6 +6,21 @@
 
 struct GLFWwindow;
 
+struct PkGraphicsPipelineCacheStats
+{
+    const char* pLoadStatus = "not loaded";
+    size_t loadedBytes = 0;
+    float loadMilliseconds = 0.0f;
+
+    uint32_t pipelinesCreated = 0;
+    float creationMilliseconds = 0.0f;
+
+    // Only counted where the driver supports VK_EXT_pipeline_creation_feedback; otherwise pipelines are unreported.
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t unreported = 0;
+};
+
 class PkGraphicsCore
 {
 public:
@@ -15,6 +30,10 @@ public:
     static bool HasWindowBeenResized();
     static void ResetWindowResizedFlag();
 
+    // The window's framebuffer size as last sampled on the main thread, which is the only one GLFW can be asked on.
+    static VkExtent2D GetFramebufferExtent();
+    static void SetFramebufferExtent(const VkExtent2D& rExtent);
+
     static VkInstance GetInstance();
     static VkSurfaceKHR GetSurface();
     static VkPhysicalDevice GetPhysicalDevice();
@@ -22,12 +41,34 @@ public:
     static VmaAllocator GetAllocator();
     static VkCommandPool GetCommandPool();
 
+    // Loaded from disk at startup when it was written by the same device and driver, and saved back at shutdown.
+    static VkPipelineCache GetPipelineCache();
+
+    // Create one pipeline through the pipeline cache, counting it in the cache stats. Safe to call from any thread.
+    static VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& rCreateInfo, VkPipeline* pPipeline);
+    static VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& rCreateInfo, VkPipeline* pPipeline);
+
+    static PkGraphicsPipelineCacheStats GetPipelineCacheStats();
+    static void ReportPipelineCacheStats();
+
     static VkQueue GetGraphicsQueue();
     static VkQueue GetPresentQueue();
 
     static void GetPhysicalDeviceProperties(VkPhysicalDeviceProperties* physicalDeviceProperties);
     static void GetFormatProperties(VkFormat imageFormat, VkFormatProperties* formatProperties);
 
+    static const VkPhysicalDeviceFeatures& GetEnabledFeatures();
+    static bool IsDeviceExtensionEnabled(const char* pExtensionName);
+
+    // True when rendering is begun with vkCmdBeginRenderingKHR rather than render pass and framebuffer objects.
+    static bool IsDynamicRenderingEnabled();
+
+    // True when frames are paced with a VK_KHR_timeline_semaphore rather than a fence per frame.
+    static bool IsTimelineSemaphoreEnabled();
+
+    // True when presents carry a VK_KHR_present_id and can be waited on with VK_KHR_present_wait.
+    static bool IsPresentWaitEnabled();
+
     static VkSampleCountFlagBits GetMaxMsaaSampleCount();
 
     static glm::mat4& GetViewMatrix();
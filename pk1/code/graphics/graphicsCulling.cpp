@@ -0,0 +1,208 @@
+#include "graphicsCulling.h"
+
+#include "graphics/graphicsFrustum.h"
+#include "graphics/graphicsSimd.h"
+#include "jobs/jobSystem.h"
+
+#include <algorithm>
+
+static const uint32_t SIMD_WIDTH = 8;
+
+// Below this many spheres one thread culls faster than it takes to hand out batches.
+static const uint32_t MIN_SPHERES_PER_CULLING_BATCH = 16384;
+
+typedef uint32_t (*PkCullingKernel)(const PkGraphicsBoundingSpheres& rSpheres, const float planes[6][4], const uint32_t begin, const uint32_t end, uint32_t* pVisibleIndices);
+
+static uint32_t cullScalar(const PkGraphicsBoundingSpheres& rSpheres, const float planes[6][4], const uint32_t begin, const uint32_t end, uint32_t* pVisibleIndices)
+{
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        bool bVisible = true;
+
+        for (uint32_t p = 0; p < 6 && bVisible; p++)
+        {
+            const float distance = planes[p][0] * rSpheres.centreX[i] + planes[p][1] * rSpheres.centreY[i] + planes[p][2] * rSpheres.centreZ[i] + planes[p][3];
+            bVisible = distance >= -rSpheres.radius[i];
+        }
+
+        if (bVisible)
+        {
+            pVisibleIndices[visibleCount++] = i;
+        }
+    }
+
+    return visibleCount;
+}
+
+#if PK_SIMD_X86
+// Appends the set bits of an 8-bit lane mask as indices starting at base.
+static uint32_t writeVisibleLanes(uint32_t mask, const uint32_t base, const uint32_t end, uint32_t* pVisibleIndices)
+{
+    uint32_t visibleCount = 0;
+
+    while (mask != 0)
+    {
+        uint32_t lane = 0;
+        while ((mask & (1u << lane)) == 0)
+        {
+            lane++;
+        }
+        mask &= mask - 1;
+
+        // Padding lanes past the last real sphere never count, whatever the frustum.
+        if (base + lane < end)
+        {
+            pVisibleIndices[visibleCount++] = base + lane;
+        }
+    }
+
+    return visibleCount;
+}
+
+static uint32_t cullSse(const PkGraphicsBoundingSpheres& rSpheres, const float planes[6][4], const uint32_t begin, const uint32_t end, uint32_t* pVisibleIndices)
+{
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = begin; i < end; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(&rSpheres.centreX[i]);
+        const __m128 y = _mm_loadu_ps(&rSpheres.centreY[i]);
+        const __m128 z = _mm_loadu_ps(&rSpheres.centreZ[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&rSpheres.radius[i]));
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_mul_ps(x, _mm_set1_ps(planes[p][0]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(planes[p][1])));
+            distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(planes[p][2])));
+            distance = _mm_add_ps(distance, _mm_set1_ps(planes[p][3]));
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        visibleCount += writeVisibleLanes(static_cast<uint32_t>(_mm_movemask_ps(visible)), i, end, pVisibleIndices + visibleCount);
+    }
+
+    return visibleCount;
+}
+
+PK_TARGET_AVX2 static uint32_t cullAvx2(const PkGraphicsBoundingSpheres& rSpheres, const float planes[6][4], const uint32_t begin, const uint32_t end, uint32_t* pVisibleIndices)
+{
+    uint32_t visibleCount = 0;
+
+    for (uint32_t i = begin; i < end; i += SIMD_WIDTH)
+    {
+        const __m256 x = _mm256_loadu_ps(&rSpheres.centreX[i]);
+        const __m256 y = _mm256_loadu_ps(&rSpheres.centreY[i]);
+        const __m256 z = _mm256_loadu_ps(&rSpheres.centreZ[i]);
+        const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&rSpheres.radius[i]));
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_mul_ps(x, _mm256_set1_ps(planes[p][0]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(planes[p][1])));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(planes[p][2])));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(planes[p][3]));
+
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+
+        visibleCount += writeVisibleLanes(static_cast<uint32_t>(_mm256_movemask_ps(visible)), i, end, pVisibleIndices + visibleCount);
+    }
+
+    return visibleCount;
+}
+#endif
+
+static PkCullingKernel getKernel()
+{
+#if PK_SIMD_X86
+    switch (PkGraphicsSimd::GetInstructionSet())
+    {
+    case PkSimdInstructionSet::Avx2:
+        return cullAvx2;
+    case PkSimdInstructionSet::Sse:
+        return cullSse;
+    default:
+        break;
+    }
+#endif
+    return cullScalar;
+}
+
+void PkGraphicsBoundingSpheres::Resize(const uint32_t count)
+{
+    const size_t paddedCount = ((count + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+
+    centreX.assign(paddedCount, 0.0f);
+    centreY.assign(paddedCount, 0.0f);
+    centreZ.assign(paddedCount, 0.0f);
+    radius.assign(paddedCount, 0.0f);
+    size = count;
+}
+
+void PkGraphicsBoundingSpheres::Set(const uint32_t index, const glm::vec3& rCentre, const float sphereRadius)
+{
+    centreX[index] = rCentre.x;
+    centreY[index] = rCentre.y;
+    centreZ[index] = rCentre.z;
+    radius[index] = sphereRadius;
+}
+
+/*static*/ const char* PkGraphicsCulling::GetInstructionSet()
+{
+    return PkGraphicsSimd::GetInstructionSetName();
+}
+
+/*static*/ void PkGraphicsCulling::CullSpheres(const PkGraphicsBoundingSpheres& rSpheres, const PkGraphicsFrustum& rFrustum, std::vector<uint32_t>& rVisibleIndices)
+{
+    float planes[6][4];
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            planes[p][c] = rFrustum.planes[p][c];
+        }
+    }
+
+    const PkCullingKernel kernel = getKernel();
+    const uint32_t count = rSpheres.size;
+
+    rVisibleIndices.resize(count);
+
+    if (count < 2 * MIN_SPHERES_PER_CULLING_BATCH || PkJobSystem::GetNumWorkers() == 1)
+    {
+        rVisibleIndices.resize(kernel(rSpheres, planes, 0, count, rVisibleIndices.data()));
+        return;
+    }
+
+    // Batches stay a multiple of the SIMD width so no two batches share a vector of spheres.
+    const uint32_t numBatches = std::min(PkJobSystem::GetNumWorkers(), count / MIN_SPHERES_PER_CULLING_BATCH);
+    uint32_t batchSize = (count + numBatches - 1) / numBatches;
+    batchSize = ((batchSize + SIMD_WIDTH - 1) / SIMD_WIDTH) * SIMD_WIDTH;
+    const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+
+    // Each batch writes its survivors at its own start position, then the runs are packed together in order.
+    std::vector<uint32_t> batchVisibleCounts(batchCount);
+
+    PkJobSystem::ParallelFor(count, batchSize, [&](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        batchVisibleCounts[begin / batchSize] = kernel(rSpheres, planes, begin, end, rVisibleIndices.data() + begin);
+    });
+
+    uint32_t visibleCount = batchVisibleCounts[0];
+    for (uint32_t batch = 1; batch < batchCount; batch++)
+    {
+        const uint32_t* pBatchBegin = rVisibleIndices.data() + batch * batchSize;
+        std::copy(pBatchBegin, pBatchBegin + batchVisibleCounts[batch], rVisibleIndices.data() + visibleCount);
+        visibleCount += batchVisibleCounts[batch];
+    }
+
+    rVisibleIndices.resize(visibleCount);
+}
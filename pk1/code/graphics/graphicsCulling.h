@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+struct PkGraphicsFrustum;
+
+// Bounding spheres in structure-of-arrays form so eight can be loaded into one AVX register per component.
+// Storage is padded to a multiple of eight with zero-radius spheres; size is the number of real entries.
+struct PkGraphicsBoundingSpheres
+{
+    std::vector<float> centreX;
+    std::vector<float> centreY;
+    std::vector<float> centreZ;
+    std::vector<float> radius;
+    uint32_t size = 0;
+
+    void Resize(const uint32_t count);
+    void Set(const uint32_t index, const glm::vec3& rCentre, const float sphereRadius);
+};
+
+class PkGraphicsCulling
+{
+public:
+    PkGraphicsCulling() = delete;
+
+    // "AVX2", "SSE" or "scalar", picked once from what the CPU supports.
+    static const char* GetInstructionSet();
+
+    // Writes the indices of the spheres that intersect the frustum to rVisibleIndices, in ascending order.
+    // Large counts are split across the job system.
+    static void CullSpheres(const PkGraphicsBoundingSpheres& rSpheres, const PkGraphicsFrustum& rFrustum, std::vector<uint32_t>& rVisibleIndices);
+};
@@ -0,0 +1,389 @@
+#include "graphicsDepthPyramid.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsShaders.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+static const uint32_t WORKGROUP_SIZE = 8;
+static const VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+
+struct PkGraphicsDepthPyramidPushConstants
+{
+    uint32_t srcWidth;
+    uint32_t srcHeight;
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    int32_t sampleCount;
+};
+
+struct PkGraphicsDepthPyramidData
+{
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline depthPipeline = VK_NULL_HANDLE;
+    VkPipeline reducePipeline = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkImage image = VK_NULL_HANDLE;
+    VmaAllocation imageAllocation = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    std::vector<VkImageView> mipImageViews;
+    std::vector<VkExtent2D> mipExtents;
+
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> descriptorSets;
+};
+
+static PkGraphicsDepthPyramidData* s_pData = nullptr;
+
+static void createDescriptorSetLayout()
+{
+    // 0: scene depth, 1: previous level, 2: level being written.
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(PkGraphicsCore::GetDevice(), &layoutInfo, nullptr, &s_pData->descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+}
+
+static VkPipeline createComputePipeline(const char* pShaderPath, const std::vector<std::string>& rDefines = {})
+{
+    auto compShaderCode = PkGraphicsShaders::LoadSpirv(pShaderPath, rDefines);
+    VkShaderModule compShaderModule = PkGraphicsUtils::CreateShaderModule(PkGraphicsCore::GetDevice(), compShaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = compShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = s_pData->pipelineLayout;
+
+    VkPipeline pipeline;
+    if (PkGraphicsCore::CreateComputePipeline(pipelineInfo, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+
+    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), compShaderModule, nullptr);
+
+    return pipeline;
+}
+
+static void createPipelines()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PkGraphicsDepthPyramidPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &s_pData->descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(PkGraphicsCore::GetDevice(), &pipelineLayoutInfo, nullptr, &s_pData->pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    // The depth attachment is multisampled whenever MSAA is, which needs a different sampler type in the shader.
+    const bool bMultisampled = PkGraphicsCore::GetMaxMsaaSampleCount() != VK_SAMPLE_COUNT_1_BIT;
+    s_pData->depthPipeline = createComputePipeline("data/shaders/depthreduce.comp", bMultisampled ? std::vector<std::string>{ "PK_DEPTH_MULTISAMPLED" } : std::vector<std::string>{});
+    s_pData->reducePipeline = createComputePipeline("data/shaders/hizreduce.comp");
+}
+
+static void createSampler()
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(PkGraphicsCore::GetDevice(), &samplerInfo, nullptr, &s_pData->sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+}
+
+static VkImageView createMipImageView(const uint32_t mipLevel)
+{
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = s_pData->image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = PYRAMID_FORMAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = mipLevel;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if (vkCreateImageView(PkGraphicsCore::GetDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture image view!");
+    }
+
+    return imageView;
+}
+
+static void createImage()
+{
+    // Level 0 matches the depth attachment exactly; each further level halves, rounding down.
+    VkExtent2D extent = PkGraphicsSwapChain::GetSwapChainExtent();
+
+    s_pData->mipExtents.clear();
+    s_pData->mipExtents.push_back(extent);
+
+    while (extent.width > 1 || extent.height > 1)
+    {
+        extent.width = std::max(extent.width / 2, 1u);
+        extent.height = std::max(extent.height / 2, 1u);
+        s_pData->mipExtents.push_back(extent);
+    }
+
+    const uint32_t mipLevels = static_cast<uint32_t>(s_pData->mipExtents.size());
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = s_pData->mipExtents[0].width;
+    imageInfo.extent.height = s_pData->mipExtents[0].height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = PYRAMID_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    if (vmaCreateImage(PkGraphicsCore::GetAllocator(), &imageInfo, &allocInfo, &s_pData->image, &s_pData->imageAllocation, nullptr) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    s_pData->imageView = PkGraphicsUtils::CreateImageView(PkGraphicsCore::GetDevice(), s_pData->image, PYRAMID_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+
+    s_pData->mipImageViews.resize(mipLevels);
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        s_pData->mipImageViews[i] = createMipImageView(i);
+    }
+}
+
+static void createDescriptorSets(VkImageView depthImageView)
+{
+    const uint32_t mipLevels = static_cast<uint32_t>(s_pData->mipExtents.size());
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = mipLevels;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = 2 * mipLevels;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = mipLevels;
+
+    if (vkCreateDescriptorPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(mipLevels, s_pData->descriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = s_pData->descriptorPool;
+    allocInfo.descriptorSetCount = mipLevels;
+    allocInfo.pSetLayouts = layouts.data();
+
+    s_pData->descriptorSets.resize(mipLevels);
+    if (vkAllocateDescriptorSets(PkGraphicsCore::GetDevice(), &allocInfo, s_pData->descriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        VkDescriptorImageInfo depthInfo{};
+        depthInfo.sampler = s_pData->sampler;
+        depthInfo.imageView = depthImageView;
+        depthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        // Level 0 reads the depth attachment instead, but the binding still has to hold something valid.
+        VkDescriptorImageInfo srcInfo{};
+        srcInfo.imageView = s_pData->mipImageViews[i > 0 ? i - 1 : 0];
+        srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo dstInfo{};
+        dstInfo.imageView = s_pData->mipImageViews[i];
+        dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkDescriptorImageInfo*, 3> imageInfos = { &depthInfo, &srcInfo, &dstInfo };
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+        {
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = s_pData->descriptorSets[i];
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pImageInfo = imageInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+static void destroyImage()
+{
+    vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), s_pData->descriptorPool, nullptr);
+    s_pData->descriptorSets.clear();
+
+    for (VkImageView imageView : s_pData->mipImageViews)
+    {
+        vkDestroyImageView(PkGraphicsCore::GetDevice(), imageView, nullptr);
+    }
+    s_pData->mipImageViews.clear();
+
+    vkDestroyImageView(PkGraphicsCore::GetDevice(), s_pData->imageView, nullptr);
+    vmaDestroyImage(PkGraphicsCore::GetAllocator(), s_pData->image, s_pData->imageAllocation);
+}
+
+/*static*/ VkImageView PkGraphicsDepthPyramid::GetImageView()
+{
+    return s_pData->imageView;
+}
+
+/*static*/ VkSampler PkGraphicsDepthPyramid::GetSampler()
+{
+    return s_pData->sampler;
+}
+
+/*static*/ VkExtent2D PkGraphicsDepthPyramid::GetExtent()
+{
+    return s_pData->mipExtents[0];
+}
+
+/*static*/ uint32_t PkGraphicsDepthPyramid::GetMipLevels()
+{
+    return static_cast<uint32_t>(s_pData->mipExtents.size());
+}
+
+/*static*/ void PkGraphicsDepthPyramid::RecordBuild(VkCommandBuffer commandBuffer)
+{
+    const uint32_t mipLevels = GetMipLevels();
+
+    // Last frame's culling may still be reading the pyramid; its contents are about to be replaced, so the old layout does not matter.
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = s_pData->image;
+    imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageBarrier.subresourceRange.baseMipLevel = 0;
+    imageBarrier.subresourceRange.levelCount = mipLevels;
+    imageBarrier.subresourceRange.baseArrayLayer = 0;
+    imageBarrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    VkMemoryBarrier levelBarrier{};
+    levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    for (uint32_t i = 0; i < mipLevels; i++)
+    {
+        const VkExtent2D srcExtent = s_pData->mipExtents[i > 0 ? i - 1 : 0];
+        const VkExtent2D dstExtent = s_pData->mipExtents[i];
+
+        PkGraphicsDepthPyramidPushConstants pushConstants{};
+        pushConstants.srcWidth = srcExtent.width;
+        pushConstants.srcHeight = srcExtent.height;
+        pushConstants.dstWidth = dstExtent.width;
+        pushConstants.dstHeight = dstExtent.height;
+        pushConstants.sampleCount = static_cast<int32_t>(PkGraphicsCore::GetMaxMsaaSampleCount());
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, i == 0 ? s_pData->depthPipeline : s_pData->reducePipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->pipelineLayout, 0, 1, &s_pData->descriptorSets[i], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, s_pData->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (dstExtent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (dstExtent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+/*static*/ void PkGraphicsDepthPyramid::OnSwapChainCreate(VkImageView depthImageView)
+{
+    createImage();
+    createDescriptorSets(depthImageView);
+}
+
+/*static*/ void PkGraphicsDepthPyramid::OnSwapChainDestroy()
+{
+    destroyImage();
+}
+
+/*static*/ void PkGraphicsDepthPyramid::InitialiseGraphicsDepthPyramid()
+{
+    s_pData = new PkGraphicsDepthPyramidData();
+
+    createDescriptorSetLayout();
+    createPipelines();
+    createSampler();
+}
+
+/*static*/ void PkGraphicsDepthPyramid::CleanupGraphicsDepthPyramid()
+{
+    vkDestroySampler(PkGraphicsCore::GetDevice(), s_pData->sampler, nullptr);
+    vkDestroyPipeline(PkGraphicsCore::GetDevice(), s_pData->reducePipeline, nullptr);
+    vkDestroyPipeline(PkGraphicsCore::GetDevice(), s_pData->depthPipeline, nullptr);
+    vkDestroyPipelineLayout(PkGraphicsCore::GetDevice(), s_pData->pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(PkGraphicsCore::GetDevice(), s_pData->descriptorSetLayout, nullptr);
+
+    delete s_pData;
+}
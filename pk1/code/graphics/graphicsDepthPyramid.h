@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <stdint.h>
+
+// A max-depth mip chain (Hi-Z) built from the scene depth attachment, for occlusion tests in compute.
+class PkGraphicsDepthPyramid
+{
+public:
+    PkGraphicsDepthPyramid() = delete;
+
+    static VkImageView GetImageView();
+    static VkSampler GetSampler();
+    static VkExtent2D GetExtent();
+    static uint32_t GetMipLevels();
+
+    // The depth image must be in DEPTH_STENCIL_READ_ONLY_OPTIMAL with its writes made visible to compute.
+    // Leaves every level in GENERAL, readable by later compute shaders.
+    static void RecordBuild(VkCommandBuffer commandBuffer);
+
+    static void OnSwapChainCreate(VkImageView depthImageView);
+    static void OnSwapChainDestroy();
+
+    static void InitialiseGraphicsDepthPyramid();
+    static void CleanupGraphicsDepthPyramid();
+};
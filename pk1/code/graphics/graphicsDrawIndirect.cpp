@@ -0,0 +1,708 @@
+#include "graphicsDrawIndirect.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsDepthPyramid.h"
+#include "graphics/graphicsFrustum.h"
+#include "graphics/graphicsModel.h"
+#include "graphics/graphicsShaders.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+static const uint32_t WORKGROUP_SIZE = 64;
+
+// Occlusion culling draws the visible set in two phases, each with its own commands, counts and visible instances.
+static const uint32_t MAX_PHASES = 2;
+
+// The compute shaders copy instances as raw 32-bit words, so the C++ layout is all that has to match.
+static_assert(sizeof(InstanceData) == 17 * sizeof(uint32_t), "cull.comp assumes seventeen words per instance");
+
+// Bindings shared by drawcmds.comp and cull.comp.
+enum PkGraphicsDrawIndirectBinding : uint32_t
+{
+    BINDING_RECORDS = 0,
+    BINDING_COMMANDS,
+    BINDING_COUNTS,
+    BINDING_OBJECT_COMMANDS,
+    BINDING_OBJECTS,
+    BINDING_INSTANCES,
+    BINDING_VISIBLE_INSTANCES,
+    BINDING_STATS,
+    BINDING_VISIBILITY,
+    BINDING_STORAGE_BUFFER_COUNT,
+
+    BINDING_CULL_DATA = BINDING_STORAGE_BUFFER_COUNT,
+    BINDING_DEPTH_PYRAMID,
+    BINDING_COUNT
+};
+
+// Matches cullMode in data/shaders/cull.comp.
+enum PkGraphicsDrawIndirectCullMode : uint32_t
+{
+    CULL_MODE_FRUSTUM = 0,
+    CULL_MODE_EARLY,
+    CULL_MODE_LATE
+};
+
+struct PkGraphicsDrawIndirectPushConstants
+{
+    uint32_t recordCount;
+    uint32_t instanceCount;
+    uint32_t cullInstances;
+    uint32_t cullMode;
+};
+
+// Matches CullData in data/shaders/drawcmds.comp and cull.comp (std140).
+struct PkGraphicsDrawIndirectCullData
+{
+    glm::vec4 frustumPlanes[6];
+    glm::mat4 view;
+    glm::vec4 projection;
+    glm::vec4 pyramid;
+    uint32_t commandCount;
+    uint32_t batchCount;
+    uint32_t phaseCount;
+    uint32_t padding;
+};
+
+struct PkGraphicsDrawIndirectFrame
+{
+    VkBuffer commandBuffer = VK_NULL_HANDLE;
+    VmaAllocation commandBufferAllocation = VK_NULL_HANDLE;
+
+    VkBuffer countBuffer = VK_NULL_HANDLE;
+    VmaAllocation countBufferAllocation = VK_NULL_HANDLE;
+
+    VkBuffer objectCommandBuffer = VK_NULL_HANDLE;
+    VmaAllocation objectCommandBufferAllocation = VK_NULL_HANDLE;
+
+    VkBuffer visibleInstanceBuffer = VK_NULL_HANDLE;
+    VmaAllocation visibleInstanceBufferAllocation = VK_NULL_HANDLE;
+
+    VkBuffer statsBuffer = VK_NULL_HANDLE;
+    VmaAllocation statsBufferAllocation = VK_NULL_HANDLE;
+    bool bCulled = false;
+
+    VkBuffer cullDataBuffer = VK_NULL_HANDLE;
+    VmaAllocation cullDataBufferAllocation = VK_NULL_HANDLE;
+    bool bOcclusionCulled = false;
+
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
+
+struct PkGraphicsDrawIndirectData
+{
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline commandPipeline = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    std::vector<PkGraphicsDrawIndirectFrame> frames;
+
+    uint32_t recordCount = 0;
+    uint32_t commandCount = 0;
+    VkBuffer recordBuffer = VK_NULL_HANDLE;
+    VmaAllocation recordBufferAllocation = VK_NULL_HANDLE;
+
+    std::vector<PkGraphicsDrawBatch> batches;
+
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    uint32_t instanceCount = 0;
+    uint32_t visibleInstanceCount = 0;
+    std::vector<VkBuffer> objectBuffers;
+
+    // Whether each instance passed the late occlusion test last frame; shared by every swap chain image.
+    VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+    VmaAllocation visibilityBufferAllocation = VK_NULL_HANDLE;
+
+    bool bCullingEnabled = true;
+    bool bOcclusionCullingEnabled = true;
+
+    PFN_vkCmdDrawIndexedIndirectCountKHR pfnCmdDrawIndexedIndirectCount = nullptr;
+
+    bool bSwapChainCreated = false;
+    bool bDepthPyramidCreated = false;
+};
+
+static PkGraphicsDrawIndirectData* s_pData = nullptr;
+
+static void createDescriptorSetLayout()
+{
+    std::array<VkDescriptorSetLayoutBinding, BINDING_COUNT> bindings{};
+
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    bindings[BINDING_CULL_DATA].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[BINDING_DEPTH_PYRAMID].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(PkGraphicsCore::GetDevice(), &layoutInfo, nullptr, &s_pData->descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+}
+
+static VkPipeline createComputePipeline(const char* pShaderPath)
+{
+    auto compShaderCode = PkGraphicsShaders::LoadSpirv(pShaderPath);
+    VkShaderModule compShaderModule = PkGraphicsUtils::CreateShaderModule(PkGraphicsCore::GetDevice(), compShaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = compShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = s_pData->pipelineLayout;
+
+    VkPipeline pipeline;
+    if (PkGraphicsCore::CreateComputePipeline(pipelineInfo, &pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+
+    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), compShaderModule, nullptr);
+
+    return pipeline;
+}
+
+static void createPipelines()
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PkGraphicsDrawIndirectPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &s_pData->descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(PkGraphicsCore::GetDevice(), &pipelineLayoutInfo, nullptr, &s_pData->pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    s_pData->commandPipeline = createComputePipeline("data/shaders/drawcmds.comp");
+    s_pData->cullPipeline = createComputePipeline("data/shaders/cull.comp");
+}
+
+static void destroyRecordBuffer()
+{
+    if (s_pData->recordBuffer != VK_NULL_HANDLE)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->recordBuffer, s_pData->recordBufferAllocation);
+        s_pData->recordBuffer = VK_NULL_HANDLE;
+    }
+
+    if (s_pData->visibilityBuffer != VK_NULL_HANDLE)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->visibilityBuffer, s_pData->visibilityBufferAllocation);
+        s_pData->visibilityBuffer = VK_NULL_HANDLE;
+    }
+}
+
+static void createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation)
+{
+    PkGraphicsUtils::CreateBuffer
+    (
+        PkGraphicsCore::GetAllocator(),
+        size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        pBuffer,
+        pBufferAllocation
+    );
+}
+
+static void createFrames()
+{
+    if (s_pData->recordCount == 0)
+    {
+        return;
+    }
+
+    const uint32_t imageCount = PkGraphicsSwapChain::GetNumSwapChainImages();
+
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = BINDING_STORAGE_BUFFER_COUNT * imageCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = imageCount;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = imageCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = imageCount;
+
+    if (vkCreateDescriptorPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    s_pData->frames.resize(imageCount);
+
+    for (uint32_t imageIndex = 0; imageIndex < imageCount; imageIndex++)
+    {
+        PkGraphicsDrawIndirectFrame& rFrame = s_pData->frames[imageIndex];
+
+        createStorageBuffer(sizeof(VkDrawIndexedIndirectCommand) * s_pData->commandCount * MAX_PHASES, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, &rFrame.commandBuffer, &rFrame.commandBufferAllocation);
+        createStorageBuffer(sizeof(uint32_t) * s_pData->batches.size() * MAX_PHASES, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, &rFrame.countBuffer, &rFrame.countBufferAllocation);
+        createStorageBuffer(sizeof(uint32_t) * s_pData->recordCount * MAX_PHASES, 0, &rFrame.objectCommandBuffer, &rFrame.objectCommandBufferAllocation);
+        createStorageBuffer(sizeof(InstanceData) * std::max(s_pData->instanceCount, 1u) * MAX_PHASES, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &rFrame.visibleInstanceBuffer, &rFrame.visibleInstanceBufferAllocation);
+
+        // Read back on the CPU once this image comes round again, by which point its fence has been waited on.
+        PkGraphicsUtils::CreateBuffer
+        (
+            PkGraphicsCore::GetAllocator(),
+            sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &rFrame.statsBuffer,
+            &rFrame.statsBufferAllocation
+        );
+
+        PkGraphicsUtils::CreateBuffer
+        (
+            PkGraphicsCore::GetAllocator(),
+            sizeof(PkGraphicsDrawIndirectCullData),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &rFrame.cullDataBuffer,
+            &rFrame.cullDataBufferAllocation
+        );
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = s_pData->descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &s_pData->descriptorSetLayout;
+
+        if (vkAllocateDescriptorSets(PkGraphicsCore::GetDevice(), &allocInfo, &rFrame.descriptorSet) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate descriptor sets!");
+        }
+
+        std::array<VkDescriptorBufferInfo, BINDING_STORAGE_BUFFER_COUNT> bufferInfos{};
+        bufferInfos[BINDING_RECORDS].buffer = s_pData->recordBuffer;
+        bufferInfos[BINDING_COMMANDS].buffer = rFrame.commandBuffer;
+        bufferInfos[BINDING_COUNTS].buffer = rFrame.countBuffer;
+        bufferInfos[BINDING_OBJECT_COMMANDS].buffer = rFrame.objectCommandBuffer;
+        bufferInfos[BINDING_OBJECTS].buffer = s_pData->objectBuffers[imageIndex];
+        bufferInfos[BINDING_INSTANCES].buffer = s_pData->instanceBuffer;
+        bufferInfos[BINDING_VISIBLE_INSTANCES].buffer = rFrame.visibleInstanceBuffer;
+        bufferInfos[BINDING_STATS].buffer = rFrame.statsBuffer;
+        bufferInfos[BINDING_VISIBILITY].buffer = s_pData->visibilityBuffer;
+
+        VkDescriptorBufferInfo cullDataInfo{};
+        cullDataInfo.buffer = rFrame.cullDataBuffer;
+        cullDataInfo.offset = 0;
+        cullDataInfo.range = sizeof(PkGraphicsDrawIndirectCullData);
+
+        // The depth pyramid is written separately, as it is replaced whenever the swap chain is resized.
+        std::array<VkWriteDescriptorSet, BINDING_DEPTH_PYRAMID> descriptorWrites{};
+
+        for (uint32_t i = 0; i < BINDING_STORAGE_BUFFER_COUNT; i++)
+        {
+            bufferInfos[i].range = VK_WHOLE_SIZE;
+
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].dstSet = rFrame.descriptorSet;
+            descriptorWrites[i].dstBinding = i;
+            descriptorWrites[i].dstArrayElement = 0;
+            descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[i].descriptorCount = 1;
+            descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+        }
+
+        descriptorWrites[BINDING_CULL_DATA].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[BINDING_CULL_DATA].dstSet = rFrame.descriptorSet;
+        descriptorWrites[BINDING_CULL_DATA].dstBinding = BINDING_CULL_DATA;
+        descriptorWrites[BINDING_CULL_DATA].dstArrayElement = 0;
+        descriptorWrites[BINDING_CULL_DATA].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[BINDING_CULL_DATA].descriptorCount = 1;
+        descriptorWrites[BINDING_CULL_DATA].pBufferInfo = &cullDataInfo;
+
+        vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+static void writeDepthPyramidDescriptors()
+{
+    VkDescriptorImageInfo pyramidInfo{};
+    pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    pyramidInfo.imageView = PkGraphicsDepthPyramid::GetImageView();
+    pyramidInfo.sampler = PkGraphicsDepthPyramid::GetSampler();
+
+    for (PkGraphicsDrawIndirectFrame& rFrame : s_pData->frames)
+    {
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = rFrame.descriptorSet;
+        descriptorWrite.dstBinding = BINDING_DEPTH_PYRAMID;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &pyramidInfo;
+
+        vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+static void destroyFrames()
+{
+    for (PkGraphicsDrawIndirectFrame& rFrame : s_pData->frames)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.cullDataBuffer, rFrame.cullDataBufferAllocation);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.statsBuffer, rFrame.statsBufferAllocation);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.visibleInstanceBuffer, rFrame.visibleInstanceBufferAllocation);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.objectCommandBuffer, rFrame.objectCommandBufferAllocation);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.countBuffer, rFrame.countBufferAllocation);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.commandBuffer, rFrame.commandBufferAllocation);
+    }
+
+    s_pData->frames.clear();
+
+    if (s_pData->descriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), s_pData->descriptorPool, nullptr);
+        s_pData->descriptorPool = VK_NULL_HANDLE;
+    }
+}
+
+static void readVisibleInstanceCount(PkGraphicsDrawIndirectFrame& rFrame)
+{
+    if (!rFrame.bCulled)
+    {
+        s_pData->visibleInstanceCount = s_pData->instanceCount;
+        return;
+    }
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), rFrame.statsBufferAllocation, &data);
+    s_pData->visibleInstanceCount = *static_cast<uint32_t*>(data);
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), rFrame.statsBufferAllocation);
+}
+
+/*static*/ bool PkGraphicsDrawIndirect::IsSupported()
+{
+    // Every object's instances live at an offset in the shared instance buffer, so commands need a non-zero firstInstance.
+    return PkGraphicsCore::GetEnabledFeatures().drawIndirectFirstInstance == VK_TRUE;
+}
+
+/*static*/ bool PkGraphicsDrawIndirect::IsDrawCountSupported()
+{
+    return s_pData->pfnCmdDrawIndexedIndirectCount != nullptr;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::SetCullingEnabled(const bool bEnabled)
+{
+    s_pData->bCullingEnabled = bEnabled;
+}
+
+/*static*/ bool PkGraphicsDrawIndirect::IsCullingEnabled()
+{
+    return s_pData->bCullingEnabled;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::SetOcclusionCullingEnabled(const bool bEnabled)
+{
+    s_pData->bOcclusionCullingEnabled = bEnabled;
+}
+
+/*static*/ bool PkGraphicsDrawIndirect::IsOcclusionCullingEnabled()
+{
+    return s_pData->bOcclusionCullingEnabled;
+}
+
+/*static*/ bool PkGraphicsDrawIndirect::IsOcclusionCullingActive()
+{
+    return s_pData->bCullingEnabled && s_pData->bOcclusionCullingEnabled && s_pData->recordCount > 0 && s_pData->instanceCount > 0;
+}
+
+/*static*/ uint32_t PkGraphicsDrawIndirect::GetInstanceCount()
+{
+    return s_pData->instanceCount;
+}
+
+/*static*/ uint32_t PkGraphicsDrawIndirect::GetVisibleInstanceCount()
+{
+    return s_pData->visibleInstanceCount;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::SetDrawRecords(const std::vector<PkGraphicsDrawRecord>& rRecords, const std::vector<PkGraphicsDrawBatch>& rBatches, VkBuffer instanceBuffer, const uint32_t instanceCount)
+{
+    destroyFrames();
+    destroyRecordBuffer();
+
+    s_pData->recordCount = static_cast<uint32_t>(rRecords.size());
+    s_pData->batches = rBatches;
+    s_pData->commandCount = 0;
+    s_pData->instanceBuffer = instanceBuffer;
+    s_pData->instanceCount = instanceCount;
+
+    for (const PkGraphicsDrawBatch& rBatch : rBatches)
+    {
+        s_pData->commandCount = std::max(s_pData->commandCount, rBatch.firstCommand + rBatch.maxCommandCount);
+    }
+
+    if (s_pData->recordCount == 0)
+    {
+        return;
+    }
+
+    PkGraphicsUtils::CreateDeviceLocalBuffer
+    (
+        PkGraphicsCore::GetDevice(),
+        PkGraphicsCore::GetAllocator(),
+        PkGraphicsCore::GetGraphicsQueue(),
+        PkGraphicsCore::GetCommandPool(),
+        rRecords.data(),
+        sizeof(PkGraphicsDrawRecord) * rRecords.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        &s_pData->recordBuffer,
+        &s_pData->recordBufferAllocation
+    );
+
+    // Nothing has been drawn yet, so the first early phase is empty and the late phase draws everything that is visible.
+    const std::vector<uint32_t> visibility(std::max(instanceCount, 1u), 0);
+
+    PkGraphicsUtils::CreateDeviceLocalBuffer
+    (
+        PkGraphicsCore::GetDevice(),
+        PkGraphicsCore::GetAllocator(),
+        PkGraphicsCore::GetGraphicsQueue(),
+        PkGraphicsCore::GetCommandPool(),
+        visibility.data(),
+        sizeof(uint32_t) * visibility.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        &s_pData->visibilityBuffer,
+        &s_pData->visibilityBufferAllocation
+    );
+
+    if (s_pData->bSwapChainCreated)
+    {
+        createFrames();
+    }
+
+    if (s_pData->bDepthPyramidCreated)
+    {
+        writeDepthPyramidDescriptors();
+    }
+}
+
+/*static*/ void PkGraphicsDrawIndirect::SetObjectBuffers(const std::vector<VkBuffer>& rObjectBuffers)
+{
+    s_pData->objectBuffers = rObjectBuffers;
+}
+
+/*static*/ VkBuffer PkGraphicsDrawIndirect::GetInstanceBuffer(const uint32_t imageIndex)
+{
+    return s_pData->bCullingEnabled ? s_pData->frames[imageIndex].visibleInstanceBuffer : s_pData->instanceBuffer;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::RecordCommandGeneration(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const glm::mat4& rView, const glm::mat4& rProjection)
+{
+    if (s_pData->recordCount == 0)
+    {
+        return;
+    }
+
+    PkGraphicsDrawIndirectFrame& rFrame = s_pData->frames[imageIndex];
+
+    readVisibleInstanceCount(rFrame);
+    rFrame.bCulled = s_pData->bCullingEnabled;
+    rFrame.bOcclusionCulled = IsOcclusionCullingActive();
+
+    const PkGraphicsFrustum frustum = PkGraphicsFrustum::FromViewProjection(rProjection * rView);
+    const VkExtent2D pyramidExtent = PkGraphicsDepthPyramid::GetExtent();
+
+    PkGraphicsDrawIndirectCullData cullData{};
+    std::copy(frustum.planes.begin(), frustum.planes.end(), cullData.frustumPlanes);
+    cullData.view = rView;
+    cullData.projection = glm::vec4(rProjection[0][0], rProjection[1][1], rProjection[2][2], rProjection[3][2]);
+    // For a zero-to-one perspective projection, proj[3][2] / proj[2][2] is the near plane distance.
+    cullData.pyramid = glm::vec4(pyramidExtent.width, pyramidExtent.height, PkGraphicsDepthPyramid::GetMipLevels(), rProjection[3][2] / rProjection[2][2]);
+    cullData.commandCount = s_pData->commandCount;
+    cullData.batchCount = static_cast<uint32_t>(s_pData->batches.size());
+    cullData.phaseCount = rFrame.bOcclusionCulled ? MAX_PHASES : 1;
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), rFrame.cullDataBufferAllocation, &data);
+    memcpy(data, &cullData, sizeof(cullData));
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), rFrame.cullDataBufferAllocation);
+
+    // Unused command slots must read as empty draws for devices that cannot take the draw count from a buffer.
+    vkCmdFillBuffer(commandBuffer, rFrame.countBuffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, rFrame.commandBuffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, rFrame.statsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    // Also orders this frame's visibility reads after the late culling of the previous frame.
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    PkGraphicsDrawIndirectPushConstants pushConstants{};
+    pushConstants.recordCount = s_pData->recordCount;
+    pushConstants.instanceCount = s_pData->instanceCount;
+    pushConstants.cullInstances = rFrame.bCulled ? 1 : 0;
+    pushConstants.cullMode = rFrame.bOcclusionCulled ? CULL_MODE_EARLY : CULL_MODE_FRUSTUM;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->pipelineLayout, 0, 1, &rFrame.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, s_pData->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->commandPipeline);
+    vkCmdDispatch(commandBuffer, (s_pData->recordCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    if (rFrame.bCulled && s_pData->instanceCount > 0)
+    {
+        // Culling adds surviving instances onto the commands written above, so those writes must land first.
+        VkMemoryBarrier commandBarrier{};
+        commandBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        commandBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        commandBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &commandBarrier, 0, nullptr, 0, nullptr);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->cullPipeline);
+        vkCmdDispatch(commandBuffer, (s_pData->instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    }
+
+    VkMemoryBarrier generateBarrier{};
+    generateBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    generateBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    generateBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &generateBarrier, 0, nullptr, 0, nullptr);
+}
+
+/*static*/ void PkGraphicsDrawIndirect::RecordLateCulling(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+{
+    if (s_pData->recordCount == 0)
+    {
+        return;
+    }
+
+    const PkGraphicsDrawIndirectFrame& rFrame = s_pData->frames[imageIndex];
+
+    if (!rFrame.bOcclusionCulled)
+    {
+        return;
+    }
+
+    PkGraphicsDrawIndirectPushConstants pushConstants{};
+    pushConstants.recordCount = s_pData->recordCount;
+    pushConstants.instanceCount = s_pData->instanceCount;
+    pushConstants.cullInstances = 1;
+    pushConstants.cullMode = CULL_MODE_LATE;
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->pipelineLayout, 0, 1, &rFrame.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, s_pData->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s_pData->cullPipeline);
+    vkCmdDispatch(commandBuffer, (s_pData->instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+/*static*/ void PkGraphicsDrawIndirect::DrawBatch(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const uint32_t batchIndex, const uint32_t phase)
+{
+    const PkGraphicsDrawIndirectFrame& rFrame = s_pData->frames[imageIndex];
+    const PkGraphicsDrawBatch& rBatch = s_pData->batches[batchIndex];
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize offset = (static_cast<VkDeviceSize>(phase) * s_pData->commandCount + rBatch.firstCommand) * stride;
+    const VkDeviceSize countOffset = (static_cast<VkDeviceSize>(phase) * s_pData->batches.size() + batchIndex) * sizeof(uint32_t);
+
+    if (IsDrawCountSupported())
+    {
+        s_pData->pfnCmdDrawIndexedIndirectCount(commandBuffer, rFrame.commandBuffer, offset, rFrame.countBuffer, countOffset, rBatch.maxCommandCount, stride);
+    }
+    else if (PkGraphicsCore::GetEnabledFeatures().multiDrawIndirect)
+    {
+        vkCmdDrawIndexedIndirect(commandBuffer, rFrame.commandBuffer, offset, rBatch.maxCommandCount, stride);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < rBatch.maxCommandCount; i++)
+        {
+            vkCmdDrawIndexedIndirect(commandBuffer, rFrame.commandBuffer, offset + i * stride, 1, stride);
+        }
+    }
+}
+
+/*static*/ void PkGraphicsDrawIndirect::OnSwapChainCreate()
+{
+    createFrames();
+    s_pData->bSwapChainCreated = true;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::OnSwapChainDestroy()
+{
+    s_pData->bSwapChainCreated = false;
+    destroyFrames();
+}
+
+/*static*/ void PkGraphicsDrawIndirect::OnDepthPyramidCreate()
+{
+    writeDepthPyramidDescriptors();
+    s_pData->bDepthPyramidCreated = true;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::OnDepthPyramidDestroy()
+{
+    s_pData->bDepthPyramidCreated = false;
+}
+
+/*static*/ void PkGraphicsDrawIndirect::InitialiseGraphicsDrawIndirect()
+{
+    s_pData = new PkGraphicsDrawIndirectData();
+
+    if (PkGraphicsCore::IsDeviceExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    {
+        s_pData->pfnCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkCmdDrawIndexedIndirectCountKHR");
+    }
+
+    createDescriptorSetLayout();
+    createPipelines();
+}
+
+/*static*/ void PkGraphicsDrawIndirect::CleanupGraphicsDrawIndirect()
+{
+    destroyFrames();
+    destroyRecordBuffer();
+
+    vkDestroyPipeline(PkGraphicsCore::GetDevice(), s_pData->cullPipeline, nullptr);
+    vkDestroyPipeline(PkGraphicsCore::GetDevice(), s_pData->commandPipeline, nullptr);
+    vkDestroyPipelineLayout(PkGraphicsCore::GetDevice(), s_pData->pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(PkGraphicsCore::GetDevice(), s_pData->descriptorSetLayout, nullptr);
+
+    delete s_pData;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+// One per object; matches DrawRecord in data/shaders/drawcmds.comp and cull.comp (std430).
+struct PkGraphicsDrawRecord
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+    uint32_t batchIndex;
+    uint32_t firstCommand;
+    uint32_t padding;
+
+    // Mesh bounds in model space: centre in xyz, radius in w.
+    glm::vec4 boundingSphere;
+};
+
+// A run of draw commands sharing one mesh and material, drawn with a single indirect call.
+struct PkGraphicsDrawBatch
+{
+    uint32_t firstCommand;
+    uint32_t maxCommandCount;
+};
+
+class PkGraphicsDrawIndirect
+{
+public:
+    PkGraphicsDrawIndirect() = delete;
+
+    static bool IsSupported();
+    static bool IsDrawCountSupported();
+
+    static void SetCullingEnabled(const bool bEnabled);
+    static bool IsCullingEnabled();
+
+    // Two-phase occlusion culling against a depth pyramid; needs instance culling to be enabled as well.
+    static void SetOcclusionCullingEnabled(const bool bEnabled);
+    static bool IsOcclusionCullingEnabled();
+    static bool IsOcclusionCullingActive();
+
+    static uint32_t GetInstanceCount();
+    static uint32_t GetVisibleInstanceCount();
+
+    // Must not be called while a frame using the previous records is in flight.
+    // Every record's firstInstance indexes into rInstanceBuffer, which needs storage buffer usage.
+    static void SetDrawRecords(const std::vector<PkGraphicsDrawRecord>& rRecords, const std::vector<PkGraphicsDrawBatch>& rBatches, VkBuffer instanceBuffer, const uint32_t instanceCount);
+
+    // One buffer of model matrices per swap chain image, indexed by InstanceData::objectIndex. Set before OnSwapChainCreate.
+    static void SetObjectBuffers(const std::vector<VkBuffer>& rObjectBuffers);
+
+    // The instance buffer to bind for indirect draws; holds only the visible instances when culling is enabled.
+    static VkBuffer GetInstanceBuffer(const uint32_t imageIndex);
+
+    // Fills phase 0: everything in the frustum, or with occlusion culling only what was visible last frame.
+    static void RecordCommandGeneration(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const glm::mat4& rView, const glm::mat4& rProjection);
+
+    // Fills phase 1 with what phase 0 missed, tested against a depth pyramid built from phase 0's depth.
+    // Does nothing unless occlusion culling was active when the commands were generated.
+    static void RecordLateCulling(VkCommandBuffer commandBuffer, const uint32_t imageIndex);
+
+    static void DrawBatch(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const uint32_t batchIndex, const uint32_t phase = 0);
+
+    static void OnSwapChainCreate();
+    static void OnSwapChainDestroy();
+
+    // The depth pyramid follows the swap chain extent, so it is replaced on every resize while the frames are kept.
+    static void OnDepthPyramidCreate();
+    static void OnDepthPyramidDestroy();
+
+    static void InitialiseGraphicsDrawIndirect();
+    static void CleanupGraphicsDrawIndirect();
+};
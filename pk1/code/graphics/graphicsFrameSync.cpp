@@ -0,0 +1,360 @@
+#include "graphicsFrameSync.h"
+
+#include "graphics/graphicsCore.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+static const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+static const uint64_t NO_FRAME = UINT64_MAX;
+
+// Everything one frame in flight holds until it finishes.
+struct PkGraphicsFrameSlot
+{
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    // Only used without timeline semaphores.
+    VkFence fence = VK_NULL_HANDLE;
+    uint64_t frameNumber = NO_FRAME;
+};
+
+struct PkGraphicsFrameSyncData
+{
+    bool bTimelineSemaphore = false;
+    VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+    PFN_vkWaitSemaphoresKHR pfnWaitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR pfnGetSemaphoreCounterValue = nullptr;
+
+    std::vector<PkGraphicsFrameSlot> slots;
+    uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+    uint32_t requestedFramesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+
+    uint64_t frameNumber = 0;
+    uint64_t submittedFrameCount = 0;
+    // The highest count seen so far; the semaphore or fences may already be further on. Raised by whichever thread
+    // sees a frame finish.
+    std::atomic<uint64_t> completedFrameCount{ 0 };
+
+    // The last frame to render to each swap chain image.
+    std::vector<uint64_t> imageFrameNumbers;
+
+    std::atomic<float> waitMilliseconds{ 0.0f };
+};
+
+static PkGraphicsFrameSyncData* s_pData = nullptr;
+
+static void raiseCompletedFrameCount(const uint64_t completedFrameCount)
+{
+    uint64_t previous = s_pData->completedFrameCount.load(std::memory_order_relaxed);
+    while (previous < completedFrameCount && !s_pData->completedFrameCount.compare_exchange_weak(previous, completedFrameCount))
+    {
+    }
+}
+
+static PkGraphicsFrameSlot& getCurrentSlot()
+{
+    return s_pData->slots[s_pData->frameNumber % s_pData->framesInFlight];
+}
+
+static void createSlots()
+{
+    s_pData->slots.resize(s_pData->framesInFlight);
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (PkGraphicsFrameSlot& rSlot : s_pData->slots)
+    {
+        if (vkCreateSemaphore(PkGraphicsCore::GetDevice(), &semaphoreInfo, nullptr, &rSlot.imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(PkGraphicsCore::GetDevice(), &semaphoreInfo, nullptr, &rSlot.renderFinishedSemaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+
+        if (!s_pData->bTimelineSemaphore && vkCreateFence(PkGraphicsCore::GetDevice(), &fenceInfo, nullptr, &rSlot.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create synchronization objects for a frame!");
+        }
+    }
+}
+
+static void destroySlots()
+{
+    for (PkGraphicsFrameSlot& rSlot : s_pData->slots)
+    {
+        vkDestroySemaphore(PkGraphicsCore::GetDevice(), rSlot.renderFinishedSemaphore, nullptr);
+        vkDestroySemaphore(PkGraphicsCore::GetDevice(), rSlot.imageAvailableSemaphore, nullptr);
+        vkDestroyFence(PkGraphicsCore::GetDevice(), rSlot.fence, nullptr);
+    }
+
+    s_pData->slots.clear();
+}
+
+static void createTimelineSemaphore()
+{
+    s_pData->pfnWaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkWaitSemaphoresKHR");
+    s_pData->pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkGetSemaphoreCounterValueKHR");
+
+    VkSemaphoreTypeCreateInfoKHR typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (s_pData->pfnWaitSemaphores == nullptr || s_pData->pfnGetSemaphoreCounterValue == nullptr ||
+        vkCreateSemaphore(PkGraphicsCore::GetDevice(), &semaphoreInfo, nullptr, &s_pData->timelineSemaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+}
+
+/*static*/ uint64_t PkGraphicsFrameSync::GetFrameNumber()
+{
+    return s_pData->frameNumber;
+}
+
+/*static*/ uint64_t PkGraphicsFrameSync::GetCompletedFrameCount()
+{
+    if (s_pData->bTimelineSemaphore)
+    {
+        uint64_t value = 0;
+        if (s_pData->pfnGetSemaphoreCounterValue(PkGraphicsCore::GetDevice(), s_pData->timelineSemaphore, &value) == VK_SUCCESS)
+        {
+            raiseCompletedFrameCount(value);
+        }
+    }
+    else
+    {
+        // Frames finish in submission order, so a signalled fence also covers every frame before its own.
+        for (const PkGraphicsFrameSlot& rSlot : s_pData->slots)
+        {
+            if (rSlot.frameNumber != NO_FRAME && vkGetFenceStatus(PkGraphicsCore::GetDevice(), rSlot.fence) == VK_SUCCESS)
+            {
+                raiseCompletedFrameCount(rSlot.frameNumber + 1);
+            }
+        }
+    }
+
+    return s_pData->completedFrameCount;
+}
+
+/*static*/ void PkGraphicsFrameSync::WaitForFrame(const uint64_t frameNumber)
+{
+    if (frameNumber < s_pData->completedFrameCount.load())
+    {
+        return;
+    }
+
+    if (frameNumber >= s_pData->submittedFrameCount)
+    {
+        throw std::runtime_error("waited for a frame that hasn't been submitted!");
+    }
+
+    if (s_pData->bTimelineSemaphore)
+    {
+        const uint64_t value = frameNumber + 1;
+
+        VkSemaphoreWaitInfoKHR waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &s_pData->timelineSemaphore;
+        waitInfo.pValues = &value;
+
+        s_pData->pfnWaitSemaphores(PkGraphicsCore::GetDevice(), &waitInfo, UINT64_MAX);
+        raiseCompletedFrameCount(value);
+        return;
+    }
+
+    // The earliest frame still in a slot from this one on; waiting for it covers this one too.
+    const PkGraphicsFrameSlot* pSlot = nullptr;
+    for (const PkGraphicsFrameSlot& rSlot : s_pData->slots)
+    {
+        if (rSlot.frameNumber != NO_FRAME && rSlot.frameNumber >= frameNumber && (pSlot == nullptr || rSlot.frameNumber < pSlot->frameNumber))
+        {
+            pSlot = &rSlot;
+        }
+    }
+
+    if (pSlot != nullptr)
+    {
+        vkWaitForFences(PkGraphicsCore::GetDevice(), 1, &pSlot->fence, VK_TRUE, UINT64_MAX);
+        raiseCompletedFrameCount(pSlot->frameNumber + 1);
+    }
+}
+
+/*static*/ void PkGraphicsFrameSync::WaitForAllFrames()
+{
+    if (s_pData->submittedFrameCount > 0)
+    {
+        WaitForFrame(s_pData->submittedFrameCount - 1);
+    }
+}
+
+/*static*/ uint32_t PkGraphicsFrameSync::GetFramesInFlight()
+{
+    return s_pData->framesInFlight;
+}
+
+/*static*/ void PkGraphicsFrameSync::SetFramesInFlight(const uint32_t framesInFlight)
+{
+    s_pData->requestedFramesInFlight = std::min(std::max(framesInFlight, 1u), PK_MAX_FRAMES_IN_FLIGHT);
+}
+
+/*static*/ void PkGraphicsFrameSync::ApplyFramesInFlight()
+{
+    if (s_pData->requestedFramesInFlight != s_pData->framesInFlight)
+    {
+        // Presents may still be waiting on the slots' semaphores, so only an idle device is safe to rebuild them on.
+        vkDeviceWaitIdle(PkGraphicsCore::GetDevice());
+        raiseCompletedFrameCount(s_pData->submittedFrameCount);
+
+        destroySlots();
+        s_pData->framesInFlight = s_pData->requestedFramesInFlight;
+        createSlots();
+    }
+}
+
+/*static*/ void PkGraphicsFrameSync::BeginFrame()
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    // The frame that last used this slot.
+    if (s_pData->frameNumber >= s_pData->framesInFlight)
+    {
+        WaitForFrame(s_pData->frameNumber - s_pData->framesInFlight);
+    }
+
+    s_pData->waitMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+/*static*/ void PkGraphicsFrameSync::BeginImage(const uint32_t imageIndex)
+{
+    // With more frames in flight than swap chain images, the image's last frame may not be the slot's.
+    if (s_pData->imageFrameNumbers[imageIndex] != NO_FRAME)
+    {
+        WaitForFrame(s_pData->imageFrameNumbers[imageIndex]);
+    }
+
+    s_pData->imageFrameNumbers[imageIndex] = s_pData->frameNumber;
+}
+
+/*static*/ VkSemaphore PkGraphicsFrameSync::GetImageAvailableSemaphore()
+{
+    return getCurrentSlot().imageAvailableSemaphore;
+}
+
+/*static*/ VkSemaphore PkGraphicsFrameSync::GetRenderFinishedSemaphore()
+{
+    return getCurrentSlot().renderFinishedSemaphore;
+}
+
+/*static*/ void PkGraphicsFrameSync::Submit(VkQueue queue, const VkSubmitInfo& rSubmitInfo)
+{
+    PkGraphicsFrameSlot& rSlot = getCurrentSlot();
+    VkResult result;
+
+    if (s_pData->bTimelineSemaphore)
+    {
+        // The timeline semaphore is signalled alongside the caller's binary ones, whose values are ignored.
+        std::vector<VkSemaphore> signalSemaphores(rSubmitInfo.pSignalSemaphores, rSubmitInfo.pSignalSemaphores + rSubmitInfo.signalSemaphoreCount);
+        std::vector<uint64_t> signalValues(rSubmitInfo.signalSemaphoreCount, 0);
+        signalSemaphores.push_back(s_pData->timelineSemaphore);
+        signalValues.push_back(s_pData->frameNumber + 1);
+
+        VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.pNext = rSubmitInfo.pNext;
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo submitInfo = rSubmitInfo;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    }
+    else
+    {
+        vkResetFences(PkGraphicsCore::GetDevice(), 1, &rSlot.fence);
+        result = vkQueueSubmit(queue, 1, &rSubmitInfo, rSlot.fence);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+
+    rSlot.frameNumber = s_pData->frameNumber;
+    s_pData->submittedFrameCount = s_pData->frameNumber + 1;
+}
+
+/*static*/ void PkGraphicsFrameSync::EndFrame()
+{
+    s_pData->frameNumber++;
+}
+
+/*static*/ void PkGraphicsFrameSync::OnSwapChainCreate(const uint32_t imageCount)
+{
+    s_pData->imageFrameNumbers.assign(imageCount, NO_FRAME);
+}
+
+/*static*/ void PkGraphicsFrameSync::GetDebugState(PkGraphicsFrameSyncDebugState& rState)
+{
+    rState.bTimelineSemaphore = s_pData->bTimelineSemaphore;
+    rState.requestedFramesInFlight = s_pData->requestedFramesInFlight;
+    rState.frameNumber = s_pData->frameNumber;
+    rState.completedFrameCount = GetCompletedFrameCount();
+    rState.waitMilliseconds = s_pData->waitMilliseconds.load();
+}
+
+/*static*/ void PkGraphicsFrameSync::ShowDebugUi(const PkGraphicsFrameSyncDebugState& rState, PkGraphicsCommandList& rCommands)
+{
+    if (ImGui::CollapsingHeader("Frame pacing"))
+    {
+        ImGui::Text("Paced with %s", rState.bTimelineSemaphore ? "a timeline semaphore" : "fences");
+
+        int framesInFlight = static_cast<int>(rState.requestedFramesInFlight);
+        if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, static_cast<int>(PK_MAX_FRAMES_IN_FLIGHT)))
+        {
+            rCommands.push_back([framesInFlight] { SetFramesInFlight(static_cast<uint32_t>(framesInFlight)); });
+        }
+
+        ImGui::Text("Frame: %llu, finished on the GPU: %llu", static_cast<unsigned long long>(rState.frameNumber), static_cast<unsigned long long>(rState.completedFrameCount));
+        ImGui::Text("Waited for a free frame: %.2f ms", rState.waitMilliseconds);
+    }
+}
+
+/*static*/ void PkGraphicsFrameSync::InitialiseGraphicsFrameSync(const uint32_t imageCount)
+{
+    s_pData = new PkGraphicsFrameSyncData();
+    s_pData->bTimelineSemaphore = PkGraphicsCore::IsTimelineSemaphoreEnabled();
+
+    if (s_pData->bTimelineSemaphore)
+    {
+        createTimelineSemaphore();
+    }
+
+    createSlots();
+    OnSwapChainCreate(imageCount);
+}
+
+/*static*/ void PkGraphicsFrameSync::CleanupGraphicsFrameSync()
+{
+    destroySlots();
+    vkDestroySemaphore(PkGraphicsCore::GetDevice(), s_pData->timelineSemaphore, nullptr);
+
+    delete s_pData;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "graphics/graphicsCommands.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <stdint.h>
+
+static const uint32_t PK_MAX_FRAMES_IN_FLIGHT = 4;
+
+struct PkGraphicsFrameSyncDebugState
+{
+    bool bTimelineSemaphore = false;
+    uint32_t requestedFramesInFlight = 0;
+    uint64_t frameNumber = 0;
+    uint64_t completedFrameCount = 0;
+    float waitMilliseconds = 0.0f;
+};
+
+// Paces frames and tells the rest of the renderer which of them the GPU has finished. Frames are numbered from 0 as
+// they begin; frame n signals a timeline semaphore to n + 1 when its work completes, so the counter is the number of
+// finished frames. Without VK_KHR_timeline_semaphore a fence per frame slot stands in for it.
+class PkGraphicsFrameSync
+{
+public:
+    PkGraphicsFrameSync() = delete;
+
+    // The frame being recorded between BeginFrame and EndFrame.
+    static uint64_t GetFrameNumber();
+
+    // Frames numbered below this have finished on the GPU, so anything they alone used can be reclaimed. Never blocks.
+    static uint64_t GetCompletedFrameCount();
+    static void WaitForFrame(const uint64_t frameNumber);
+    static void WaitForAllFrames();
+
+    // 1 to PK_MAX_FRAMES_IN_FLIGHT. A change waits for the device and takes effect at the next ApplyFramesInFlight.
+    static uint32_t GetFramesInFlight();
+    static void SetFramesInFlight(const uint32_t framesInFlight);
+
+    // Rebuilds the frame slots if the number of frames in flight has changed. Call before BeginFrame, with nothing
+    // else using frame sync; everything else here may be called from another thread while BeginFrame waits.
+    static void ApplyFramesInFlight();
+
+    // Waits until the frame about to begin has a free slot.
+    static void BeginFrame();
+
+    // Waits for the last frame that rendered to the image, for per-image resources, and claims the image for this frame.
+    static void BeginImage(const uint32_t imageIndex);
+
+    // Acquire signals the first; the frame's submit signals the second for present to wait on.
+    static VkSemaphore GetImageAvailableSemaphore();
+    static VkSemaphore GetRenderFinishedSemaphore();
+
+    // Submits the frame's work, adding whatever signals its completion.
+    static void Submit(VkQueue queue, const VkSubmitInfo& rSubmitInfo);
+
+    static void EndFrame();
+
+    // Forgets which frames used which images; call when the swap chain's images are replaced.
+    static void OnSwapChainCreate(const uint32_t imageCount);
+
+    // The first is called on the render thread; the second draws what it captured and queues any changes made.
+    static void GetDebugState(PkGraphicsFrameSyncDebugState& rState);
+    static void ShowDebugUi(const PkGraphicsFrameSyncDebugState& rState, PkGraphicsCommandList& rCommands);
+
+    static void InitialiseGraphicsFrameSync(const uint32_t imageCount);
+    static void CleanupGraphicsFrameSync();
+};
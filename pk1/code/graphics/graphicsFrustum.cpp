@@ -0,0 +1,39 @@
+#include "graphicsFrustum.h"
+
+/*static*/ PkGraphicsFrustum PkGraphicsFrustum::FromViewProjection(const glm::mat4& rViewProjection)
+{
+    // glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(rViewProjection[0][i], rViewProjection[1][i], rViewProjection[2][i], rViewProjection[3][i]);
+    }
+
+    PkGraphicsFrustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];  // left
+    frustum.planes[1] = rows[3] - rows[0];  // right
+    frustum.planes[2] = rows[3] + rows[1];  // bottom
+    frustum.planes[3] = rows[3] - rows[1];  // top
+    frustum.planes[4] = rows[2];            // near
+    frustum.planes[5] = rows[3] - rows[2];  // far
+
+    for (glm::vec4& rPlane : frustum.planes)
+    {
+        rPlane /= glm::length(glm::vec3(rPlane));
+    }
+
+    return frustum;
+}
+
+bool PkGraphicsFrustum::IsSphereVisible(const glm::vec3& rCentre, const float radius) const
+{
+    for (const glm::vec4& rPlane : planes)
+    {
+        if (glm::dot(glm::vec3(rPlane), rCentre) + rPlane.w < -radius)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
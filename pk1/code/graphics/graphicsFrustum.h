@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+// Planes point inwards and are normalised, so dot(plane.xyz, p) + plane.w is the signed distance of p from the plane.
+struct PkGraphicsFrustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    // Expects a Vulkan style projection (clip space depth from 0 to w).
+    static PkGraphicsFrustum FromViewProjection(const glm::mat4& rViewProjection);
+
+    bool IsSphereVisible(const glm::vec3& rCentre, const float radius) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+// 64-bit FNV-1a, for cache keys and file names. Not for anything that has to resist deliberate collisions.
+static constexpr uint64_t PK_HASH_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr uint64_t PK_HASH_PRIME = 1099511628211ull;
+
+// Continues the hash over a run of bytes, so several runs can be hashed as one.
+inline uint64_t PkHashBytes(uint64_t hash, const void* pData, const size_t size)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= PK_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+// The raw bytes of a value, padding included, so only for types without any.
+template<typename T>
+inline uint64_t PkHashValue(const uint64_t hash, const T& rValue)
+{
+    return PkHashBytes(hash, &rValue, sizeof(T));
+}
+
+// One whole word per step rather than a byte: cheaper, and usable at compile time.
+constexpr uint64_t PkHashWord(const uint64_t hash, const uint64_t word)
+{
+    return (hash ^ word) * PK_HASH_PRIME;
+}
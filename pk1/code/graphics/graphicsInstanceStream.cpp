@@ -0,0 +1,280 @@
+#include "graphicsInstanceStream.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include <algorithm>
+
+// Upper bound on what one frame copies to the GPU; at 68 bytes an instance this is a little over 120k instances.
+static const VkDeviceSize MAX_UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+static const uint32_t BITS_PER_WORD = 64;
+
+struct PkGraphicsInstanceStreamStaging
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+};
+
+struct PkGraphicsInstanceStreamData
+{
+    std::vector<InstanceData> instances;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VmaAllocation bufferAllocation = VK_NULL_HANDLE;
+
+    // One bit per instance. The scan resumes from uploadCursor so a budget-limited frame does not starve the tail.
+    std::vector<uint64_t> dirtyWords;
+    uint32_t uploadCursor = 0;
+    uint32_t pendingCount = 0;
+
+    uint32_t uploadBudget = 0;
+    std::vector<PkGraphicsInstanceStreamStaging> staging;
+    std::vector<VkBufferCopy> copyRegions;
+
+    uint32_t uploadedInstanceCount = 0;
+    uint32_t uploadedRangeCount = 0;
+
+    bool bSwapChainCreated = false;
+};
+
+static PkGraphicsInstanceStreamData* s_pData = nullptr;
+
+static void createStagingBuffers()
+{
+    const VkDeviceSize maxInstancesPerFrame = MAX_UPLOAD_BYTES_PER_FRAME / sizeof(InstanceData);
+    s_pData->uploadBudget = static_cast<uint32_t>(std::min<VkDeviceSize>(std::max<size_t>(s_pData->instances.size(), 1), maxInstancesPerFrame));
+
+    s_pData->staging.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+
+    for (PkGraphicsInstanceStreamStaging& rStaging : s_pData->staging)
+    {
+        PkGraphicsUtils::CreateBuffer
+        (
+            PkGraphicsCore::GetAllocator(),
+            sizeof(InstanceData) * s_pData->uploadBudget,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &rStaging.buffer,
+            &rStaging.allocation
+        );
+    }
+}
+
+static void destroyStagingBuffers()
+{
+    for (PkGraphicsInstanceStreamStaging& rStaging : s_pData->staging)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rStaging.buffer, rStaging.allocation);
+    }
+
+    s_pData->staging.clear();
+}
+
+static void destroyBuffer()
+{
+    if (s_pData->buffer != VK_NULL_HANDLE)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->buffer, s_pData->bufferAllocation);
+        s_pData->buffer = VK_NULL_HANDLE;
+    }
+}
+
+static void collectDirtyRanges()
+{
+    std::vector<VkBufferCopy>& rRegions = s_pData->copyRegions;
+    rRegions.clear();
+
+    const uint32_t wordCount = static_cast<uint32_t>(s_pData->dirtyWords.size());
+    const VkDeviceSize stride = sizeof(InstanceData);
+
+    uint32_t stagedCount = 0;
+    uint32_t wordIndex = s_pData->uploadCursor;
+
+    for (uint32_t visited = 0; visited < wordCount && stagedCount < s_pData->uploadBudget; visited++)
+    {
+        wordIndex = (s_pData->uploadCursor + visited) % wordCount;
+
+        uint64_t& rWord = s_pData->dirtyWords[wordIndex];
+        for (uint32_t bit = 0; rWord != 0 && bit < BITS_PER_WORD && stagedCount < s_pData->uploadBudget; bit++)
+        {
+            const uint64_t bitMask = 1ull << bit;
+            if ((rWord & bitMask) == 0)
+            {
+                continue;
+            }
+
+            rWord &= ~bitMask;
+
+            // Neighbouring dirty instances extend the previous range rather than adding a region.
+            const VkDeviceSize dstOffset = stride * (wordIndex * BITS_PER_WORD + bit);
+            if (!rRegions.empty() && rRegions.back().dstOffset + rRegions.back().size == dstOffset)
+            {
+                rRegions.back().size += stride;
+            }
+            else
+            {
+                VkBufferCopy region{};
+                region.srcOffset = stride * stagedCount;
+                region.dstOffset = dstOffset;
+                region.size = stride;
+                rRegions.push_back(region);
+            }
+
+            stagedCount++;
+        }
+    }
+
+    s_pData->uploadCursor = wordIndex;
+    s_pData->pendingCount -= stagedCount;
+    s_pData->uploadedInstanceCount = stagedCount;
+    s_pData->uploadedRangeCount = static_cast<uint32_t>(rRegions.size());
+}
+
+/*static*/ void PkGraphicsInstanceStream::SetInstances(const std::vector<InstanceData>& rInstances)
+{
+    destroyBuffer();
+
+    s_pData->instances = rInstances;
+    s_pData->dirtyWords.assign((rInstances.size() + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
+    s_pData->uploadCursor = 0;
+    s_pData->pendingCount = 0;
+
+    PkGraphicsUtils::CreateDeviceLocalBuffer
+    (
+        PkGraphicsCore::GetDevice(),
+        PkGraphicsCore::GetAllocator(),
+        PkGraphicsCore::GetGraphicsQueue(),
+        PkGraphicsCore::GetCommandPool(),
+        rInstances.data(),
+        sizeof(InstanceData) * std::max<size_t>(rInstances.size(), 1),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        &s_pData->buffer,
+        &s_pData->bufferAllocation
+    );
+
+    if (s_pData->bSwapChainCreated)
+    {
+        destroyStagingBuffers();
+        createStagingBuffers();
+    }
+}
+
+/*static*/ const std::vector<InstanceData>& PkGraphicsInstanceStream::GetInstances()
+{
+    return s_pData->instances;
+}
+
+/*static*/ uint32_t PkGraphicsInstanceStream::GetInstanceCount()
+{
+    return static_cast<uint32_t>(s_pData->instances.size());
+}
+
+/*static*/ void PkGraphicsInstanceStream::SetInstanceTransform(const uint32_t instanceIndex, const glm::mat4& rTransform)
+{
+    s_pData->instances[instanceIndex].transform = rTransform;
+
+    uint64_t& rWord = s_pData->dirtyWords[instanceIndex / BITS_PER_WORD];
+    const uint64_t bitMask = 1ull << (instanceIndex % BITS_PER_WORD);
+
+    if ((rWord & bitMask) == 0)
+    {
+        rWord |= bitMask;
+        s_pData->pendingCount++;
+    }
+}
+
+/*static*/ VkBuffer PkGraphicsInstanceStream::GetBuffer()
+{
+    return s_pData->buffer;
+}
+
+/*static*/ void PkGraphicsInstanceStream::RecordUpload(VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+{
+    s_pData->uploadedInstanceCount = 0;
+    s_pData->uploadedRangeCount = 0;
+
+    if (s_pData->pendingCount == 0)
+    {
+        return;
+    }
+
+    collectDirtyRanges();
+
+    // Staging is per swap chain image, and only the last frame that rendered to this image read this buffer.
+    // PkGraphicsFrameSync::BeginImage has already waited for that frame to finish on the GPU, through the timeline
+    // semaphore (or its slot's fence where that is unsupported), so the buffer can be overwritten without a wait here.
+    const PkGraphicsInstanceStreamStaging& rStaging = s_pData->staging[imageIndex];
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), rStaging.allocation, &data);
+    for (const VkBufferCopy& rRegion : s_pData->copyRegions)
+    {
+        memcpy(static_cast<char*>(data) + rRegion.srcOffset, reinterpret_cast<const char*>(s_pData->instances.data()) + rRegion.dstOffset, rRegion.size);
+    }
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), rStaging.allocation);
+
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = s_pData->buffer;
+    bufferBarrier.offset = 0;
+    bufferBarrier.size = VK_WHOLE_SIZE;
+
+    // Earlier frames may still be drawing from the buffer, so the copy waits for their reads to finish.
+    bufferBarrier.srcAccessMask = 0;
+    bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, rStaging.buffer, s_pData->buffer, static_cast<uint32_t>(s_pData->copyRegions.size()), s_pData->copyRegions.data());
+
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+/*static*/ uint32_t PkGraphicsInstanceStream::GetUploadedInstanceCount()
+{
+    return s_pData->uploadedInstanceCount;
+}
+
+/*static*/ uint32_t PkGraphicsInstanceStream::GetUploadedRangeCount()
+{
+    return s_pData->uploadedRangeCount;
+}
+
+/*static*/ uint32_t PkGraphicsInstanceStream::GetPendingInstanceCount()
+{
+    return s_pData->pendingCount;
+}
+
+/*static*/ uint32_t PkGraphicsInstanceStream::GetUploadBudget()
+{
+    return s_pData->uploadBudget;
+}
+
+/*static*/ void PkGraphicsInstanceStream::OnSwapChainCreate()
+{
+    createStagingBuffers();
+    s_pData->bSwapChainCreated = true;
+}
+
+/*static*/ void PkGraphicsInstanceStream::OnSwapChainDestroy()
+{
+    s_pData->bSwapChainCreated = false;
+    destroyStagingBuffers();
+}
+
+/*static*/ void PkGraphicsInstanceStream::InitialiseGraphicsInstanceStream()
+{
+    s_pData = new PkGraphicsInstanceStreamData();
+}
+
+/*static*/ void PkGraphicsInstanceStream::CleanupGraphicsInstanceStream()
+{
+    destroyBuffer();
+
+    delete s_pData;
+}
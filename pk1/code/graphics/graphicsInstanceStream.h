@@ -0,0 +1,45 @@
+#pragma once
+
+#include "graphics/graphicsModel.h"
+
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+// Every instance in the scene, kept on the CPU and mirrored in one device local buffer. Changes mark the instance
+// in a dirty bitset and only the dirty ranges are copied up, through a staging buffer per swap chain image.
+class PkGraphicsInstanceStream
+{
+public:
+    PkGraphicsInstanceStream() = delete;
+
+    // Replaces every instance and uploads them all at once. The old buffer must no longer be in use by the GPU.
+    static void SetInstances(const std::vector<InstanceData>& rInstances);
+
+    static const std::vector<InstanceData>& GetInstances();
+    static uint32_t GetInstanceCount();
+
+    // Takes effect on the CPU straight away and reaches the buffer with a later RecordUpload.
+    static void SetInstanceTransform(const uint32_t instanceIndex, const glm::mat4& rTransform);
+
+    // Usable as a vertex buffer and as a storage buffer.
+    static VkBuffer GetBuffer();
+
+    // Copies dirty instances, up to a fixed budget per frame, and records their transfer into the buffer. Anything over
+    // the budget stays dirty for the next frame. Record outside a render pass; vertex input and compute shaders later
+    // in the command buffer see the new data.
+    static void RecordUpload(VkCommandBuffer commandBuffer, const uint32_t imageIndex);
+
+    static uint32_t GetUploadedInstanceCount();
+    static uint32_t GetUploadedRangeCount();
+    static uint32_t GetPendingInstanceCount();
+    static uint32_t GetUploadBudget();
+
+    static void OnSwapChainCreate();
+    static void OnSwapChainDestroy();
+
+    static void InitialiseGraphicsInstanceStream();
+    static void CleanupGraphicsInstanceStream();
+};
@@ -0,0 +1,448 @@
+#include "graphicsLatency.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsFrameSync.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> PkGraphicsLatencyTime;
+
+// Frames are kept until the display is done with them, which may be a few frames after the GPU is.
+static const uint32_t FRAME_HISTORY_SIZE = 8;
+
+// How much earlier than the estimate the CPU wakes, to absorb jitter in its own frame time.
+static const float SLEEP_MARGIN_MILLISECONDS = 1.0f;
+
+// Shorter waits are taken as not having blocked at all.
+static const float BLOCKED_MILLISECONDS = 0.1f;
+
+// A present that takes longer than this to reach the display, such as to a minimised window, is given up on.
+static const uint64_t PRESENT_WAIT_TIMEOUT_NANOSECONDS = 100000000;
+
+static const float SMOOTHING = 0.1f;
+
+static const uint64_t NO_FRAME = UINT64_MAX;
+
+struct PkGraphicsLatencyFrame
+{
+    uint64_t frameNumber = NO_FRAME;
+    PkGraphicsLatencyTime inputTime;
+    bool bSubmitted = false;
+    bool bCompleted = false;
+
+    // 0 until the frame has been presented with an id.
+    uint64_t presentId = 0;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+};
+
+struct PkGraphicsLatencyData
+{
+    std::atomic<bool> bSleepEnabled{ false };
+
+    bool bTimestampsEnabled = false;
+    float timestampPeriod = 1.0f;
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    // One pair per frame in flight, so a frame's results are read before its queries are reused.
+    VkCommandBuffer frameStartCommandBuffers[PK_MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer frameEndCommandBuffers[PK_MAX_FRAMES_IN_FLIGHT];
+
+    PFN_vkWaitForPresentKHR pfnWaitForPresent = nullptr;
+
+    PkGraphicsLatencyFrame frames[FRAME_HISTORY_SIZE];
+
+    PkGraphicsLatencyTime lastPresentTime;
+    bool bHasPresented = false;
+
+    float cpuMilliseconds = 0.0f;
+    float gpuMilliseconds = 0.0f;
+    float displayIntervalMilliseconds = 0.0f;
+    float sleepMilliseconds = 0.0f;
+    float latencyMilliseconds = 0.0f;
+};
+
+static PkGraphicsLatencyData* s_pData = nullptr;
+
+static float getMilliseconds(const PkGraphicsLatencyTime& rStart, const PkGraphicsLatencyTime& rEnd)
+{
+    return std::chrono::duration<float, std::chrono::milliseconds::period>(rEnd - rStart).count();
+}
+
+static void smooth(float& rAverage, const float value)
+{
+    rAverage = rAverage == 0.0f ? value : rAverage + (value - rAverage) * SMOOTHING;
+}
+
+static PkGraphicsLatencyFrame& getFrame(const uint64_t frameNumber)
+{
+    return s_pData->frames[frameNumber % FRAME_HISTORY_SIZE];
+}
+
+static const char* getPresentModeName(const VkPresentModeKHR presentMode)
+{
+    switch (presentMode)
+    {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO relaxed";
+    default: return "Other";
+    }
+}
+
+// Waits for the frame to be displayed where presents can be waited on, otherwise for the GPU to finish it.
+static void waitForFrameOutput(const uint64_t frameNumber)
+{
+    const PkGraphicsLatencyFrame& rFrame = getFrame(frameNumber);
+
+    if (rFrame.frameNumber == frameNumber && rFrame.presentId != 0 && rFrame.swapChain == PkGraphicsSwapChain::GetSwapChain())
+    {
+        s_pData->pfnWaitForPresent(PkGraphicsCore::GetDevice(), rFrame.swapChain, rFrame.presentId, PRESENT_WAIT_TIMEOUT_NANOSECONDS);
+    }
+    else
+    {
+        PkGraphicsFrameSync::WaitForFrame(frameNumber);
+    }
+}
+
+static void readTimestamps(const uint64_t frameNumber)
+{
+    const uint32_t firstQuery = static_cast<uint32_t>(frameNumber % PK_MAX_FRAMES_IN_FLIGHT) * 2;
+    uint64_t timestamps[2];
+
+    if (vkGetQueryPoolResults(PkGraphicsCore::GetDevice(), s_pData->queryPool, firstQuery, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS &&
+        timestamps[1] > timestamps[0])
+    {
+        smooth(s_pData->gpuMilliseconds, static_cast<float>(timestamps[1] - timestamps[0]) * s_pData->timestampPeriod / 1000000.0f);
+    }
+}
+
+static void createTimestampCommandBuffers()
+{
+    VkPhysicalDeviceProperties properties;
+    PkGraphicsCore::GetPhysicalDeviceProperties(&properties);
+
+    s_pData->bTimestampsEnabled = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+    s_pData->timestampPeriod = properties.limits.timestampPeriod;
+
+    if (s_pData->bTimestampsEnabled)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = PK_MAX_FRAMES_IN_FLIGHT * 2;
+
+        if (vkCreateQueryPool(PkGraphicsCore::GetDevice(), &queryPoolInfo, nullptr, &s_pData->queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics command pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = s_pData->commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = PK_MAX_FRAMES_IN_FLIGHT;
+
+    if (vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, s_pData->frameStartCommandBuffers) != VK_SUCCESS ||
+        vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, s_pData->frameEndCommandBuffers) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+
+    // Recorded once and resubmitted; without timestamp support they are left empty so the submit stays the same.
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    for (uint32_t i = 0; i < PK_MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        vkBeginCommandBuffer(s_pData->frameStartCommandBuffers[i], &beginInfo);
+        if (s_pData->bTimestampsEnabled)
+        {
+            vkCmdResetQueryPool(s_pData->frameStartCommandBuffers[i], s_pData->queryPool, i * 2, 2);
+            vkCmdWriteTimestamp(s_pData->frameStartCommandBuffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s_pData->queryPool, i * 2);
+        }
+        vkEndCommandBuffer(s_pData->frameStartCommandBuffers[i]);
+
+        vkBeginCommandBuffer(s_pData->frameEndCommandBuffers[i], &beginInfo);
+        if (s_pData->bTimestampsEnabled)
+        {
+            vkCmdWriteTimestamp(s_pData->frameEndCommandBuffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s_pData->queryPool, i * 2 + 1);
+        }
+        vkEndCommandBuffer(s_pData->frameEndCommandBuffers[i]);
+    }
+}
+
+static void destroyTimestampCommandBuffers()
+{
+    vkDestroyCommandPool(PkGraphicsCore::GetDevice(), s_pData->commandPool, nullptr);
+    vkDestroyQueryPool(PkGraphicsCore::GetDevice(), s_pData->queryPool, nullptr);
+}
+
+/*static*/ void PkGraphicsLatency::SleepBeforeInput()
+{
+    const uint64_t frameNumber = PkGraphicsFrameSync::GetFrameNumber();
+    s_pData->sleepMilliseconds = 0.0f;
+
+    if (s_pData->bSleepEnabled.load() && frameNumber >= 2)
+    {
+        const PkGraphicsLatencyTime startTime = std::chrono::high_resolution_clock::now();
+
+        // Only the previous frame may be queued ahead of this one.
+        waitForFrameOutput(frameNumber - 2);
+
+        const PkGraphicsLatencyTime unblockedTime = std::chrono::high_resolution_clock::now();
+
+        // Blocking means the GPU or display is the bottleneck and has only just moved on to the previous frame. It will
+        // be through it in about a frame, so input is sampled late enough for this frame to be submitted just as it is.
+        if (getMilliseconds(startTime, unblockedTime) > BLOCKED_MILLISECONDS)
+        {
+            float frameMilliseconds = s_pData->gpuMilliseconds;
+            if (PkGraphicsCore::IsPresentWaitEnabled())
+            {
+                frameMilliseconds = std::max(frameMilliseconds, s_pData->displayIntervalMilliseconds);
+            }
+
+            const float sleepMilliseconds = frameMilliseconds - s_pData->cpuMilliseconds - SLEEP_MARGIN_MILLISECONDS;
+            if (sleepMilliseconds > 0.0f)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<float, std::chrono::milliseconds::period>(sleepMilliseconds));
+            }
+        }
+
+        s_pData->sleepMilliseconds = getMilliseconds(startTime, std::chrono::high_resolution_clock::now());
+    }
+}
+
+/*static*/ void PkGraphicsLatency::SetInputTime(const std::chrono::time_point<std::chrono::high_resolution_clock>& rInputTime)
+{
+    const uint64_t frameNumber = PkGraphicsFrameSync::GetFrameNumber();
+
+    PkGraphicsLatencyFrame& rFrame = getFrame(frameNumber);
+    rFrame = PkGraphicsLatencyFrame{};
+    rFrame.frameNumber = frameNumber;
+    rFrame.inputTime = rInputTime;
+}
+
+/*static*/ bool PkGraphicsLatency::IsSleepEnabled()
+{
+    return s_pData->bSleepEnabled.load();
+}
+
+/*static*/ void PkGraphicsLatency::SetSleepEnabled(const bool bEnabled)
+{
+    s_pData->bSleepEnabled = bEnabled;
+}
+
+/*static*/ void PkGraphicsLatency::Update()
+{
+    const uint64_t completedFrameCount = PkGraphicsFrameSync::GetCompletedFrameCount();
+    const PkGraphicsLatencyTime now = std::chrono::high_resolution_clock::now();
+
+    // Timings are only noticed here, so each one can be late by up to a frame of CPU time.
+    for (PkGraphicsLatencyFrame& rFrame : s_pData->frames)
+    {
+        if (rFrame.frameNumber == NO_FRAME || !rFrame.bSubmitted)
+        {
+            continue;
+        }
+
+        if (!rFrame.bCompleted && rFrame.frameNumber < completedFrameCount)
+        {
+            rFrame.bCompleted = true;
+
+            if (s_pData->bTimestampsEnabled)
+            {
+                readTimestamps(rFrame.frameNumber);
+            }
+
+            if (rFrame.presentId == 0)
+            {
+                smooth(s_pData->latencyMilliseconds, getMilliseconds(rFrame.inputTime, now));
+            }
+        }
+
+        if (rFrame.presentId != 0)
+        {
+            // Presents to a retired swap chain can't be waited on any more.
+            if (rFrame.swapChain != PkGraphicsSwapChain::GetSwapChain())
+            {
+                rFrame.presentId = 0;
+            }
+            else if (s_pData->pfnWaitForPresent(PkGraphicsCore::GetDevice(), rFrame.swapChain, rFrame.presentId, 0) == VK_SUCCESS)
+            {
+                smooth(s_pData->latencyMilliseconds, getMilliseconds(rFrame.inputTime, now));
+
+                if (s_pData->bHasPresented)
+                {
+                    smooth(s_pData->displayIntervalMilliseconds, getMilliseconds(s_pData->lastPresentTime, now));
+                }
+                s_pData->lastPresentTime = now;
+                s_pData->bHasPresented = true;
+
+                rFrame.presentId = 0;
+            }
+        }
+    }
+}
+
+/*static*/ VkCommandBuffer PkGraphicsLatency::GetFrameStartCommandBuffer()
+{
+    return s_pData->frameStartCommandBuffers[PkGraphicsFrameSync::GetFrameNumber() % PK_MAX_FRAMES_IN_FLIGHT];
+}
+
+/*static*/ VkCommandBuffer PkGraphicsLatency::GetFrameEndCommandBuffer()
+{
+    return s_pData->frameEndCommandBuffers[PkGraphicsFrameSync::GetFrameNumber() % PK_MAX_FRAMES_IN_FLIGHT];
+}
+
+/*static*/ void PkGraphicsLatency::OnSubmit()
+{
+    PkGraphicsLatencyFrame& rFrame = getFrame(PkGraphicsFrameSync::GetFrameNumber());
+
+    if (rFrame.frameNumber == PkGraphicsFrameSync::GetFrameNumber())
+    {
+        rFrame.bSubmitted = true;
+        smooth(s_pData->cpuMilliseconds, getMilliseconds(rFrame.inputTime, std::chrono::high_resolution_clock::now()));
+    }
+}
+
+/*static*/ uint64_t PkGraphicsLatency::GetPresentId()
+{
+    // Ids only have to increase, and frame numbers do.
+    return PkGraphicsFrameSync::GetFrameNumber() + 1;
+}
+
+/*static*/ void PkGraphicsLatency::OnPresent(VkSwapchainKHR swapChain)
+{
+    PkGraphicsLatencyFrame& rFrame = getFrame(PkGraphicsFrameSync::GetFrameNumber());
+
+    if (PkGraphicsCore::IsPresentWaitEnabled() && rFrame.frameNumber == PkGraphicsFrameSync::GetFrameNumber())
+    {
+        rFrame.presentId = GetPresentId();
+        rFrame.swapChain = swapChain;
+    }
+}
+
+/*static*/ float PkGraphicsLatency::GetLatencyMilliseconds()
+{
+    return s_pData->latencyMilliseconds;
+}
+
+/*static*/ void PkGraphicsLatency::GetDebugState(PkGraphicsLatencyDebugState& rState)
+{
+    rState.bSleepEnabled = s_pData->bSleepEnabled.load();
+    rState.bTimestampsEnabled = s_pData->bTimestampsEnabled;
+    rState.bPresentWaitEnabled = PkGraphicsCore::IsPresentWaitEnabled();
+
+    rState.requestedPresentMode = PkGraphicsSwapChain::GetRequestedPresentMode();
+    rState.presentMode = PkGraphicsSwapChain::GetPresentMode();
+    rState.availablePresentModes = PkGraphicsSwapChain::GetAvailablePresentModes();
+
+    rState.requestedImageCount = PkGraphicsSwapChain::GetRequestedImageCount();
+    rState.minImageCount = PkGraphicsSwapChain::GetMinImageCount();
+    rState.maxImageCount = PkGraphicsSwapChain::GetMaxImageCount();
+    rState.imageCount = PkGraphicsSwapChain::GetNumSwapChainImages();
+
+    rState.cpuMilliseconds = s_pData->cpuMilliseconds;
+    rState.gpuMilliseconds = s_pData->gpuMilliseconds;
+    rState.displayIntervalMilliseconds = s_pData->displayIntervalMilliseconds;
+    rState.sleepMilliseconds = s_pData->sleepMilliseconds;
+    rState.latencyMilliseconds = s_pData->latencyMilliseconds;
+}
+
+/*static*/ void PkGraphicsLatency::ShowDebugUi(const PkGraphicsLatencyDebugState& rState, PkGraphicsCommandList& rCommands)
+{
+    if (ImGui::CollapsingHeader("Latency"))
+    {
+        bool bSleepEnabled = rState.bSleepEnabled;
+        if (ImGui::Checkbox("Sleep before input", &bSleepEnabled))
+        {
+            rCommands.push_back([bSleepEnabled] { SetSleepEnabled(bSleepEnabled); });
+        }
+
+        if (ImGui::BeginCombo("Present mode", getPresentModeName(rState.requestedPresentMode)))
+        {
+            for (const VkPresentModeKHR presentMode : rState.availablePresentModes)
+            {
+                if (ImGui::Selectable(getPresentModeName(presentMode), presentMode == rState.requestedPresentMode))
+                {
+                    rCommands.push_back([presentMode] { PkGraphicsSwapChain::SetRequestedPresentMode(presentMode); });
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        // 0 keeps the default of one more than the minimum.
+        const uint32_t maxImageCount = rState.maxImageCount > 0 ? rState.maxImageCount : rState.minImageCount + 2;
+        int imageCount = static_cast<int>(rState.requestedImageCount);
+        if (ImGui::SliderInt("Swap chain images", &imageCount, 0, static_cast<int>(maxImageCount), imageCount == 0 ? "default" : "%d"))
+        {
+            rCommands.push_back([imageCount] { PkGraphicsSwapChain::SetRequestedImageCount(static_cast<uint32_t>(imageCount)); });
+        }
+
+        ImGui::Text("Presenting with %s to %u images", getPresentModeName(rState.presentMode), rState.imageCount);
+
+        if (rState.bTimestampsEnabled)
+        {
+            ImGui::Text("CPU: %.2f ms, GPU: %.2f ms, slept: %.2f ms", rState.cpuMilliseconds, rState.gpuMilliseconds, rState.sleepMilliseconds);
+        }
+        else
+        {
+            ImGui::Text("CPU: %.2f ms, GPU: not timed, slept: %.2f ms", rState.cpuMilliseconds, rState.sleepMilliseconds);
+        }
+
+        if (rState.bPresentWaitEnabled)
+        {
+            ImGui::Text("Display interval: %.2f ms", rState.displayIntervalMilliseconds);
+            ImGui::Text("Input to display: %.2f ms", rState.latencyMilliseconds);
+        }
+        else
+        {
+            ImGui::Text("Input to GPU finished: %.2f ms (no VK_KHR_present_wait)", rState.latencyMilliseconds);
+        }
+    }
+}
+
+/*static*/ void PkGraphicsLatency::InitialiseGraphicsLatency()
+{
+    s_pData = new PkGraphicsLatencyData();
+
+    if (PkGraphicsCore::IsPresentWaitEnabled())
+    {
+        s_pData->pfnWaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkWaitForPresentKHR");
+        if (s_pData->pfnWaitForPresent == nullptr)
+        {
+            throw std::runtime_error("failed to load vkWaitForPresentKHR!");
+        }
+    }
+
+    createTimestampCommandBuffers();
+}
+
+/*static*/ void PkGraphicsLatency::CleanupGraphicsLatency()
+{
+    destroyTimestampCommandBuffers();
+
+    delete s_pData;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "graphics/graphicsCommands.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+struct PkGraphicsLatencyDebugState
+{
+    bool bSleepEnabled = false;
+    bool bTimestampsEnabled = false;
+    bool bPresentWaitEnabled = false;
+
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    std::vector<VkPresentModeKHR> availablePresentModes;
+
+    uint32_t requestedImageCount = 0;
+    uint32_t minImageCount = 0;
+    uint32_t maxImageCount = 0;
+    uint32_t imageCount = 0;
+
+    float cpuMilliseconds = 0.0f;
+    float gpuMilliseconds = 0.0f;
+    float displayIntervalMilliseconds = 0.0f;
+    float sleepMilliseconds = 0.0f;
+    float latencyMilliseconds = 0.0f;
+};
+
+// Measures input-to-photon latency and, in low-latency mode, keeps the CPU from running ahead of the GPU. Each frame is
+// timed on the GPU with a pair of timestamps; where VK_KHR_present_wait is enabled its presents are also timed to the
+// display, otherwise latency is only measured up to the GPU finishing the frame.
+class PkGraphicsLatency
+{
+public:
+    PkGraphicsLatency() = delete;
+
+    // Call before input is sampled for the next frame. In low-latency mode it waits until at most one frame is queued
+    // ahead, then sleeps for as long as the GPU or display will take to get through it less the CPU's own time.
+    static void SleepBeforeInput();
+
+    // When the next frame's input was sampled, which its latency is measured from; call before it begins.
+    static void SetInputTime(const std::chrono::time_point<std::chrono::high_resolution_clock>& rInputTime);
+
+    // May be called from any thread; the game thread checks it to decide whether to wait for the renderer.
+    static bool IsSleepEnabled();
+    static void SetSleepEnabled(const bool bEnabled);
+
+    // Collects the timings of frames the GPU or display has finished with; call once per frame after it begins.
+    static void Update();
+
+    // Submit the frame's work between these; they write its GPU timestamps.
+    static VkCommandBuffer GetFrameStartCommandBuffer();
+    static VkCommandBuffer GetFrameEndCommandBuffer();
+
+    static void OnSubmit();
+
+    // The VK_KHR_present_id of the frame being presented, and the swap chain it was presented to once it has been.
+    static uint64_t GetPresentId();
+    static void OnPresent(VkSwapchainKHR swapChain);
+
+    // Smoothed over recent frames; 0 until something has been measured.
+    static float GetLatencyMilliseconds();
+
+    // The first is called on the render thread; the second draws what it captured and queues any changes made.
+    static void GetDebugState(PkGraphicsLatencyDebugState& rState);
+    static void ShowDebugUi(const PkGraphicsLatencyDebugState& rState, PkGraphicsCommandList& rCommands);
+
+    static void InitialiseGraphicsLatency();
+    static void CleanupGraphicsLatency();
+};
@@ -0,0 +1,132 @@
+#include "graphicsLayoutCache.h"
+
+#include "graphics/graphicsCore.h"
+
+#include "imgui/imgui.h"
+
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <stdint.h>
+
+// Every field of a layout's create info, so equal keys are equal layouts rather than a hash that might collide.
+typedef std::vector<uint64_t> PkGraphicsLayoutKey;
+
+struct PkGraphicsLayoutCacheData
+{
+    // Guards everything below.
+    std::mutex mutex;
+    std::map<PkGraphicsLayoutKey, VkDescriptorSetLayout> descriptorSetLayouts;
+    std::map<PkGraphicsLayoutKey, VkPipelineLayout> pipelineLayouts;
+    uint32_t requestCount = 0;
+};
+
+static PkGraphicsLayoutCacheData* s_pData = nullptr;
+
+/*static*/ VkDescriptorSetLayout PkGraphicsLayoutCache::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& rBindings)
+{
+    PkGraphicsLayoutKey key;
+    for (const VkDescriptorSetLayoutBinding& rBinding : rBindings)
+    {
+        if (rBinding.pImmutableSamplers != nullptr)
+        {
+            throw std::runtime_error("immutable samplers can't be cached!");
+        }
+
+        key.insert(key.end(), { rBinding.binding, static_cast<uint64_t>(rBinding.descriptorType), rBinding.descriptorCount, rBinding.stageFlags });
+    }
+
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+    s_pData->requestCount++;
+
+    auto it = s_pData->descriptorSetLayouts.find(key);
+    if (it != s_pData->descriptorSetLayouts.end())
+    {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(rBindings.size());
+    layoutInfo.pBindings = rBindings.data();
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    if (vkCreateDescriptorSetLayout(PkGraphicsCore::GetDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+
+    s_pData->descriptorSetLayouts.emplace(key, descriptorSetLayout);
+    return descriptorSetLayout;
+}
+
+/*static*/ VkPipelineLayout PkGraphicsLayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& rSetLayouts, const std::vector<VkPushConstantRange>& rPushConstantRanges)
+{
+    PkGraphicsLayoutKey key;
+    key.push_back(rSetLayouts.size());
+    for (VkDescriptorSetLayout setLayout : rSetLayouts)
+    {
+        key.push_back(reinterpret_cast<uint64_t>(setLayout));
+    }
+    for (const VkPushConstantRange& rRange : rPushConstantRanges)
+    {
+        key.insert(key.end(), { rRange.stageFlags, rRange.offset, rRange.size });
+    }
+
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+    s_pData->requestCount++;
+
+    auto it = s_pData->pipelineLayouts.find(key);
+    if (it != s_pData->pipelineLayouts.end())
+    {
+        return it->second;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(rSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = rSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(rPushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = rPushConstantRanges.data();
+
+    VkPipelineLayout pipelineLayout;
+    if (vkCreatePipelineLayout(PkGraphicsCore::GetDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    s_pData->pipelineLayouts.emplace(key, pipelineLayout);
+    return pipelineLayout;
+}
+
+/*static*/ void PkGraphicsLayoutCache::ShowDebugUi()
+{
+    if (ImGui::CollapsingHeader("Layout cache"))
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        ImGui::Text("Descriptor set layouts: %u", static_cast<uint32_t>(s_pData->descriptorSetLayouts.size()));
+        ImGui::Text("Pipeline layouts: %u", static_cast<uint32_t>(s_pData->pipelineLayouts.size()));
+        ImGui::Text("Requests: %u", s_pData->requestCount);
+    }
+}
+
+/*static*/ void PkGraphicsLayoutCache::InitialiseGraphicsLayoutCache()
+{
+    s_pData = new PkGraphicsLayoutCacheData();
+}
+
+/*static*/ void PkGraphicsLayoutCache::CleanupGraphicsLayoutCache()
+{
+    for (auto& rLayout : s_pData->pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(PkGraphicsCore::GetDevice(), rLayout.second, nullptr);
+    }
+
+    for (auto& rLayout : s_pData->descriptorSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(PkGraphicsCore::GetDevice(), rLayout.second, nullptr);
+    }
+
+    delete s_pData;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+
+// Descriptor set and pipeline layouts shared between every caller that asks for an identical one, so pipeline
+// permutations reuse layouts instead of each making their own. Layouts live until the cache is cleaned up.
+class PkGraphicsLayoutCache
+{
+public:
+    PkGraphicsLayoutCache() = delete;
+
+    // Bindings are compared in the order given; PkGraphicsReflection returns them sorted.
+    static VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& rBindings);
+    static VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& rSetLayouts, const std::vector<VkPushConstantRange>& rPushConstantRanges);
+
+    static void ShowDebugUi();
+
+    static void InitialiseGraphicsLayoutCache();
+    static void CleanupGraphicsLayoutCache();
+};
@@ -1,8 +1,8 @@
 #include "graphicsModel.h"
 
 #include "graphics/graphicsCore.h"
-#include "graphics/graphicsSwapChain.h"
 #include "graphics/graphicsUtils.h"
+#include "jobs/jobSystem.h"
 
 #include <vk_mem_alloc.h>
 
@@ -12,6 +12,9 @@
 #include <stb_image.h>
 #include <tiny_obj_loader.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <unordered_map>
 #include <iostream>
 
@@ -26,25 +29,48 @@ namespace std
     };
 }
 
-struct UniformBufferObject
+// Cells across the mesh's bounding sphere for each coarser level of detail; see generateLods.
+static const uint32_t LOD_GRID_RESOLUTIONS[PK_MAX_MESH_LODS - 1] = { 24, 8 };
+
+struct PkGraphicsMeshLod
 {
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
 };
 
-struct PkGraphicsModelData
+struct PkGraphicsMesh
 {
-    std::string modelPath;
-    std::string texturePath;
+    std::string path;
+    uint32_t id = 0;
+    uint32_t refCount = 0;
 
-    glm::mat4 matrix = glm::mat4(1.0f);
+    std::vector<Vertex> vertices;
+    VkBuffer vertexBuffer;
+    VmaAllocation vertexBufferAllocation;
 
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VmaAllocation> uniformBufferAllocations;
+    // Every level of detail shares the vertices; their indices follow each other in one buffer.
+    std::vector<uint32_t> indices;
+    VkBuffer indexBuffer;
+    VmaAllocation indexBufferAllocation;
+    std::vector<PkGraphicsMeshLod> lods;
 
-    VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    // Local space centre in xyz, radius in w.
+    glm::vec4 boundingSphere = glm::vec4(0.0f);
+};
+
+// Texture pixels decoded ahead of creating the material they are for.
+struct PkGraphicsDecodedTexture
+{
+    stbi_uc* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+};
+
+struct PkGraphicsMaterial
+{
+    std::string path;
+    uint32_t id = 0;
+    uint32_t refCount = 0;
 
     VkImage textureImage;
     VkImageView textureImageView;
@@ -52,19 +78,29 @@ struct PkGraphicsModelData
     uint32_t mipLevels;
     VkSampler textureSampler;
 
-    std::vector<InstanceData> instances;
-    VkBuffer instanceBuffer;
-    VmaAllocation instanceBufferAllocation;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+};
 
-    std::vector<Vertex> vertices;
-    VkBuffer vertexBuffer;
-    VmaAllocation vertexBufferAllocation;
+struct PkGraphicsModelData
+{
+    PkGraphicsMesh* pMesh = nullptr;
+    PkGraphicsMaterial* pMaterial = nullptr;
 
-    std::vector<uint32_t> indices;
-    VkBuffer indexBuffer;
-    VmaAllocation indexBufferAllocation;
+    glm::mat4 matrix = glm::mat4(1.0f);
+
+    std::vector<InstanceData> instances;
+
+    std::vector<glm::vec3> occluderVertices;
+    std::vector<uint32_t> occluderIndices;
 };
 
+// Models loaded from the same files share one mesh and one material, so draws of them can skip rebinding.
+static std::unordered_map<std::string, PkGraphicsMesh*> s_meshes;
+static std::unordered_map<std::string, PkGraphicsMaterial*> s_materials;
+static uint32_t s_nextMeshId = 0;
+static uint32_t s_nextMaterialId = 0;
+
 static void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation)
 {
     VkBufferCreateInfo bufferInfo{};
@@ -257,110 +293,65 @@ static void transitionImageLayout(VkCommandPool commandPool, VkImage image, VkFo
     PkGraphicsUtils::EndSingleTimeCommands(PkGraphicsCore::GetDevice(), PkGraphicsCore::GetGraphicsQueue(), commandPool, commandBuffer);
 }
 
-static void createUniformBuffers(PkGraphicsModelData& rData)
+static void createDescriptorSet(PkGraphicsMaterial& rMaterial, VkDescriptorSetLayout descriptorSetLayout)
 {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-    size_t bufferCount = PkGraphicsSwapChain::GetNumSwapChainImages();
-
-    rData.uniformBuffers.resize(bufferCount);
-    rData.uniformBufferAllocations.resize(bufferCount);
-
-    for (size_t i = 0; i < bufferCount; i++)
-    {
-        createBuffer
-        (
-            bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &rData.uniformBuffers[i],
-            &rData.uniformBufferAllocations[i]
-        );
-    }
-}
-
-static void destroyUniformBuffers(PkGraphicsModelData& rData)
-{
-    size_t bufferCount = PkGraphicsSwapChain::GetNumSwapChainImages();
-
-    for (size_t i = 0; i < bufferCount; i++)
-    {
-        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rData.uniformBuffers[i], rData.uniformBufferAllocations[i]);
-    }
-}
-
-static void createDescriptorPool(PkGraphicsModelData& rData)
-{
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = PkGraphicsSwapChain::GetNumSwapChainImages();
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = PkGraphicsSwapChain::GetNumSwapChainImages();
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = PkGraphicsSwapChain::GetNumSwapChainImages();
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
 
-    if (vkCreateDescriptorPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &rData.descriptorPool) != VK_SUCCESS)
+    if (vkCreateDescriptorPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &rMaterial.descriptorPool) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create descriptor pool!");
     }
-}
 
-static void createDescriptorSets(PkGraphicsModelData& rData, VkDescriptorSetLayout descriptorSetLayout)
-{
-    std::vector<VkDescriptorSetLayout> layouts(PkGraphicsSwapChain::GetNumSwapChainImages(), descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = rData.descriptorPool;
-    allocInfo.descriptorSetCount = PkGraphicsSwapChain::GetNumSwapChainImages();
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorPool = rMaterial.descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
 
-    rData.descriptorSets.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
-    if (vkAllocateDescriptorSets(PkGraphicsCore::GetDevice(), &allocInfo, rData.descriptorSets.data()) != VK_SUCCESS)
+    if (vkAllocateDescriptorSets(PkGraphicsCore::GetDevice(), &allocInfo, &rMaterial.descriptorSet) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
-    for (size_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
-    {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = rData.uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = rData.textureImageView;
-        imageInfo.sampler = rData.textureSampler;
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = rData.descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = rData.descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-
-        vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-    }
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = rMaterial.textureImageView;
+    imageInfo.sampler = rMaterial.textureSampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = rMaterial.descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+// Touches nothing shared, so it can run as a job.
+static void decodeTexture(const char* pTexturePath, PkGraphicsDecodedTexture& rTexture)
+{
+    int texChannels;
+    rTexture.pixels = stbi_load(pTexturePath, &rTexture.width, &rTexture.height, &texChannels, STBI_rgb_alpha);
 }
 
-static void createTextureImage(PkGraphicsModelData& rData)
+static void createTextureImage(PkGraphicsMaterial& rData, PkGraphicsDecodedTexture& rTexture)
 {
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(rData.texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    const int texWidth = rTexture.width;
+    const int texHeight = rTexture.height;
+    stbi_uc* pixels = rTexture.pixels;
+    rTexture.pixels = nullptr;
+
     VkDeviceSize imageSize = texWidth * texHeight * 4;
     rData.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
@@ -422,7 +413,7 @@ static void createTextureImage(PkGraphicsModelData& rData)
     generateMipmaps(PkGraphicsCore::GetCommandPool(), rData.textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, rData.mipLevels);
 }
 
-static void createTextureSampler(PkGraphicsModelData& rData)
+static void createTextureSampler(PkGraphicsMaterial& rData)
 {
     VkPhysicalDeviceProperties properties{};
     PkGraphicsCore::GetPhysicalDeviceProperties(&properties);
@@ -451,53 +442,114 @@ static void createTextureSampler(PkGraphicsModelData& rData)
     }
 }
 
-static void populateInstanceData(PkGraphicsModelData& rData)
+static void populateInstanceData(PkGraphicsModelData& rData, const uint32_t boardDimensions)
 {
-    uint32_t boardDimensions = 1;
-
     const uint32_t instanceCount = boardDimensions * boardDimensions;
 
     rData.instances.resize(instanceCount);
 
-    float tileSize = 1.5f;
-
-    float rowStat = tileSize * boardDimensions / static_cast<float>(2.0f);
-
-    float x = 0.0f;// -rowStat;
-    float y = 0.0f;// -rowStat;
-    uint32_t xStep = 0;
+    // A square board of tiles centred on the model's origin, each turned a quarter more than the last.
+    const float tileSize = 1.5f;
+    const float boardOffset = tileSize * (boardDimensions - 1) * 0.5f;
 
     float rot = 0.0f;
 
     for (uint32_t i = 0; i < instanceCount; i++)
     {
-        rData.instances[i].pos = glm::vec3(x, y, 0.0f);
-        rData.instances[i].rot = glm::radians(rot);
+        const float x = tileSize * (i % boardDimensions) - boardOffset;
+        const float y = tileSize * (i / boardDimensions) - boardOffset;
+
+        rData.instances[i].transform = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)), glm::radians(rot), glm::vec3(0.0f, 0.0f, 1.0f));
+        rData.instances[i].objectIndex = 0;
 
         rot += 90.0f;
+    }
+}
+
+static void computeBoundingSphere(PkGraphicsMesh& rData)
+{
+    if (rData.vertices.empty())
+    {
+        return;
+    }
+
+    glm::vec3 minPos = rData.vertices[0].pos;
+    glm::vec3 maxPos = rData.vertices[0].pos;
+
+    for (const Vertex& rVertex : rData.vertices)
+    {
+        minPos = glm::min(minPos, rVertex.pos);
+        maxPos = glm::max(maxPos, rVertex.pos);
+    }
+
+    // Centred on the bounding box; not the tightest sphere but cheap and never too small.
+    const glm::vec3 centre = (minPos + maxPos) * 0.5f;
+
+    float radiusSquared = 0.0f;
+    for (const Vertex& rVertex : rData.vertices)
+    {
+        const glm::vec3 offset = rVertex.pos - centre;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+
+    rData.boundingSphere = glm::vec4(centre, std::sqrt(radiusSquared));
+}
+
+// Vertex clustering: snap every vertex to a grid cell, let the first vertex in each cell stand in for the rest, and
+// drop the triangles that collapse. Coarse, but it needs no new vertices and works on any mesh.
+static void generateLods(PkGraphicsMesh& rData)
+{
+    const uint32_t baseIndexCount = static_cast<uint32_t>(rData.indices.size());
 
-        xStep++;
-        if (xStep >= boardDimensions)
+    rData.lods.clear();
+    rData.lods.push_back(PkGraphicsMeshLod{ 0, baseIndexCount });
+
+    const glm::vec3 gridMin = glm::vec3(rData.boundingSphere) - glm::vec3(rData.boundingSphere.w);
+    std::vector<uint32_t> remap(rData.vertices.size());
+
+    for (const uint32_t gridResolution : LOD_GRID_RESOLUTIONS)
+    {
+        const float cellSize = std::max(2.0f * rData.boundingSphere.w / gridResolution, std::numeric_limits<float>::min());
+        std::unordered_map<uint64_t, uint32_t> cellVertices;
+
+        for (uint32_t i = 0; i < rData.vertices.size(); i++)
         {
-            xStep = 0;
-            y += tileSize;
-            x = -rowStat;
+            const glm::vec3 cell = glm::floor((rData.vertices[i].pos - gridMin) / cellSize);
+            const uint64_t key = (static_cast<uint64_t>(cell.x) << 42) | (static_cast<uint64_t>(cell.y) << 21) | static_cast<uint64_t>(cell.z);
+
+            remap[i] = cellVertices.emplace(key, i).first->second;
         }
-        else
+
+        PkGraphicsMeshLod lod;
+        lod.firstIndex = static_cast<uint32_t>(rData.indices.size());
+
+        for (uint32_t i = 0; i + 2 < baseIndexCount; i += 3)
         {
-            x += tileSize;
+            const uint32_t a = remap[rData.indices[i + 0]];
+            const uint32_t b = remap[rData.indices[i + 1]];
+            const uint32_t c = remap[rData.indices[i + 2]];
+
+            if (a != b && b != c && a != c)
+            {
+                rData.indices.push_back(a);
+                rData.indices.push_back(b);
+                rData.indices.push_back(c);
+            }
         }
+
+        lod.indexCount = static_cast<uint32_t>(rData.indices.size()) - lod.firstIndex;
+        rData.lods.push_back(lod);
     }
 }
 
-static void loadModel(PkGraphicsModelData& rData)
+static void loadModel(PkGraphicsMesh& rData)
 {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, rData.modelPath.c_str())) 
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, rData.path.c_str())) 
     {
         throw std::runtime_error(warn + err);
     }
@@ -534,43 +586,40 @@ static void loadModel(PkGraphicsModelData& rData)
             rData.indices.push_back(uniqueVertices[vertex]);
         }
     }
+
+    computeBoundingSphere(rData);
+    generateLods(rData);
 }
 
-static void createInstanceBuffer(PkGraphicsModelData& rData)
+static void loadOccluder(PkGraphicsModelData& rData, const char* pOccluderPath)
 {
-    VkDeviceSize bufferSize = sizeof(rData.instances[0]) * rData.instances.size();
-
-    VkBuffer stagingBuffer;
-    VmaAllocation stagingBufferAllocation;
-    createBuffer
-    (
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer,
-        &stagingBufferAllocation
-    );
-
-    void* data;
-    vmaMapMemory(PkGraphicsCore::GetAllocator(), stagingBufferAllocation, &data);
-    memcpy(data, rData.instances.data(), (size_t)bufferSize);
-    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), stagingBufferAllocation);
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
 
-    createBuffer
-    (
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &rData.instanceBuffer,
-        &rData.instanceBufferAllocation
-    );
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, pOccluderPath))
+    {
+        throw std::runtime_error(warn + err);
+    }
 
-    copyBuffer(PkGraphicsCore::GetCommandPool(), stagingBuffer, rData.instanceBuffer, bufferSize);
+    rData.occluderVertices.resize(attrib.vertices.size() / 3);
+    for (size_t i = 0; i < rData.occluderVertices.size(); i++)
+    {
+        rData.occluderVertices[i] = glm::vec3(attrib.vertices[3 * i + 0], attrib.vertices[3 * i + 1], attrib.vertices[3 * i + 2]);
+    }
 
-    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), stagingBuffer, stagingBufferAllocation);
+    rData.occluderIndices.clear();
+    for (const auto& shape : shapes)
+    {
+        for (const auto& index : shape.mesh.indices)
+        {
+            rData.occluderIndices.push_back(static_cast<uint32_t>(index.vertex_index));
+        }
+    }
 }
 
-static void createVertexBuffer(PkGraphicsModelData& rData)
+static void createVertexBuffer(PkGraphicsMesh& rData)
 {
     VkDeviceSize bufferSize = sizeof(rData.vertices[0]) * rData.vertices.size();
 
@@ -604,7 +653,7 @@ static void createVertexBuffer(PkGraphicsModelData& rData)
     vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), stagingBuffer, stagingBufferAllocation);
 }
 
-static void createIndexBuffer(PkGraphicsModelData& rData)
+static void createIndexBuffer(PkGraphicsMesh& rData)
 {
     VkDeviceSize bufferSize = sizeof(rData.indices[0]) * rData.indices.size();
 
@@ -638,85 +687,204 @@ static void createIndexBuffer(PkGraphicsModelData& rData)
     vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), stagingBuffer, stagingBufferAllocation);
 }
 
-void PkGraphicsModel::UpdateUniformBuffer(const uint32_t imageIndex)
+static PkGraphicsMesh* acquireMesh(const char* pModelPath)
 {
-    float fieldOfView = PkGraphicsCore::GetFieldOfView();
-    float aspectRatio = PkGraphicsSwapChain::GetSwapChainExtent().width / (float)PkGraphicsSwapChain::GetSwapChainExtent().height;
-    float nearViewPlane = PkGraphicsCore::GetNearViewPlane();
-    float farViewPlane = PkGraphicsCore::GetFarViewPlane();
+    PkGraphicsMesh*& rpMesh = s_meshes[pModelPath];
 
-    UniformBufferObject ubo{};
-    ubo.model = m_pData->matrix;
-    ubo.view = PkGraphicsCore::GetViewMatrix();
-    ubo.proj = glm::perspective(glm::radians(fieldOfView), aspectRatio, nearViewPlane, farViewPlane);
-    ubo.proj[1][1] *= -1;
+    if (rpMesh == nullptr)
+    {
+        rpMesh = new PkGraphicsMesh();
+        rpMesh->path = pModelPath;
+        rpMesh->id = s_nextMeshId++;
 
-    void* data;
-    vmaMapMemory(PkGraphicsCore::GetAllocator(), m_pData->uniformBufferAllocations[imageIndex], &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), m_pData->uniformBufferAllocations[imageIndex]);
+        loadModel(*rpMesh);
+        createVertexBuffer(*rpMesh);
+        createIndexBuffer(*rpMesh);
+    }
+
+    rpMesh->refCount++;
+    return rpMesh;
+}
+
+static void releaseMesh(PkGraphicsMesh* pMesh)
+{
+    if (--pMesh->refCount > 0)
+    {
+        return;
+    }
+
+    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), pMesh->indexBuffer, pMesh->indexBufferAllocation);
+    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), pMesh->vertexBuffer, pMesh->vertexBufferAllocation);
+
+    s_meshes.erase(pMesh->path);
+    delete pMesh;
+}
+
+static PkGraphicsMaterial* acquireMaterial(const char* pTexturePath, VkDescriptorSetLayout descriptorSetLayout, PkGraphicsDecodedTexture& rTexture)
+{
+    PkGraphicsMaterial*& rpMaterial = s_materials[pTexturePath];
+
+    if (rpMaterial == nullptr)
+    {
+        rpMaterial = new PkGraphicsMaterial();
+        rpMaterial->path = pTexturePath;
+        rpMaterial->id = s_nextMaterialId++;
+
+        createTextureImage(*rpMaterial, rTexture);
+        createTextureSampler(*rpMaterial);
+        createDescriptorSet(*rpMaterial, descriptorSetLayout);
+    }
+
+    rpMaterial->refCount++;
+    return rpMaterial;
+}
+
+static void releaseMaterial(PkGraphicsMaterial* pMaterial)
+{
+    if (--pMaterial->refCount > 0)
+    {
+        return;
+    }
+
+    vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), pMaterial->descriptorPool, nullptr);
+    vkDestroySampler(PkGraphicsCore::GetDevice(), pMaterial->textureSampler, nullptr);
+    vkDestroyImageView(PkGraphicsCore::GetDevice(), pMaterial->textureImageView, nullptr);
+    vmaDestroyImage(PkGraphicsCore::GetAllocator(), pMaterial->textureImage, pMaterial->textureImageAllocation);
+
+    s_materials.erase(pMaterial->path);
+    delete pMaterial;
+}
+
+uint32_t PkGraphicsModel::GetMeshId() const
+{
+    return m_pData->pMesh->id;
+}
+
+uint32_t PkGraphicsModel::GetMaterialId() const
+{
+    return m_pData->pMaterial->id;
+}
+
+uint32_t PkGraphicsModel::GetIndexCount() const
+{
+    return m_pData->pMesh->lods[0].indexCount;
+}
+
+uint32_t PkGraphicsModel::GetLodCount() const
+{
+    return static_cast<uint32_t>(m_pData->pMesh->lods.size());
+}
+
+uint32_t PkGraphicsModel::GetLodIndexCount(const uint32_t lod) const
+{
+    return m_pData->pMesh->lods[lod].indexCount;
+}
+
+const std::vector<InstanceData>& PkGraphicsModel::GetInstances() const
+{
+    return m_pData->instances;
+}
+
+const glm::vec4& PkGraphicsModel::GetBoundingSphere() const
+{
+    return m_pData->pMesh->boundingSphere;
+}
+
+void PkGraphicsModel::LoadOccluder(const char* pOccluderPath)
+{
+    loadOccluder(*m_pData, pOccluderPath);
+}
+
+bool PkGraphicsModel::HasOccluder() const
+{
+    return !m_pData->occluderIndices.empty();
 }
 
-void PkGraphicsModel::DrawModel(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const uint32_t imageIndex)
+const std::vector<glm::vec3>& PkGraphicsModel::GetOccluderVertices() const
 {
-    VkBuffer vertexBuffers[] = { m_pData->vertexBuffer };
+    return m_pData->occluderVertices;
+}
+
+const std::vector<uint32_t>& PkGraphicsModel::GetOccluderIndices() const
+{
+    return m_pData->occluderIndices;
+}
+
+void PkGraphicsModel::BindMesh(VkCommandBuffer commandBuffer) const
+{
+    VkBuffer vertexBuffers[] = { m_pData->pMesh->vertexBuffer };
     VkDeviceSize vertexOffsets[] = { 0 };
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, vertexOffsets);
 
-    VkBuffer instanceBuffers[] = { m_pData->instanceBuffer };
-    VkDeviceSize instanceOffsets[] = { 0 };
-    vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceBuffers, instanceOffsets);
-
-    vkCmdBindIndexBuffer(commandBuffer, m_pData->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, m_pData->pMesh->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
 
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_pData->descriptorSets[imageIndex], 0, nullptr);
+void PkGraphicsModel::BindMaterial(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, PK_DESCRIPTOR_SET_MATERIAL, 1, &m_pData->pMaterial->descriptorSet, 0, nullptr);
+}
 
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_pData->indices.size()), static_cast<uint32_t>(m_pData->instances.size()), 0, 0, 0);
+void PkGraphicsModel::DrawInstances(VkCommandBuffer commandBuffer, const uint32_t firstInstance, const uint32_t instanceCount, const uint32_t lod) const
+{
+    const PkGraphicsMeshLod& rLod = m_pData->pMesh->lods[lod];
+    vkCmdDrawIndexed(commandBuffer, rLod.indexCount, instanceCount, rLod.firstIndex, 0, firstInstance);
 }
 
-void PkGraphicsModel::SetMatrix(glm::mat4& rMat)
+void PkGraphicsModel::DrawModel(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const uint32_t firstInstance) const
 {
-    m_pData->matrix = rMat;
+    BindMesh(commandBuffer);
+    BindMaterial(commandBuffer, pipelineLayout);
+    DrawInstances(commandBuffer, firstInstance, static_cast<uint32_t>(m_pData->instances.size()));
 }
 
-void PkGraphicsModel::OnSwapChainCreate(VkDescriptorSetLayout descriptorSetLayout)
+void PkGraphicsModel::SetMatrix(glm::mat4& rMat)
 {
-    createUniformBuffers(*m_pData);
-    createDescriptorPool(*m_pData);
-    createDescriptorSets(*m_pData, descriptorSetLayout);
+    m_pData->matrix = rMat;
 }
 
-void PkGraphicsModel::OnSwapChainDestroy()
+const glm::mat4& PkGraphicsModel::GetMatrix() const
 {
-    vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), m_pData->descriptorPool, nullptr);
-    destroyUniformBuffers(*m_pData);
+    return m_pData->matrix;
 }
 
-PkGraphicsModel::PkGraphicsModel(VkCommandPool commandPool, const char* pModelPath, const char* pTexturePath)
+PkGraphicsModel::PkGraphicsModel(VkCommandPool commandPool, VkDescriptorSetLayout materialDescriptorSetLayout, const char* pModelPath, const char* pTexturePath, const uint32_t boardDimensions)
 {
     m_pData = new PkGraphicsModelData();
 
-    m_pData->modelPath = pModelPath;
-    m_pData->texturePath = pTexturePath;
+    // A texture not loaded yet is decoded on a worker while the mesh is parsed here.
+    PkGraphicsDecodedTexture texture;
+    PkJobCounter decodeCounter;
+    PkJobParallelForFunc decodeFunc = [pTexturePath, &texture](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        decodeTexture(pTexturePath, texture);
+    };
+
+    if (s_materials.count(pTexturePath) == 0)
+    {
+        PkJobSystem::Dispatch(1, 1, decodeFunc, decodeCounter);
+    }
+
+    try
+    {
+        m_pData->pMesh = acquireMesh(pModelPath);
+    }
+    catch (...)
+    {
+        PkJobSystem::Wait(decodeCounter);
+        stbi_image_free(texture.pixels);
+        throw;
+    }
 
-    loadModel(*m_pData);
-    populateInstanceData(*m_pData);
+    PkJobSystem::Wait(decodeCounter);
+    m_pData->pMaterial = acquireMaterial(pTexturePath, materialDescriptorSetLayout, texture);
 
-    createTextureImage(*m_pData);
-    createTextureSampler(*m_pData);
-    createInstanceBuffer(*m_pData);
-    createVertexBuffer(*m_pData);
-    createIndexBuffer(*m_pData);
+    populateInstanceData(*m_pData, boardDimensions);
 }
 
 PkGraphicsModel::~PkGraphicsModel()
 {
-    vkDestroySampler(PkGraphicsCore::GetDevice(), m_pData->textureSampler, nullptr);
-    vkDestroyImageView(PkGraphicsCore::GetDevice(), m_pData->textureImageView, nullptr);
-    vmaDestroyImage(PkGraphicsCore::GetAllocator(), m_pData->textureImage, m_pData->textureImageAllocation);
-    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), m_pData->indexBuffer, m_pData->indexBufferAllocation);
-    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), m_pData->vertexBuffer, m_pData->vertexBufferAllocation);
-    vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), m_pData->instanceBuffer, m_pData->instanceBufferAllocation);
+    releaseMaterial(m_pData->pMaterial);
+    releaseMesh(m_pData->pMesh);
 
     delete m_pData;
 }
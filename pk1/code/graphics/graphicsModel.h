@@ -1,5 +1,7 @@
 #pragma once
 
+#include "graphics/graphicsVertexLayout.h"
+
 #include <vulkan/vulkan_core.h>
 #include <glm/glm.hpp>
 
@@ -8,10 +10,18 @@
 
 struct PkGraphicsModelData;
 
+// Descriptor set indices shared by the scene pipeline layout and shader.vert/shader.frag.
+static const uint32_t PK_DESCRIPTOR_SET_CAMERA = 0;
+static const uint32_t PK_DESCRIPTOR_SET_MATERIAL = 1;
+
+// Full detail plus the simplified levels every mesh gets when it is loaded.
+static const uint32_t PK_MAX_MESH_LODS = 3;
+
+// Placement of one instance relative to its object; the object's own matrix is applied on top in shader.vert.
 struct InstanceData
 {
-    glm::vec3 pos;
-    float rot;
+    glm::mat4 transform;
+    uint32_t objectIndex;
 };
 
 struct Vertex
@@ -26,67 +36,55 @@ struct Vertex
     }
 };
 
-static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions()
-{
-    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{};
-
-    bindingDescriptions[0].binding = 0;
-    bindingDescriptions[0].stride = sizeof(Vertex);
-    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+PK_VERTEX_LAYOUT(Vertex, pos, color, texCoord);
+PK_VERTEX_LAYOUT(InstanceData, transform, objectIndex);
 
-    bindingDescriptions[1].binding = 1;
-    bindingDescriptions[1].stride = sizeof(InstanceData);
-    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-
-    return bindingDescriptions;
-}
-
-static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() 
+// Vertices, then instances, for shader.vert.
+static std::vector<PkGraphicsVertexStream> getVertexStreams()
 {
-    std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
-
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = offsetof(Vertex, Vertex::pos);
-
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = offsetof(Vertex, Vertex::color);
-
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = offsetof(Vertex, Vertex::texCoord);
-
-    attributeDescriptions[3].binding = 1;
-    attributeDescriptions[3].location = 3;
-    attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[3].offset = offsetof(InstanceData, InstanceData::pos);
-
-    attributeDescriptions[4].binding = 1;
-    attributeDescriptions[4].location = 4;
-    attributeDescriptions[4].format = VK_FORMAT_R32_SFLOAT;
-    attributeDescriptions[4].offset = offsetof(InstanceData, InstanceData::rot);
-
-    return attributeDescriptions;
+    return {
+        PkGraphicsVertexLayout::GetStream<Vertex>(VK_VERTEX_INPUT_RATE_VERTEX),
+        PkGraphicsVertexLayout::GetStream<InstanceData>(VK_VERTEX_INPUT_RATE_INSTANCE)
+    };
 }
 
 class PkGraphicsModel
 {
 public:
     PkGraphicsModel() = delete;
-	PkGraphicsModel(VkCommandPool commandPool, const char* pModelPath, const char* pTexturePath);
+	// The model is drawn boardDimensions x boardDimensions times, as a board of tiles.
+	PkGraphicsModel(VkCommandPool commandPool, VkDescriptorSetLayout materialDescriptorSetLayout, const char* pModelPath, const char* pTexturePath, const uint32_t boardDimensions = 1);
 	~PkGraphicsModel();
 
     void SetMatrix(glm::mat4& rMat);
-
-    void UpdateUniformBuffer(const uint32_t imageIndex);
-    void DrawModel(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const uint32_t imageIndex);
-
-	void OnSwapChainCreate(VkDescriptorSetLayout descriptorSetLayout);
-	void OnSwapChainDestroy();
+    const glm::mat4& GetMatrix() const;
+
+    uint32_t GetMeshId() const;
+    uint32_t GetMaterialId() const;
+
+    // Index count of the full detail mesh.
+    uint32_t GetIndexCount() const;
+    uint32_t GetLodCount() const;
+    uint32_t GetLodIndexCount(const uint32_t lod) const;
+    // Where each tile starts out; the scene streams any later changes.
+    const std::vector<InstanceData>& GetInstances() const;
+
+    // Bounds of the mesh in model space before instance placement: centre in xyz, radius in w.
+    const glm::vec4& GetBoundingSphere() const;
+
+    // Optional low-poly occluder for CPU occlusion culling, in the same space as the mesh; positions only, kept on the CPU.
+    void LoadOccluder(const char* pOccluderPath);
+    bool HasOccluder() const;
+    const std::vector<glm::vec3>& GetOccluderVertices() const;
+    const std::vector<uint32_t>& GetOccluderIndices() const;
+
+    void BindMesh(VkCommandBuffer commandBuffer) const;
+    void BindMaterial(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+
+    // Instances are read from whichever instance buffer the scene has bound, so one call can draw the instances of
+    // several models that share this mesh and material.
+    void DrawInstances(VkCommandBuffer commandBuffer, const uint32_t firstInstance, const uint32_t instanceCount, const uint32_t lod = 0) const;
+    void DrawModel(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const uint32_t firstInstance) const;
 
 private:
 	PkGraphicsModelData* m_pData;
@@ -0,0 +1,428 @@
+#include "graphicsOcclusion.h"
+
+#include "graphics/graphicsSimd.h"
+#include "jobs/jobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const uint32_t TILE_WIDTH = 8;
+static const uint32_t TILE_HEIGHT = 4;
+static const uint32_t FULL_TILE_MASK = 0xffffffff;
+
+// The buffer is only a few dozen tiles high, so small batches are needed to give every worker a share.
+static const uint32_t TILE_ROWS_PER_BATCH = 4;
+
+// A front facing screen space triangle, ready to rasterise.
+struct PkOcclusionTriangle
+{
+    // Edge functions a * x + b * y + c, non-negative for pixel centres inside the triangle.
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+
+    // Depth plane z = depthA * x + depthB * y + depthC, and the farthest depth of any vertex.
+    float depthA;
+    float depthB;
+    float depthC;
+    float zMax;
+
+    uint32_t tileXBegin;
+    uint32_t tileXEnd;
+    uint32_t tileYBegin;
+    uint32_t tileYEnd;
+};
+
+// Writes one coverage mask per tile from tileXBegin to tileXEnd on a row of tiles.
+// Bit (row * TILE_WIDTH + column) is set when that pixel's centre is inside the triangle.
+typedef void (*PkOcclusionCoverageKernel)(const PkOcclusionTriangle& rTriangle, const uint32_t tileY, uint32_t* pMasks);
+
+static void coverScalar(const PkOcclusionTriangle& rTriangle, const uint32_t tileY, uint32_t* pMasks)
+{
+    for (uint32_t tileX = rTriangle.tileXBegin; tileX < rTriangle.tileXEnd; tileX++)
+    {
+        uint32_t mask = 0;
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+        {
+            const float y = static_cast<float>(tileY * TILE_HEIGHT + row) + 0.5f;
+
+            for (uint32_t column = 0; column < TILE_WIDTH; column++)
+            {
+                const float x = static_cast<float>(tileX * TILE_WIDTH + column) + 0.5f;
+
+                bool bInside = true;
+                for (uint32_t e = 0; e < 3; e++)
+                {
+                    bInside = bInside && (rTriangle.edgeA[e] * x + rTriangle.edgeB[e] * y) + rTriangle.edgeC[e] >= 0.0f;
+                }
+
+                if (bInside)
+                {
+                    mask |= 1u << (row * TILE_WIDTH + column);
+                }
+            }
+        }
+
+        pMasks[tileX - rTriangle.tileXBegin] = mask;
+    }
+}
+
+#if PK_SIMD_X86
+static void coverSse(const PkOcclusionTriangle& rTriangle, const uint32_t tileY, uint32_t* pMasks)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 columnCentres = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    for (uint32_t tileX = rTriangle.tileXBegin; tileX < rTriangle.tileXEnd; tileX++)
+    {
+        // Each row of eight pixels is two vectors of four; a * x is the same for every row of the tile.
+        const __m128 xLeft = _mm_add_ps(_mm_set1_ps(static_cast<float>(tileX * TILE_WIDTH)), columnCentres);
+        const __m128 xRight = _mm_add_ps(xLeft, _mm_set1_ps(4.0f));
+
+        __m128 axLeft[3];
+        __m128 axRight[3];
+        for (uint32_t e = 0; e < 3; e++)
+        {
+            axLeft[e] = _mm_mul_ps(_mm_set1_ps(rTriangle.edgeA[e]), xLeft);
+            axRight[e] = _mm_mul_ps(_mm_set1_ps(rTriangle.edgeA[e]), xRight);
+        }
+
+        uint32_t mask = 0;
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+        {
+            const float y = static_cast<float>(tileY * TILE_HEIGHT + row) + 0.5f;
+
+            __m128 insideLeft = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            __m128 insideRight = insideLeft;
+
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                const __m128 by = _mm_set1_ps(rTriangle.edgeB[e] * y);
+                const __m128 c = _mm_set1_ps(rTriangle.edgeC[e]);
+
+                insideLeft = _mm_and_ps(insideLeft, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(axLeft[e], by), c), zero));
+                insideRight = _mm_and_ps(insideRight, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(axRight[e], by), c), zero));
+            }
+
+            const uint32_t rowMask = static_cast<uint32_t>(_mm_movemask_ps(insideLeft)) | (static_cast<uint32_t>(_mm_movemask_ps(insideRight)) << 4);
+            mask |= rowMask << (row * TILE_WIDTH);
+        }
+
+        pMasks[tileX - rTriangle.tileXBegin] = mask;
+    }
+}
+
+PK_TARGET_AVX2 static void coverAvx2(const PkOcclusionTriangle& rTriangle, const uint32_t tileY, uint32_t* pMasks)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 columnCentres = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+    for (uint32_t tileX = rTriangle.tileXBegin; tileX < rTriangle.tileXEnd; tileX++)
+    {
+        // One row of the tile fills a vector; a * x is the same for every row.
+        const __m256 x = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(tileX * TILE_WIDTH)), columnCentres);
+
+        __m256 ax[3];
+        for (uint32_t e = 0; e < 3; e++)
+        {
+            ax[e] = _mm256_mul_ps(_mm256_set1_ps(rTriangle.edgeA[e]), x);
+        }
+
+        uint32_t mask = 0;
+
+        for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+        {
+            const float y = static_cast<float>(tileY * TILE_HEIGHT + row) + 0.5f;
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                const __m256 by = _mm256_set1_ps(rTriangle.edgeB[e] * y);
+                const __m256 c = _mm256_set1_ps(rTriangle.edgeC[e]);
+
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_add_ps(ax[e], by), c), zero, _CMP_GE_OQ));
+            }
+
+            mask |= static_cast<uint32_t>(_mm256_movemask_ps(inside)) << (row * TILE_WIDTH);
+        }
+
+        pMasks[tileX - rTriangle.tileXBegin] = mask;
+    }
+}
+#endif
+
+static PkOcclusionCoverageKernel getKernel()
+{
+#if PK_SIMD_X86
+    switch (PkGraphicsSimd::GetInstructionSet())
+    {
+    case PkSimdInstructionSet::Avx2:
+        return coverAvx2;
+    case PkSimdInstructionSet::Sse:
+        return coverSse;
+    default:
+        break;
+    }
+#endif
+    return coverScalar;
+}
+
+static void setupTriangles(const PkGraphicsOcclusionBuffer& rBuffer, const std::vector<PkGraphicsOccluder>& rOccluders, std::vector<PkOcclusionTriangle>& rTriangles)
+{
+    const float width = static_cast<float>(rBuffer.width);
+    const float height = static_cast<float>(rBuffer.height);
+
+    std::vector<glm::vec4> clipVertices;
+
+    rTriangles.clear();
+
+    for (const PkGraphicsOccluder& rOccluder : rOccluders)
+    {
+        const std::vector<glm::vec3>& rVertices = *rOccluder.pVertices;
+        const std::vector<uint32_t>& rIndices = *rOccluder.pIndices;
+        const glm::mat4 matrix = rBuffer.viewProjection * rOccluder.matrix;
+
+        clipVertices.resize(rVertices.size());
+        for (size_t i = 0; i < rVertices.size(); i++)
+        {
+            clipVertices[i] = matrix * glm::vec4(rVertices[i], 1.0f);
+        }
+
+        for (size_t i = 0; i + 2 < rIndices.size(); i += 3)
+        {
+            glm::vec3 screen[3];
+            bool bInFrontOfNearPlane = false;
+
+            for (uint32_t v = 0; v < 3; v++)
+            {
+                const glm::vec4& rClip = clipVertices[rIndices[i + v]];
+
+                if (rClip.w <= 0.0f || rClip.z < 0.0f)
+                {
+                    bInFrontOfNearPlane = true;
+                    break;
+                }
+
+                const float invW = 1.0f / rClip.w;
+                screen[v] = glm::vec3((rClip.x * invW * 0.5f + 0.5f) * width, (rClip.y * invW * 0.5f + 0.5f) * height, rClip.z * invW);
+            }
+
+            // Skipped rather than clipped; drawing less of an occluder only ever culls less.
+            if (bInFrontOfNearPlane)
+            {
+                continue;
+            }
+
+            const float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+
+            // Front faces wind counter-clockwise on screen, which is a negative area with y pointing down.
+            if (area >= 0.0f)
+            {
+                continue;
+            }
+
+            const float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+            const float maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+            const float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+            const float maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+            const float minZ = std::min(screen[0].z, std::min(screen[1].z, screen[2].z));
+            const float maxZ = std::max(screen[0].z, std::max(screen[1].z, screen[2].z));
+
+            if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height || minZ > 1.0f)
+            {
+                continue;
+            }
+
+            PkOcclusionTriangle triangle;
+
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                const glm::vec3& rFrom = screen[e];
+                const glm::vec3& rTo = screen[(e + 1) % 3];
+
+                // Signs chosen so the opposite vertex, and so the inside of a negative area triangle, is positive.
+                triangle.edgeA[e] = rTo.y - rFrom.y;
+                triangle.edgeB[e] = rFrom.x - rTo.x;
+                triangle.edgeC[e] = rFrom.y * rTo.x - rFrom.x * rTo.y;
+            }
+
+            const float dx1 = screen[1].x - screen[0].x;
+            const float dy1 = screen[1].y - screen[0].y;
+            const float dz1 = screen[1].z - screen[0].z;
+            const float dx2 = screen[2].x - screen[0].x;
+            const float dy2 = screen[2].y - screen[0].y;
+            const float dz2 = screen[2].z - screen[0].z;
+
+            triangle.depthA = (dz1 * dy2 - dz2 * dy1) / area;
+            triangle.depthB = (dx1 * dz2 - dx2 * dz1) / area;
+            triangle.depthC = screen[0].z - triangle.depthA * screen[0].x - triangle.depthB * screen[0].y;
+            triangle.zMax = std::min(maxZ, 1.0f);
+
+            triangle.tileXBegin = static_cast<uint32_t>(std::max(minX, 0.0f)) / TILE_WIDTH;
+            triangle.tileXEnd = static_cast<uint32_t>(std::min(maxX, width - 1.0f)) / TILE_WIDTH + 1;
+            triangle.tileYBegin = static_cast<uint32_t>(std::max(minY, 0.0f)) / TILE_HEIGHT;
+            triangle.tileYEnd = static_cast<uint32_t>(std::min(maxY, height - 1.0f)) / TILE_HEIGHT + 1;
+
+            rTriangles.push_back(triangle);
+        }
+    }
+}
+
+static void updateTile(PkGraphicsOcclusionBuffer& rBuffer, const uint32_t tile, const uint32_t coverage, const float zTriangle)
+{
+    float& rZMax0 = rBuffer.zMax0[tile];
+    float& rZMax1 = rBuffer.zMax1[tile];
+    uint32_t& rMask = rBuffer.mask[tile];
+
+    // Entirely behind the layer that already covers the tile.
+    if (zTriangle >= rZMax0)
+    {
+        return;
+    }
+
+    // A triangle far in front of the working layer would push that layer's depth a long way back, so start a new
+    // working layer with it instead. Dropping coverage is always safe; it only means less gets culled.
+    if (rZMax1 - zTriangle > rZMax0 - rZMax1)
+    {
+        rZMax1 = 0.0f;
+        rMask = 0;
+    }
+
+    rZMax1 = std::max(rZMax1, zTriangle);
+    rMask |= coverage;
+
+    if (rMask == FULL_TILE_MASK)
+    {
+        rZMax0 = rZMax1;
+        rZMax1 = 0.0f;
+        rMask = 0;
+    }
+}
+
+static void rasteriseTileRows(PkGraphicsOcclusionBuffer& rBuffer, const std::vector<PkOcclusionTriangle>& rTriangles, const PkOcclusionCoverageKernel kernel, const uint32_t tileYBegin, const uint32_t tileYEnd)
+{
+    std::vector<uint32_t> masks(rBuffer.tilesX);
+
+    // Every tile is owned by one batch and sees the triangles in submission order, whatever the number of workers.
+    for (const PkOcclusionTriangle& rTriangle : rTriangles)
+    {
+        const uint32_t yBegin = std::max(rTriangle.tileYBegin, tileYBegin);
+        const uint32_t yEnd = std::min(rTriangle.tileYEnd, tileYEnd);
+
+        for (uint32_t tileY = yBegin; tileY < yEnd; tileY++)
+        {
+            kernel(rTriangle, tileY, masks.data());
+
+            // The farthest point of the depth plane over a tile is at one of its corners.
+            const float yFar = static_cast<float>((rTriangle.depthB > 0.0f ? tileY + 1 : tileY) * TILE_HEIGHT);
+
+            for (uint32_t tileX = rTriangle.tileXBegin; tileX < rTriangle.tileXEnd; tileX++)
+            {
+                const uint32_t coverage = masks[tileX - rTriangle.tileXBegin];
+
+                if (coverage == 0)
+                {
+                    continue;
+                }
+
+                const float xFar = static_cast<float>((rTriangle.depthA > 0.0f ? tileX + 1 : tileX) * TILE_WIDTH);
+                const float zTile = std::min(rTriangle.depthA * xFar + rTriangle.depthB * yFar + rTriangle.depthC, rTriangle.zMax);
+
+                updateTile(rBuffer, tileY * rBuffer.tilesX + tileX, coverage, zTile);
+            }
+        }
+    }
+}
+
+void PkGraphicsOcclusionBuffer::Resize(const uint32_t pixelWidth, const uint32_t pixelHeight)
+{
+    tilesX = (pixelWidth + TILE_WIDTH - 1) / TILE_WIDTH;
+    tilesY = (pixelHeight + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    width = tilesX * TILE_WIDTH;
+    height = tilesY * TILE_HEIGHT;
+
+    zMax0.assign(tilesX * tilesY, 1.0f);
+    zMax1.assign(tilesX * tilesY, 0.0f);
+    mask.assign(tilesX * tilesY, 0);
+}
+
+/*static*/ uint32_t PkGraphicsSoftwareOcclusion::RenderOccluders(PkGraphicsOcclusionBuffer& rBuffer, const std::vector<PkGraphicsOccluder>& rOccluders, const glm::mat4& rViewProjection)
+{
+    rBuffer.viewProjection = rViewProjection;
+
+    std::fill(rBuffer.zMax0.begin(), rBuffer.zMax0.end(), 1.0f);
+    std::fill(rBuffer.zMax1.begin(), rBuffer.zMax1.end(), 0.0f);
+    std::fill(rBuffer.mask.begin(), rBuffer.mask.end(), 0);
+
+    std::vector<PkOcclusionTriangle> triangles;
+    setupTriangles(rBuffer, rOccluders, triangles);
+
+    const PkOcclusionCoverageKernel kernel = getKernel();
+
+    PkJobSystem::ParallelFor(rBuffer.tilesY, TILE_ROWS_PER_BATCH, [&](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        rasteriseTileRows(rBuffer, triangles, kernel, begin, end);
+    });
+
+    return static_cast<uint32_t>(triangles.size());
+}
+
+/*static*/ bool PkGraphicsSoftwareOcclusion::IsBoxVisible(const PkGraphicsOcclusionBuffer& rBuffer, const glm::vec3& rMin, const glm::vec3& rMax)
+{
+    const float width = static_cast<float>(rBuffer.width);
+    const float height = static_cast<float>(rBuffer.height);
+
+    float minX = std::numeric_limits<float>::max();
+    float maxX = -std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxY = -std::numeric_limits<float>::max();
+    float zNear = std::numeric_limits<float>::max();
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec3 corner((i & 1) ? rMax.x : rMin.x, (i & 2) ? rMax.y : rMin.y, (i & 4) ? rMax.z : rMin.z);
+        const glm::vec4 clip = rBuffer.viewProjection * glm::vec4(corner, 1.0f);
+
+        if (clip.w <= 0.0f || clip.z < 0.0f)
+        {
+            return true;
+        }
+
+        const float invW = 1.0f / clip.w;
+        const float x = (clip.x * invW * 0.5f + 0.5f) * width;
+        const float y = (clip.y * invW * 0.5f + 0.5f) * height;
+
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        zNear = std::min(zNear, clip.z * invW);
+    }
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+    {
+        return false;
+    }
+
+    const uint32_t tileXBegin = static_cast<uint32_t>(std::max(minX, 0.0f)) / TILE_WIDTH;
+    const uint32_t tileXEnd = static_cast<uint32_t>(std::min(maxX, width - 1.0f)) / TILE_WIDTH + 1;
+    const uint32_t tileYBegin = static_cast<uint32_t>(std::max(minY, 0.0f)) / TILE_HEIGHT;
+    const uint32_t tileYEnd = static_cast<uint32_t>(std::min(maxY, height - 1.0f)) / TILE_HEIGHT + 1;
+
+    for (uint32_t tileY = tileYBegin; tileY < tileYEnd; tileY++)
+    {
+        for (uint32_t tileX = tileXBegin; tileX < tileXEnd; tileX++)
+        {
+            if (zNear < rBuffer.zMax0[tileY * rBuffer.tilesX + tileX])
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
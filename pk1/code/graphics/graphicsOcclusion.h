@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+// Low-poly stand-in geometry rasterised into the occlusion buffer. It must lie inside the visible surface of the
+// object it stands in for, and like the scene pipeline only its counter-clockwise (front) faces are drawn.
+struct PkGraphicsOccluder
+{
+    const std::vector<glm::vec3>* pVertices = nullptr;
+    const std::vector<uint32_t>* pIndices = nullptr;
+    glm::mat4 matrix = glm::mat4(1.0f);
+};
+
+// A small depth buffer in the style of masked occlusion culling. Instead of a depth per pixel, every 8x4 pixel tile
+// keeps a coverage mask and two conservative depths, so a tile only becomes an occluder once it is fully covered.
+// Depth runs from 0 at the near plane to 1 at the far plane.
+struct PkGraphicsOcclusionBuffer
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+
+    // Farthest depth of the fully covered layer; nothing behind it in the tile can be seen.
+    std::vector<float> zMax0;
+    // Farthest depth and coverage of the layer still being filled in.
+    std::vector<float> zMax1;
+    std::vector<uint32_t> mask;
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    // Rounds the size up to whole tiles.
+    void Resize(const uint32_t pixelWidth, const uint32_t pixelHeight);
+};
+
+// Has no dependency on Vulkan, so it can run and be tested without a GPU.
+class PkGraphicsSoftwareOcclusion
+{
+public:
+    PkGraphicsSoftwareOcclusion() = delete;
+
+    // Clears the buffer and rasterises every occluder, splitting rows of tiles across the job system.
+    // Expects a Vulkan style projection (clip space depth from 0 to w, y down). Returns the number of triangles drawn.
+    static uint32_t RenderOccluders(PkGraphicsOcclusionBuffer& rBuffer, const std::vector<PkGraphicsOccluder>& rOccluders, const glm::mat4& rViewProjection);
+
+    // False only if the world space box is entirely hidden by what RenderOccluders drew. Boxes crossing the near plane are visible.
+    static bool IsBoxVisible(const PkGraphicsOcclusionBuffer& rBuffer, const glm::vec3& rMin, const glm::vec3& rMax);
+};
@@ -0,0 +1,641 @@
+#include "graphicsPipelineLibrary.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsHash.h"
+#include "graphics/graphicsShaders.h"
+#include "graphics/graphicsUtils.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Compile threads: half the hardware threads, at most MAX_COMPILE_THREADS. The other half stays free for the game,
+// render and job system threads, which each frame needs; compiles only need to be done before their pipeline is
+// drawn. The startup set is only a handful of pipelines (the scene's and one per board rotation mode, for each scene
+// render pass), so a fifth thread would rarely have anything to do.
+static const uint32_t MAX_COMPILE_THREADS = 4;
+
+enum PkGraphicsPipelineLibraryState : uint32_t
+{
+    STATE_QUEUED = 0,
+    STATE_COMPILING,
+    STATE_READY,
+    STATE_FAILED
+};
+
+struct PkGraphicsPipelineLibraryEntry
+{
+    PkGraphicsPipelineDesc desc;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::atomic<uint32_t> state{ STATE_QUEUED };
+    float compileMilliseconds = 0.0f;
+
+    // Built from changed shaders while the old pipeline carries on drawing; swapped in at the start of a frame.
+    bool bReloadQueued = false;
+    VkPipeline reloadedPipeline = VK_NULL_HANDLE;
+};
+
+// Replaced by a reload but possibly still used by frames in flight.
+struct PkGraphicsRetiredPipeline
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    uint64_t retiredFrameNumber = 0;
+};
+
+struct PkGraphicsPipelineLibraryData
+{
+    std::vector<std::thread> workers;
+
+    // Guards everything below.
+    std::mutex mutex;
+    std::condition_variable queueCondition;
+    std::condition_variable readyCondition;
+    std::deque<PkGraphicsPipelineLibraryEntry*> queue;
+    std::unordered_map<PkGraphicsPipelineKey, PkGraphicsPipelineLibraryEntry*> entries;
+    uint32_t compilingCount = 0;
+    bool quit = false;
+
+    std::vector<PkGraphicsRetiredPipeline> retiredPipelines;
+    uint32_t reloadedCount = 0;
+
+    uint32_t compiledCount = 0;
+    float compileMilliseconds = 0.0f;
+    float longestCompileMilliseconds = 0.0f;
+};
+
+static PkGraphicsPipelineLibraryData* s_pData = nullptr;
+
+// Lengths go first, so adjacent strings and arrays can't run into one another.
+static uint64_t hashString(const uint64_t hash, const std::string& rString)
+{
+    return PkHashBytes(PkHashValue(hash, rString.size()), rString.data(), rString.size());
+}
+
+static uint64_t hashConstants(const uint64_t hash, const std::vector<uint32_t>& rConstants)
+{
+    return PkHashBytes(PkHashValue(hash, rConstants.size()), rConstants.data(), rConstants.size() * sizeof(uint32_t));
+}
+
+// One 32-bit entry per constant_id, in order. Fills rMapEntries, which the returned info points into.
+static VkSpecializationInfo getSpecializationInfo(const std::vector<uint32_t>& rConstants, std::vector<VkSpecializationMapEntry>& rMapEntries)
+{
+    rMapEntries.resize(rConstants.size());
+    for (uint32_t i = 0; i < static_cast<uint32_t>(rConstants.size()); i++)
+    {
+        rMapEntries[i].constantID = i;
+        rMapEntries[i].offset = i * sizeof(uint32_t);
+        rMapEntries[i].size = sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(rMapEntries.size());
+    specializationInfo.pMapEntries = rMapEntries.data();
+    specializationInfo.dataSize = rConstants.size() * sizeof(uint32_t);
+    specializationInfo.pData = rConstants.data();
+
+    return specializationInfo;
+}
+
+static VkPipeline createPipeline(const PkGraphicsPipelineDesc& rDesc)
+{
+    auto vertShaderCode = PkGraphicsShaders::LoadSpirv(rDesc.vertShaderPath);
+    auto fragShaderCode = PkGraphicsShaders::LoadSpirv(rDesc.fragShaderPath);
+
+    VkShaderModule vertShaderModule = PkGraphicsUtils::CreateShaderModule(PkGraphicsCore::GetDevice(), vertShaderCode);
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+
+    // Failed reloads are expected while a shader is being edited, so they mustn't leak the module already made.
+    try
+    {
+        fragShaderModule = PkGraphicsUtils::CreateShaderModule(PkGraphicsCore::GetDevice(), fragShaderCode);
+    }
+    catch (...)
+    {
+        vkDestroyShaderModule(PkGraphicsCore::GetDevice(), vertShaderModule, nullptr);
+        throw;
+    }
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    std::vector<VkSpecializationMapEntry> vertMapEntries;
+    std::vector<VkSpecializationMapEntry> fragMapEntries;
+    const VkSpecializationInfo vertSpecializationInfo = getSpecializationInfo(rDesc.vertConstants, vertMapEntries);
+    const VkSpecializationInfo fragSpecializationInfo = getSpecializationInfo(rDesc.fragConstants, fragMapEntries);
+
+    if (!rDesc.vertConstants.empty())
+    {
+        shaderStages[0].pSpecializationInfo = &vertSpecializationInfo;
+    }
+    if (!rDesc.fragConstants.empty())
+    {
+        shaderStages[1].pSpecializationInfo = &fragSpecializationInfo;
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(rDesc.vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = rDesc.vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(rDesc.vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = rDesc.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = rDesc.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = rDesc.cullMode;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = rDesc.samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = rDesc.bDepthTestEnable ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = rDesc.bDepthWriteEnable ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = rDesc.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = rDesc.bBlendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = rDesc.layout;
+    pipelineInfo.renderPass = rDesc.renderPass;
+    pipelineInfo.subpass = rDesc.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &rDesc.colourFormat;
+    renderingInfo.depthAttachmentFormat = rDesc.depthFormat;
+
+    if (rDesc.renderPass == VK_NULL_HANDLE)
+    {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    VkPipeline pipeline;
+    const VkResult result = PkGraphicsCore::CreateGraphicsPipeline(pipelineInfo, &pipeline);
+
+    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), fragShaderModule, nullptr);
+    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), vertShaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
+
+// The entry must already be marked as compiling. Failures are kept on the entry and rethrown to whoever asks for it,
+// as an exception can't leave a worker thread.
+static void compileEntry(PkGraphicsPipelineLibraryEntry& rEntry)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    bool bSucceeded = true;
+
+    try
+    {
+        pipeline = createPipeline(rEntry.desc);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "pipeline library: " << rEntry.desc.vertShaderPath << ": " << e.what() << std::endl;
+        bSucceeded = false;
+    }
+
+    const float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        rEntry.pipeline = pipeline;
+        rEntry.compileMilliseconds = milliseconds;
+        rEntry.state.store(bSucceeded ? STATE_READY : STATE_FAILED, std::memory_order_release);
+
+        s_pData->compilingCount--;
+        s_pData->compiledCount++;
+        s_pData->compileMilliseconds += milliseconds;
+        s_pData->longestCompileMilliseconds = std::max(s_pData->longestCompileMilliseconds, milliseconds);
+    }
+    s_pData->readyCondition.notify_all();
+}
+
+// A failed reload leaves the old pipeline in place, so a typo in a shader being edited doesn't stop the frame.
+static void reloadEntry(PkGraphicsPipelineLibraryEntry& rEntry)
+{
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+
+    try
+    {
+        pipeline = createPipeline(rEntry.desc);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "pipeline library: reload of " << rEntry.desc.vertShaderPath << " failed: " << e.what() << std::endl;
+    }
+
+    const float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            // Never bound if a second reload finished before the first was swapped in.
+            if (rEntry.reloadedPipeline != VK_NULL_HANDLE)
+            {
+                vkDestroyPipeline(PkGraphicsCore::GetDevice(), rEntry.reloadedPipeline, nullptr);
+            }
+
+            rEntry.reloadedPipeline = pipeline;
+            rEntry.compileMilliseconds = milliseconds;
+        }
+
+        s_pData->compilingCount--;
+        s_pData->compileMilliseconds += milliseconds;
+    }
+    s_pData->readyCondition.notify_all();
+}
+
+static void workerMain()
+{
+    while (true)
+    {
+        PkGraphicsPipelineLibraryEntry* pEntry = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(s_pData->mutex);
+            s_pData->queueCondition.wait(lock, [] { return s_pData->quit || !s_pData->queue.empty(); });
+
+            if (s_pData->queue.empty())
+            {
+                return;
+            }
+
+            pEntry = s_pData->queue.front();
+            s_pData->queue.pop_front();
+            s_pData->compilingCount++;
+
+            if (pEntry->bReloadQueued)
+            {
+                pEntry->bReloadQueued = false;
+            }
+            else
+            {
+                pEntry->state.store(STATE_COMPILING, std::memory_order_relaxed);
+            }
+        }
+
+        if (pEntry->state.load(std::memory_order_relaxed) == STATE_COMPILING)
+        {
+            compileEntry(*pEntry);
+        }
+        else
+        {
+            reloadEntry(*pEntry);
+        }
+    }
+}
+
+static PkGraphicsPipelineLibraryEntry* findEntry(const PkGraphicsPipelineKey key)
+{
+    auto it = s_pData->entries.find(key);
+
+    if (it == s_pData->entries.end())
+    {
+        throw std::runtime_error("pipeline was never requested!");
+    }
+
+    return it->second;
+}
+
+static VkPipeline getReadyPipeline(const PkGraphicsPipelineLibraryEntry& rEntry)
+{
+    if (rEntry.state.load(std::memory_order_acquire) == STATE_FAILED)
+    {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return rEntry.pipeline;
+}
+
+/*static*/ PkGraphicsPipelineKey PkGraphicsPipelineLibrary::GetKey(const PkGraphicsPipelineDesc& rDesc)
+{
+    uint64_t hash = PK_HASH_OFFSET_BASIS;
+
+    hash = hashString(hash, rDesc.vertShaderPath);
+    hash = hashString(hash, rDesc.fragShaderPath);
+    hash = hashConstants(hash, rDesc.vertConstants);
+    hash = hashConstants(hash, rDesc.fragConstants);
+
+    if (rDesc.vertexInputHash != 0)
+    {
+        hash = PkHashValue(hash, rDesc.vertexInputHash);
+    }
+    else
+    {
+        hash = PkHashValue(hash, rDesc.vertexBindings.size());
+        for (const VkVertexInputBindingDescription& rBinding : rDesc.vertexBindings)
+        {
+            hash = PkHashValue(hash, rBinding);
+        }
+
+        hash = PkHashValue(hash, rDesc.vertexAttributes.size());
+        for (const VkVertexInputAttributeDescription& rAttribute : rDesc.vertexAttributes)
+        {
+            hash = PkHashValue(hash, rAttribute);
+        }
+    }
+
+    hash = PkHashValue(hash, rDesc.topology);
+    hash = PkHashValue(hash, rDesc.cullMode);
+    hash = PkHashValue(hash, rDesc.bBlendEnable);
+    hash = PkHashValue(hash, rDesc.bDepthTestEnable);
+    hash = PkHashValue(hash, rDesc.bDepthWriteEnable);
+    hash = PkHashValue(hash, rDesc.depthCompareOp);
+    hash = PkHashValue(hash, rDesc.samples);
+    hash = PkHashValue(hash, rDesc.colourFormat);
+    hash = PkHashValue(hash, rDesc.depthFormat);
+    hash = PkHashValue(hash, rDesc.renderPass);
+    hash = PkHashValue(hash, rDesc.subpass);
+    hash = PkHashValue(hash, rDesc.layout);
+
+    return hash;
+}
+
+/*static*/ PkGraphicsPipelineKey PkGraphicsPipelineLibrary::Request(const PkGraphicsPipelineDesc& rDesc)
+{
+    const PkGraphicsPipelineKey key = GetKey(rDesc);
+
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        if (s_pData->entries.find(key) != s_pData->entries.end())
+        {
+            return key;
+        }
+
+        PkGraphicsPipelineLibraryEntry* pEntry = new PkGraphicsPipelineLibraryEntry();
+        pEntry->desc = rDesc;
+
+        s_pData->entries[key] = pEntry;
+        s_pData->queue.push_back(pEntry);
+    }
+    s_pData->queueCondition.notify_one();
+
+    return key;
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::Warm(const std::vector<PkGraphicsPipelineDesc>& rDescs)
+{
+    for (const PkGraphicsPipelineDesc& rDesc : rDescs)
+    {
+        Request(rDesc);
+    }
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::Reload(const std::vector<std::string>& rChangedSources)
+{
+    if (rChangedSources.empty())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        for (auto& rEntry : s_pData->entries)
+        {
+            PkGraphicsPipelineLibraryEntry* pEntry = rEntry.second;
+
+            if (pEntry->state.load(std::memory_order_relaxed) != STATE_READY || pEntry->bReloadQueued)
+            {
+                continue;
+            }
+
+            for (const std::string& rSource : rChangedSources)
+            {
+                if (pEntry->desc.vertShaderPath == rSource || pEntry->desc.fragShaderPath == rSource)
+                {
+                    pEntry->bReloadQueued = true;
+                    s_pData->queue.push_back(pEntry);
+                    break;
+                }
+            }
+        }
+    }
+    s_pData->queueCondition.notify_all();
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::PromoteReloadedPipelines(const uint64_t frameNumber)
+{
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+    for (auto& rEntry : s_pData->entries)
+    {
+        PkGraphicsPipelineLibraryEntry* pEntry = rEntry.second;
+
+        if (pEntry->reloadedPipeline != VK_NULL_HANDLE)
+        {
+            s_pData->retiredPipelines.push_back(PkGraphicsRetiredPipeline{ pEntry->pipeline, frameNumber });
+            pEntry->pipeline = pEntry->reloadedPipeline;
+            pEntry->reloadedPipeline = VK_NULL_HANDLE;
+            s_pData->reloadedCount++;
+        }
+    }
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::DestroyRetiredPipelines(const uint64_t completedFrameNumber)
+{
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+    auto it = s_pData->retiredPipelines.begin();
+
+    while (it != s_pData->retiredPipelines.end())
+    {
+        if (it->retiredFrameNumber <= completedFrameNumber)
+        {
+            vkDestroyPipeline(PkGraphicsCore::GetDevice(), it->pipeline, nullptr);
+            it = s_pData->retiredPipelines.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/*static*/ VkPipeline PkGraphicsPipelineLibrary::GetPipeline(const PkGraphicsPipelineKey key)
+{
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+    const PkGraphicsPipelineLibraryEntry* pEntry = findEntry(key);
+    return pEntry->state.load(std::memory_order_acquire) >= STATE_READY ? getReadyPipeline(*pEntry) : VK_NULL_HANDLE;
+}
+
+/*static*/ VkPipeline PkGraphicsPipelineLibrary::WaitForPipeline(const PkGraphicsPipelineKey key)
+{
+    std::unique_lock<std::mutex> lock(s_pData->mutex);
+
+    PkGraphicsPipelineLibraryEntry* pEntry = findEntry(key);
+
+    if (pEntry->state.load(std::memory_order_relaxed) == STATE_QUEUED)
+    {
+        s_pData->queue.erase(std::find(s_pData->queue.begin(), s_pData->queue.end(), pEntry));
+        pEntry->state.store(STATE_COMPILING, std::memory_order_relaxed);
+        s_pData->compilingCount++;
+
+        lock.unlock();
+        compileEntry(*pEntry);
+        lock.lock();
+    }
+
+    s_pData->readyCondition.wait(lock, [pEntry] { return pEntry->state.load(std::memory_order_acquire) >= STATE_READY; });
+
+    return getReadyPipeline(*pEntry);
+}
+
+/*static*/ uint32_t PkGraphicsPipelineLibrary::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+    return static_cast<uint32_t>(s_pData->queue.size()) + s_pData->compilingCount;
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::ShowDebugUi()
+{
+    if (ImGui::CollapsingHeader("Pipeline library"))
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        ImGui::Text("Compile threads: %u", static_cast<uint32_t>(s_pData->workers.size()));
+        ImGui::Text("Pipelines: %u, queued: %u, compiling: %u", static_cast<uint32_t>(s_pData->entries.size()), static_cast<uint32_t>(s_pData->queue.size()), s_pData->compilingCount);
+        ImGui::Text("Compiled: %u in %.2f ms (longest %.2f ms)", s_pData->compiledCount, s_pData->compileMilliseconds, s_pData->longestCompileMilliseconds);
+        ImGui::Text("Hot reloads: %u, awaiting destruction: %u", s_pData->reloadedCount, static_cast<uint32_t>(s_pData->retiredPipelines.size()));
+    }
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::Clear()
+{
+    std::unique_lock<std::mutex> lock(s_pData->mutex);
+
+    s_pData->queue.clear();
+    s_pData->readyCondition.wait(lock, [] { return s_pData->compilingCount == 0; });
+
+    for (auto& rEntry : s_pData->entries)
+    {
+        vkDestroyPipeline(PkGraphicsCore::GetDevice(), rEntry.second->reloadedPipeline, nullptr);
+        vkDestroyPipeline(PkGraphicsCore::GetDevice(), rEntry.second->pipeline, nullptr);
+        delete rEntry.second;
+    }
+
+    for (const PkGraphicsRetiredPipeline& rRetired : s_pData->retiredPipelines)
+    {
+        vkDestroyPipeline(PkGraphicsCore::GetDevice(), rRetired.pipeline, nullptr);
+    }
+
+    s_pData->entries.clear();
+    s_pData->retiredPipelines.clear();
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::InitialiseGraphicsPipelineLibrary()
+{
+    s_pData = new PkGraphicsPipelineLibraryData();
+
+    // See MAX_COMPILE_THREADS; always at least one, as nothing else compiles the queue.
+    const uint32_t numThreads = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), MAX_COMPILE_THREADS);
+
+    for (uint32_t i = 0; i < numThreads; i++)
+    {
+        s_pData->workers.emplace_back(workerMain);
+    }
+}
+
+/*static*/ void PkGraphicsPipelineLibrary::CleanupGraphicsPipelineLibrary()
+{
+    Clear();
+
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+        s_pData->quit = true;
+    }
+    s_pData->queueCondition.notify_all();
+
+    for (std::thread& rWorker : s_pData->workers)
+    {
+        rWorker.join();
+    }
+
+    delete s_pData;
+}
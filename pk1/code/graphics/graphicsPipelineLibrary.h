@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+typedef uint64_t PkGraphicsPipelineKey;
+
+// Everything that goes into a graphics pipeline. Descs that hash to the same key share one pipeline. Viewport and
+// scissor are always dynamic.
+struct PkGraphicsPipelineDesc
+{
+    // GLSL sources, compiled through PkGraphicsShaders.
+    std::string vertShaderPath;
+    std::string fragShaderPath;
+
+    // Specialization constants for each stage, one 32-bit value per constant_id starting from 0. Every combination is
+    // its own pipeline, so shaders branch on these instead of on uniforms.
+    std::vector<uint32_t> vertConstants;
+    std::vector<uint32_t> fragConstants;
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    // From PkGraphicsReflection::GetVertexInput. When set it stands in for the bindings and attributes in the key.
+    uint64_t vertexInputHash = 0;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    bool bBlendEnable = false;
+
+    bool bDepthTestEnable = true;
+    bool bDepthWriteEnable = true;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkFormat colourFormat = VK_FORMAT_UNDEFINED;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+    // Left null when dynamic rendering is enabled.
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+};
+
+// Graphics pipelines compiled on a pool of worker threads of its own, so compiles never queue up in front of the job
+// system's per-frame work. Callers ask for a pipeline each frame and leave out whatever isn't ready yet.
+class PkGraphicsPipelineLibrary
+{
+public:
+    PkGraphicsPipelineLibrary() = delete;
+
+    static PkGraphicsPipelineKey GetKey(const PkGraphicsPipelineDesc& rDesc);
+
+    // Queues the pipeline for compilation unless the library already has it.
+    static PkGraphicsPipelineKey Request(const PkGraphicsPipelineDesc& rDesc);
+
+    // Requests every permutation up front so they are compiled in the background before anything draws with them.
+    static void Warm(const std::vector<PkGraphicsPipelineDesc>& rDescs);
+
+    // VK_NULL_HANDLE until the pipeline has finished compiling. Never blocks.
+    static VkPipeline GetPipeline(const PkGraphicsPipelineKey key);
+
+    // Compiles the pipeline on the calling thread if no worker has picked it up yet, otherwise waits for it.
+    static VkPipeline WaitForPipeline(const PkGraphicsPipelineKey key);
+
+    static uint32_t GetPendingCount();
+
+    // Rebuilds, in the background, every pipeline using one of the given shader sources. The old pipelines keep drawing
+    // until PromoteReloadedPipelines swaps the new ones in.
+    static void Reload(const std::vector<std::string>& rChangedSources);
+
+    // Call at the start of a frame, before any pipeline is looked up. Replaced pipelines are retired with the frame number.
+    static void PromoteReloadedPipelines(const uint64_t frameNumber);
+
+    // Destroys pipelines retired on or before the given frame, once the caller knows no frame using them is in flight.
+    static void DestroyRetiredPipelines(const uint64_t completedFrameNumber);
+
+    static void ShowDebugUi();
+
+    // Waits for compiles in flight and destroys every pipeline, retired ones included. Call once no frame using them is
+    // in flight, before the layouts or render passes they were made with are destroyed.
+    static void Clear();
+
+    static void InitialiseGraphicsPipelineLibrary();
+    static void CleanupGraphicsPipelineLibrary();
+};
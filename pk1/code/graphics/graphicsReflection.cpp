@@ -0,0 +1,566 @@
+#include "graphicsReflection.h"
+
+#include "graphics/graphicsHash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+static const uint32_t SPIRV_HEADER_WORDS = 5;
+
+// The few parts of the SPIR-V specification reflection needs.
+enum PkGraphicsSpirvOp : uint32_t
+{
+    OP_ENTRY_POINT = 15,
+    OP_TYPE_BOOL = 20,
+    OP_TYPE_INT = 21,
+    OP_TYPE_FLOAT = 22,
+    OP_TYPE_VECTOR = 23,
+    OP_TYPE_MATRIX = 24,
+    OP_TYPE_IMAGE = 25,
+    OP_TYPE_SAMPLER = 26,
+    OP_TYPE_SAMPLED_IMAGE = 27,
+    OP_TYPE_ARRAY = 28,
+    OP_TYPE_RUNTIME_ARRAY = 29,
+    OP_TYPE_STRUCT = 30,
+    OP_TYPE_POINTER = 32,
+    OP_CONSTANT = 43,
+    OP_VARIABLE = 59,
+    OP_DECORATE = 71,
+    OP_MEMBER_DECORATE = 72
+};
+
+enum PkGraphicsSpirvDecoration : uint32_t
+{
+    DECORATION_BUFFER_BLOCK = 3,
+    DECORATION_ARRAY_STRIDE = 6,
+    DECORATION_MATRIX_STRIDE = 7,
+    DECORATION_BUILT_IN = 11,
+    DECORATION_LOCATION = 30,
+    DECORATION_BINDING = 33,
+    DECORATION_DESCRIPTOR_SET = 34,
+    DECORATION_OFFSET = 35
+};
+
+enum PkGraphicsSpirvStorageClass : uint32_t
+{
+    STORAGE_CLASS_UNIFORM_CONSTANT = 0,
+    STORAGE_CLASS_INPUT = 1,
+    STORAGE_CLASS_UNIFORM = 2,
+    STORAGE_CLASS_PUSH_CONSTANT = 9,
+    STORAGE_CLASS_STORAGE_BUFFER = 12
+};
+
+static const uint32_t DIM_BUFFER = 5;
+static const uint32_t DIM_SUBPASS_DATA = 6;
+static const uint32_t IMAGE_SAMPLED_STORAGE = 2;
+
+static const uint32_t NOT_DECORATED = ~0u;
+
+struct PkGraphicsSpirvMember
+{
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+};
+
+// Everything reflection keeps about one result id.
+struct PkGraphicsSpirvId
+{
+    uint32_t opcode = 0;
+    const uint32_t* pWords = nullptr;
+
+    uint32_t set = NOT_DECORATED;
+    uint32_t binding = NOT_DECORATED;
+    uint32_t location = NOT_DECORATED;
+    uint32_t arrayStride = 0;
+    bool bBuiltIn = false;
+    bool bBufferBlock = false;
+    std::vector<PkGraphicsSpirvMember> members;
+};
+
+typedef std::unordered_map<uint32_t, PkGraphicsSpirvId> PkGraphicsSpirvIds;
+
+static const PkGraphicsSpirvId& getId(const PkGraphicsSpirvIds& rIds, const uint32_t id)
+{
+    auto it = rIds.find(id);
+    if (it == rIds.end() || it->second.pWords == nullptr)
+    {
+        throw std::runtime_error("failed to reflect shader!");
+    }
+
+    return it->second;
+}
+
+static PkGraphicsSpirvMember& getMember(PkGraphicsSpirvId& rId, const uint32_t member)
+{
+    if (rId.members.size() <= member)
+    {
+        rId.members.resize(member + 1);
+    }
+
+    return rId.members[member];
+}
+
+static uint32_t getArrayLength(const PkGraphicsSpirvIds& rIds, const PkGraphicsSpirvId& rArray)
+{
+    const PkGraphicsSpirvId& rLength = getId(rIds, rArray.pWords[3]);
+    if (rLength.opcode != OP_CONSTANT)
+    {
+        throw std::runtime_error("failed to reflect shader!");
+    }
+
+    return rLength.pWords[3];
+}
+
+// Bytes taken by a value of the type, as laid out by the offset and stride decorations of the block it is in.
+static uint32_t getTypeSize(const PkGraphicsSpirvIds& rIds, const uint32_t typeId, const uint32_t matrixStride = 0)
+{
+    const PkGraphicsSpirvId& rType = getId(rIds, typeId);
+
+    switch (rType.opcode)
+    {
+    case OP_TYPE_BOOL:
+        return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+        return rType.pWords[2] / 8;
+    case OP_TYPE_VECTOR:
+        return rType.pWords[3] * getTypeSize(rIds, rType.pWords[2]);
+    case OP_TYPE_MATRIX:
+        return rType.pWords[3] * (matrixStride != 0 ? matrixStride : getTypeSize(rIds, rType.pWords[2]));
+    case OP_TYPE_ARRAY:
+        return getArrayLength(rIds, rType) * (rType.arrayStride != 0 ? rType.arrayStride : getTypeSize(rIds, rType.pWords[2]));
+    case OP_TYPE_RUNTIME_ARRAY:
+        return 0;
+    case OP_TYPE_STRUCT:
+    {
+        const uint32_t memberCount = (rType.pWords[0] >> 16) - 2;
+        uint32_t size = 0;
+
+        for (uint32_t i = 0; i < memberCount; i++)
+        {
+            const PkGraphicsSpirvMember member = i < rType.members.size() ? rType.members[i] : PkGraphicsSpirvMember();
+            size = std::max(size, member.offset + getTypeSize(rIds, rType.pWords[2 + i], member.matrixStride));
+        }
+
+        return size;
+    }
+    default:
+        throw std::runtime_error("failed to reflect shader!");
+    }
+}
+
+static VkDescriptorType getDescriptorType(const uint32_t storageClass, const PkGraphicsSpirvId& rType)
+{
+    if (storageClass == STORAGE_CLASS_STORAGE_BUFFER)
+    {
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+
+    if (storageClass == STORAGE_CLASS_UNIFORM)
+    {
+        // GLSL buffer blocks come out of glslc as BufferBlock decorated uniforms.
+        return rType.bBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    }
+
+    switch (rType.opcode)
+    {
+    case OP_TYPE_SAMPLED_IMAGE:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case OP_TYPE_SAMPLER:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case OP_TYPE_IMAGE:
+    {
+        const bool bStorage = rType.pWords[7] == IMAGE_SAMPLED_STORAGE;
+
+        if (rType.pWords[3] == DIM_BUFFER)
+        {
+            return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        }
+        if (rType.pWords[3] == DIM_SUBPASS_DATA)
+        {
+            return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        }
+
+        return bStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    }
+    default:
+        throw std::runtime_error("failed to reflect shader!");
+    }
+}
+
+static VkFormat getInputFormat(const PkGraphicsSpirvIds& rIds, const PkGraphicsSpirvId& rType)
+{
+    uint32_t componentCount = 1;
+    const PkGraphicsSpirvId* pComponent = &rType;
+
+    if (rType.opcode == OP_TYPE_VECTOR)
+    {
+        componentCount = rType.pWords[3];
+        pComponent = &getId(rIds, rType.pWords[2]);
+    }
+
+    if ((pComponent->opcode != OP_TYPE_FLOAT && pComponent->opcode != OP_TYPE_INT) || pComponent->pWords[2] != 32)
+    {
+        throw std::runtime_error("failed to reflect shader!");
+    }
+
+    static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+    static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+    static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+    if (pComponent->opcode == OP_TYPE_FLOAT)
+    {
+        return floatFormats[componentCount - 1];
+    }
+
+    return pComponent->pWords[3] != 0 ? intFormats[componentCount - 1] : uintFormats[componentCount - 1];
+}
+
+enum PkGraphicsNumericType : uint32_t
+{
+    NUMERIC_TYPE_FLOAT = 0,
+    NUMERIC_TYPE_SINT,
+    NUMERIC_TYPE_UINT
+};
+
+// What a shader reads an attribute of the format as. Normalised and float formats are all read as floats.
+static PkGraphicsNumericType getNumericType(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R16G16_SINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+        return NUMERIC_TYPE_SINT;
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R16G16_UINT:
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32B32_UINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+        return NUMERIC_TYPE_UINT;
+    default:
+        return NUMERIC_TYPE_FLOAT;
+    }
+}
+
+static VkShaderStageFlagBits getStage(const uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+    case 0:
+        return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1:
+        return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2:
+        return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3:
+        return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4:
+        return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5:
+        return VK_SHADER_STAGE_COMPUTE_BIT;
+    default:
+        throw std::runtime_error("failed to reflect shader!");
+    }
+}
+
+/*static*/ PkGraphicsReflectedShader PkGraphicsReflection::Reflect(const std::vector<char>& rSpirv)
+{
+    // The code comes from a file read into chars, so it is copied to be sure of its alignment.
+    std::vector<uint32_t> words(rSpirv.size() / sizeof(uint32_t));
+    memcpy(words.data(), rSpirv.data(), words.size() * sizeof(uint32_t));
+
+    if (rSpirv.size() % sizeof(uint32_t) != 0 || words.size() < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC)
+    {
+        throw std::runtime_error("failed to reflect shader!");
+    }
+
+    PkGraphicsReflectedShader shader{};
+    bool bEntryPointFound = false;
+
+    PkGraphicsSpirvIds ids;
+    std::vector<const uint32_t*> variables;
+
+    for (size_t i = SPIRV_HEADER_WORDS; i < words.size();)
+    {
+        const uint32_t* pWords = &words[i];
+        const uint32_t opcode = pWords[0] & 0xffff;
+        const uint32_t wordCount = pWords[0] >> 16;
+
+        if (wordCount == 0 || i + wordCount > words.size())
+        {
+            throw std::runtime_error("failed to reflect shader!");
+        }
+
+        switch (opcode)
+        {
+        case OP_ENTRY_POINT:
+            if (!bEntryPointFound)
+            {
+                shader.stage = getStage(pWords[1]);
+                bEntryPointFound = true;
+            }
+            break;
+        case OP_TYPE_BOOL:
+        case OP_TYPE_INT:
+        case OP_TYPE_FLOAT:
+        case OP_TYPE_VECTOR:
+        case OP_TYPE_MATRIX:
+        case OP_TYPE_IMAGE:
+        case OP_TYPE_SAMPLER:
+        case OP_TYPE_SAMPLED_IMAGE:
+        case OP_TYPE_ARRAY:
+        case OP_TYPE_RUNTIME_ARRAY:
+        case OP_TYPE_STRUCT:
+        case OP_TYPE_POINTER:
+            ids[pWords[1]].opcode = opcode;
+            ids[pWords[1]].pWords = pWords;
+            break;
+        case OP_CONSTANT:
+            ids[pWords[2]].opcode = opcode;
+            ids[pWords[2]].pWords = pWords;
+            break;
+        case OP_VARIABLE:
+            ids[pWords[2]].opcode = opcode;
+            ids[pWords[2]].pWords = pWords;
+            variables.push_back(pWords);
+            break;
+        case OP_DECORATE:
+        {
+            PkGraphicsSpirvId& rId = ids[pWords[1]];
+            switch (pWords[2])
+            {
+            case DECORATION_BUFFER_BLOCK: rId.bBufferBlock = true; break;
+            case DECORATION_ARRAY_STRIDE: rId.arrayStride = pWords[3]; break;
+            case DECORATION_BUILT_IN: rId.bBuiltIn = true; break;
+            case DECORATION_LOCATION: rId.location = pWords[3]; break;
+            case DECORATION_BINDING: rId.binding = pWords[3]; break;
+            case DECORATION_DESCRIPTOR_SET: rId.set = pWords[3]; break;
+            }
+            break;
+        }
+        case OP_MEMBER_DECORATE:
+            if (pWords[3] == DECORATION_OFFSET)
+            {
+                getMember(ids[pWords[1]], pWords[2]).offset = pWords[4];
+            }
+            else if (pWords[3] == DECORATION_MATRIX_STRIDE)
+            {
+                getMember(ids[pWords[1]], pWords[2]).matrixStride = pWords[4];
+            }
+            else if (pWords[3] == DECORATION_BUILT_IN)
+            {
+                // Members of gl_PerVertex; the whole block is built in.
+                ids[pWords[1]].bBuiltIn = true;
+            }
+            break;
+        }
+
+        i += wordCount;
+    }
+
+    if (!bEntryPointFound)
+    {
+        throw std::runtime_error("failed to reflect shader!");
+    }
+
+    for (const uint32_t* pVariable : variables)
+    {
+        const PkGraphicsSpirvId& rVariable = ids[pVariable[2]];
+        const uint32_t storageClass = pVariable[3];
+
+        const PkGraphicsSpirvId& rPointer = getId(ids, pVariable[1]);
+        const PkGraphicsSpirvId* pType = &getId(ids, rPointer.pWords[3]);
+
+        if (storageClass == STORAGE_CLASS_PUSH_CONSTANT)
+        {
+            shader.pushConstantSize = std::max(shader.pushConstantSize, getTypeSize(ids, rPointer.pWords[3]));
+        }
+        else if (storageClass == STORAGE_CLASS_UNIFORM_CONSTANT || storageClass == STORAGE_CLASS_UNIFORM || storageClass == STORAGE_CLASS_STORAGE_BUFFER)
+        {
+            PkGraphicsReflectedBinding binding{};
+            binding.set = rVariable.set != NOT_DECORATED ? rVariable.set : 0;
+            binding.binding = rVariable.binding != NOT_DECORATED ? rVariable.binding : 0;
+            binding.descriptorCount = 1;
+
+            // Arrays of descriptors are one binding of several descriptors.
+            while (pType->opcode == OP_TYPE_ARRAY || pType->opcode == OP_TYPE_RUNTIME_ARRAY)
+            {
+                if (pType->opcode == OP_TYPE_RUNTIME_ARRAY)
+                {
+                    throw std::runtime_error("unsupported descriptor array!");
+                }
+
+                binding.descriptorCount *= getArrayLength(ids, *pType);
+                pType = &getId(ids, pType->pWords[2]);
+            }
+
+            binding.descriptorType = getDescriptorType(storageClass, *pType);
+            shader.bindings.push_back(binding);
+        }
+        else if (storageClass == STORAGE_CLASS_INPUT && shader.stage == VK_SHADER_STAGE_VERTEX_BIT && !rVariable.bBuiltIn && !pType->bBuiltIn)
+        {
+            if (rVariable.location == NOT_DECORATED)
+            {
+                throw std::runtime_error("failed to reflect shader!");
+            }
+
+            if (pType->opcode == OP_TYPE_MATRIX)
+            {
+                const VkFormat columnFormat = getInputFormat(ids, getId(ids, pType->pWords[2]));
+
+                for (uint32_t column = 0; column < pType->pWords[3]; column++)
+                {
+                    shader.inputs.push_back({ rVariable.location + column, columnFormat });
+                }
+            }
+            else
+            {
+                shader.inputs.push_back({ rVariable.location, getInputFormat(ids, *pType) });
+            }
+        }
+    }
+
+    std::sort(shader.inputs.begin(), shader.inputs.end(), [](const PkGraphicsReflectedInput& rA, const PkGraphicsReflectedInput& rB) { return rA.location < rB.location; });
+
+    return shader;
+}
+
+/*static*/ std::vector<VkDescriptorSetLayoutBinding> PkGraphicsReflection::GetSetLayoutBindings(const std::vector<PkGraphicsReflectedShader>& rShaders, const uint32_t set)
+{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+
+    for (const PkGraphicsReflectedShader& rShader : rShaders)
+    {
+        for (const PkGraphicsReflectedBinding& rBinding : rShader.bindings)
+        {
+            if (rBinding.set != set)
+            {
+                continue;
+            }
+
+            auto it = std::find_if(layoutBindings.begin(), layoutBindings.end(), [&rBinding](const VkDescriptorSetLayoutBinding& rLayoutBinding) { return rLayoutBinding.binding == rBinding.binding; });
+
+            if (it == layoutBindings.end())
+            {
+                VkDescriptorSetLayoutBinding layoutBinding{};
+                layoutBinding.binding = rBinding.binding;
+                layoutBinding.descriptorType = rBinding.descriptorType;
+                layoutBinding.descriptorCount = rBinding.descriptorCount;
+                layoutBinding.stageFlags = rShader.stage;
+                layoutBinding.pImmutableSamplers = nullptr;
+                layoutBindings.push_back(layoutBinding);
+            }
+            else if (it->descriptorType != rBinding.descriptorType || it->descriptorCount != rBinding.descriptorCount)
+            {
+                throw std::runtime_error("shaders declare different descriptors for one binding!");
+            }
+            else
+            {
+                it->stageFlags |= rShader.stage;
+            }
+        }
+    }
+
+    std::sort(layoutBindings.begin(), layoutBindings.end(), [](const VkDescriptorSetLayoutBinding& rA, const VkDescriptorSetLayoutBinding& rB) { return rA.binding < rB.binding; });
+
+    return layoutBindings;
+}
+
+/*static*/ uint32_t PkGraphicsReflection::GetSetCount(const std::vector<PkGraphicsReflectedShader>& rShaders)
+{
+    uint32_t setCount = 0;
+
+    for (const PkGraphicsReflectedShader& rShader : rShaders)
+    {
+        for (const PkGraphicsReflectedBinding& rBinding : rShader.bindings)
+        {
+            setCount = std::max(setCount, rBinding.set + 1);
+        }
+    }
+
+    return setCount;
+}
+
+/*static*/ std::vector<VkPushConstantRange> PkGraphicsReflection::GetPushConstantRanges(const std::vector<PkGraphicsReflectedShader>& rShaders)
+{
+    VkPushConstantRange range{};
+
+    for (const PkGraphicsReflectedShader& rShader : rShaders)
+    {
+        if (rShader.pushConstantSize > 0)
+        {
+            range.stageFlags |= rShader.stage;
+            range.size = std::max(range.size, rShader.pushConstantSize);
+        }
+    }
+
+    if (range.size == 0)
+    {
+        return {};
+    }
+
+    return { range };
+}
+
+/*static*/ uint64_t PkGraphicsReflection::GetVertexInput(const PkGraphicsReflectedShader& rVertexShader, const std::vector<PkGraphicsVertexStream>& rStreams, std::vector<VkVertexInputBindingDescription>& rBindings, std::vector<VkVertexInputAttributeDescription>& rAttributes)
+{
+    rBindings.clear();
+    rAttributes.clear();
+
+    // The streams' layout hashes already cover their strides, offsets and formats.
+    uint64_t hash = PK_HASH_OFFSET_BASIS;
+    size_t inputIndex = 0;
+
+    for (uint32_t binding = 0; binding < static_cast<uint32_t>(rStreams.size()); binding++)
+    {
+        const PkGraphicsVertexStream& rStream = rStreams[binding];
+
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = binding;
+        bindingDescription.stride = rStream.stride;
+        bindingDescription.inputRate = rStream.inputRate;
+        rBindings.push_back(bindingDescription);
+
+        hash = PkHashWord(hash, rStream.layoutHash);
+        hash = PkHashWord(hash, rStream.inputRate);
+
+        for (uint32_t i = 0; i < rStream.attributeCount; i++)
+        {
+            if (inputIndex == rVertexShader.inputs.size())
+            {
+                throw std::runtime_error("vertex streams do not match the shader's inputs!");
+            }
+
+            const PkGraphicsReflectedInput& rInput = rVertexShader.inputs[inputIndex++];
+
+            VkVertexInputAttributeDescription attributeDescription = rStream.pAttributes[i];
+            attributeDescription.binding = binding;
+            attributeDescription.location = rInput.location;
+
+            if (getNumericType(attributeDescription.format) != getNumericType(rInput.format))
+            {
+                throw std::runtime_error("vertex attribute does not match its shader input!");
+            }
+
+            rAttributes.push_back(attributeDescription);
+            hash = PkHashWord(hash, rInput.location);
+        }
+    }
+
+    if (inputIndex != rVertexShader.inputs.size())
+    {
+        throw std::runtime_error("vertex streams do not match the shader's inputs!");
+    }
+
+    return hash;
+}
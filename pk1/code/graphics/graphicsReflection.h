@@ -0,0 +1,59 @@
+#pragma once
+
+#include "graphics/graphicsVertexLayout.h"
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+#include <stdint.h>
+
+// A descriptor a shader declares.
+struct PkGraphicsReflectedBinding
+{
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType descriptorType;
+    uint32_t descriptorCount;
+};
+
+// One location of a vertex shader input, as the shader reads it. A matrix takes one location per column.
+struct PkGraphicsReflectedInput
+{
+    uint32_t location;
+    VkFormat format;
+};
+
+struct PkGraphicsReflectedShader
+{
+    VkShaderStageFlagBits stage;
+    std::vector<PkGraphicsReflectedBinding> bindings;
+    // Sorted by location; only filled for vertex shaders.
+    std::vector<PkGraphicsReflectedInput> inputs;
+    uint32_t pushConstantSize = 0;
+};
+
+// Reads the interface of a SPIR-V module, so layouts and vertex input are derived from the shaders instead of being
+// kept in step with them by hand.
+class PkGraphicsReflection
+{
+public:
+    PkGraphicsReflection() = delete;
+
+    // Throws if the module isn't SPIR-V or uses something reflection doesn't handle.
+    static PkGraphicsReflectedShader Reflect(const std::vector<char>& rSpirv);
+
+    // The bindings every given shader declares in the set, with the stages of all the shaders using each one. Shaders
+    // that share a descriptor set need one layout for it, so pass every shader the set is bound for.
+    static std::vector<VkDescriptorSetLayoutBinding> GetSetLayoutBindings(const std::vector<PkGraphicsReflectedShader>& rShaders, const uint32_t set);
+
+    // One past the highest set any of the shaders uses.
+    static uint32_t GetSetCount(const std::vector<PkGraphicsReflectedShader>& rShaders);
+
+    // A single range from offset 0 covering every shader's push constants; empty if none use any.
+    static std::vector<VkPushConstantRange> GetPushConstantRanges(const std::vector<PkGraphicsReflectedShader>& rShaders);
+
+    // Streams take the shader's input locations in order, one per attribute, each on the binding of its index in
+    // rStreams. Throws if the streams don't cover the shader's inputs or an attribute is read as the wrong type.
+    // Returns a hash of the vertex input for pipeline keys.
+    static uint64_t GetVertexInput(const PkGraphicsReflectedShader& rVertexShader, const std::vector<PkGraphicsVertexStream>& rStreams, std::vector<VkVertexInputBindingDescription>& rBindings, std::vector<VkVertexInputAttributeDescription>& rAttributes);
+};
@@ -0,0 +1,700 @@
+#include "graphicsRenderGraph.h"
+
+#include "graphics/graphicsCore.h"
+#include "graphics/graphicsSwapChain.h"
+#include "graphics/graphicsUtils.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+static const VkAccessFlags WRITE_ACCESS_MASK =
+    VK_ACCESS_SHADER_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_TRANSFER_WRITE_BIT |
+    VK_ACCESS_HOST_WRITE_BIT |
+    VK_ACCESS_MEMORY_WRITE_BIT;
+
+static const uint32_t NO_MEMORY_BLOCK = UINT32_MAX;
+
+struct PkGraphicsRenderGraphImage
+{
+    const char* pName = nullptr;
+    PkGraphicsRenderGraphImageDesc desc{};
+    bool bImported = false;
+
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkMemoryRequirements memoryRequirements{};
+    uint32_t memoryBlock = NO_MEMORY_BLOCK;
+
+    // The first and last declared passes that use the image; images whose ranges do not overlap may alias.
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+
+    // State left by the last pass to use the image, carried from pass to pass and from frame to frame.
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stageMask = 0;
+    VkAccessFlags accessMask = 0;
+    bool bUsedThisFrame = false;
+};
+
+// Every use of one resource by one pass, with reads and writes merged.
+struct PkGraphicsRenderGraphUse
+{
+    PkGraphicsRenderGraphResource resource;
+    PkGraphicsRenderGraphAccess access;
+    bool bRead;
+    bool bWrite;
+};
+
+struct PkGraphicsRenderGraphPassData
+{
+    const char* pName = nullptr;
+    bool bHasSideEffects = false;
+    bool bEnabled = true;
+    bool bLive = false;
+    PkGraphicsRenderGraphExecuteFunc func;
+    std::vector<PkGraphicsRenderGraphUse> uses;
+};
+
+// Memory shared by images with disjoint lifetimes. The block remembers its last use so the next image placed in it,
+// this frame or the next, waits for whichever image used it before.
+struct PkGraphicsRenderGraphMemoryBlock
+{
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    VkMemoryRequirements memoryRequirements{};
+    std::vector<PkGraphicsRenderGraphResource> images;
+
+    VkPipelineStageFlags stageMask = 0;
+    VkAccessFlags accessMask = 0;
+};
+
+struct PkGraphicsRenderGraphData
+{
+    std::vector<PkGraphicsRenderGraphImage> images;
+    std::vector<PkGraphicsRenderGraphPassData> passes;
+    std::vector<PkGraphicsRenderGraphMemoryBlock> memoryBlocks;
+    PkGraphicsRenderGraphResource swapChainImage = UINT32_MAX;
+    bool bCompiled = false;
+
+    std::vector<VkCommandPool> commandPools;
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    std::vector<bool> neededImages;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+
+    VkDeviceSize transientMemorySize = 0;
+    VkDeviceSize unaliasedMemorySize = 0;
+    PkGraphicsRenderGraphStats stats;
+};
+
+static PkGraphicsRenderGraphData* s_pData = nullptr;
+
+static bool hasDepth(const VkFormat format)
+{
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+        format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static bool hasStencil(const VkFormat format)
+{
+    return format == VK_FORMAT_S8_UINT || format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+// Layout transitions of a depth/stencil image must cover both aspects, even though only depth is ever sampled.
+static VkImageAspectFlags getBarrierAspectMask(const VkFormat format)
+{
+    if (!hasDepth(format) && !hasStencil(format))
+    {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
+    return (hasDepth(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : 0) | (hasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+static void addUse(const PkGraphicsRenderGraphPass pass, const PkGraphicsRenderGraphResource resource, const PkGraphicsRenderGraphAccess& rAccess, const bool bRead, const bool bWrite)
+{
+    std::vector<PkGraphicsRenderGraphUse>& rUses = s_pData->passes[pass].uses;
+
+    for (PkGraphicsRenderGraphUse& rUse : rUses)
+    {
+        if (rUse.resource != resource)
+        {
+            continue;
+        }
+
+        if (rUse.access.layout != rAccess.layout)
+        {
+            throw std::runtime_error("render graph pass needs one resource in two layouts!");
+        }
+
+        rUse.access.stageMask |= rAccess.stageMask;
+        rUse.access.accessMask |= rAccess.accessMask;
+        rUse.bRead |= bRead;
+        rUse.bWrite |= bWrite;
+        return;
+    }
+
+    rUses.push_back(PkGraphicsRenderGraphUse{ resource, rAccess, bRead, bWrite });
+}
+
+static void createCommandBuffers()
+{
+    PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
+
+    s_pData->commandPools.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+    s_pData->commandBuffers.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+
+    for (uint32_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
+    {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+        if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPools[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create graphics command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = s_pData->commandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, &s_pData->commandBuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
+    }
+}
+
+static void destroyCommandBuffers()
+{
+    for (VkCommandPool commandPool : s_pData->commandPools)
+    {
+        vkDestroyCommandPool(PkGraphicsCore::GetDevice(), commandPool, nullptr);
+    }
+
+    s_pData->commandPools.clear();
+    s_pData->commandBuffers.clear();
+}
+
+static void createImage(PkGraphicsRenderGraphImage& rImage)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = PkGraphicsSwapChain::GetSwapChainExtent().width;
+    imageInfo.extent.height = PkGraphicsSwapChain::GetSwapChainExtent().height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = rImage.desc.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = rImage.desc.usage;
+    imageInfo.samples = rImage.desc.samples;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(PkGraphicsCore::GetDevice(), &imageInfo, nullptr, &rImage.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    vkGetImageMemoryRequirements(PkGraphicsCore::GetDevice(), rImage.image, &rImage.memoryRequirements);
+}
+
+static bool overlaps(const PkGraphicsRenderGraphImage& rA, const PkGraphicsRenderGraphImage& rB)
+{
+    return rA.firstPass <= rB.lastPass && rB.firstPass <= rA.lastPass;
+}
+
+// Largest first, each image goes into the first block it shares a memory type with and whose images are all dead by
+// the time it is needed.
+static void assignMemoryBlocks()
+{
+    std::vector<PkGraphicsRenderGraphResource> order;
+    for (PkGraphicsRenderGraphResource i = 0; i < s_pData->images.size(); i++)
+    {
+        if (!s_pData->images[i].bImported)
+        {
+            order.push_back(i);
+        }
+    }
+
+    std::stable_sort(order.begin(), order.end(), [](const PkGraphicsRenderGraphResource a, const PkGraphicsRenderGraphResource b)
+    {
+        return s_pData->images[a].memoryRequirements.size > s_pData->images[b].memoryRequirements.size;
+    });
+
+    for (const PkGraphicsRenderGraphResource resource : order)
+    {
+        PkGraphicsRenderGraphImage& rImage = s_pData->images[resource];
+
+        for (uint32_t blockIndex = 0; blockIndex < s_pData->memoryBlocks.size() && rImage.memoryBlock == NO_MEMORY_BLOCK; blockIndex++)
+        {
+            PkGraphicsRenderGraphMemoryBlock& rBlock = s_pData->memoryBlocks[blockIndex];
+
+            if ((rBlock.memoryRequirements.memoryTypeBits & rImage.memoryRequirements.memoryTypeBits) == 0)
+            {
+                continue;
+            }
+
+            const bool bOverlaps = std::any_of(rBlock.images.begin(), rBlock.images.end(), [&rImage](const PkGraphicsRenderGraphResource other)
+            {
+                return overlaps(rImage, s_pData->images[other]);
+            });
+
+            if (!bOverlaps)
+            {
+                rBlock.memoryRequirements.size = std::max(rBlock.memoryRequirements.size, rImage.memoryRequirements.size);
+                rBlock.memoryRequirements.alignment = std::max(rBlock.memoryRequirements.alignment, rImage.memoryRequirements.alignment);
+                rBlock.memoryRequirements.memoryTypeBits &= rImage.memoryRequirements.memoryTypeBits;
+                rBlock.images.push_back(resource);
+                rImage.memoryBlock = blockIndex;
+            }
+        }
+
+        if (rImage.memoryBlock == NO_MEMORY_BLOCK)
+        {
+            PkGraphicsRenderGraphMemoryBlock block;
+            block.memoryRequirements = rImage.memoryRequirements;
+            block.images.push_back(resource);
+
+            rImage.memoryBlock = static_cast<uint32_t>(s_pData->memoryBlocks.size());
+            s_pData->memoryBlocks.push_back(block);
+        }
+
+        s_pData->unaliasedMemorySize += rImage.memoryRequirements.size;
+    }
+}
+
+static void destroyImages()
+{
+    for (PkGraphicsRenderGraphImage& rImage : s_pData->images)
+    {
+        if (!rImage.bImported && rImage.image != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(PkGraphicsCore::GetDevice(), rImage.imageView, nullptr);
+            vkDestroyImage(PkGraphicsCore::GetDevice(), rImage.image, nullptr);
+        }
+    }
+
+    for (PkGraphicsRenderGraphMemoryBlock& rBlock : s_pData->memoryBlocks)
+    {
+        vmaFreeMemory(PkGraphicsCore::GetAllocator(), rBlock.allocation);
+    }
+
+    s_pData->images.clear();
+    s_pData->memoryBlocks.clear();
+    s_pData->passes.clear();
+    s_pData->swapChainImage = UINT32_MAX;
+    s_pData->transientMemorySize = 0;
+    s_pData->unaliasedMemorySize = 0;
+    s_pData->bCompiled = false;
+}
+
+// Walks back from the swap chain image: a pass is kept if it has side effects or writes something a kept pass reads.
+static void cullPasses()
+{
+    std::vector<bool>& rNeeded = s_pData->neededImages;
+    rNeeded.assign(s_pData->images.size(), false);
+    rNeeded[s_pData->swapChainImage] = true;
+
+    for (uint32_t i = static_cast<uint32_t>(s_pData->passes.size()); i-- > 0;)
+    {
+        PkGraphicsRenderGraphPassData& rPass = s_pData->passes[i];
+
+        rPass.bLive = rPass.bEnabled && (rPass.bHasSideEffects || std::any_of(rPass.uses.begin(), rPass.uses.end(), [&rNeeded](const PkGraphicsRenderGraphUse& rUse)
+        {
+            return rUse.bWrite && rNeeded[rUse.resource];
+        }));
+
+        if (!rPass.bLive)
+        {
+            continue;
+        }
+
+        // A pass that overwrites an image without reading it makes any earlier writer of that image unnecessary.
+        for (const PkGraphicsRenderGraphUse& rUse : rPass.uses)
+        {
+            if (rUse.bWrite && !rUse.bRead)
+            {
+                rNeeded[rUse.resource] = false;
+            }
+        }
+
+        for (const PkGraphicsRenderGraphUse& rUse : rPass.uses)
+        {
+            if (rUse.bRead)
+            {
+                rNeeded[rUse.resource] = true;
+            }
+        }
+    }
+}
+
+static void addImageBarrier(const PkGraphicsRenderGraphImage& rImage, const VkImageLayout oldLayout, const VkImageLayout newLayout, const VkAccessFlags srcAccessMask, const VkAccessFlags dstAccessMask)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = rImage.image;
+    barrier.subresourceRange.aspectMask = getBarrierAspectMask(rImage.desc.format);
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    s_pData->imageBarriers.push_back(barrier);
+}
+
+static void recordPipelineBarrier(VkCommandBuffer commandBuffer, const VkPipelineStageFlags srcStageMask, const VkPipelineStageFlags dstStageMask)
+{
+    // Nothing earlier in the frame touched the resources, so the only wait is on the layout transition itself.
+    const VkPipelineStageFlags srcStages = srcStageMask != 0 ? srcStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStageMask, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(s_pData->imageBarriers.size()), s_pData->imageBarriers.data());
+
+    s_pData->stats.barrierBatches++;
+    s_pData->stats.imageBarriers += static_cast<uint32_t>(s_pData->imageBarriers.size());
+    s_pData->imageBarriers.clear();
+}
+
+// Every transition and wait a pass needs goes into one vkCmdPipelineBarrier before it; reads following reads in the
+// same layout need none.
+static void recordPassBarriers(VkCommandBuffer commandBuffer, const PkGraphicsRenderGraphPassData& rPass)
+{
+    VkPipelineStageFlags srcStageMask = 0;
+    VkPipelineStageFlags dstStageMask = 0;
+
+    for (const PkGraphicsRenderGraphUse& rUse : rPass.uses)
+    {
+        PkGraphicsRenderGraphImage& rImage = s_pData->images[rUse.resource];
+
+        VkImageLayout oldLayout = rImage.layout;
+        VkPipelineStageFlags prevStageMask = rImage.stageMask;
+        VkAccessFlags prevAccessMask = rImage.accessMask;
+
+        if (!rImage.bImported && !rImage.bUsedThisFrame)
+        {
+            // Whatever is in the memory belongs to an earlier image or an earlier frame.
+            const PkGraphicsRenderGraphMemoryBlock& rBlock = s_pData->memoryBlocks[rImage.memoryBlock];
+            oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            prevStageMask = rBlock.stageMask;
+            prevAccessMask = rBlock.accessMask;
+        }
+        else if (rUse.bWrite && !rUse.bRead && oldLayout != rUse.access.layout)
+        {
+            oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        const bool bLayoutChange = oldLayout != rUse.access.layout;
+        const bool bAfterWrite = (prevAccessMask & WRITE_ACCESS_MASK) != 0;
+        const bool bWriteAfterRead = rUse.bWrite && prevStageMask != 0;
+
+        if (bLayoutChange || bAfterWrite)
+        {
+            addImageBarrier(rImage, oldLayout, rUse.access.layout, prevAccessMask & WRITE_ACCESS_MASK, rUse.access.accessMask);
+            srcStageMask |= prevStageMask;
+            dstStageMask |= rUse.access.stageMask;
+
+            rImage.stageMask = rUse.access.stageMask;
+            rImage.accessMask = rUse.access.accessMask;
+        }
+        else if (bWriteAfterRead)
+        {
+            // Only earlier reads to wait for: an execution dependency is enough.
+            srcStageMask |= prevStageMask;
+            dstStageMask |= rUse.access.stageMask;
+
+            rImage.stageMask = rUse.access.stageMask;
+            rImage.accessMask = rUse.access.accessMask;
+        }
+        else
+        {
+            rImage.stageMask |= rUse.access.stageMask;
+            rImage.accessMask |= rUse.access.accessMask;
+        }
+
+        // A read-only use leaves nothing for the next pass to make visible.
+        if (!rUse.bWrite)
+        {
+            rImage.accessMask &= ~WRITE_ACCESS_MASK;
+        }
+
+        rImage.layout = rUse.access.layout;
+        rImage.bUsedThisFrame = true;
+
+        if (rImage.memoryBlock != NO_MEMORY_BLOCK)
+        {
+            s_pData->memoryBlocks[rImage.memoryBlock].stageMask = rImage.stageMask;
+            s_pData->memoryBlocks[rImage.memoryBlock].accessMask = rImage.accessMask;
+        }
+    }
+
+    if (dstStageMask != 0)
+    {
+        recordPipelineBarrier(commandBuffer, srcStageMask, dstStageMask);
+    }
+}
+
+/*static*/ PkGraphicsRenderGraphResource PkGraphicsRenderGraph::CreateImage(const char* pName, const PkGraphicsRenderGraphImageDesc& rDesc)
+{
+    PkGraphicsRenderGraphImage image;
+    image.pName = pName;
+    image.desc = rDesc;
+
+    s_pData->images.push_back(image);
+    return static_cast<PkGraphicsRenderGraphResource>(s_pData->images.size() - 1);
+}
+
+/*static*/ PkGraphicsRenderGraphResource PkGraphicsRenderGraph::ImportSwapChainImage()
+{
+    if (s_pData->swapChainImage == UINT32_MAX)
+    {
+        PkGraphicsRenderGraphImage image;
+        image.pName = "Swap chain";
+        image.desc.format = PkGraphicsSwapChain::GetSwapChainImageFormat();
+        image.desc.samples = VK_SAMPLE_COUNT_1_BIT;
+        image.desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        image.bImported = true;
+
+        s_pData->images.push_back(image);
+        s_pData->swapChainImage = static_cast<PkGraphicsRenderGraphResource>(s_pData->images.size() - 1);
+    }
+
+    return s_pData->swapChainImage;
+}
+
+/*static*/ PkGraphicsRenderGraphPass PkGraphicsRenderGraph::AddPass(const char* pName, const bool bHasSideEffects, PkGraphicsRenderGraphExecuteFunc func)
+{
+    PkGraphicsRenderGraphPassData pass;
+    pass.pName = pName;
+    pass.bHasSideEffects = bHasSideEffects;
+    pass.func = func;
+
+    s_pData->passes.push_back(pass);
+    return static_cast<PkGraphicsRenderGraphPass>(s_pData->passes.size() - 1);
+}
+
+/*static*/ void PkGraphicsRenderGraph::AddRead(const PkGraphicsRenderGraphPass pass, const PkGraphicsRenderGraphResource resource, const PkGraphicsRenderGraphAccess& rAccess)
+{
+    addUse(pass, resource, rAccess, true, false);
+}
+
+/*static*/ void PkGraphicsRenderGraph::AddWrite(const PkGraphicsRenderGraphPass pass, const PkGraphicsRenderGraphResource resource, const PkGraphicsRenderGraphAccess& rAccess)
+{
+    addUse(pass, resource, rAccess, false, true);
+}
+
+/*static*/ void PkGraphicsRenderGraph::SetPassEnabled(const PkGraphicsRenderGraphPass pass, const bool bEnabled)
+{
+    s_pData->passes[pass].bEnabled = bEnabled;
+}
+
+/*static*/ void PkGraphicsRenderGraph::Compile()
+{
+    ImportSwapChainImage();
+
+    // Lifetimes span every declared pass, enabled or not, so the aliasing holds whichever passes run in a frame.
+    for (uint32_t passIndex = 0; passIndex < s_pData->passes.size(); passIndex++)
+    {
+        for (const PkGraphicsRenderGraphUse& rUse : s_pData->passes[passIndex].uses)
+        {
+            PkGraphicsRenderGraphImage& rImage = s_pData->images[rUse.resource];
+            rImage.firstPass = std::min(rImage.firstPass, passIndex);
+            rImage.lastPass = std::max(rImage.lastPass, passIndex);
+        }
+    }
+
+    for (PkGraphicsRenderGraphImage& rImage : s_pData->images)
+    {
+        if (!rImage.bImported)
+        {
+            createImage(rImage);
+        }
+    }
+
+    assignMemoryBlocks();
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    for (PkGraphicsRenderGraphMemoryBlock& rBlock : s_pData->memoryBlocks)
+    {
+        if (vmaAllocateMemory(PkGraphicsCore::GetAllocator(), &rBlock.memoryRequirements, &allocInfo, &rBlock.allocation, nullptr) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate render graph memory!");
+        }
+
+        for (const PkGraphicsRenderGraphResource resource : rBlock.images)
+        {
+            PkGraphicsRenderGraphImage& rImage = s_pData->images[resource];
+
+            if (vmaBindImageMemory(PkGraphicsCore::GetAllocator(), rBlock.allocation, rImage.image) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to bind render graph memory!");
+            }
+
+            const VkImageAspectFlags viewAspectMask = hasDepth(rImage.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+            rImage.imageView = PkGraphicsUtils::CreateImageView(PkGraphicsCore::GetDevice(), rImage.image, rImage.desc.format, viewAspectMask, 1);
+        }
+
+        s_pData->transientMemorySize += rBlock.memoryRequirements.size;
+    }
+
+    s_pData->bCompiled = true;
+}
+
+/*static*/ VkImage PkGraphicsRenderGraph::GetImage(const PkGraphicsRenderGraphResource resource)
+{
+    return s_pData->images[resource].image;
+}
+
+/*static*/ VkImageView PkGraphicsRenderGraph::GetImageView(const PkGraphicsRenderGraphResource resource)
+{
+    return s_pData->images[resource].imageView;
+}
+
+/*static*/ VkCommandBuffer PkGraphicsRenderGraph::Execute(const uint32_t imageIndex)
+{
+    if (!s_pData->bCompiled)
+    {
+        throw std::runtime_error("render graph executed before it was compiled!");
+    }
+
+    cullPasses();
+
+    s_pData->stats = PkGraphicsRenderGraphStats();
+
+    for (PkGraphicsRenderGraphImage& rImage : s_pData->images)
+    {
+        rImage.bUsedThisFrame = false;
+    }
+
+    // The acquire semaphore is waited on at colour attachment output, so the first transition must wait there too.
+    PkGraphicsRenderGraphImage& rSwapChainImage = s_pData->images[s_pData->swapChainImage];
+    rSwapChainImage.image = PkGraphicsSwapChain::GetSwapChainImage(imageIndex);
+    rSwapChainImage.imageView = PkGraphicsSwapChain::GetSwapChainImageView(imageIndex);
+    rSwapChainImage.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    rSwapChainImage.stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    rSwapChainImage.accessMask = 0;
+
+    VkCommandBuffer commandBuffer = s_pData->commandBuffers[imageIndex];
+
+    if (vkResetCommandPool(PkGraphicsCore::GetDevice(), s_pData->commandPools[imageIndex], 0) != VK_SUCCESS)
+    {
+        throw std::runtime_error("vkResetCommandPool error");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    for (const PkGraphicsRenderGraphPassData& rPass : s_pData->passes)
+    {
+        if (!rPass.bEnabled)
+        {
+            s_pData->stats.passesDisabled++;
+            continue;
+        }
+
+        if (!rPass.bLive)
+        {
+            s_pData->stats.passesCulled++;
+            continue;
+        }
+
+        recordPassBarriers(commandBuffer, rPass);
+        rPass.func(commandBuffer, imageIndex);
+        s_pData->stats.passesExecuted++;
+    }
+
+    addImageBarrier(rSwapChainImage, rSwapChainImage.layout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, rSwapChainImage.accessMask & WRITE_ACCESS_MASK, 0);
+    recordPipelineBarrier(commandBuffer, rSwapChainImage.stageMask, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    return commandBuffer;
+}
+
+/*static*/ void PkGraphicsRenderGraph::GetDebugState(PkGraphicsRenderGraphDebugState& rState)
+{
+    rState.stats = s_pData->stats;
+    rState.transientMemorySize = s_pData->transientMemorySize;
+    rState.unaliasedMemorySize = s_pData->unaliasedMemorySize;
+    rState.memoryBlockCount = static_cast<uint32_t>(s_pData->memoryBlocks.size());
+
+    rState.passes.clear();
+    for (const PkGraphicsRenderGraphPassData& rPass : s_pData->passes)
+    {
+        PkGraphicsRenderGraphDebugPass pass;
+        pass.pName = rPass.pName;
+        pass.bEnabled = rPass.bEnabled;
+        pass.bLive = rPass.bLive;
+        rState.passes.push_back(pass);
+    }
+}
+
+/*static*/ void PkGraphicsRenderGraph::ShowDebugUi(const PkGraphicsRenderGraphDebugState& rState)
+{
+    if (ImGui::CollapsingHeader("Render graph"))
+    {
+        const PkGraphicsRenderGraphStats& rStats = rState.stats;
+
+        ImGui::Text("Passes: %u run, %u culled, %u disabled", rStats.passesExecuted, rStats.passesCulled, rStats.passesDisabled);
+        ImGui::Text("Barriers: %u calls, %u image barriers", rStats.barrierBatches, rStats.imageBarriers);
+        ImGui::Text("Transient memory: %.1f MiB in %u blocks (%.1f MiB unaliased)", rState.transientMemorySize / (1024.0f * 1024.0f), rState.memoryBlockCount, rState.unaliasedMemorySize / (1024.0f * 1024.0f));
+
+        for (const PkGraphicsRenderGraphDebugPass& rPass : rState.passes)
+        {
+            ImGui::BulletText("%s: %s", rPass.pName, !rPass.bEnabled ? "disabled" : (rPass.bLive ? "run" : "culled"));
+        }
+    }
+}
+
+/*static*/ void PkGraphicsRenderGraph::Reset()
+{
+    destroyImages();
+}
+
+/*static*/ void PkGraphicsRenderGraph::OnSwapChainCreate()
+{
+    createCommandBuffers();
+}
+
+/*static*/ void PkGraphicsRenderGraph::OnSwapChainDestroy()
+{
+    destroyCommandBuffers();
+}
+
+/*static*/ void PkGraphicsRenderGraph::InitialiseGraphicsRenderGraph()
+{
+    s_pData = new PkGraphicsRenderGraphData();
+}
+
+/*static*/ void PkGraphicsRenderGraph::CleanupGraphicsRenderGraph()
+{
+    delete s_pData;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+
+#include "graphics/graphicsCommands.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+typedef uint32_t PkGraphicsRenderGraphResource;
+typedef uint32_t PkGraphicsRenderGraphPass;
+
+typedef std::function<void(VkCommandBuffer commandBuffer, const uint32_t imageIndex)> PkGraphicsRenderGraphExecuteFunc;
+
+// An image owned by the graph, sized to the swap chain. Its contents last for one frame only, so images whose passes
+// never overlap may share memory.
+struct PkGraphicsRenderGraphImageDesc
+{
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+};
+
+// Where and how a pass touches a resource, and the layout it needs the image in.
+struct PkGraphicsRenderGraphAccess
+{
+    VkPipelineStageFlags stageMask;
+    VkAccessFlags accessMask;
+    VkImageLayout layout;
+};
+
+static const PkGraphicsRenderGraphAccess PK_RENDER_GRAPH_COLOUR_ATTACHMENT =
+{
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+};
+
+static const PkGraphicsRenderGraphAccess PK_RENDER_GRAPH_DEPTH_ATTACHMENT =
+{
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+};
+
+static const PkGraphicsRenderGraphAccess PK_RENDER_GRAPH_DEPTH_COMPUTE_READ =
+{
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_ACCESS_SHADER_READ_BIT,
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+};
+
+struct PkGraphicsRenderGraphStats
+{
+    uint32_t passesExecuted = 0;
+    uint32_t passesCulled = 0;
+    uint32_t passesDisabled = 0;
+    uint32_t barrierBatches = 0;
+    uint32_t imageBarriers = 0;
+};
+
+struct PkGraphicsRenderGraphDebugPass
+{
+    // Pass names are string literals, so they outlive the graph they were added to.
+    const char* pName = nullptr;
+    bool bEnabled = false;
+    bool bLive = false;
+};
+
+struct PkGraphicsRenderGraphDebugState
+{
+    PkGraphicsRenderGraphStats stats;
+    VkDeviceSize transientMemorySize = 0;
+    VkDeviceSize unaliasedMemorySize = 0;
+    uint32_t memoryBlockCount = 0;
+    std::vector<PkGraphicsRenderGraphDebugPass> passes;
+};
+
+// Passes run in the order they are added. Each frame the graph drops disabled passes and passes whose writes nothing
+// reads, then records the rest into one command buffer with the barriers between them worked out from their reads and
+// writes. Passes and resources are declared again each time the swap chain is resized.
+class PkGraphicsRenderGraph
+{
+public:
+    PkGraphicsRenderGraph() = delete;
+
+    static PkGraphicsRenderGraphResource CreateImage(const char* pName, const PkGraphicsRenderGraphImageDesc& rDesc);
+
+    // The image being rendered this frame. It is handed over in PRESENT_SRC_KHR once the last pass has written it.
+    static PkGraphicsRenderGraphResource ImportSwapChainImage();
+
+    // A pass with side effects writes something outside the graph and is never culled.
+    static PkGraphicsRenderGraphPass AddPass(const char* pName, const bool bHasSideEffects, PkGraphicsRenderGraphExecuteFunc func);
+
+    // A write with no read of the same resource in the same pass discards what was there before.
+    static void AddRead(const PkGraphicsRenderGraphPass pass, const PkGraphicsRenderGraphResource resource, const PkGraphicsRenderGraphAccess& rAccess);
+    static void AddWrite(const PkGraphicsRenderGraphPass pass, const PkGraphicsRenderGraphResource resource, const PkGraphicsRenderGraphAccess& rAccess);
+
+    // Passes start enabled; a disabled pass is skipped until enabled again, along with anything only it needed.
+    static void SetPassEnabled(const PkGraphicsRenderGraphPass pass, const bool bEnabled);
+
+    // Creates the images, sharing memory where lifetimes allow. Call once every pass has been added.
+    static void Compile();
+
+    static VkImage GetImage(const PkGraphicsRenderGraphResource resource);
+    static VkImageView GetImageView(const PkGraphicsRenderGraphResource resource);
+
+    static VkCommandBuffer Execute(const uint32_t imageIndex);
+
+    // The first is called on the render thread; the second draws what it captured.
+    static void GetDebugState(PkGraphicsRenderGraphDebugState& rState);
+    static void ShowDebugUi(const PkGraphicsRenderGraphDebugState& rState);
+
+    // Destroys the images and forgets every pass and resource, ready for them to be declared again at a new size.
+    static void Reset();
+
+    // The per-image command buffers only need recreating when the number of swap chain images changes.
+    static void OnSwapChainCreate();
+    static void OnSwapChainDestroy();
+
+    static void InitialiseGraphicsRenderGraph();
+    static void CleanupGraphicsRenderGraph();
+};
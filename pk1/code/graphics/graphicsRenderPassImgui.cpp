@@ -1,6 +1,7 @@
 #include "graphicsRenderPassImgui.h"
 
 #include "graphics/graphicsCore.h"
+#include "graphics/graphicsFrameSync.h"
 #include "graphics/graphicsSwapChain.h"
 #include "graphics/graphicsUtils.h"
 
@@ -8,18 +9,20 @@
 #include "imgui/imgui_impl_vulkan.h"
 #include "imgui/imgui_impl_glfw.h"
 
+#include <algorithm>
 #include <iostream>
 #include <array>
 
 struct PkGraphicsRenderPassImguiData
 {
-    std::vector<VkCommandPool> commandPools;
+    VkCommandPool commandPool;
 
     VkDescriptorPool descriptorPool;
-    VkRenderPass renderPass;
 
-    std::vector<VkFramebuffer> frameBuffers;
-    std::vector<VkCommandBuffer> commandBuffers;
+    // Pointed to by the UI pipeline's rendering info, so it must live as long as the UI.
+    VkFormat colourFormat;
+
+    const PkGraphicsImguiDrawData* pDrawData = nullptr;
 };
 
 static PkGraphicsRenderPassImguiData* s_pData = nullptr;
@@ -35,32 +38,25 @@ static void check_vk_result(VkResult err)
 */
 }
 
-static void createCommandPools()
+// Only used to upload the fonts; the UI itself is recorded inside the scene's render pass.
+static void createCommandPool()
 {
-    s_pData->commandPools.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
-
     PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
 
-    for (size_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPool) != VK_SUCCESS)
     {
-        VkCommandPoolCreateInfo poolInfo{};
-        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-
-        if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPools[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create graphics command pool!");
-        }
+        throw std::runtime_error("failed to create graphics command pool!");
     }
 }
 
-static void destroyCommandPools()
+static void destroyCommandPool()
 {
-    for (VkCommandPool commandPool : s_pData->commandPools)
-    {
-        vkDestroyCommandPool(PkGraphicsCore::GetDevice(), commandPool, nullptr);
-    }
+    vkDestroyCommandPool(PkGraphicsCore::GetDevice(), s_pData->commandPool, nullptr);
 }
 
 static void createDescriptorPool()
@@ -98,161 +94,42 @@ static void destroyDescriptorPool()
     vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), s_pData->descriptorPool, nullptr);
 }
 
-static void createRenderPass()
+// Called inside the UI subpass of the scene's render pass, or with dynamic rendering, from a secondary executed at
+// the end of the scene's rendering scope.
+/*static*/ void PkGraphicsRenderPassImgui::RecordDrawData(VkCommandBuffer commandBuffer)
 {
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = PkGraphicsSwapChain::GetSwapChainImageFormat();
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;  // or VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(PkGraphicsCore::GetDevice(), &renderPassInfo, nullptr, &s_pData->renderPass) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Could not create Dear ImGui's render pass");
-    }
+    ImGui_ImplVulkan_RenderDrawData(const_cast<ImDrawData*>(&s_pData->pDrawData->drawData), commandBuffer);
 }
 
-static void destroyRenderPass()
+/*static*/ void PkGraphicsRenderPassImgui::SetDrawData(const PkGraphicsImguiDrawData& rDrawData)
 {
-    vkDestroyRenderPass(PkGraphicsCore::GetDevice(), s_pData->renderPass, nullptr);
-}
-
-static void createFrameBuffers()
-{
-    s_pData->frameBuffers.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
-
-    for (uint32_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
-    {
-        std::array<VkImageView, 1> attachments =
-        {
-            PkGraphicsSwapChain::GetSwapChainImageView(i),
-        };
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = s_pData->renderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = PkGraphicsSwapChain::GetSwapChainExtent().width;
-        framebufferInfo.height = PkGraphicsSwapChain::GetSwapChainExtent().height;
-        framebufferInfo.layers = 1;
-
-        if (vkCreateFramebuffer(PkGraphicsCore::GetDevice(), &framebufferInfo, nullptr, &s_pData->frameBuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create framebuffer!");
-        }
-    }
+    s_pData->pDrawData = &rDrawData;
 }
 
-static void destroyFrameBuffers()
+/*static*/ void PkGraphicsRenderPassImgui::CopyDrawData(PkGraphicsImguiDrawData& rDrawData)
 {
-    for (VkFramebuffer framebuffer : s_pData->frameBuffers)
-    {
-        vkDestroyFramebuffer(PkGraphicsCore::GetDevice(), framebuffer, nullptr);
-    }
-}
+    ClearDrawData(rDrawData);
 
-static void createCommandBuffers()
-{
-    s_pData->commandBuffers.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+    const ImDrawData* pDrawData = ImGui::GetDrawData();
 
-    for (size_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
+    for (int i = 0; i < pDrawData->CmdListsCount; i++)
     {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = s_pData->commandPools[i];
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = 1;
-
-        if (vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, &s_pData->commandBuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to allocate command buffers!");
-        }
+        rDrawData.pCmdLists.push_back(pDrawData->CmdLists[i]->CloneOutput());
     }
-}
 
-static void destroyCommandBuffers()
-{
-    for (size_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
-    {
-        vkFreeCommandBuffers(PkGraphicsCore::GetDevice(), s_pData->commandPools[i], 1, &s_pData->commandBuffers[i]);
-    }
+    rDrawData.drawData = *pDrawData;
+    rDrawData.drawData.CmdLists = rDrawData.pCmdLists.data();
 }
 
-/*static*/ VkCommandBuffer& PkGraphicsRenderPassImgui::GetCommandBuffer(const uint32_t imageIndex)
+/*static*/ void PkGraphicsRenderPassImgui::ClearDrawData(PkGraphicsImguiDrawData& rDrawData)
 {
-    ImDrawData* pDrawData = ImGui::GetDrawData();
-
-    if (vkResetCommandPool(PkGraphicsCore::GetDevice(), s_pData->commandPools[imageIndex], 0) != VK_SUCCESS)
+    for (ImDrawList* pCmdList : rDrawData.pCmdLists)
     {
-        throw std::runtime_error("vkResetCommandPool error");
+        IM_DELETE(pCmdList);
     }
 
-    VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-    commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    commandBufferBeginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    if (vkBeginCommandBuffer(s_pData->commandBuffers[imageIndex], &commandBufferBeginInfo) != VK_SUCCESS)
-    {
-        throw std::runtime_error("commandBufferBeginInfo error");
-    }
-
-    VkClearValue clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-    VkRenderPassBeginInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = s_pData->renderPass;
-    renderPassInfo.framebuffer = s_pData->frameBuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = PkGraphicsSwapChain::GetSwapChainExtent();
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearValue;
-
-    vkCmdBeginRenderPass(s_pData->commandBuffers[imageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    // Record dear imgui primitives into command buffer
-    ImGui_ImplVulkan_RenderDrawData(pDrawData, s_pData->commandBuffers[imageIndex]);
-
-    // Submit command buffer
-    vkCmdEndRenderPass(s_pData->commandBuffers[imageIndex]);
-
-    if (vkEndCommandBuffer(s_pData->commandBuffers[imageIndex]) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to record command buffer!");
-    }
-
-
-    return s_pData->commandBuffers[imageIndex];
+    rDrawData.pCmdLists.clear();
+    rDrawData.drawData.Clear();
 }
 
 /*static*/ void PkGraphicsRenderPassImgui::BeginImguiFrame()
@@ -267,21 +144,24 @@ static void destroyCommandBuffers()
     ImGui::Render();
 }
 
-/*static*/ void PkGraphicsRenderPassImgui::OnSwapChainCreate()
+/*static*/ void PkGraphicsRenderPassImgui::SetTarget(const PkGraphicsRenderPassImguiTarget& rTarget)
 {
-    createRenderPass();
-    createFrameBuffers();
-    createCommandBuffers();
-}
+    // Only the pipeline depends on the target; the fonts and descriptor sets are kept.
+    s_pData->colourFormat = rTarget.colourFormat;
 
-/*static*/ void PkGraphicsRenderPassImgui::OnSwapChainDestroy()
-{
-    destroyCommandBuffers();
-    destroyFrameBuffers();
-    destroyRenderPass();
+    ImGui_ImplVulkan_MainPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.RenderPass = rTarget.renderPass;
+    pipelineInfo.Subpass = rTarget.subpass;
+    pipelineInfo.MSAASamples = rTarget.samples;
+    pipelineInfo.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    pipelineInfo.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    pipelineInfo.PipelineRenderingCreateInfo.pColorAttachmentFormats = &s_pData->colourFormat;
+    pipelineInfo.PipelineRenderingCreateInfo.depthAttachmentFormat = rTarget.depthFormat;
+
+    ImGui_ImplVulkan_CreateMainPipeline(pipelineInfo);
 }
 
-/*static*/ void PkGraphicsRenderPassImgui::InitialiseGraphicsRenderPassImgui()
+/*static*/ void PkGraphicsRenderPassImgui::InitialiseGraphicsRenderPassImgui(const PkGraphicsRenderPassImguiTarget& rTarget)
 {
     s_pData = new PkGraphicsRenderPassImguiData();
 
@@ -298,11 +178,9 @@ static void destroyCommandBuffers()
 
     PkGraphicsQueueFamilyIndices indices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
 
-    createCommandPools();
+    createCommandPool();
     createDescriptorPool();
 
-    OnSwapChainCreate();
-
     // Setup Platform/Renderer backends
     ImGui_ImplGlfw_InitForVulkan(PkGraphicsCore::GetWindow(), true);
     ImGui_ImplVulkan_InitInfo init_info = {};
@@ -311,13 +189,27 @@ static void destroyCommandBuffers()
     init_info.Device = PkGraphicsCore::GetDevice();
     init_info.QueueFamily = indices.graphicsFamily.value();
     init_info.Queue = PkGraphicsCore::GetGraphicsQueue();
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.PipelineCache = PkGraphicsCore::GetPipelineCache();
     init_info.DescriptorPool = s_pData->descriptorPool;
     init_info.Allocator = nullptr;// PkGraphicsCore::GetAllocator()->GetAllocationCallbacks();
     init_info.MinImageCount = 2;
-    init_info.ImageCount = PkGraphicsSwapChain::GetNumSwapChainImages();
+    // The backend reuses its vertex and index buffers round-robin, one set per frame drawn. Image count and frames in
+    // flight can both change at runtime but the GPU never has more than PK_MAX_FRAMES_IN_FLIGHT frames, so sizing for
+    // that means a set is never rewritten while a frame still reads it.
+    init_info.ImageCount = std::max(PkGraphicsSwapChain::GetNumSwapChainImages(), PK_MAX_FRAMES_IN_FLIGHT);
+    init_info.Subpass = rTarget.subpass;
+    init_info.MSAASamples = rTarget.samples;
     init_info.CheckVkResultFn = check_vk_result;
-    ImGui_ImplVulkan_Init(&init_info, s_pData->renderPass);
+
+    s_pData->colourFormat = rTarget.colourFormat;
+
+    init_info.UseDynamicRendering = rTarget.renderPass == VK_NULL_HANDLE;
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &s_pData->colourFormat;
+    init_info.PipelineRenderingCreateInfo.depthAttachmentFormat = rTarget.depthFormat;
+
+    ImGui_ImplVulkan_Init(&init_info, rTarget.renderPass);
 
     // Load Fonts
     // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
@@ -336,9 +228,9 @@ static void destroyCommandBuffers()
 
     // Upload Fonts
     {
-        VkCommandBuffer commandBuffer = PkGraphicsUtils::BeginSingleTimeCommands(PkGraphicsCore::GetDevice(), s_pData->commandPools[0]);
+        VkCommandBuffer commandBuffer = PkGraphicsUtils::BeginSingleTimeCommands(PkGraphicsCore::GetDevice(), s_pData->commandPool);
         ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
-        PkGraphicsUtils::EndSingleTimeCommands(PkGraphicsCore::GetDevice(), PkGraphicsCore::GetGraphicsQueue(), s_pData->commandPools[0], commandBuffer);
+        PkGraphicsUtils::EndSingleTimeCommands(PkGraphicsCore::GetDevice(), PkGraphicsCore::GetGraphicsQueue(), s_pData->commandPool, commandBuffer);
 
         ImGui_ImplVulkan_DestroyFontUploadObjects();
     }
@@ -346,10 +238,8 @@ static void destroyCommandBuffers()
 
 /*static*/ void PkGraphicsRenderPassImgui::CleanupGraphicsRenderPassImgui()
 {
-    OnSwapChainDestroy();
-
     destroyDescriptorPool();
-    destroyCommandPools();
+    destroyCommandPool();
 
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
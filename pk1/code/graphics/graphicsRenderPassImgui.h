@@ -1,22 +1,51 @@
 #pragma once
 
+#include "imgui/imgui.h"
+
 #include <vulkan/vulkan_core.h>
 
+#include <vector>
 #include <stdint.h>
 
+// The render pass and subpass the UI pipeline is made for, or with dynamic rendering, the attachments of the rendering
+// scope it is drawn in.
+struct PkGraphicsRenderPassImguiTarget
+{
+	VkRenderPass renderPass;
+	uint32_t subpass;
+	VkFormat colourFormat;
+	VkFormat depthFormat;
+	VkSampleCountFlagBits samples;
+};
+
+// A frame's UI draw lists, copied out of ImGui so they can be drawn while it builds the next frame.
+struct PkGraphicsImguiDrawData
+{
+	ImDrawData drawData;
+	std::vector<ImDrawList*> pCmdLists;
+};
+
 class PkGraphicsRenderPassImgui
 {
 public:
 	PkGraphicsRenderPassImgui() = delete;
 
-	static VkCommandBuffer& GetCommandBuffer(const uint32_t imageIndex);
+	// Draws the copy last passed to SetDrawData.
+	static void RecordDrawData(VkCommandBuffer commandBuffer);
+	static void SetDrawData(const PkGraphicsImguiDrawData& rDrawData);
+
+	// Replaces the copy with the draw data of the frame just ended; call after EndImguiFrame.
+	static void CopyDrawData(PkGraphicsImguiDrawData& rDrawData);
+	static void ClearDrawData(PkGraphicsImguiDrawData& rDrawData);
 
 	static void BeginImguiFrame();
 	static void EndImguiFrame();
 
-	static void OnSwapChainCreate();
-	static void OnSwapChainDestroy();
+	// Rebuilds the UI pipeline for a new target, such as the scene's render pass after a change of swap chain format.
+	// Nothing drawn with the old pipeline may still be in flight.
+	static void SetTarget(const PkGraphicsRenderPassImguiTarget& rTarget);
 
-	static void InitialiseGraphicsRenderPassImgui();
+	// The UI is drawn inside another module's render pass or rendering scope; its pipeline is made for that target.
+	static void InitialiseGraphicsRenderPassImgui(const PkGraphicsRenderPassImguiTarget& rTarget);
 	static void CleanupGraphicsRenderPassImgui();
 };
@@ -1,37 +1,215 @@
 #include "graphicsRenderPassScene.h"
 
+#include "graphics/graphicsBoard.h"
 #include "graphics/graphicsCore.h"
+#include "graphics/graphicsCulling.h"
+#include "graphics/graphicsDepthPyramid.h"
+#include "graphics/graphicsDrawIndirect.h"
+#include "graphics/graphicsFrustum.h"
+#include "graphics/graphicsInstanceStream.h"
+#include "graphics/graphicsLayoutCache.h"
 #include "graphics/graphicsModel.h"
+#include "graphics/graphicsOcclusion.h"
+#include "graphics/graphicsPipelineLibrary.h"
+#include "graphics/graphicsRenderGraph.h"
+#include "graphics/graphicsRenderPassImgui.h"
+#include "graphics/graphicsReflection.h"
+#include "graphics/graphicsRenderQueue.h"
+#include "graphics/graphicsShaders.h"
 #include "graphics/graphicsSwapChain.h"
 #include "graphics/graphicsUtils.h"
 
+#include "imgui/imgui.h"
+#include "jobs/jobSystem.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
-#include <fstream>
+#include <limits>
+#include <map>
 
-struct PkGrapicsRenderPassSceneData 
+// Below this many draws per batch it is cheaper to record on fewer threads than to pay for another secondary command buffer.
+static const uint32_t MIN_DRAWS_PER_RECORDING_BATCH = 64;
+
+// Tiles along each side of every model's board. Raise it to stream hundreds of thousands of instances.
+static const uint32_t BOARD_DIMENSIONS = 1;
+
+// Width of the CPU occlusion buffer in pixels; the height follows the swap chain's aspect ratio.
+static const uint32_t OCCLUSION_BUFFER_WIDTH = 320;
+
+static const char* SCENE_VERT_SHADER_PATH = "data/shaders/shader.vert";
+static const char* BOARD_VERT_SHADER_PATH = "data/shaders/board.vert";
+static const char* SCENE_FRAG_SHADER_PATH = "data/shaders/shader.frag";
+
+// Occlusion culling splits the scene into an early pass, whose depth feeds the depth pyramid, and a late pass that continues it.
+enum PkGraphicsRenderPassSceneVariant
 {
-    VkCommandPool commandPool;
+    RENDER_PASS_SINGLE,
+    RENDER_PASS_EARLY,
+    RENDER_PASS_LATE
+};
+
+// Matches the specialization constants in data/shaders/shader.frag.
+enum PkGraphicsSceneFragConstant : uint32_t
+{
+    FRAG_CONSTANT_TEXTURE_COUNT = 0,
+    FRAG_CONSTANT_ALPHA_TEST,
+    FRAG_CONSTANT_COUNT
+};
+
+struct PkGraphicsRenderPassSceneThread
+{
+    VkCommandPool commandPool = VK_NULL_HANDLE;
     std::vector<VkCommandBuffer> commandBuffers;
+    uint32_t numCommandBuffersUsed = 0;
+};
+
+// Everything the scene records for one swap chain image; the render graph's primary command buffer executes it.
+struct PkGraphicsRenderPassSceneFrame
+{
+    // The instances of this frame's draws, rewritten every frame the CPU path records.
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    VmaAllocation instanceBufferAllocation = VK_NULL_HANDLE;
+    uint32_t instanceCapacity = 0;
+
+    std::vector<PkGraphicsRenderPassSceneThread> threads;
+    std::vector<VkCommandBuffer> secondaryCommandBuffers;
+    std::vector<VkCommandBuffer> lateSecondaryCommandBuffers;
+    std::vector<PkGraphicsRenderQueueStats> batchStats;
+
+    // With dynamic rendering the UI is recorded into a secondary too: a rendering scope that executes secondaries
+    // cannot also take inline draws.
+    VkCommandBuffer uiCommandBuffer = VK_NULL_HANDLE;
+};
 
-    VkDescriptorSetLayout descriptorSetLayout;
+struct CameraBufferObject
+{
+    alignas(16) glm::mat4 view;
+    alignas(16) glm::mat4 proj;
+};
 
-    VkRenderPass renderPass;
+// One instanced draw: every visible object with the same state as modelIndex, their instances packed together in the
+// frame's instance buffer.
+struct PkGraphicsRenderPassSceneDraw
+{
+    uint64_t sortKey;
+    uint32_t modelIndex;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+struct PkGrapicsRenderPassSceneData 
+{
+    VkCommandPool commandPool;
+    std::vector<PkGraphicsRenderPassSceneFrame> frames;
+
+    // Reflected when the scene is initialised; layouts and vertex input are derived from these. Hot reloads rebuild
+    // pipelines but not their interfaces, so a change to a shader's inputs or bindings needs a restart.
+    PkGraphicsReflectedShader sceneVertShader;
+    PkGraphicsReflectedShader boardVertShader;
+    PkGraphicsReflectedShader fragShader;
+
+    // Owned by the layout cache.
+    VkDescriptorSetLayout cameraDescriptorSetLayout;
+    VkDescriptorSetLayout materialDescriptorSetLayout;
+
+    std::vector<VkBuffer> cameraBuffers;
+    std::vector<VmaAllocation> cameraBufferAllocations;
+    std::vector<VkBuffer> objectBuffers;
+    std::vector<VmaAllocation> objectBufferAllocations;
+    VkDescriptorPool cameraDescriptorPool;
+    std::vector<VkDescriptorSet> cameraDescriptorSets;
+
+    // Render pass objects exist only without dynamic rendering, which needs just the attachment formats.
+    VkFormat colourFormat;
+    VkFormat depthFormat;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkRenderPass earlyRenderPass = VK_NULL_HANDLE;
+    VkRenderPass lateRenderPass = VK_NULL_HANDLE;
+    PFN_vkCmdBeginRenderingKHR pfnCmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR pfnCmdEndRendering = nullptr;
+    // Owned by the layout cache.
     VkPipelineLayout pipelineLayout;
-    VkPipeline pipeline;
+    VkPipelineLayout boardPipelineLayout;
+    PkGraphicsPipelineKey pipelineKey = 0;
+    // One board pipeline per rotation mode, picked each frame by what the board's tiles need.
+    PkGraphicsPipelineKey boardPipelineKeys[PK_BOARD_TILE_ROTATION_COUNT] = {};
+    // Looked up from the pipeline library as each frame is prepared; VK_NULL_HANDLE while still compiling.
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipeline boardPipeline = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> framebuffers;
 
-    VkImage colourImage;
-    VkImageView colourImageView;
-    VmaAllocation colourImageAllocation;
-
-    VkImage depthImage;
-    VkImageView depthImageView;
-    VmaAllocation depthImageAllocation;
+    // The early pass has no resolve attachment, so it isn't compatible with the other passes and has its own.
+    PkGraphicsPipelineKey earlyPipelineKey = 0;
+    PkGraphicsPipelineKey earlyBoardPipelineKeys[PK_BOARD_TILE_ROTATION_COUNT] = {};
+    VkPipeline earlyPipeline = VK_NULL_HANDLE;
+    VkPipeline earlyBoardPipeline = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> earlyFramebuffers;
+
+    // Owned by the render graph, which sizes them to the swap chain and orders every access to them.
+    PkGraphicsRenderGraphResource colourImage;
+    PkGraphicsRenderGraphResource depthImage;
+    PkGraphicsRenderGraphResource swapChainImage;
+
+    PkGraphicsRenderGraphPass uploadPass;
+    PkGraphicsRenderGraphPass commandGenerationPass;
+    PkGraphicsRenderGraphPass earlyPass;
+    PkGraphicsRenderGraphPass depthPyramidPass;
+    PkGraphicsRenderGraphPass latePass;
+    PkGraphicsRenderGraphPass scenePass;
 
     std::vector<PkGraphicsModel*> pModels;
+    std::vector<uint32_t> firstInstances;
+    uint32_t instanceCount;
+
+    // Spins a share of the instances every frame, to exercise instance streaming.
+    bool bAnimateInstances = false;
+    int animatedPercent = 100;
+    // The spin after the last simulation step and before it; frames are drawn in between.
+    float animationTime = 0.0f;
+    float previousAnimationTime = 0.0f;
+
+    // One entry per indirect draw batch, naming a model whose mesh and material the whole batch shares.
+    std::vector<uint32_t> drawBatchModels;
+    bool bDrawIndirect = false;
+
+    // Model space bounds of every instance of an object, and the world space copies the culler reads each frame.
+    std::vector<glm::vec4> objectLocalBounds;
+    std::vector<bool> objectLocalBoundsDirty;
+    PkGraphicsBoundingSpheres objectBounds;
+    std::vector<uint32_t> visibleObjects;
+    bool bCpuCulling = true;
+
+    // Models with an occluder, one per instance, drawn into a small CPU depth buffer that other objects are tested against.
+    std::vector<PkGraphicsOccluder> occluders;
+    PkGraphicsOcclusionBuffer occlusionBuffer;
+    bool bOcclusionCulling = true;
+
+    // Culling runs as a job from BeginCulling until the render queue is built. The job writes cullingStats;
+    // the debug UI reads the copy taken once the job has finished.
+    PkJobParallelForFunc cullingFunc;
+    PkJobCounter cullingCounter;
+    bool bCullingPending = false;
+    PkGraphicsRenderPassSceneCullingStats cullingStats;
+    PkGraphicsRenderPassSceneCullingStats shownCullingStats;
+
+    std::vector<PkGraphicsRenderQueueItem> renderQueue;
+    std::vector<PkGraphicsRenderQueueItem> renderQueueScratch;
+    PkGraphicsRenderQueueStats renderQueueStats;
+
+    // Visible objects that share a mesh and material are merged into one draw, unless automatic instancing is off.
+    std::vector<PkGraphicsRenderPassSceneDraw> draws;
+    bool bAutoInstancing = true;
+
+    // The debug UI asks for the benchmark and the render thread runs it as it prepares a frame, recording from its own
+    // pools; the commands are never submitted.
+    bool bBenchmarkRequested = false;
+    PkGraphicsRenderPassSceneFrame benchmarkFrame;
+    std::vector<PkGraphicsRenderPassSceneBenchmarkResult> benchmarkResults;
 };
 
 static PkGrapicsRenderPassSceneData* s_pData = nullptr;
@@ -62,182 +240,301 @@ static VkFormat findDepthFormat()
     (
         { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
     );
 }
 
-static VkShaderModule createShaderModule(const std::vector<char>& code)
+static void createCommandPool()
 {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(PkGraphicsCore::GetDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPool) != VK_SUCCESS)
     {
-        throw std::runtime_error("failed to create shader module!");
+        throw std::runtime_error("failed to create graphics command pool!");
     }
+}
 
-    return shaderModule;
+static PkGraphicsReflectedShader reflectShader(const char* pShaderPath)
+{
+    return PkGraphicsReflection::Reflect(PkGraphicsShaders::LoadSpirv(pShaderPath));
 }
 
-static std::vector<char> readFile(const std::string& filename)
+// Every scene pipeline binds the same camera and material sets, so their layouts take the bindings of all the scene's
+// shaders together.
+static void createDescriptorSetLayouts()
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    s_pData->sceneVertShader = reflectShader(SCENE_VERT_SHADER_PATH);
+    s_pData->boardVertShader = reflectShader(BOARD_VERT_SHADER_PATH);
+    s_pData->fragShader = reflectShader(SCENE_FRAG_SHADER_PATH);
+
+    const std::vector<PkGraphicsReflectedShader> shaders = { s_pData->sceneVertShader, s_pData->boardVertShader, s_pData->fragShader };
 
-    if (!file.is_open())
+    if (PkGraphicsReflection::GetSetCount(shaders) != 2)
     {
-        throw std::runtime_error("failed to open file!");
+        throw std::runtime_error("scene shaders use unexpected descriptor sets!");
     }
 
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-
-    file.close();
-
-    return buffer;
+    s_pData->cameraDescriptorSetLayout = PkGraphicsLayoutCache::GetDescriptorSetLayout(PkGraphicsReflection::GetSetLayoutBindings(shaders, PK_DESCRIPTOR_SET_CAMERA));
+    s_pData->materialDescriptorSetLayout = PkGraphicsLayoutCache::GetDescriptorSetLayout(PkGraphicsReflection::GetSetLayoutBindings(shaders, PK_DESCRIPTOR_SET_MATERIAL));
 }
 
-static void createCommandPool()
+static void createCameraResources()
 {
-    PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
+    const uint32_t imageCount = PkGraphicsSwapChain::GetNumSwapChainImages();
 
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    s_pData->cameraBuffers.resize(imageCount);
+    s_pData->cameraBufferAllocations.resize(imageCount);
+    s_pData->objectBuffers.resize(imageCount);
+    s_pData->objectBufferAllocations.resize(imageCount);
 
-    if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->commandPool) != VK_SUCCESS)
+    const VkDeviceSize objectBufferSize = sizeof(glm::mat4) * std::max<size_t>(s_pData->pModels.size(), 1);
+
+    for (uint32_t i = 0; i < imageCount; i++)
     {
-        throw std::runtime_error("failed to create graphics command pool!");
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = sizeof(CameraBufferObject);
+        bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        if (vmaCreateBuffer(PkGraphicsCore::GetAllocator(), &bufferInfo, &allocInfo, &s_pData->cameraBuffers[i], &s_pData->cameraBufferAllocations[i], nullptr) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create buffer!");
+        }
+
+        // Model matrices are rewritten every frame, so they stay in host visible memory like the camera.
+        PkGraphicsUtils::CreateBuffer
+        (
+            PkGraphicsCore::GetAllocator(),
+            objectBufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &s_pData->objectBuffers[i],
+            &s_pData->objectBufferAllocations[i]
+        );
     }
-}
 
-static void createDescriptorSetLayout()
-{
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = imageCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = imageCount;
 
-    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = imageCount;
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
+    if (vkCreateDescriptorPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &s_pData->cameraDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(imageCount, s_pData->cameraDescriptorSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = s_pData->cameraDescriptorPool;
+    allocInfo.descriptorSetCount = imageCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    s_pData->cameraDescriptorSets.resize(imageCount);
+    if (vkAllocateDescriptorSets(PkGraphicsCore::GetDevice(), &allocInfo, s_pData->cameraDescriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
 
-    if (vkCreateDescriptorSetLayout(PkGraphicsCore::GetDevice(), &layoutInfo, nullptr, &s_pData->descriptorSetLayout) != VK_SUCCESS)
+    for (uint32_t i = 0; i < imageCount; i++)
     {
-        throw std::runtime_error("failed to create descriptor set layout!");
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = s_pData->cameraBuffers[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(CameraBufferObject);
+
+        VkDescriptorBufferInfo objectBufferInfo{};
+        objectBufferInfo.buffer = s_pData->objectBuffers[i];
+        objectBufferInfo.offset = 0;
+        objectBufferInfo.range = objectBufferSize;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = s_pData->cameraDescriptorSets[i];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[1].dstSet = s_pData->cameraDescriptorSets[i];
+        descriptorWrites[1].dstBinding = 1;
+        descriptorWrites[1].dstArrayElement = 0;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[1].descriptorCount = 1;
+        descriptorWrites[1].pBufferInfo = &objectBufferInfo;
+
+        vkUpdateDescriptorSets(PkGraphicsCore::GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     }
 }
 
-static void createColourResources()
+static void destroyCameraResources()
 {
-    VkFormat colourFormat = PkGraphicsSwapChain::GetSwapChainImageFormat();
+    vkDestroyDescriptorPool(PkGraphicsCore::GetDevice(), s_pData->cameraDescriptorPool, nullptr);
+
+    for (size_t i = 0; i < s_pData->cameraBuffers.size(); i++)
+    {
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->objectBuffers[i], s_pData->objectBufferAllocations[i]);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), s_pData->cameraBuffers[i], s_pData->cameraBufferAllocations[i]);
+    }
+}
 
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = PkGraphicsSwapChain::GetSwapChainExtent().width;
-    imageInfo.extent.height = PkGraphicsSwapChain::GetSwapChainExtent().height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = PkGraphicsSwapChain::GetSwapChainImageFormat();
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    imageInfo.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+static void createInstances()
+{
+    std::vector<InstanceData> instances;
 
-    VmaAllocationCreateInfo allocInfo = {};
-    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    s_pData->firstInstances.resize(s_pData->pModels.size());
 
-    if (vmaCreateImage(PkGraphicsCore::GetAllocator(), &imageInfo, &allocInfo, &s_pData->colourImage, &s_pData->colourImageAllocation, nullptr) != VK_SUCCESS)
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
     {
-        throw std::runtime_error("failed to create buffer!");
+        s_pData->firstInstances[i] = static_cast<uint32_t>(instances.size());
+
+        for (InstanceData instance : s_pData->pModels[i]->GetInstances())
+        {
+            instance.objectIndex = i;
+            instances.push_back(instance);
+        }
     }
 
-    s_pData->colourImageView = PkGraphicsUtils::CreateImageView(PkGraphicsCore::GetDevice(), s_pData->colourImage, colourFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    s_pData->instanceCount = static_cast<uint32_t>(instances.size());
+
+    // The indirect path reads the streamed buffer directly. The CPU path copies from the stream's CPU side into each
+    // frame's own buffer instead.
+    PkGraphicsInstanceStream::SetInstances(instances);
+}
+
+static void setInstanceTransform(const uint32_t objectIndex, const uint32_t instanceIndex, const glm::mat4& rTransform)
+{
+    PkGraphicsInstanceStream::SetInstanceTransform(s_pData->firstInstances[objectIndex] + instanceIndex, rTransform);
+    s_pData->objectLocalBoundsDirty[objectIndex] = true;
 }
 
-static void destroyColourResources()
+static void animateInstances(const float animationTime)
 {
-    vkDestroyImageView(PkGraphicsCore::GetDevice(), s_pData->colourImageView, nullptr);
-    vmaDestroyImage(PkGraphicsCore::GetAllocator(), s_pData->colourImage, s_pData->colourImageAllocation);
+    const glm::mat4 spin = glm::rotate(glm::mat4(1.0f), animationTime, glm::vec3(0.0f, 0.0f, 1.0f));
+    const uint32_t animatedPercent = static_cast<uint32_t>(s_pData->animatedPercent);
+
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
+    {
+        const std::vector<InstanceData>& rInstances = s_pData->pModels[i]->GetInstances();
+
+        for (uint32_t j = 0; j < rInstances.size(); j++)
+        {
+            if ((s_pData->firstInstances[i] + j) % 100 < animatedPercent)
+            {
+                setInstanceTransform(i, j, rInstances[j].transform * spin);
+            }
+        }
+    }
 }
 
-static void createDepthResources()
+static void createDrawRecords()
 {
-    VkFormat depthFormat = findDepthFormat();
+    // Objects sharing a mesh and material become one batch, drawn by a single indirect call.
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> batchIndices;
+    std::vector<PkGraphicsDrawBatch> batches;
+    std::vector<PkGraphicsDrawRecord> records(s_pData->pModels.size());
 
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = PkGraphicsSwapChain::GetSwapChainExtent().width;
-    imageInfo.extent.height = PkGraphicsSwapChain::GetSwapChainExtent().height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = findDepthFormat();
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    s_pData->drawBatchModels.clear();
 
-    VmaAllocationCreateInfo allocInfo = {};
-    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
+    {
+        const PkGraphicsModel* pModel = s_pData->pModels[i];
+
+        auto result = batchIndices.emplace(std::make_pair(pModel->GetMaterialId(), pModel->GetMeshId()), static_cast<uint32_t>(batches.size()));
+        if (result.second)
+        {
+            batches.push_back(PkGraphicsDrawBatch{ 0, 0 });
+            s_pData->drawBatchModels.push_back(i);
+        }
+
+        const uint32_t batchIndex = result.first->second;
+        batches[batchIndex].maxCommandCount++;
+
+        records[i].indexCount = pModel->GetIndexCount();
+        records[i].firstIndex = 0;
+        records[i].vertexOffset = 0;
+        records[i].instanceCount = static_cast<uint32_t>(pModel->GetInstances().size());
+        records[i].firstInstance = s_pData->firstInstances[i];
+        records[i].batchIndex = batchIndex;
+        records[i].padding = 0;
+        records[i].boundingSphere = pModel->GetBoundingSphere();
+    }
+
+    uint32_t firstCommand = 0;
+    for (PkGraphicsDrawBatch& rBatch : batches)
+    {
+        rBatch.firstCommand = firstCommand;
+        firstCommand += rBatch.maxCommandCount;
+    }
 
-    if (vmaCreateImage(PkGraphicsCore::GetAllocator(), &imageInfo, &allocInfo, &s_pData->depthImage, &s_pData->depthImageAllocation, nullptr) != VK_SUCCESS)
+    for (PkGraphicsDrawRecord& rRecord : records)
     {
-        throw std::runtime_error("failed to create buffer!");
+        rRecord.firstCommand = batches[rRecord.batchIndex].firstCommand;
     }
 
-    s_pData->depthImageView = PkGraphicsUtils::CreateImageView(PkGraphicsCore::GetDevice(), s_pData->depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+    PkGraphicsDrawIndirect::SetDrawRecords(records, batches, PkGraphicsInstanceStream::GetBuffer(), s_pData->instanceCount);
 }
 
-static void destroyDepthResources()
+static glm::mat4 getProjectionMatrix()
 {
-    vkDestroyImageView(PkGraphicsCore::GetDevice(), s_pData->depthImageView, nullptr);
-    vmaDestroyImage(PkGraphicsCore::GetAllocator(), s_pData->depthImage, s_pData->depthImageAllocation);
+    float fieldOfView = PkGraphicsCore::GetFieldOfView();
+    float aspectRatio = PkGraphicsSwapChain::GetSwapChainExtent().width / (float)PkGraphicsSwapChain::GetSwapChainExtent().height;
+    float nearViewPlane = PkGraphicsCore::GetNearViewPlane();
+    float farViewPlane = PkGraphicsCore::GetFarViewPlane();
+
+    glm::mat4 proj = glm::perspective(glm::radians(fieldOfView), aspectRatio, nearViewPlane, farViewPlane);
+    proj[1][1] *= -1;
+
+    return proj;
 }
 
-static void createRenderPass()
+// Attachments start and end in the layouts the render graph leaves them in, and the graph's barriers order the passes.
+// The UI is drawn in a second subpass straight onto the resolved image, so the swap chain image is written out once.
+// The early pass only leaves its colour and depth for the late pass to continue, so it has neither the resolve nor the
+// UI subpass; the single and late passes are compatible with each other and share framebuffers, pipelines and
+// secondaries, while the early pass has its own.
+static VkRenderPass createRenderPass(const PkGraphicsRenderPassSceneVariant variant)
 {
+    const bool bEarly = variant == RENDER_PASS_EARLY;
+    const bool bLate = variant == RENDER_PASS_LATE;
+
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = PkGraphicsSwapChain::GetSwapChainImageFormat();
     colorAttachment.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.loadOp = bLate ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = bEarly ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.loadOp = bLate ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = bEarly ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentDescription colorAttachmentResolve{};
@@ -247,7 +544,7 @@ static void createRenderPass()
     colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
@@ -262,183 +559,159 @@ static void createRenderPass()
     colorAttachmentResolveRef.attachment = 2;
     colorAttachmentResolveRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-    subpass.pResolveAttachments = &colorAttachmentResolveRef;
+    std::array<VkSubpassDescription, 2> subpasses{};
+    subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[0].colorAttachmentCount = 1;
+    subpasses[0].pColorAttachments = &colorAttachmentRef;
+    subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
+    subpasses[0].pResolveAttachments = bEarly ? nullptr : &colorAttachmentResolveRef;
 
+    subpasses[PK_SCENE_SUBPASS_UI].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[PK_SCENE_SUBPASS_UI].colorAttachmentCount = 1;
+    subpasses[PK_SCENE_SUBPASS_UI].pColorAttachments = &colorAttachmentResolveRef;
+
+    // The resolve happens at the end of the scene subpass as a colour attachment write; the UI blends over it pixel by pixel.
     VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.srcSubpass = 0;
+    dependency.dstSubpass = PK_SCENE_SUBPASS_UI;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
     std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.attachmentCount = bEarly ? 2 : static_cast<uint32_t>(attachments.size());
     renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.subpassCount = bEarly ? 1 : static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = bEarly ? 0 : 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(PkGraphicsCore::GetDevice(), &renderPassInfo, nullptr, &s_pData->renderPass) != VK_SUCCESS)
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(PkGraphicsCore::GetDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create render pass!");
     }
+
+    return renderPass;
+}
+
+static void createRenderPasses()
+{
+    s_pData->colourFormat = PkGraphicsSwapChain::GetSwapChainImageFormat();
+    s_pData->depthFormat = findDepthFormat();
+
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        return;
+    }
+
+    s_pData->renderPass = createRenderPass(RENDER_PASS_SINGLE);
+    s_pData->earlyRenderPass = createRenderPass(RENDER_PASS_EARLY);
+    s_pData->lateRenderPass = createRenderPass(RENDER_PASS_LATE);
+}
+
+static void destroyRenderPasses()
+{
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        return;
+    }
+
+    vkDestroyRenderPass(PkGraphicsCore::GetDevice(), s_pData->lateRenderPass, nullptr);
+    vkDestroyRenderPass(PkGraphicsCore::GetDevice(), s_pData->earlyRenderPass, nullptr);
+    vkDestroyRenderPass(PkGraphicsCore::GetDevice(), s_pData->renderPass, nullptr);
 }
 
-static void createPipeline()
+// Push constants come from the pipeline's own shaders; the sets are the scene's.
+static VkPipelineLayout getPipelineLayout(const PkGraphicsReflectedShader& rVertShader)
 {
-    auto vertShaderCode = readFile("data/shaders/vert.spv");
-    auto fragShaderCode = readFile("data/shaders/frag.spv");
+    std::vector<VkDescriptorSetLayout> setLayouts(2);
+    setLayouts[PK_DESCRIPTOR_SET_CAMERA] = s_pData->cameraDescriptorSetLayout;
+    setLayouts[PK_DESCRIPTOR_SET_MATERIAL] = s_pData->materialDescriptorSetLayout;
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    return PkGraphicsLayoutCache::GetPipelineLayout(setLayouts, PkGraphicsReflection::GetPushConstantRanges({ rVertShader, s_pData->fragShader }));
+}
 
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
+// Every scene pipeline shares shader.frag and its fixed function state; they differ in vertex shader and input.
+static PkGraphicsPipelineDesc getPipelineDesc(const char* pVertShaderPath, const PkGraphicsReflectedShader& rVertShader, const std::vector<PkGraphicsVertexStream>& rStreams, VkPipelineLayout pipelineLayout, VkRenderPass renderPass)
+{
+    PkGraphicsPipelineDesc desc;
+    desc.vertShaderPath = pVertShaderPath;
+    desc.fragShaderPath = SCENE_FRAG_SHADER_PATH;
+    desc.vertexInputHash = PkGraphicsReflection::GetVertexInput(rVertShader, rStreams, desc.vertexBindings, desc.vertexAttributes);
+    desc.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
+    desc.colourFormat = s_pData->colourFormat;
+    desc.depthFormat = s_pData->depthFormat;
+    desc.renderPass = renderPass;
+    desc.subpass = 0;
+    desc.layout = pipelineLayout;
+
+    desc.fragConstants.resize(FRAG_CONSTANT_COUNT);
+    desc.fragConstants[FRAG_CONSTANT_TEXTURE_COUNT] = 1;
+    desc.fragConstants[FRAG_CONSTANT_ALPHA_TEST] = VK_FALSE;
+    return desc;
+}
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
+static void addPipelineDescs(VkRenderPass renderPass, PkGraphicsPipelineKey& rPipelineKey, PkGraphicsPipelineKey* pBoardPipelineKeys, std::vector<PkGraphicsPipelineDesc>& rDescs)
+{
+    const PkGraphicsPipelineDesc sceneDesc = getPipelineDesc(SCENE_VERT_SHADER_PATH, s_pData->sceneVertShader, getVertexStreams(), s_pData->pipelineLayout, renderPass);
+    rDescs.push_back(sceneDesc);
+    rPipelineKey = PkGraphicsPipelineLibrary::GetKey(sceneDesc);
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    for (uint32_t rotation = 0; rotation < PK_BOARD_TILE_ROTATION_COUNT; rotation++)
+    {
+        PkGraphicsPipelineDesc boardDesc = getPipelineDesc(BOARD_VERT_SHADER_PATH, s_pData->boardVertShader, PkGraphicsBoard::GetVertexStreams(), s_pData->boardPipelineLayout, renderPass);
+        boardDesc.vertConstants = { rotation };
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        rDescs.push_back(boardDesc);
+        pBoardPipelineKeys[rotation] = PkGraphicsPipelineLibrary::GetKey(boardDesc);
+    }
+}
 
-    auto bindingDescriptions = getBindingDescriptions();
-    auto attributeDescriptions = getAttributeDescriptions();
+// Pipelines are compiled in the background; frames leave out whatever can't be drawn until they are ready. With dynamic
+// rendering there are no render pass objects, so the early pass's keys match the others and nothing is built twice.
+static void createPipelines()
+{
+    s_pData->pipelineLayout = getPipelineLayout(s_pData->sceneVertShader);
+    s_pData->boardPipelineLayout = getPipelineLayout(s_pData->boardVertShader);
 
-    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    std::vector<PkGraphicsPipelineDesc> descs;
+    addPipelineDescs(s_pData->renderPass, s_pData->pipelineKey, s_pData->boardPipelineKeys, descs);
+    addPipelineDescs(s_pData->earlyRenderPass, s_pData->earlyPipelineKey, s_pData->earlyBoardPipelineKeys, descs);
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    PkGraphicsPipelineLibrary::Warm(descs);
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)PkGraphicsSwapChain::GetSwapChainExtent().width;
-    viewport.height = (float)PkGraphicsSwapChain::GetSwapChainExtent().height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
+    s_pData->pipeline = VK_NULL_HANDLE;
+    s_pData->boardPipeline = VK_NULL_HANDLE;
+    s_pData->earlyPipeline = VK_NULL_HANDLE;
+    s_pData->earlyBoardPipeline = VK_NULL_HANDLE;
+}
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = PkGraphicsSwapChain::GetSwapChainExtent();
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = PkGraphicsCore::GetMaxMsaaSampleCount();
-
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &s_pData->descriptorSetLayout;
-
-    if (vkCreatePipelineLayout(PkGraphicsCore::GetDevice(), &pipelineLayoutInfo, nullptr, &s_pData->pipelineLayout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = s_pData->pipelineLayout;
-    pipelineInfo.renderPass = s_pData->renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-    if (vkCreateGraphicsPipelines(PkGraphicsCore::GetDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &s_pData->pipeline) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
-
-    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(PkGraphicsCore::GetDevice(), vertShaderModule, nullptr);
-}
-
-static void destroyPipeline()
-{
-    vkDestroyPipeline(PkGraphicsCore::GetDevice(), s_pData->pipeline, nullptr);
-    vkDestroyPipelineLayout(PkGraphicsCore::GetDevice(), s_pData->pipelineLayout, nullptr);
+static void destroyPipelines()
+{
+    PkGraphicsPipelineLibrary::Clear();
 }
 
 static void createFramebuffers()
 {
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        return;
+    }
+
     s_pData->framebuffers.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
+    s_pData->earlyFramebuffers.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
 
     for (uint32_t i = 0; i < PkGraphicsSwapChain::GetNumSwapChainImages(); i++)
     {
         std::array<VkImageView, 3> attachments =
         {
-            s_pData->colourImageView,
-            s_pData->depthImageView,
+            PkGraphicsRenderGraph::GetImageView(s_pData->colourImage),
+            PkGraphicsRenderGraph::GetImageView(s_pData->depthImage),
             PkGraphicsSwapChain::GetSwapChainImageView(i)
         };
 
@@ -455,147 +728,1353 @@ static void createFramebuffers()
         {
             throw std::runtime_error("failed to create framebuffer!");
         }
+
+        // The early pass leaves out the swap chain image.
+        framebufferInfo.renderPass = s_pData->earlyRenderPass;
+        framebufferInfo.attachmentCount = 2;
+
+        if (vkCreateFramebuffer(PkGraphicsCore::GetDevice(), &framebufferInfo, nullptr, &s_pData->earlyFramebuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create framebuffer!");
+        }
     }
 }
 
-static void createCommandBuffers()
+static VkCommandPool createFrameCommandPool()
 {
-    s_pData->commandBuffers.resize(s_pData->framebuffers.size());
+    PkGraphicsQueueFamilyIndices queueFamilyIndices = PkGraphicsUtils::FindQueueFamilies(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    VkCommandPool commandPool;
+    if (vkCreateCommandPool(PkGraphicsCore::GetDevice(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create graphics command pool!");
+    }
 
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = s_pData->commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t)s_pData->commandBuffers.size();
+    return commandPool;
+}
 
-    if (vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, s_pData->commandBuffers.data()) != VK_SUCCESS)
+static void reserveFrameInstances(PkGraphicsRenderPassSceneFrame& rFrame, const uint32_t instanceCount)
+{
+    if (rFrame.instanceBuffer != VK_NULL_HANDLE && instanceCount <= rFrame.instanceCapacity)
     {
-        throw std::runtime_error("failed to allocate command buffers!");
+        return;
     }
 
-    for (size_t i = 0; i < s_pData->commandBuffers.size(); i++)
+    // Only called once the frame's fence has been waited on, so the old buffer is no longer read by the GPU.
+    if (rFrame.instanceBuffer != VK_NULL_HANDLE)
     {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.instanceBuffer, rFrame.instanceBufferAllocation);
+    }
 
-        if (vkBeginCommandBuffer(s_pData->commandBuffers[i], &beginInfo) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to begin recording command buffer!");
-        }
+    rFrame.instanceCapacity = std::max(std::max(instanceCount, rFrame.instanceCapacity * 2), 1u);
+
+    PkGraphicsUtils::CreateBuffer
+    (
+        PkGraphicsCore::GetAllocator(),
+        sizeof(InstanceData) * rFrame.instanceCapacity,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &rFrame.instanceBuffer,
+        &rFrame.instanceBufferAllocation
+    );
+}
+
+static void createFrameThreads(PkGraphicsRenderPassSceneFrame& rFrame)
+{
+    // Each worker records into command buffers from its own pool, so no pool is ever touched by two threads at once.
+    rFrame.threads.resize(PkJobSystem::GetNumWorkerIndices());
+
+    for (PkGraphicsRenderPassSceneThread& rThread : rFrame.threads)
+    {
+        rThread.commandPool = createFrameCommandPool();
+    }
+}
+
+static void destroyFrameThreads(PkGraphicsRenderPassSceneFrame& rFrame)
+{
+    for (PkGraphicsRenderPassSceneThread& rThread : rFrame.threads)
+    {
+        vkDestroyCommandPool(PkGraphicsCore::GetDevice(), rThread.commandPool, nullptr);
+    }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = s_pData->renderPass;
-        renderPassInfo.framebuffer = s_pData->framebuffers[i];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = PkGraphicsSwapChain::GetSwapChainExtent();
+    rFrame.threads.clear();
+}
 
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        clearValues[1].depthStencil = { 1.0f, 0 };
+static void createFrames()
+{
+    s_pData->frames.resize(PkGraphicsSwapChain::GetNumSwapChainImages());
 
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+    for (PkGraphicsRenderPassSceneFrame& rFrame : s_pData->frames)
+    {
+        // Every instance in the scene visible at once is the most a frame can draw.
+        reserveFrameInstances(rFrame, s_pData->instanceCount);
+        createFrameThreads(rFrame);
+    }
+}
 
-        vkCmdBeginRenderPass(s_pData->commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+static void destroyFrames()
+{
+    for (PkGraphicsRenderPassSceneFrame& rFrame : s_pData->frames)
+    {
+        destroyFrameThreads(rFrame);
+        vmaDestroyBuffer(PkGraphicsCore::GetAllocator(), rFrame.instanceBuffer, rFrame.instanceBufferAllocation);
+    }
 
-        vkCmdBindPipeline(s_pData->commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, s_pData->pipeline);
+    s_pData->frames.clear();
+}
 
-        for (PkGraphicsModel* pModel : s_pData->pModels)
+static void resetFrame(PkGraphicsRenderPassSceneFrame& rFrame)
+{
+    for (PkGraphicsRenderPassSceneThread& rThread : rFrame.threads)
+    {
+        if (vkResetCommandPool(PkGraphicsCore::GetDevice(), rThread.commandPool, 0) != VK_SUCCESS)
         {
-            pModel->DrawModel(s_pData->commandBuffers[i], s_pData->pipelineLayout, static_cast<uint32_t>(i));
+            throw std::runtime_error("vkResetCommandPool error");
         }
 
-        vkCmdEndRenderPass(s_pData->commandBuffers[i]);
+        rThread.numCommandBuffersUsed = 0;
+    }
+}
 
-        if (vkEndCommandBuffer(s_pData->commandBuffers[i]) != VK_SUCCESS)
+static VkCommandBuffer getSecondaryCommandBuffer(PkGraphicsRenderPassSceneThread& rThread)
+{
+    if (rThread.numCommandBuffersUsed == rThread.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = rThread.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(PkGraphicsCore::GetDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
         {
-            throw std::runtime_error("failed to record command buffer!");
+            throw std::runtime_error("failed to allocate command buffers!");
         }
+
+        rThread.commandBuffers.push_back(commandBuffer);
     }
+
+    return rThread.commandBuffers[rThread.numCommandBuffersUsed++];
 }
 
-static void destroyFramebuffers()
+// Largest scale along any axis, for bounding spheres under non-uniform scale.
+static float getMaxScale(const glm::mat4& rMatrix)
 {
-    for (VkFramebuffer framebuffer : s_pData->framebuffers)
+    return std::max(glm::length(glm::vec3(rMatrix[0])), std::max(glm::length(glm::vec3(rMatrix[1])), glm::length(glm::vec3(rMatrix[2]))));
+}
+
+static glm::vec4 computeObjectLocalBounds(const uint32_t objectIndex)
+{
+    const glm::vec4& rMeshSphere = s_pData->pModels[objectIndex]->GetBoundingSphere();
+    const uint32_t instanceCount = static_cast<uint32_t>(s_pData->pModels[objectIndex]->GetInstances().size());
+    const InstanceData* pInstances = PkGraphicsInstanceStream::GetInstances().data() + s_pData->firstInstances[objectIndex];
+
+    if (instanceCount == 0)
     {
-        vkDestroyFramebuffer(PkGraphicsCore::GetDevice(), framebuffer, nullptr);
+        return glm::vec4(0.0f);
+    }
+
+    // Place the mesh sphere the same way shader.vert places vertices, then enclose every placed sphere.
+    std::vector<glm::vec3> centres(instanceCount);
+    std::vector<float> radii(instanceCount);
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(-std::numeric_limits<float>::max());
+
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        centres[i] = glm::vec3(pInstances[i].transform * glm::vec4(glm::vec3(rMeshSphere), 1.0f));
+        radii[i] = rMeshSphere.w * getMaxScale(pInstances[i].transform);
+
+        minPos = glm::min(minPos, centres[i] - glm::vec3(radii[i]));
+        maxPos = glm::max(maxPos, centres[i] + glm::vec3(radii[i]));
     }
+
+    const glm::vec3 centre = (minPos + maxPos) * 0.5f;
+
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        radius = std::max(radius, glm::length(centres[i] - centre) + radii[i]);
+    }
+
+    return glm::vec4(centre, radius);
 }
 
-/*static*/ VkCommandBuffer& PkGraphicsRenderPassScene::GetCommandBuffer(uint32_t imageIndex)
+static void createObjectBounds()
 {
-    return s_pData->commandBuffers[imageIndex];
+    s_pData->objectLocalBounds.resize(s_pData->pModels.size());
+    s_pData->objectLocalBoundsDirty.assign(s_pData->pModels.size(), false);
+
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
+    {
+        s_pData->objectLocalBounds[i] = computeObjectLocalBounds(i);
+    }
+
+    s_pData->objectBounds.Resize(static_cast<uint32_t>(s_pData->pModels.size()));
 }
 
-/*static*/ void PkGraphicsRenderPassScene::UpdateResourceDescriptors(const uint32_t imageIndex)
+// Refits the bounds of objects whose instances have moved since the last frame.
+static void updateObjectBounds()
 {
-    for (PkGraphicsModel* pModel : s_pData->pModels)
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
     {
-        pModel->UpdateUniformBuffer(imageIndex);
+        if (s_pData->objectLocalBoundsDirty[i])
+        {
+            s_pData->objectLocalBounds[i] = computeObjectLocalBounds(i);
+            s_pData->objectLocalBoundsDirty[i] = false;
+        }
     }
 }
 
-/*static*/ void PkGraphicsRenderPassScene::OnSwapChainCreate()
+static void updateOccluders()
 {
-    for (PkGraphicsModel* pModel : s_pData->pModels)
+    s_pData->occluders.clear();
+
+    for (uint32_t i = 0; i < s_pData->pModels.size(); i++)
     {
-        pModel->OnSwapChainCreate(s_pData->descriptorSetLayout);
+        const PkGraphicsModel* pModel = s_pData->pModels[i];
+
+        if (!pModel->HasOccluder())
+        {
+            continue;
+        }
+
+        const uint32_t instanceCount = static_cast<uint32_t>(pModel->GetInstances().size());
+        const InstanceData* pInstances = PkGraphicsInstanceStream::GetInstances().data() + s_pData->firstInstances[i];
+
+        for (uint32_t j = 0; j < instanceCount; j++)
+        {
+            PkGraphicsOccluder occluder;
+            occluder.pVertices = &pModel->GetOccluderVertices();
+            occluder.pIndices = &pModel->GetOccluderIndices();
+            occluder.matrix = pModel->GetMatrix() * pInstances[j].transform;
+
+            s_pData->occluders.push_back(occluder);
+        }
     }
+}
 
-    createColourResources();
-    createDepthResources();
-    createRenderPass();
-    createPipeline();
-    createFramebuffers();
-    createCommandBuffers();
+static void occludeObjects(const glm::mat4& rViewProjection)
+{
+    PkGraphicsRenderPassSceneCullingStats& rStats = s_pData->cullingStats;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    updateOccluders();
+    rStats.occluderTriangles = PkGraphicsSoftwareOcclusion::RenderOccluders(s_pData->occlusionBuffer, s_pData->occluders, rViewProjection);
+
+    uint32_t visibleCount = 0;
+    for (const uint32_t objectIndex : s_pData->visibleObjects)
+    {
+        const PkGraphicsBoundingSpheres& rBounds = s_pData->objectBounds;
+        const glm::vec3 centre(rBounds.centreX[objectIndex], rBounds.centreY[objectIndex], rBounds.centreZ[objectIndex]);
+        const glm::vec3 extent(rBounds.radius[objectIndex]);
+
+        if (PkGraphicsSoftwareOcclusion::IsBoxVisible(s_pData->occlusionBuffer, centre - extent, centre + extent))
+        {
+            s_pData->visibleObjects[visibleCount++] = objectIndex;
+        }
+    }
+
+    rStats.occludedObjects = static_cast<uint32_t>(s_pData->visibleObjects.size()) - visibleCount;
+    s_pData->visibleObjects.resize(visibleCount);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    rStats.occlusionMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
 }
 
-/*static*/ void PkGraphicsRenderPassScene::OnSwapChainDestroy()
+// Takes its settings as arguments because it runs as a job while the debug UI may change them.
+static void cullObjects(const glm::mat4& rViewProjection, const bool bFrustumCulling, const bool bOcclusionCulling)
 {
-    vkFreeCommandBuffers(PkGraphicsCore::GetDevice(), s_pData->commandPool, static_cast<uint32_t>(s_pData->commandBuffers.size()), s_pData->commandBuffers.data());
-    destroyFramebuffers();
-    destroyPipeline();
-    vkDestroyRenderPass(PkGraphicsCore::GetDevice(), s_pData->renderPass, nullptr);
-    destroyDepthResources();
-    destroyColourResources();
+    const uint32_t objectCount = static_cast<uint32_t>(s_pData->pModels.size());
+
+    s_pData->cullingStats = PkGraphicsRenderPassSceneCullingStats();
+
+    for (uint32_t i = 0; i < objectCount; i++)
+    {
+        const glm::mat4& rMatrix = s_pData->pModels[i]->GetMatrix();
+        const glm::vec4& rLocalBounds = s_pData->objectLocalBounds[i];
+
+        const float scale = getMaxScale(rMatrix);
+        const glm::vec3 centre = glm::vec3(rMatrix * glm::vec4(glm::vec3(rLocalBounds), 1.0f));
+
+        s_pData->objectBounds.Set(i, centre, rLocalBounds.w * scale);
+    }
+
+    if (bFrustumCulling)
+    {
+        PkGraphicsCulling::CullSpheres(s_pData->objectBounds, PkGraphicsFrustum::FromViewProjection(rViewProjection), s_pData->visibleObjects);
+    }
+    else
+    {
+        s_pData->visibleObjects.resize(objectCount);
+        for (uint32_t i = 0; i < objectCount; i++)
+        {
+            s_pData->visibleObjects[i] = i;
+        }
+    }
 
-    for (PkGraphicsModel* pModel : s_pData->pModels)
+    if (bOcclusionCulling)
     {
-        pModel->OnSwapChainDestroy();
+        occludeObjects(rViewProjection);
     }
 
+    s_pData->cullingStats.visibleObjects = static_cast<uint32_t>(s_pData->visibleObjects.size());
 }
 
-/*static*/ void PkGraphicsRenderPassScene::InitialiseGraphicsRenderPassScene()
+static void beginCulling()
 {
-    s_pData = new PkGrapicsRenderPassSceneData();
-    createCommandPool();
-    createDescriptorSetLayout();
+    // Done here on the calling thread, as instances can only change between frames.
+    updateObjectBounds();
 
-    s_pData->pModels.resize(2);
+    const glm::mat4 viewProjection = getProjectionMatrix() * PkGraphicsCore::GetViewMatrix();
+    const bool bFrustumCulling = s_pData->bCpuCulling;
+    const bool bOcclusionCulling = s_pData->bOcclusionCulling;
 
-    s_pData->pModels[0] = new PkGraphicsModel(s_pData->commandPool, "data/models/viking_room.obj", "data/textures/viking_room.png");
-    glm::mat4 m0 = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-    s_pData->pModels[0]->SetMatrix(m0);
+    s_pData->cullingFunc = [viewProjection, bFrustumCulling, bOcclusionCulling](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        cullObjects(viewProjection, bFrustumCulling, bOcclusionCulling);
+    };
 
-    s_pData->pModels[1] = new PkGraphicsModel(s_pData->commandPool, "data/models/viking_room.obj", "data/textures/viking_room.png");
-    glm::mat4 m1 = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    s_pData->pModels[1]->SetMatrix(m1);
+    s_pData->bCullingPending = true;
+    PkJobSystem::Dispatch(1, 1, s_pData->cullingFunc, s_pData->cullingCounter);
+}
+
+static void finishCulling()
+{
+    if (!s_pData->bCullingPending)
+    {
+        return;
+    }
 
-    OnSwapChainCreate();
+    PkJobSystem::Wait(s_pData->cullingCounter);
+    s_pData->bCullingPending = false;
+    s_pData->shownCullingStats = s_pData->cullingStats;
 }
 
-/*static*/ void PkGraphicsRenderPassScene::CleanupGraphicsRenderPassScene()
+static void buildRenderQueue()
 {
-    OnSwapChainDestroy();
+    const glm::mat4& rView = PkGraphicsCore::GetViewMatrix();
+    const float farViewPlane = PkGraphicsCore::GetFarViewPlane();
+
+    // Culls now if nothing started it earlier in the frame.
+    if (!s_pData->bCullingPending)
+    {
+        beginCulling();
+    }
+    finishCulling();
+
+    s_pData->renderQueue.resize(s_pData->visibleObjects.size());
+
+    for (uint32_t i = 0; i < s_pData->visibleObjects.size(); i++)
+    {
+        const uint32_t objectIndex = s_pData->visibleObjects[i];
+        const PkGraphicsModel* pModel = s_pData->pModels[objectIndex];
+
+        // Depth is only a tie-break within identical state, front to back so early depth testing rejects more fragments.
+        glm::vec4 viewPosition = rView * pModel->GetMatrix()[3];
+        float normalisedDepth = -viewPosition.z / farViewPlane;
+
+        s_pData->renderQueue[i].sortKey = PkGraphicsRenderQueue::MakeSortKey(0, 0, pModel->GetMaterialId(), pModel->GetMeshId(), normalisedDepth);
+        s_pData->renderQueue[i].drawIndex = objectIndex;
+    }
+
+    PkGraphicsRenderQueue::Sort(s_pData->renderQueue, s_pData->renderQueueScratch);
+}
+
+static bool isSameDrawState(const uint64_t sortKeyA, const uint64_t sortKeyB)
+{
+    return PkGraphicsRenderQueue::GetPass(sortKeyA) == PkGraphicsRenderQueue::GetPass(sortKeyB)
+        && PkGraphicsRenderQueue::GetPipeline(sortKeyA) == PkGraphicsRenderQueue::GetPipeline(sortKeyB)
+        && PkGraphicsRenderQueue::GetMaterial(sortKeyA) == PkGraphicsRenderQueue::GetMaterial(sortKeyB)
+        && PkGraphicsRenderQueue::GetMesh(sortKeyA) == PkGraphicsRenderQueue::GetMesh(sortKeyB);
+}
+
+static void buildDraws(PkGraphicsRenderPassSceneFrame& rFrame)
+{
+    uint32_t visibleInstanceCount = 0;
+    for (const PkGraphicsRenderQueueItem& rItem : s_pData->renderQueue)
+    {
+        visibleInstanceCount += static_cast<uint32_t>(s_pData->pModels[rItem.drawIndex]->GetInstances().size());
+    }
+
+    reserveFrameInstances(rFrame, visibleInstanceCount);
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), rFrame.instanceBufferAllocation, &data);
+    InstanceData* pInstances = static_cast<InstanceData*>(data);
+
+    s_pData->draws.clear();
+    uint32_t instanceOffset = 0;
+
+    // The queue is sorted by state first, so every object that can share a draw is already next to its neighbours.
+    for (const PkGraphicsRenderQueueItem& rItem : s_pData->renderQueue)
+    {
+        const uint32_t objectIndex = rItem.drawIndex;
+        const uint32_t instanceCount = static_cast<uint32_t>(s_pData->pModels[objectIndex]->GetInstances().size());
+
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        if (!s_pData->bAutoInstancing || s_pData->draws.empty() || !isSameDrawState(s_pData->draws.back().sortKey, rItem.sortKey))
+        {
+            s_pData->draws.push_back(PkGraphicsRenderPassSceneDraw{ rItem.sortKey, objectIndex, instanceOffset, 0 });
+        }
+
+        memcpy(pInstances + instanceOffset, &PkGraphicsInstanceStream::GetInstances()[s_pData->firstInstances[objectIndex]], sizeof(InstanceData) * instanceCount);
+
+        s_pData->draws.back().instanceCount += instanceCount;
+        instanceOffset += instanceCount;
+    }
+
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), rFrame.instanceBufferAllocation);
+}
+
+static VkRenderPass getRenderPass(const PkGraphicsRenderPassSceneVariant variant)
+{
+    switch (variant)
+    {
+    case RENDER_PASS_EARLY:
+        return s_pData->earlyRenderPass;
+    case RENDER_PASS_LATE:
+        return s_pData->lateRenderPass;
+    default:
+        return s_pData->renderPass;
+    }
+}
+
+static VkFramebuffer getFramebuffer(const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex)
+{
+    return variant == RENDER_PASS_EARLY ? s_pData->earlyFramebuffers[imageIndex] : s_pData->framebuffers[imageIndex];
+}
+
+static VkPipeline getScenePipeline(const PkGraphicsRenderPassSceneVariant variant)
+{
+    return variant == RENDER_PASS_EARLY ? s_pData->earlyPipeline : s_pData->pipeline;
+}
+
+static VkPipeline getBoardPipeline(const PkGraphicsRenderPassSceneVariant variant)
+{
+    return variant == RENDER_PASS_EARLY ? s_pData->earlyBoardPipeline : s_pData->boardPipeline;
+}
+
+static void bindPipeline(VkCommandBuffer commandBuffer, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex, VkBuffer instanceBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, getScenePipeline(variant));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pData->pipelineLayout, PK_DESCRIPTOR_SET_CAMERA, 1, &s_pData->cameraDescriptorSets[imageIndex], 0, nullptr);
+
+    VkBuffer instanceBuffers[] = { instanceBuffer };
+    VkDeviceSize instanceOffsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceBuffers, instanceOffsets);
+}
+
+static void beginSecondaryCommandBuffer(VkCommandBuffer commandBuffer, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex)
+{
+    VkCommandBufferInheritanceRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &s_pData->colourFormat;
+    renderingInfo.depthAttachmentFormat = s_pData->depthFormat;
+    renderingInfo.rasterizationSamples = PkGraphicsCore::GetMaxMsaaSampleCount();
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        inheritanceInfo.pNext = &renderingInfo;
+    }
+    else
+    {
+        inheritanceInfo.renderPass = getRenderPass(variant);
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = getFramebuffer(variant, imageIndex);
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording command buffer!");
+    }
+
+    // Dynamic state isn't inherited from the primary, so every secondary sets its own.
+    const VkExtent2D extent = PkGraphicsSwapChain::GetSwapChainExtent();
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)extent.width;
+    viewport.height = (float)extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+// Draws recorded on the CPU are only used without occlusion culling, which needs indirect draws, so always in the single pass.
+static void recordSecondaryCommandBuffer(VkCommandBuffer commandBuffer, const uint32_t imageIndex, const std::vector<PkGraphicsRenderPassSceneDraw>& rDraws, const uint32_t begin, const uint32_t end, PkGraphicsRenderQueueStats& rStats)
+{
+    beginSecondaryCommandBuffer(commandBuffer, RENDER_PASS_SINGLE, imageIndex);
+
+    rStats = PkGraphicsRenderQueueStats();
+
+    // Secondary command buffers start with no state bound, so the first draw of each batch always binds everything.
+    uint64_t boundSortKey = 0;
+    bool bFirstDraw = true;
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const PkGraphicsRenderPassSceneDraw& rDraw = rDraws[i];
+        const PkGraphicsModel* pModel = s_pData->pModels[rDraw.modelIndex];
+
+        if (bFirstDraw || PkGraphicsRenderQueue::GetPipeline(rDraw.sortKey) != PkGraphicsRenderQueue::GetPipeline(boundSortKey))
+        {
+            bindPipeline(commandBuffer, RENDER_PASS_SINGLE, imageIndex, s_pData->frames[imageIndex].instanceBuffer);
+            rStats.pipelineBinds++;
+        }
+        else
+        {
+            rStats.pipelineBindsSaved++;
+        }
+
+        if (bFirstDraw || PkGraphicsRenderQueue::GetMaterial(rDraw.sortKey) != PkGraphicsRenderQueue::GetMaterial(boundSortKey))
+        {
+            pModel->BindMaterial(commandBuffer, s_pData->pipelineLayout);
+            rStats.materialBinds++;
+        }
+        else
+        {
+            rStats.materialBindsSaved++;
+        }
+
+        if (bFirstDraw || PkGraphicsRenderQueue::GetMesh(rDraw.sortKey) != PkGraphicsRenderQueue::GetMesh(boundSortKey))
+        {
+            pModel->BindMesh(commandBuffer);
+            rStats.meshBinds++;
+        }
+        else
+        {
+            rStats.meshBindsSaved++;
+        }
+
+        pModel->DrawInstances(commandBuffer, rDraw.firstInstance, rDraw.instanceCount);
+        rStats.drawCount++;
+
+        boundSortKey = rDraw.sortKey;
+        bFirstDraw = false;
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+}
+
+static void recordSecondaryCommandBuffers(PkGraphicsRenderPassSceneFrame& rFrame, const uint32_t imageIndex, const std::vector<PkGraphicsRenderPassSceneDraw>& rDraws, const uint32_t numBatches)
+{
+    const uint32_t drawCount = static_cast<uint32_t>(rDraws.size());
+    const uint32_t batchSize = (drawCount + numBatches - 1) / numBatches;
+    const uint32_t batchCount = (drawCount + batchSize - 1) / batchSize;
+
+    rFrame.secondaryCommandBuffers.resize(batchCount);
+    rFrame.batchStats.resize(batchCount);
+
+    PkJobSystem::ParallelFor(drawCount, batchSize, [&rFrame, imageIndex, &rDraws, batchSize](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        // Batches are stored by position in the draw list so the primary executes them in sorted order whichever worker recorded them.
+        const uint32_t batch = begin / batchSize;
+
+        VkCommandBuffer commandBuffer = getSecondaryCommandBuffer(rFrame.threads[workerIndex]);
+        recordSecondaryCommandBuffer(commandBuffer, imageIndex, rDraws, begin, end, rFrame.batchStats[batch]);
+
+        rFrame.secondaryCommandBuffers[batch] = commandBuffer;
+    });
+}
+
+static VkCommandBuffer recordIndirectCommandBuffer(PkGraphicsRenderPassSceneFrame& rFrame, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex)
+{
+    // The late pass draws what the late culling phase found; the early and single passes draw the first phase.
+    const uint32_t phase = variant == RENDER_PASS_LATE ? 1 : 0;
+
+    // The draw count is tiny on the CPU side (one call per batch), so a single secondary is recorded on this thread.
+    VkCommandBuffer commandBuffer = getSecondaryCommandBuffer(rFrame.threads[PkJobSystem::GetCurrentWorkerIndex()]);
+    beginSecondaryCommandBuffer(commandBuffer, variant, imageIndex);
+
+    PkGraphicsRenderQueueStats& rStats = s_pData->renderQueueStats;
+
+    if (!s_pData->drawBatchModels.empty())
+    {
+        bindPipeline(commandBuffer, variant, imageIndex, PkGraphicsDrawIndirect::GetInstanceBuffer(imageIndex));
+        rStats.pipelineBinds++;
+    }
+
+    for (uint32_t batchIndex = 0; batchIndex < s_pData->drawBatchModels.size(); batchIndex++)
+    {
+        const PkGraphicsModel* pModel = s_pData->pModels[s_pData->drawBatchModels[batchIndex]];
+
+        pModel->BindMaterial(commandBuffer, s_pData->pipelineLayout);
+        pModel->BindMesh(commandBuffer);
+        rStats.materialBinds++;
+        rStats.meshBinds++;
+
+        PkGraphicsDrawIndirect::DrawBatch(commandBuffer, imageIndex, batchIndex, phase);
+        rStats.drawCount++;
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    return commandBuffer;
+}
+
+static VkCommandBuffer recordBoardCommandBuffer(PkGraphicsRenderPassSceneFrame& rFrame, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex)
+{
+    VkCommandBuffer commandBuffer = getSecondaryCommandBuffer(rFrame.threads[PkJobSystem::GetCurrentWorkerIndex()]);
+    beginSecondaryCommandBuffer(commandBuffer, variant, imageIndex);
+
+    const PkGraphicsModel* pModel = PkGraphicsBoard::GetModel();
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, getBoardPipeline(variant));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s_pData->boardPipelineLayout, PK_DESCRIPTOR_SET_CAMERA, 1, &s_pData->cameraDescriptorSets[imageIndex], 0, nullptr);
+    pModel->BindMaterial(commandBuffer, s_pData->boardPipelineLayout);
+    pModel->BindMesh(commandBuffer);
+
+    VkBuffer tileBuffers[] = { PkGraphicsBoard::GetTileBuffer() };
+    VkDeviceSize tileOffsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 1, 1, tileBuffers, tileOffsets);
+
+    // Each chunk places its tiles with its own constants, then draws them all at once.
+    for (const PkGraphicsBoardDraw& rDraw : PkGraphicsBoard::GetDraws())
+    {
+        vkCmdPushConstants(commandBuffer, s_pData->boardPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(rDraw.constants), &rDraw.constants);
+        pModel->DrawInstances(commandBuffer, rDraw.firstTile, rDraw.tileCount, rDraw.lod);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    return commandBuffer;
+}
+
+// Only used with dynamic rendering, where every pass inherits the same attachment formats whatever its variant.
+static VkCommandBuffer recordUiCommandBuffer(PkGraphicsRenderPassSceneFrame& rFrame, const uint32_t imageIndex)
+{
+    VkCommandBuffer commandBuffer = getSecondaryCommandBuffer(rFrame.threads[PkJobSystem::GetCurrentWorkerIndex()]);
+    beginSecondaryCommandBuffer(commandBuffer, RENDER_PASS_SINGLE, imageIndex);
+
+    PkGraphicsRenderPassImgui::RecordDrawData(commandBuffer);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+    }
+
+    return commandBuffer;
+}
+
+// The UI goes into the multisampled colour after the scene and is resolved with it, so the swap chain image is still
+// written once. The early pass's resolve would only be overwritten, so it does not resolve at all.
+static void recordRendering(VkCommandBuffer commandBuffer, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex, const std::vector<VkCommandBuffer>& rSecondaryCommandBuffers, const bool bDrawUi)
+{
+    const bool bEarly = variant == RENDER_PASS_EARLY;
+    const bool bLate = variant == RENDER_PASS_LATE;
+
+    VkRenderingAttachmentInfoKHR colourAttachment{};
+    colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colourAttachment.imageView = PkGraphicsRenderGraph::GetImageView(s_pData->colourImage);
+    colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colourAttachment.resolveMode = bEarly ? VK_RESOLVE_MODE_NONE_KHR : VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+    colourAttachment.resolveImageView = bEarly ? VK_NULL_HANDLE : PkGraphicsSwapChain::GetSwapChainImageView(imageIndex);
+    colourAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colourAttachment.loadOp = bLate ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colourAttachment.storeOp = bEarly ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colourAttachment.clearValue.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = PkGraphicsRenderGraph::GetImageView(s_pData->depthImage);
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE_KHR;
+    depthAttachment.loadOp = bLate ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = bEarly ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = PkGraphicsSwapChain::GetSwapChainExtent();
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colourAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+    s_pData->pfnCmdBeginRendering(commandBuffer, &renderingInfo);
+
+    if (!rSecondaryCommandBuffers.empty())
+    {
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(rSecondaryCommandBuffers.size()), rSecondaryCommandBuffers.data());
+    }
+
+    if (bDrawUi)
+    {
+        vkCmdExecuteCommands(commandBuffer, 1, &s_pData->frames[imageIndex].uiCommandBuffer);
+    }
+
+    s_pData->pfnCmdEndRendering(commandBuffer);
+}
+
+// Only the pass that resolves to the swap chain image draws the UI; the early pass has no UI subpass.
+static void recordRenderPass(VkCommandBuffer commandBuffer, const PkGraphicsRenderPassSceneVariant variant, const uint32_t imageIndex, const std::vector<VkCommandBuffer>& rSecondaryCommandBuffers, const bool bDrawUi)
+{
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        recordRendering(commandBuffer, variant, imageIndex, rSecondaryCommandBuffers, bDrawUi);
+        return;
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = getRenderPass(variant);
+    renderPassInfo.framebuffer = getFramebuffer(variant, imageIndex);
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = PkGraphicsSwapChain::GetSwapChainExtent();
+
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    if (!rSecondaryCommandBuffers.empty())
+    {
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(rSecondaryCommandBuffers.size()), rSecondaryCommandBuffers.data());
+    }
+
+    if (variant != RENDER_PASS_EARLY)
+    {
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+        if (bDrawUi)
+        {
+            PkGraphicsRenderPassImgui::RecordDrawData(commandBuffer);
+        }
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+// Runs on the render thread once the frame's own recording is done, so it shares nothing with the frame but the
+// pipeline and descriptor sets it binds; its command buffers are never submitted.
+static void runRecordingBenchmark(const uint32_t imageIndex)
+{
+    const uint32_t drawCounts[] = { 1000, 10000, 100000 };
+
+    PkGraphicsRenderPassSceneFrame& rFrame = s_pData->benchmarkFrame;
+    std::vector<PkGraphicsRenderQueueItem> renderQueue;
+    std::vector<PkGraphicsRenderQueueItem> renderQueueScratch;
+    std::vector<PkGraphicsRenderPassSceneDraw> draws;
+
+    s_pData->benchmarkResults.clear();
+
+    for (uint32_t drawCount : drawCounts)
+    {
+        renderQueue.resize(drawCount);
+        for (uint32_t i = 0; i < drawCount; i++)
+        {
+            const uint32_t modelIndex = i % static_cast<uint32_t>(s_pData->pModels.size());
+            const PkGraphicsModel* pModel = s_pData->pModels[modelIndex];
+
+            renderQueue[i].sortKey = PkGraphicsRenderQueue::MakeSortKey(0, 0, pModel->GetMaterialId(), pModel->GetMeshId(), 0.0f);
+            renderQueue[i].drawIndex = modelIndex;
+        }
+
+        PkGraphicsRenderQueue::Sort(renderQueue, renderQueueScratch);
+
+        // Measures recording cost per draw, so nothing is merged.
+        draws.resize(drawCount);
+        for (uint32_t i = 0; i < drawCount; i++)
+        {
+            const uint32_t modelIndex = renderQueue[i].drawIndex;
+            draws[i] = PkGraphicsRenderPassSceneDraw{ renderQueue[i].sortKey, modelIndex, 0, static_cast<uint32_t>(s_pData->pModels[modelIndex]->GetInstances().size()) };
+        }
+
+        for (uint32_t threadCount = 1; threadCount <= PkJobSystem::GetNumWorkers(); threadCount++)
+        {
+            resetFrame(rFrame);
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            recordSecondaryCommandBuffers(rFrame, imageIndex, draws, threadCount);
+            auto endTime = std::chrono::high_resolution_clock::now();
+
+            PkGraphicsRenderPassSceneBenchmarkResult result;
+            result.drawCount = drawCount;
+            result.threadCount = threadCount;
+            result.milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+            s_pData->benchmarkResults.push_back(result);
+        }
+    }
+
+    resetFrame(rFrame);
+    rFrame.secondaryCommandBuffers.clear();
+}
+
+// The general rotation pipeline can draw any board, so it stands in while the specialised one is compiling.
+static VkPipeline findBoardPipeline(const PkGraphicsPipelineKey* pBoardPipelineKeys)
+{
+    VkPipeline pipeline = PkGraphicsPipelineLibrary::GetPipeline(pBoardPipelineKeys[PkGraphicsBoard::GetTileRotation()]);
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        pipeline = PkGraphicsPipelineLibrary::GetPipeline(pBoardPipelineKeys[PK_BOARD_TILE_ROTATION_ANY]);
+    }
+    return pipeline;
+}
+
+// Does the CPU side of the frame: culling results into draws, secondaries recorded, and the render graph's passes
+// switched on or off to match.
+static void prepareFrame(const uint32_t imageIndex)
+{
+    PkGraphicsRenderPassSceneFrame& rFrame = s_pData->frames[imageIndex];
+
+    resetFrame(rFrame);
+
+    s_pData->pipeline = PkGraphicsPipelineLibrary::GetPipeline(s_pData->pipelineKey);
+    s_pData->earlyPipeline = PkGraphicsPipelineLibrary::GetPipeline(s_pData->earlyPipelineKey);
+    s_pData->boardPipeline = findBoardPipeline(s_pData->boardPipelineKeys);
+    s_pData->earlyBoardPipeline = findBoardPipeline(s_pData->earlyBoardPipelineKeys);
+
+    const bool bOcclusionCulling = s_pData->bDrawIndirect && PkGraphicsDrawIndirect::IsOcclusionCullingActive();
+    // The scene's own objects and the board are drawn by whichever pass comes first.
+    const PkGraphicsRenderPassSceneVariant firstVariant = bOcclusionCulling ? RENDER_PASS_EARLY : RENDER_PASS_SINGLE;
+
+    // Until the scene's pipelines have compiled its objects are skipped; the board and UI still draw.
+    if (s_pData->pipeline == VK_NULL_HANDLE || getScenePipeline(firstVariant) == VK_NULL_HANDLE)
+    {
+        rFrame.secondaryCommandBuffers.clear();
+        rFrame.lateSecondaryCommandBuffers.clear();
+        s_pData->renderQueueStats = PkGraphicsRenderQueueStats();
+    }
+    else if (s_pData->bDrawIndirect)
+    {
+        s_pData->renderQueueStats = PkGraphicsRenderQueueStats();
+        rFrame.secondaryCommandBuffers.assign(1, recordIndirectCommandBuffer(rFrame, firstVariant, imageIndex));
+
+        if (bOcclusionCulling)
+        {
+            rFrame.lateSecondaryCommandBuffers.assign(1, recordIndirectCommandBuffer(rFrame, RENDER_PASS_LATE, imageIndex));
+        }
+    }
+    else
+    {
+        buildRenderQueue();
+        buildDraws(rFrame);
+
+        const uint32_t drawCount = static_cast<uint32_t>(s_pData->draws.size());
+        const uint32_t maxBatches = (drawCount + MIN_DRAWS_PER_RECORDING_BATCH - 1) / MIN_DRAWS_PER_RECORDING_BATCH;
+        const uint32_t numBatches = std::min(PkJobSystem::GetNumWorkers(), maxBatches);
+
+        if (numBatches > 0)
+        {
+            recordSecondaryCommandBuffers(rFrame, imageIndex, s_pData->draws, numBatches);
+
+            s_pData->renderQueueStats = PkGraphicsRenderQueueStats();
+            for (const PkGraphicsRenderQueueStats& rStats : rFrame.batchStats)
+            {
+                s_pData->renderQueueStats.Accumulate(rStats);
+            }
+        }
+        else
+        {
+            rFrame.secondaryCommandBuffers.clear();
+            s_pData->renderQueueStats = PkGraphicsRenderQueueStats();
+        }
+    }
+
+    if (!bOcclusionCulling)
+    {
+        rFrame.lateSecondaryCommandBuffers.clear();
+    }
+
+    // The board culls and picks levels of detail by chunk on this thread; it is drawn after the scene's own objects.
+    const glm::mat4 view = PkGraphicsCore::GetViewMatrix();
+    PkGraphicsBoard::BeginFrame();
+    PkGraphicsBoard::Cull(getProjectionMatrix() * view, glm::vec3(glm::inverse(view)[3]));
+
+    if (!PkGraphicsBoard::GetDraws().empty() && getBoardPipeline(firstVariant) != VK_NULL_HANDLE)
+    {
+        rFrame.secondaryCommandBuffers.push_back(recordBoardCommandBuffer(rFrame, firstVariant, imageIndex));
+    }
+
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        rFrame.uiCommandBuffer = recordUiCommandBuffer(rFrame, imageIndex);
+    }
+
+    // Held until the scene's pipeline has compiled, as the benchmark binds it just as the scene does.
+    if (s_pData->bBenchmarkRequested && s_pData->pipeline != VK_NULL_HANDLE && !s_pData->pModels.empty())
+    {
+        runRecordingBenchmark(imageIndex);
+        s_pData->bBenchmarkRequested = false;
+    }
+
+    PkGraphicsRenderGraph::SetPassEnabled(s_pData->commandGenerationPass, s_pData->bDrawIndirect);
+    PkGraphicsRenderGraph::SetPassEnabled(s_pData->earlyPass, bOcclusionCulling);
+    PkGraphicsRenderGraph::SetPassEnabled(s_pData->depthPyramidPass, bOcclusionCulling);
+    PkGraphicsRenderGraph::SetPassEnabled(s_pData->latePass, bOcclusionCulling);
+    PkGraphicsRenderGraph::SetPassEnabled(s_pData->scenePass, !bOcclusionCulling);
+}
+
+// Occlusion culling draws what was visible last frame, builds a depth pyramid from it, then draws whatever that depth
+// does not hide; otherwise the scene is a single pass. Only the pass that resolves, late or single, writes the swap
+// chain image.
+static void addRenderGraphPasses()
+{
+    const PkGraphicsRenderGraphImageDesc colourDesc = { PkGraphicsSwapChain::GetSwapChainImageFormat(), PkGraphicsCore::GetMaxMsaaSampleCount(), VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+    // Sampled when building the depth pyramid.
+    const PkGraphicsRenderGraphImageDesc depthDesc = { findDepthFormat(), PkGraphicsCore::GetMaxMsaaSampleCount(), VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+
+    s_pData->colourImage = PkGraphicsRenderGraph::CreateImage("Scene colour", colourDesc);
+    s_pData->depthImage = PkGraphicsRenderGraph::CreateImage("Scene depth", depthDesc);
+    s_pData->swapChainImage = PkGraphicsRenderGraph::ImportSwapChainImage();
+
+    // Kept current on both paths, so switching to indirect draws never sees stale instances.
+    s_pData->uploadPass = PkGraphicsRenderGraph::AddPass("Scene uploads", true, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        PkGraphicsInstanceStream::RecordUpload(commandBuffer, imageIndex);
+        PkGraphicsBoard::RecordUpload(commandBuffer, imageIndex);
+    });
+
+    // Draw commands are generated on the GPU and must be complete before the render pass reads them.
+    s_pData->commandGenerationPass = PkGraphicsRenderGraph::AddPass("Draw command generation", true, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        PkGraphicsDrawIndirect::RecordCommandGeneration(commandBuffer, imageIndex, PkGraphicsCore::GetViewMatrix(), getProjectionMatrix());
+    });
+
+    s_pData->earlyPass = PkGraphicsRenderGraph::AddPass("Scene early", false, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        recordRenderPass(commandBuffer, RENDER_PASS_EARLY, imageIndex, s_pData->frames[imageIndex].secondaryCommandBuffers, false);
+    });
+    PkGraphicsRenderGraph::AddWrite(s_pData->earlyPass, s_pData->colourImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->earlyPass, s_pData->depthImage, PK_RENDER_GRAPH_DEPTH_ATTACHMENT);
+
+    // The depth pyramid is kept for next frame's culling, so the pass is never culled.
+    s_pData->depthPyramidPass = PkGraphicsRenderGraph::AddPass("Depth pyramid and late culling", true, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        PkGraphicsDepthPyramid::RecordBuild(commandBuffer);
+        PkGraphicsDrawIndirect::RecordLateCulling(commandBuffer, imageIndex);
+    });
+    PkGraphicsRenderGraph::AddRead(s_pData->depthPyramidPass, s_pData->depthImage, PK_RENDER_GRAPH_DEPTH_COMPUTE_READ);
+
+    s_pData->latePass = PkGraphicsRenderGraph::AddPass("Scene late", false, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        recordRenderPass(commandBuffer, RENDER_PASS_LATE, imageIndex, s_pData->frames[imageIndex].lateSecondaryCommandBuffers, true);
+    });
+    PkGraphicsRenderGraph::AddRead(s_pData->latePass, s_pData->colourImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->latePass, s_pData->colourImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+    PkGraphicsRenderGraph::AddRead(s_pData->latePass, s_pData->depthImage, PK_RENDER_GRAPH_DEPTH_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->latePass, s_pData->depthImage, PK_RENDER_GRAPH_DEPTH_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->latePass, s_pData->swapChainImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+
+    s_pData->scenePass = PkGraphicsRenderGraph::AddPass("Scene", false, [](VkCommandBuffer commandBuffer, const uint32_t imageIndex)
+    {
+        recordRenderPass(commandBuffer, RENDER_PASS_SINGLE, imageIndex, s_pData->frames[imageIndex].secondaryCommandBuffers, true);
+    });
+    PkGraphicsRenderGraph::AddWrite(s_pData->scenePass, s_pData->colourImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->scenePass, s_pData->depthImage, PK_RENDER_GRAPH_DEPTH_ATTACHMENT);
+    PkGraphicsRenderGraph::AddWrite(s_pData->scenePass, s_pData->swapChainImage, PK_RENDER_GRAPH_COLOUR_ATTACHMENT);
+}
+
+static void destroyFramebuffers()
+{
+    for (VkFramebuffer framebuffer : s_pData->framebuffers)
+    {
+        vkDestroyFramebuffer(PkGraphicsCore::GetDevice(), framebuffer, nullptr);
+    }
+
+    for (VkFramebuffer framebuffer : s_pData->earlyFramebuffers)
+    {
+        vkDestroyFramebuffer(PkGraphicsCore::GetDevice(), framebuffer, nullptr);
+    }
+}
+
+/*static*/ void PkGraphicsRenderPassScene::PrepareFrame(const uint32_t imageIndex)
+{
+    prepareFrame(imageIndex);
+}
+
+/*static*/ void PkGraphicsRenderPassScene::GetDebugState(PkGraphicsRenderPassSceneDebugState& rState)
+{
+    rState.bAutoInstancing = s_pData->bAutoInstancing;
+    rState.renderQueueStats = s_pData->renderQueueStats;
+    rState.objectsDrawn = static_cast<uint32_t>(s_pData->renderQueue.size());
+
+    rState.bAnimateInstances = s_pData->bAnimateInstances;
+    rState.animatedPercent = s_pData->animatedPercent;
+    rState.instanceCount = PkGraphicsInstanceStream::GetInstanceCount();
+    rState.uploadedInstanceCount = PkGraphicsInstanceStream::GetUploadedInstanceCount();
+    rState.uploadedRangeCount = PkGraphicsInstanceStream::GetUploadedRangeCount();
+    rState.uploadBudget = PkGraphicsInstanceStream::GetUploadBudget();
+    rState.pendingInstanceCount = PkGraphicsInstanceStream::GetPendingInstanceCount();
+
+    PkGraphicsBoard::GetDebugState(rState.board);
+
+    rState.bCpuCulling = s_pData->bCpuCulling;
+    rState.bOcclusionCulling = s_pData->bOcclusionCulling;
+    rState.cullingStats = s_pData->shownCullingStats;
+    rState.objectCount = static_cast<uint32_t>(s_pData->pModels.size());
+    rState.occlusionWidth = s_pData->occlusionBuffer.width;
+    rState.occlusionHeight = s_pData->occlusionBuffer.height;
+
+    rState.bDrawIndirect = s_pData->bDrawIndirect;
+    if (PkGraphicsDrawIndirect::IsSupported())
+    {
+        rState.bGpuCulling = PkGraphicsDrawIndirect::IsCullingEnabled();
+        rState.bGpuOcclusionCulling = PkGraphicsDrawIndirect::IsOcclusionCullingEnabled();
+        rState.batchCount = static_cast<uint32_t>(s_pData->drawBatchModels.size());
+        rState.indirectInstanceCount = PkGraphicsDrawIndirect::GetInstanceCount();
+        rState.visibleInstanceCount = s_pData->bDrawIndirect ? PkGraphicsDrawIndirect::GetVisibleInstanceCount() : 0;
+    }
+
+    rState.bBenchmarkRequested = s_pData->bBenchmarkRequested;
+    rState.benchmarkResults = s_pData->benchmarkResults;
+}
+
+/*static*/ void PkGraphicsRenderPassScene::ShowDebugUi(const PkGraphicsRenderPassSceneDebugState& rState, PkGraphicsCommandList& rCommands)
+{
+    if (ImGui::CollapsingHeader("Render queue", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const PkGraphicsRenderQueueStats& rStats = rState.renderQueueStats;
+
+        bool bAutoInstancing = rState.bAutoInstancing;
+        if (ImGui::Checkbox("Automatic instancing", &bAutoInstancing))
+        {
+            rCommands.push_back([bAutoInstancing] { s_pData->bAutoInstancing = bAutoInstancing; });
+        }
+        ImGui::Text("Draws: %u", rStats.drawCount);
+        if (!rState.bDrawIndirect)
+        {
+            ImGui::Text("Objects drawn: %u", rState.objectsDrawn);
+        }
+        ImGui::Text("Pipeline binds: %u (%u saved)", rStats.pipelineBinds, rStats.pipelineBindsSaved);
+        ImGui::Text("Material binds: %u (%u saved)", rStats.materialBinds, rStats.materialBindsSaved);
+        ImGui::Text("Mesh binds: %u (%u saved)", rStats.meshBinds, rStats.meshBindsSaved);
+    }
+
+    if (ImGui::CollapsingHeader("Instance streaming", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        bool bAnimateInstances = rState.bAnimateInstances;
+        if (ImGui::Checkbox("Animate instances", &bAnimateInstances))
+        {
+            rCommands.push_back([bAnimateInstances] { s_pData->bAnimateInstances = bAnimateInstances; });
+        }
+
+        int animatedPercent = rState.animatedPercent;
+        if (ImGui::SliderInt("Animated share (%)", &animatedPercent, 0, 100))
+        {
+            rCommands.push_back([animatedPercent] { s_pData->animatedPercent = animatedPercent; });
+        }
+
+        ImGui::Text("Instances: %u", rState.instanceCount);
+        ImGui::Text("Uploaded: %u in %u ranges (budget %u)", rState.uploadedInstanceCount, rState.uploadedRangeCount, rState.uploadBudget);
+        ImGui::Text("Still dirty: %u", rState.pendingInstanceCount);
+    }
+
+    PkGraphicsBoard::ShowDebugUi(rState.board, rCommands);
+
+    if (ImGui::CollapsingHeader("CPU culling", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        const PkGraphicsRenderPassSceneCullingStats& rStats = rState.cullingStats;
+
+        bool bCpuCulling = rState.bCpuCulling;
+        if (ImGui::Checkbox("Frustum culling", &bCpuCulling))
+        {
+            rCommands.push_back([bCpuCulling] { s_pData->bCpuCulling = bCpuCulling; });
+        }
+
+        bool bOcclusionCulling = rState.bOcclusionCulling;
+        if (ImGui::Checkbox("Occlusion culling##cpu", &bOcclusionCulling))
+        {
+            rCommands.push_back([bOcclusionCulling] { s_pData->bOcclusionCulling = bOcclusionCulling; });
+        }
+
+        ImGui::Text("Instruction set: %s", PkGraphicsCulling::GetInstructionSet());
+        ImGui::Text("Visible objects: %u / %u", rStats.visibleObjects, rState.objectCount);
+        ImGui::Text("Occluded objects: %u", rStats.occludedObjects);
+        ImGui::Text("Occluder triangles: %u (%ux%u buffer)", rStats.occluderTriangles, rState.occlusionWidth, rState.occlusionHeight);
+        ImGui::Text("Occlusion time: %.3f ms", rStats.occlusionMilliseconds);
+    }
+
+    if (ImGui::CollapsingHeader("Indirect draws", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        if (PkGraphicsDrawIndirect::IsSupported())
+        {
+            bool bDrawIndirect = rState.bDrawIndirect;
+            if (ImGui::Checkbox("Use indirect draws", &bDrawIndirect))
+            {
+                rCommands.push_back([bDrawIndirect] { s_pData->bDrawIndirect = bDrawIndirect; });
+            }
+            ImGui::Text("Batches: %u", rState.batchCount);
+            ImGui::Text("GPU draw count: %s", PkGraphicsDrawIndirect::IsDrawCountSupported() ? "yes" : "no");
+
+            bool bCullingEnabled = rState.bGpuCulling;
+            if (ImGui::Checkbox("GPU instance culling", &bCullingEnabled))
+            {
+                rCommands.push_back([bCullingEnabled] { PkGraphicsDrawIndirect::SetCullingEnabled(bCullingEnabled); });
+            }
+
+            bool bOcclusionCullingEnabled = rState.bGpuOcclusionCulling;
+            if (ImGui::Checkbox("Occlusion culling", &bOcclusionCullingEnabled))
+            {
+                rCommands.push_back([bOcclusionCullingEnabled] { PkGraphicsDrawIndirect::SetOcclusionCullingEnabled(bOcclusionCullingEnabled); });
+            }
+
+            if (rState.bDrawIndirect)
+            {
+                ImGui::Text("Visible instances: %u / %u", rState.visibleInstanceCount, rState.indirectInstanceCount);
+            }
+        }
+        else
+        {
+            ImGui::Text("Not supported (drawIndirectFirstInstance)");
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Scene recording"))
+    {
+        ImGui::Text("Recording threads: %u", PkJobSystem::GetNumWorkers());
+
+        if (rState.bBenchmarkRequested)
+        {
+            ImGui::Text("Benchmark waiting for the scene pipeline...");
+        }
+        else if (ImGui::Button("Run recording benchmark"))
+        {
+            rCommands.push_back([] { s_pData->bBenchmarkRequested = true; });
+        }
+
+        for (const PkGraphicsRenderPassSceneBenchmarkResult& rResult : rState.benchmarkResults)
+        {
+            ImGui::Text("%6u draws, %2u threads: %.3f ms", rResult.drawCount, rResult.threadCount, rResult.milliseconds);
+        }
+    }
+}
+
+/*static*/ void PkGraphicsRenderPassScene::Simulate(const float stepTime)
+{
+    s_pData->previousAnimationTime = s_pData->animationTime;
+
+    if (s_pData->bAnimateInstances)
+    {
+        s_pData->animationTime += stepTime;
+    }
+
+    PkGraphicsBoard::Update(stepTime);
+}
+
+/*static*/ void PkGraphicsRenderPassScene::Update(const float interpolation)
+{
+    // Culling must not read instances while they change; it is normally already finished by the last frame's recording.
+    finishCulling();
+
+    // Only the drawn state is written to the instances, so a frame costs the same however many steps it took.
+    if (s_pData->bAnimateInstances)
+    {
+        animateInstances(glm::mix(s_pData->previousAnimationTime, s_pData->animationTime, interpolation));
+    }
+}
+
+/*static*/ void PkGraphicsRenderPassScene::BeginCulling()
+{
+    // The indirect path culls on the GPU instead.
+    if (s_pData->bDrawIndirect || s_pData->bCullingPending)
+    {
+        return;
+    }
+
+    beginCulling();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::FinishCulling()
+{
+    finishCulling();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::UpdateResourceDescriptors(const uint32_t imageIndex)
+{
+    CameraBufferObject ubo{};
+    ubo.view = PkGraphicsCore::GetViewMatrix();
+    ubo.proj = getProjectionMatrix();
+
+    void* data;
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), s_pData->cameraBufferAllocations[imageIndex], &data);
+    memcpy(data, &ubo, sizeof(ubo));
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), s_pData->cameraBufferAllocations[imageIndex]);
+
+    vmaMapMemory(PkGraphicsCore::GetAllocator(), s_pData->objectBufferAllocations[imageIndex], &data);
+    glm::mat4* pMatrices = static_cast<glm::mat4*>(data);
+    for (size_t i = 0; i < s_pData->pModels.size(); i++)
+    {
+        pMatrices[i] = s_pData->pModels[i]->GetMatrix();
+    }
+    vmaUnmapMemory(PkGraphicsCore::GetAllocator(), s_pData->objectBufferAllocations[imageIndex]);
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnSwapChainImagesCreate()
+{
+    PkGraphicsInstanceStream::OnSwapChainCreate();
+    PkGraphicsBoard::OnSwapChainCreate();
+    createCameraResources();
+    PkGraphicsDrawIndirect::SetObjectBuffers(s_pData->objectBuffers);
+    PkGraphicsDrawIndirect::OnSwapChainCreate();
+    createFrames();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnSwapChainImagesDestroy()
+{
+    // A job started before the swap chain went out of date may still be reading the occlusion buffer.
+    finishCulling();
+    destroyFrames();
+    PkGraphicsDrawIndirect::OnSwapChainDestroy();
+    destroyCameraResources();
+    PkGraphicsBoard::OnSwapChainDestroy();
+    PkGraphicsInstanceStream::OnSwapChainDestroy();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnSwapChainFormatCreate()
+{
+    createRenderPasses();
+    createPipelines();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnSwapChainFormatDestroy()
+{
+    destroyPipelines();
+    destroyRenderPasses();
+}
+
+/*static*/ PkGraphicsRenderPassImguiTarget PkGraphicsRenderPassScene::GetUiTarget()
+{
+    PkGraphicsRenderPassImguiTarget target{};
+    target.colourFormat = s_pData->colourFormat;
+
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        target.depthFormat = s_pData->depthFormat;
+        target.samples = PkGraphicsCore::GetMaxMsaaSampleCount();
+    }
+    else
+    {
+        target.renderPass = s_pData->renderPass;
+        target.subpass = PK_SCENE_SUBPASS_UI;
+        target.depthFormat = VK_FORMAT_UNDEFINED;
+        target.samples = VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    return target;
+}
+
+/*static*/ void PkGraphicsRenderPassScene::AddRenderGraphPasses()
+{
+    addRenderGraphPasses();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnRenderGraphCompiled()
+{
+    const VkExtent2D extent = PkGraphicsSwapChain::GetSwapChainExtent();
+    s_pData->occlusionBuffer.Resize(OCCLUSION_BUFFER_WIDTH, std::max(OCCLUSION_BUFFER_WIDTH * extent.height / extent.width, 1u));
+
+    PkGraphicsDepthPyramid::OnSwapChainCreate(PkGraphicsRenderGraph::GetImageView(s_pData->depthImage));
+    PkGraphicsDrawIndirect::OnDepthPyramidCreate();
+    createFramebuffers();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::OnRenderGraphDestroy()
+{
+    // The occlusion buffer is resized along with everything else that follows the swap chain extent.
+    finishCulling();
+    destroyFramebuffers();
+    PkGraphicsDrawIndirect::OnDepthPyramidDestroy();
+    PkGraphicsDepthPyramid::OnSwapChainDestroy();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::InitialiseGraphicsRenderPassScene()
+{
+    s_pData = new PkGrapicsRenderPassSceneData();
+    createCommandPool();
+
+    if (PkGraphicsCore::IsDynamicRenderingEnabled())
+    {
+        s_pData->pfnCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkCmdBeginRenderingKHR");
+        s_pData->pfnCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(PkGraphicsCore::GetDevice(), "vkCmdEndRenderingKHR");
+    }
+    createDescriptorSetLayouts();
+
+    s_pData->pModels.resize(2);
+
+    s_pData->pModels[0] = new PkGraphicsModel(s_pData->commandPool, s_pData->materialDescriptorSetLayout, "data/models/viking_room.obj", "data/textures/viking_room.png", BOARD_DIMENSIONS);
+    s_pData->pModels[0]->LoadOccluder("data/models/viking_room_occluder.obj");
+    glm::mat4 m0 = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    s_pData->pModels[0]->SetMatrix(m0);
+
+    s_pData->pModels[1] = new PkGraphicsModel(s_pData->commandPool, s_pData->materialDescriptorSetLayout, "data/models/viking_room.obj", "data/textures/viking_room.png", BOARD_DIMENSIONS);
+    s_pData->pModels[1]->LoadOccluder("data/models/viking_room_occluder.obj");
+    glm::mat4 m1 = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    s_pData->pModels[1]->SetMatrix(m1);
+
+    PkGraphicsInstanceStream::InitialiseGraphicsInstanceStream();
+    createInstances();
+    createObjectBounds();
+
+    PkGraphicsBoard::InitialiseGraphicsBoard(s_pData->commandPool, s_pData->materialDescriptorSetLayout);
+
+    PkGraphicsDepthPyramid::InitialiseGraphicsDepthPyramid();
+    PkGraphicsDrawIndirect::InitialiseGraphicsDrawIndirect();
+    createDrawRecords();
+    createFrameThreads(s_pData->benchmarkFrame);
+
+    OnSwapChainImagesCreate();
+    OnSwapChainFormatCreate();
+}
+
+/*static*/ void PkGraphicsRenderPassScene::CleanupGraphicsRenderPassScene()
+{
+    OnSwapChainFormatDestroy();
+    OnSwapChainImagesDestroy();
+
+    destroyFrameThreads(s_pData->benchmarkFrame);
+    PkGraphicsDrawIndirect::CleanupGraphicsDrawIndirect();
+    PkGraphicsDepthPyramid::CleanupGraphicsDepthPyramid();
+    PkGraphicsBoard::CleanupGraphicsBoard();
+    PkGraphicsInstanceStream::CleanupGraphicsInstanceStream();
 
     for (uint32_t i = 0; i < s_pData->pModels.size(); ++i)
     {
         delete s_pData->pModels[i];
     }
 
-    vkDestroyDescriptorSetLayout(PkGraphicsCore::GetDevice(), s_pData->descriptorSetLayout, nullptr);
     vkDestroyCommandPool(PkGraphicsCore::GetDevice(), s_pData->commandPool, nullptr);
     delete s_pData;
 }
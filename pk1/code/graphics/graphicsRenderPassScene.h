@@ -1,20 +1,113 @@
 #pragma once
 
+#include "graphics/graphicsBoard.h"
+#include "graphics/graphicsCommands.h"
+#include "graphics/graphicsRenderPassImgui.h"
+#include "graphics/graphicsRenderQueue.h"
+
 #include <vulkan/vulkan_core.h>
 
 #include <stdint.h>
+#include <vector>
+
+// The scene's render passes draw the UI in this subpass, over the resolved swap chain image.
+static const uint32_t PK_SCENE_SUBPASS_UI = 1;
+
+struct PkGraphicsRenderPassSceneCullingStats
+{
+	uint32_t visibleObjects = 0;
+	uint32_t occludedObjects = 0;
+	uint32_t occluderTriangles = 0;
+	float occlusionMilliseconds = 0.0f;
+};
+
+struct PkGraphicsRenderPassSceneBenchmarkResult
+{
+	uint32_t drawCount = 0;
+	uint32_t threadCount = 0;
+	float milliseconds = 0.0f;
+};
+
+struct PkGraphicsRenderPassSceneDebugState
+{
+	bool bAutoInstancing = false;
+	PkGraphicsRenderQueueStats renderQueueStats;
+	uint32_t objectsDrawn = 0;
+
+	bool bAnimateInstances = false;
+	int animatedPercent = 0;
+	uint32_t instanceCount = 0;
+	uint32_t uploadedInstanceCount = 0;
+	uint32_t uploadedRangeCount = 0;
+	uint32_t uploadBudget = 0;
+	uint32_t pendingInstanceCount = 0;
+
+	PkGraphicsBoardDebugState board;
+
+	bool bCpuCulling = false;
+	bool bOcclusionCulling = false;
+	PkGraphicsRenderPassSceneCullingStats cullingStats;
+	uint32_t objectCount = 0;
+	uint32_t occlusionWidth = 0;
+	uint32_t occlusionHeight = 0;
+
+	bool bDrawIndirect = false;
+	bool bGpuCulling = false;
+	bool bGpuOcclusionCulling = false;
+	uint32_t batchCount = 0;
+	uint32_t indirectInstanceCount = 0;
+	uint32_t visibleInstanceCount = 0;
+
+	bool bBenchmarkRequested = false;
+	std::vector<PkGraphicsRenderPassSceneBenchmarkResult> benchmarkResults;
+};
 
 class PkGraphicsRenderPassScene
 {
 public:
 	PkGraphicsRenderPassScene() = delete;
 
-	static VkCommandBuffer& GetCommandBuffer(const uint32_t imageIndex);
+	// Records the scene's secondaries for this image and picks which of its render graph passes run.
+	static void PrepareFrame(const uint32_t imageIndex);
+
+	// Advances anything in the scene that moves on its own by one fixed simulation step.
+	static void Simulate(const float stepTime);
+
+	// Shows the scene the given fraction of the way from the state before the last step to the one after it. Call
+	// once per frame, after the frame's steps and before BeginCulling.
+	static void Update(const float interpolation);
+
+	// Starts CPU culling for this frame's camera on the job system; PrepareFrame waits for it.
+	static void BeginCulling();
+
+	// Waits for culling started by BeginCulling. PrepareFrame already does; a frame that ends before it must call this
+	// before its packet is handed back, so no culling job outlives the frame.
+	static void FinishCulling();
 
 	static void UpdateResourceDescriptors(const uint32_t imageIndex);
 
-	static void OnSwapChainCreate();
-	static void OnSwapChainDestroy();
+	// The first is called on the render thread; the second draws what it captured and queues any changes made.
+	static void GetDebugState(PkGraphicsRenderPassSceneDebugState& rState);
+	static void ShowDebugUi(const PkGraphicsRenderPassSceneDebugState& rState, PkGraphicsCommandList& rCommands);
+
+	// Where the UI is drawn: the UI subpass of the scene's render passes, which are all compatible with one another,
+	// or the scene's own rendering scope when dynamic rendering is enabled.
+	static PkGraphicsRenderPassImguiTarget GetUiTarget();
+
+	// Per-image buffers, descriptor sets and recording state, only rebuilt when the number of swap chain images changes.
+	static void OnSwapChainImagesCreate();
+	static void OnSwapChainImagesDestroy();
+
+	// Render passes and pipelines, only rebuilt when the swap chain's format changes. Pipelines use dynamic viewport
+	// and scissor, so a plain resize keeps them.
+	static void OnSwapChainFormatCreate();
+	static void OnSwapChainFormatDestroy();
+
+	// Declares the scene's images and passes; its framebuffers are made once the graph has created the images.
+	// Everything sized to the swap chain extent is rebuilt here on every resize.
+	static void AddRenderGraphPasses();
+	static void OnRenderGraphCompiled();
+	static void OnRenderGraphDestroy();
 
 	static void InitialiseGraphicsRenderPassScene();
 	static void CleanupGraphicsRenderPassScene();
@@ -0,0 +1,96 @@
+#include "graphicsRenderQueue.h"
+
+#include <algorithm>
+
+static const uint32_t PASS_SHIFT = 60;
+static const uint32_t PIPELINE_SHIFT = 48;
+static const uint32_t MATERIAL_SHIFT = 32;
+static const uint32_t MESH_SHIFT = 16;
+static const uint32_t DEPTH_SHIFT = 0;
+
+static const uint64_t PASS_MASK = 0xf;
+static const uint64_t PIPELINE_MASK = 0xfff;
+static const uint64_t MATERIAL_MASK = 0xffff;
+static const uint64_t MESH_MASK = 0xffff;
+static const uint64_t DEPTH_MASK = 0xffff;
+
+static const uint32_t RADIX_BITS = 8;
+static const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+static const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+/*static*/ uint64_t PkGraphicsRenderQueue::MakeSortKey(const uint32_t pass, const uint32_t pipeline, const uint32_t material, const uint32_t mesh, const float normalisedDepth)
+{
+    const float clampedDepth = std::min(std::max(normalisedDepth, 0.0f), 1.0f);
+    const uint64_t depthBucket = static_cast<uint64_t>(clampedDepth * static_cast<float>(DEPTH_MASK));
+
+    return ((pass & PASS_MASK) << PASS_SHIFT)
+        | ((pipeline & PIPELINE_MASK) << PIPELINE_SHIFT)
+        | ((material & MATERIAL_MASK) << MATERIAL_SHIFT)
+        | ((mesh & MESH_MASK) << MESH_SHIFT)
+        | ((depthBucket & DEPTH_MASK) << DEPTH_SHIFT);
+}
+
+/*static*/ uint32_t PkGraphicsRenderQueue::GetPass(const uint64_t sortKey)
+{
+    return static_cast<uint32_t>((sortKey >> PASS_SHIFT) & PASS_MASK);
+}
+
+/*static*/ uint32_t PkGraphicsRenderQueue::GetPipeline(const uint64_t sortKey)
+{
+    return static_cast<uint32_t>((sortKey >> PIPELINE_SHIFT) & PIPELINE_MASK);
+}
+
+/*static*/ uint32_t PkGraphicsRenderQueue::GetMaterial(const uint64_t sortKey)
+{
+    return static_cast<uint32_t>((sortKey >> MATERIAL_SHIFT) & MATERIAL_MASK);
+}
+
+/*static*/ uint32_t PkGraphicsRenderQueue::GetMesh(const uint64_t sortKey)
+{
+    return static_cast<uint32_t>((sortKey >> MESH_SHIFT) & MESH_MASK);
+}
+
+/*static*/ void PkGraphicsRenderQueue::Sort(std::vector<PkGraphicsRenderQueueItem>& rItems, std::vector<PkGraphicsRenderQueueItem>& rScratch)
+{
+    const size_t count = rItems.size();
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    rScratch.resize(count);
+
+    // Least significant digit first; every pass is stable so earlier passes keep their order within equal digits.
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        const uint32_t shift = pass * RADIX_BITS;
+
+        uint32_t histogram[RADIX_SIZE] = {};
+        for (const PkGraphicsRenderQueueItem& rItem : rItems)
+        {
+            histogram[(rItem.sortKey >> shift) & (RADIX_SIZE - 1)]++;
+        }
+
+        // Most of the key is usually identical across the queue (one pass, few pipelines), so skip digits with a single bucket.
+        if (histogram[(rItems[0].sortKey >> shift) & (RADIX_SIZE - 1)] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < RADIX_SIZE; i++)
+        {
+            const uint32_t bucketCount = histogram[i];
+            histogram[i] = offset;
+            offset += bucketCount;
+        }
+
+        for (const PkGraphicsRenderQueueItem& rItem : rItems)
+        {
+            rScratch[histogram[(rItem.sortKey >> shift) & (RADIX_SIZE - 1)]++] = rItem;
+        }
+
+        rItems.swap(rScratch);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Sort key layout, most significant first: pass (4 bits), pipeline (12), material (16), mesh (16), depth bucket (16).
+// Sorting by key groups draws by the state that is most expensive to change.
+struct PkGraphicsRenderQueueItem
+{
+    uint64_t sortKey;
+    uint32_t drawIndex;
+};
+
+struct PkGraphicsRenderQueueStats
+{
+    uint32_t drawCount = 0;
+
+    uint32_t pipelineBinds = 0;
+    uint32_t pipelineBindsSaved = 0;
+    uint32_t materialBinds = 0;
+    uint32_t materialBindsSaved = 0;
+    uint32_t meshBinds = 0;
+    uint32_t meshBindsSaved = 0;
+
+    void Accumulate(const PkGraphicsRenderQueueStats& rOther)
+    {
+        drawCount += rOther.drawCount;
+        pipelineBinds += rOther.pipelineBinds;
+        pipelineBindsSaved += rOther.pipelineBindsSaved;
+        materialBinds += rOther.materialBinds;
+        materialBindsSaved += rOther.materialBindsSaved;
+        meshBinds += rOther.meshBinds;
+        meshBindsSaved += rOther.meshBindsSaved;
+    }
+};
+
+class PkGraphicsRenderQueue
+{
+public:
+    PkGraphicsRenderQueue() = delete;
+
+    static uint64_t MakeSortKey(const uint32_t pass, const uint32_t pipeline, const uint32_t material, const uint32_t mesh, const float normalisedDepth);
+
+    static uint32_t GetPass(const uint64_t sortKey);
+    static uint32_t GetPipeline(const uint64_t sortKey);
+    static uint32_t GetMaterial(const uint64_t sortKey);
+    static uint32_t GetMesh(const uint64_t sortKey);
+
+    static void Sort(std::vector<PkGraphicsRenderQueueItem>& rItems, std::vector<PkGraphicsRenderQueueItem>& rScratch);
+};
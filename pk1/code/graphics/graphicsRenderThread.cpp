@@ -0,0 +1,274 @@
+#include "graphicsRenderThread.h"
+
+#include "imgui/imgui.h"
+#include "jobs/jobSystem.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+// One packet being filled by the game thread while the other is rendered.
+static const uint32_t PACKET_COUNT = 2;
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> PkGraphicsRenderThreadTime;
+
+// Packet indices passed from one thread to one other. Each side only ever advances its own counter.
+struct PkGraphicsPacketQueue
+{
+    std::atomic<uint32_t> pushedCount{ 0 };
+    std::atomic<uint32_t> poppedCount{ 0 };
+    uint32_t packetIndices[PACKET_COUNT];
+};
+
+struct PkGraphicsRenderThreadData
+{
+    bool bThreaded = false;
+    PkGraphicsRenderFunc renderFunc;
+    std::thread thread;
+
+    PkGraphicsFramePacket packets[PACKET_COUNT];
+    PkGraphicsPacketQueue submittedPackets;
+    PkGraphicsPacketQueue freePackets;
+
+    // Game thread only.
+    uint32_t currentPacketIndex = 0;
+    uint64_t submittedPacketCount = 0;
+    float gameWaitMilliseconds = 0.0f;
+
+    // Raised by the render thread each time it is ready for another packet.
+    std::atomic<uint64_t> requestedPacketCount{ 0 };
+
+    // Only for sleeping while there is nothing to take off a queue; the queues themselves take no lock.
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    std::atomic<bool> bQuit{ false };
+    // Set once the render thread has stopped on an exception, which is then rethrown on the game thread.
+    std::atomic<bool> bFailed{ false };
+    std::exception_ptr pException;
+
+    std::atomic<float> renderWaitMilliseconds{ 0.0f };
+    std::atomic<float> renderMilliseconds{ 0.0f };
+};
+
+static PkGraphicsRenderThreadData* s_pData = nullptr;
+
+static float getMilliseconds(const PkGraphicsRenderThreadTime& rStart)
+{
+    return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - rStart).count();
+}
+
+static bool tryPush(PkGraphicsPacketQueue& rQueue, const uint32_t packetIndex)
+{
+    const uint32_t pushedCount = rQueue.pushedCount.load(std::memory_order_relaxed);
+
+    if (pushedCount - rQueue.poppedCount.load(std::memory_order_acquire) == PACKET_COUNT)
+    {
+        return false;
+    }
+
+    rQueue.packetIndices[pushedCount % PACKET_COUNT] = packetIndex;
+    rQueue.pushedCount.store(pushedCount + 1, std::memory_order_release);
+    return true;
+}
+
+static bool tryPop(PkGraphicsPacketQueue& rQueue, uint32_t& rPacketIndex)
+{
+    const uint32_t poppedCount = rQueue.poppedCount.load(std::memory_order_relaxed);
+
+    if (poppedCount == rQueue.pushedCount.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    rPacketIndex = rQueue.packetIndices[poppedCount % PACKET_COUNT];
+    rQueue.poppedCount.store(poppedCount + 1, std::memory_order_release);
+    return true;
+}
+
+// Taking the lock between changing the state and notifying means a waiter can't miss the change.
+static void wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_pData->wakeMutex);
+    }
+    s_pData->wakeCondition.notify_all();
+}
+
+// Sleeps until the condition holds or the render thread has failed.
+template<typename Condition>
+static void waitUntil(Condition condition)
+{
+    std::unique_lock<std::mutex> lock(s_pData->wakeMutex);
+    s_pData->wakeCondition.wait(lock, [&condition] { return condition() || s_pData->bFailed.load(); });
+}
+
+static void rethrowIfFailed()
+{
+    if (s_pData->bFailed.load())
+    {
+        std::rethrow_exception(s_pData->pException);
+    }
+}
+
+static void renderThreadMain()
+{
+    // Culling and command recording queue jobs from this thread.
+    PkJobSystem::RegisterThread("Render");
+
+    while (true)
+    {
+        s_pData->requestedPacketCount.fetch_add(1);
+        wake();
+
+        const PkGraphicsRenderThreadTime waitStartTime = std::chrono::high_resolution_clock::now();
+
+        // Packets already submitted are still rendered after a quit.
+        uint32_t packetIndex = 0;
+        bool bPopped = false;
+        {
+            std::unique_lock<std::mutex> lock(s_pData->wakeMutex);
+            s_pData->wakeCondition.wait(lock, [&packetIndex, &bPopped]
+            {
+                bPopped = tryPop(s_pData->submittedPackets, packetIndex);
+                return bPopped || s_pData->bQuit.load();
+            });
+        }
+
+        if (!bPopped)
+        {
+            return;
+        }
+
+        s_pData->renderWaitMilliseconds = getMilliseconds(waitStartTime);
+
+        const PkGraphicsRenderThreadTime renderStartTime = std::chrono::high_resolution_clock::now();
+
+        try
+        {
+            s_pData->renderFunc(s_pData->packets[packetIndex]);
+        }
+        catch (...)
+        {
+            s_pData->pException = std::current_exception();
+            s_pData->bFailed = true;
+            wake();
+            return;
+        }
+
+        s_pData->renderMilliseconds = getMilliseconds(renderStartTime);
+
+        tryPush(s_pData->freePackets, packetIndex);
+        wake();
+    }
+}
+
+/*static*/ bool PkGraphicsRenderThread::IsThreaded()
+{
+    return s_pData->bThreaded;
+}
+
+/*static*/ PkGraphicsFramePacket& PkGraphicsRenderThread::AcquirePacket(const bool bWaitForRenderer)
+{
+    if (!s_pData->bThreaded)
+    {
+        return s_pData->packets[0];
+    }
+
+    const PkGraphicsRenderThreadTime waitStartTime = std::chrono::high_resolution_clock::now();
+
+    if (bWaitForRenderer)
+    {
+        waitUntil([] { return s_pData->requestedPacketCount.load() > s_pData->submittedPacketCount; });
+    }
+
+    uint32_t packetIndex = 0;
+    waitUntil([&packetIndex] { return tryPop(s_pData->freePackets, packetIndex); });
+
+    rethrowIfFailed();
+
+    s_pData->gameWaitMilliseconds = getMilliseconds(waitStartTime);
+    s_pData->currentPacketIndex = packetIndex;
+
+    return s_pData->packets[packetIndex];
+}
+
+/*static*/ void PkGraphicsRenderThread::SubmitPacket()
+{
+    if (!s_pData->bThreaded)
+    {
+        s_pData->renderFunc(s_pData->packets[0]);
+        return;
+    }
+
+    rethrowIfFailed();
+
+    // Can't fail: there are only as many packets as the queue holds.
+    tryPush(s_pData->submittedPackets, s_pData->currentPacketIndex);
+    s_pData->submittedPacketCount++;
+    wake();
+}
+
+/*static*/ void PkGraphicsRenderThread::WaitUntilIdle()
+{
+    if (!s_pData->bThreaded)
+    {
+        return;
+    }
+
+    waitUntil([] { return s_pData->requestedPacketCount.load() > s_pData->submittedPacketCount; });
+
+    rethrowIfFailed();
+}
+
+/*static*/ void PkGraphicsRenderThread::ShowDebugUi()
+{
+    if (ImGui::CollapsingHeader("Render thread"))
+    {
+        if (!s_pData->bThreaded)
+        {
+            ImGui::Text("Rendering on the game thread");
+            return;
+        }
+
+        ImGui::Text("Game thread waited for a packet: %.2f ms", s_pData->gameWaitMilliseconds);
+        ImGui::Text("Render thread waited for a packet: %.2f ms", s_pData->renderWaitMilliseconds.load());
+        ImGui::Text("Render thread frame: %.2f ms", s_pData->renderMilliseconds.load());
+    }
+}
+
+/*static*/ void PkGraphicsRenderThread::InitialiseGraphicsRenderThread(const bool bThreaded, PkGraphicsRenderFunc renderFunc)
+{
+    s_pData = new PkGraphicsRenderThreadData();
+    s_pData->bThreaded = bThreaded;
+    s_pData->renderFunc = renderFunc;
+
+    if (bThreaded)
+    {
+        for (uint32_t i = 0; i < PACKET_COUNT; i++)
+        {
+            tryPush(s_pData->freePackets, i);
+        }
+
+        s_pData->thread = std::thread(renderThreadMain);
+    }
+}
+
+/*static*/ void PkGraphicsRenderThread::CleanupGraphicsRenderThread()
+{
+    if (s_pData->thread.joinable())
+    {
+        s_pData->bQuit = true;
+        wake();
+        s_pData->thread.join();
+    }
+
+    for (PkGraphicsFramePacket& rPacket : s_pData->packets)
+    {
+        PkGraphicsRenderPassImgui::ClearDrawData(rPacket.uiDrawData);
+    }
+
+    delete s_pData;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "graphics/graphicsCommands.h"
+#include "graphics/graphicsFrameSync.h"
+#include "graphics/graphicsLatency.h"
+#include "graphics/graphicsRenderGraph.h"
+#include "graphics/graphicsRenderPassImgui.h"
+#include "graphics/graphicsRenderPassScene.h"
+
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+
+// Renderer state for the debug UI, captured by the render thread once it has rendered a packet.
+struct PkGraphicsDebugState
+{
+    PkGraphicsFrameSyncDebugState frameSync;
+    PkGraphicsLatencyDebugState latency;
+    PkGraphicsRenderGraphDebugState renderGraph;
+    PkGraphicsRenderPassSceneDebugState scene;
+};
+
+// Everything the renderer needs from one game frame. The game thread fills it in; once submitted it belongs to the
+// render thread until it is handed back. The packet is the only way state passes between the two threads.
+struct PkGraphicsFramePacket
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> inputTime;
+    VkExtent2D framebufferExtent{ 0, 0 };
+
+    glm::mat4 viewMatrix = glm::mat4(1.0f);
+    float fieldOfView = 45.0f;
+
+    // The scene is advanced by this many fixed steps, then drawn the given fraction of the way through the next.
+    uint32_t simulationStepCount = 0;
+    float simulationStepTime = 0.0f;
+    float interpolation = 0.0f;
+
+    PkGraphicsImguiDrawData uiDrawData;
+
+    // Run on the render thread before the packet is rendered.
+    PkGraphicsCommandList commands;
+
+    // Written by the render thread after rendering the packet, for the game thread's next use of it.
+    PkGraphicsDebugState debugState;
+};
+
+typedef std::function<void(PkGraphicsFramePacket& rPacket)> PkGraphicsRenderFunc;
+
+// Runs the renderer on its own thread, fed by the game thread through two frame packets: one being filled while the
+// other is rendered. Packets pass between the threads on lock-free single-producer, single-consumer queues.
+class PkGraphicsRenderThread
+{
+public:
+    PkGraphicsRenderThread() = delete;
+
+    static bool IsThreaded();
+
+    // Game thread. Waits for a free packet; with bWaitForRenderer, also until the render thread has nothing left to
+    // do but wait for it, so the packet's input is as fresh as possible when it is rendered.
+    static PkGraphicsFramePacket& AcquirePacket(const bool bWaitForRenderer);
+    static void SubmitPacket();
+
+    // Game thread. Waits until every submitted packet has been rendered.
+    static void WaitUntilIdle();
+
+    static void ShowDebugUi();
+
+    // Without a thread, SubmitPacket renders the packet before returning.
+    static void InitialiseGraphicsRenderThread(const bool bThreaded, PkGraphicsRenderFunc renderFunc);
+    // Waits for submitted packets to be rendered, then stops the thread.
+    static void CleanupGraphicsRenderThread();
+};
@@ -0,0 +1,296 @@
+#include "graphicsShaders.h"
+
+#include "graphics/graphicsHash.h"
+#include "graphics/graphicsUtils.h"
+
+#include "imgui/imgui.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdint.h>
+
+static const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+
+static const std::chrono::milliseconds POLL_INTERVAL(250);
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+struct PkGraphicsShadersData
+{
+    std::string compilerPath;
+
+    // Guards everything below.
+    std::mutex mutex;
+    std::map<std::string, std::filesystem::file_time_type> watchedSources;
+    std::chrono::steady_clock::time_point lastPollTime;
+
+    // Cache paths being compiled. Pipelines sharing a shader load it from several compile threads at once, and all
+    // but the first wait here for its build rather than writing the same file alongside it.
+    std::set<std::string> compilingPaths;
+    std::condition_variable compiledCondition;
+
+    uint32_t cacheHitCount = 0;
+    uint32_t compiledCount = 0;
+    uint32_t failedCount = 0;
+    uint32_t removedCount = 0;
+    float compileMilliseconds = 0.0f;
+    std::string lastCompiledPath;
+    float lastCompileMilliseconds = 0.0f;
+};
+
+static PkGraphicsShadersData* s_pData = nullptr;
+
+static std::string findCompiler()
+{
+    // The SDK installers set VULKAN_SDK; otherwise glslc has to be on the path.
+    const char* pSdkPath = std::getenv("VULKAN_SDK");
+
+    if (pSdkPath != nullptr)
+    {
+#ifdef _WIN32
+        const std::filesystem::path compilerPath = std::filesystem::path(pSdkPath) / "Bin" / "glslc.exe";
+#else
+        const std::filesystem::path compilerPath = std::filesystem::path(pSdkPath) / "bin" / "glslc";
+#endif
+        if (std::filesystem::exists(compilerPath))
+        {
+            return compilerPath.string();
+        }
+    }
+
+    return "glslc";
+}
+
+static std::string getHashText(const uint64_t hash)
+{
+    char hashText[17];
+    snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(hash));
+    return hashText;
+}
+
+// Every build of one source with one set of defines shares a prefix, so older builds of it can be found and removed.
+static std::string getCachePrefix(const std::string& rSourcePath, const uint64_t variantHash)
+{
+    return std::filesystem::path(rSourcePath).filename().string() + "." + getHashText(variantHash) + ".";
+}
+
+static std::string getCachePath(const std::string& rPrefix, const uint64_t hash)
+{
+    return (std::filesystem::path(SHADER_CACHE_DIRECTORY) / (rPrefix + getHashText(hash) + ".spv")).string();
+}
+
+// Returns how many builds were removed.
+static uint32_t removeOlderBuilds(const std::string& rPrefix, const std::string& rCachePath)
+{
+    uint32_t removedCount = 0;
+    std::error_code error;
+
+    for (const std::filesystem::directory_entry& rEntry : std::filesystem::directory_iterator(SHADER_CACHE_DIRECTORY, error))
+    {
+        const std::string fileName = rEntry.path().filename().string();
+
+        if (fileName.compare(0, rPrefix.size(), rPrefix) == 0 && rEntry.path().extension() == ".spv" &&
+            rEntry.path() != std::filesystem::path(rCachePath) && std::filesystem::remove(rEntry.path(), error))
+        {
+            removedCount++;
+        }
+    }
+
+    return removedCount;
+}
+
+static bool isSpirvFile(const std::string& rPath)
+{
+    std::ifstream file(rPath, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const std::streamoff size = file.tellg();
+    uint32_t magic = 0;
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+
+    return file && size % sizeof(uint32_t) == 0 && magic == SPIRV_MAGIC;
+}
+
+// glslc writes errors to stderr itself, so a failure only needs reporting as such.
+static bool compile(const std::string& rSourcePath, const std::vector<std::string>& rDefines, const std::string& rOutputPath)
+{
+    // Written next to the final file and renamed, so a build cut short never looks like a cached one.
+    const std::string tempPath = rOutputPath + ".tmp";
+
+    std::ostringstream command;
+    command << "\"" << s_pData->compilerPath << "\"";
+    for (const std::string& rDefine : rDefines)
+    {
+        command << " -D" << rDefine;
+    }
+    command << " \"" << rSourcePath << "\" -o \"" << tempPath << "\"";
+
+#ifdef _WIN32
+    // cmd.exe strips the outer quotes of a command line that starts with one.
+    const std::string commandLine = "\"" + command.str() + "\"";
+#else
+    const std::string commandLine = command.str();
+#endif
+
+    if (std::system(commandLine.c_str()) != 0 || !isSpirvFile(tempPath))
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, rOutputPath, error);
+    return !error;
+}
+
+static void watchSource(const std::string& rSourcePath)
+{
+    std::error_code error;
+    const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(rSourcePath, error);
+
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+    s_pData->watchedSources.emplace(rSourcePath, writeTime);
+}
+
+/*static*/ std::vector<char> PkGraphicsShaders::LoadSpirv(const std::string& rSourcePath, const std::vector<std::string>& rDefines)
+{
+    const std::vector<char> source = PkGraphicsUtils::ReadFile(rSourcePath);
+
+    // Which source and defines a build is for; the build itself is then named by a hash of everything that goes in.
+    uint64_t variantHash = PkHashBytes(PK_HASH_OFFSET_BASIS, rSourcePath.c_str(), rSourcePath.size() + 1);
+    uint64_t hash = PkHashBytes(PK_HASH_OFFSET_BASIS, source.data(), source.size());
+    for (const std::string& rDefine : rDefines)
+    {
+        variantHash = PkHashBytes(variantHash, rDefine.c_str(), rDefine.size() + 1);
+        hash = PkHashBytes(hash, rDefine.c_str(), rDefine.size() + 1);
+    }
+
+    const std::string cachePrefix = getCachePrefix(rSourcePath, variantHash);
+    const std::string cachePath = getCachePath(cachePrefix, hash);
+
+    bool bCompile = false;
+    {
+        std::unique_lock<std::mutex> lock(s_pData->mutex);
+        s_pData->compiledCondition.wait(lock, [&cachePath] { return s_pData->compilingPaths.count(cachePath) == 0; });
+
+        if (std::filesystem::exists(cachePath))
+        {
+            s_pData->cacheHitCount++;
+        }
+        else
+        {
+            s_pData->compilingPaths.insert(cachePath);
+            bCompile = true;
+        }
+    }
+
+    if (bCompile)
+    {
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        const bool bCompiled = compile(rSourcePath, rDefines, cachePath);
+        const float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        // Only the newest build of a source is ever loaded again.
+        const uint32_t removedCount = bCompiled ? removeOlderBuilds(cachePrefix, cachePath) : 0;
+
+        {
+            std::lock_guard<std::mutex> lock(s_pData->mutex);
+            s_pData->compilingPaths.erase(cachePath);
+
+            if (bCompiled)
+            {
+                s_pData->compiledCount++;
+                s_pData->removedCount += removedCount;
+                s_pData->compileMilliseconds += milliseconds;
+                s_pData->lastCompiledPath = rSourcePath;
+                s_pData->lastCompileMilliseconds = milliseconds;
+            }
+            else
+            {
+                s_pData->failedCount++;
+            }
+        }
+        s_pData->compiledCondition.notify_all();
+
+        // Threads that waited for this build find no file and try it themselves, reporting the same error.
+        if (!bCompiled)
+        {
+            throw std::runtime_error("failed to compile shader!");
+        }
+    }
+
+    watchSource(rSourcePath);
+
+    return PkGraphicsUtils::ReadFile(cachePath);
+}
+
+/*static*/ std::vector<std::string> PkGraphicsShaders::PollChangedSources()
+{
+    std::vector<std::string> changedSources;
+
+    std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - s_pData->lastPollTime < POLL_INTERVAL)
+    {
+        return changedSources;
+    }
+    s_pData->lastPollTime = now;
+
+    for (auto& rSource : s_pData->watchedSources)
+    {
+        // An editor may be part way through saving; the file is looked at again next time.
+        std::error_code error;
+        const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(rSource.first, error);
+
+        if (!error && writeTime != rSource.second)
+        {
+            rSource.second = writeTime;
+            changedSources.push_back(rSource.first);
+        }
+    }
+
+    return changedSources;
+}
+
+/*static*/ void PkGraphicsShaders::ShowDebugUi()
+{
+    if (ImGui::CollapsingHeader("Shaders"))
+    {
+        std::lock_guard<std::mutex> lock(s_pData->mutex);
+
+        ImGui::Text("Compiled: %u in %.2f ms, failed: %u", s_pData->compiledCount, s_pData->compileMilliseconds, s_pData->failedCount);
+        ImGui::Text("Cache hits: %u, old builds removed: %u", s_pData->cacheHitCount, s_pData->removedCount);
+        ImGui::Text("Watching %u sources", static_cast<uint32_t>(s_pData->watchedSources.size()));
+
+        if (!s_pData->lastCompiledPath.empty())
+        {
+            ImGui::Text("Last compiled: %s in %.2f ms", s_pData->lastCompiledPath.c_str(), s_pData->lastCompileMilliseconds);
+        }
+    }
+}
+
+/*static*/ void PkGraphicsShaders::InitialiseGraphicsShaders()
+{
+    s_pData = new PkGraphicsShadersData();
+    s_pData->compilerPath = findCompiler();
+
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY);
+}
+
+/*static*/ void PkGraphicsShaders::CleanupGraphicsShaders()
+{
+    delete s_pData;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// GLSL sources compiled to SPIR-V at runtime with the Vulkan SDK's glslc. Builds are kept on disk keyed by a hash of the
+// source and its defines, so a source is only compiled again once its contents change; older builds of it are removed.
+class PkGraphicsShaders
+{
+public:
+    PkGraphicsShaders() = delete;
+
+    // Safe to call from any thread. Throws if the source has no cached build and can't be compiled.
+    static std::vector<char> LoadSpirv(const std::string& rSourcePath, const std::vector<std::string>& rDefines = {});
+
+    // Sources loaded so far whose files have been written since they were last checked. Checks the disk at most a few
+    // times a second, so it can be called every frame.
+    static std::vector<std::string> PollChangedSources();
+
+    static void ShowDebugUi();
+
+    static void InitialiseGraphicsShaders();
+    static void CleanupGraphicsShaders();
+};
@@ -0,0 +1,62 @@
+#include "graphicsSimd.h"
+
+#if PK_SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static PkSimdInstructionSet detectInstructionSet()
+{
+#if PK_SIMD_X86
+#if defined(_MSC_VER)
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+    const int maxLeaf = cpuInfo[0];
+
+    __cpuid(cpuInfo, 1);
+    const bool bOsXsave = (cpuInfo[2] & (1 << 27)) != 0;
+    const bool bAvx = (cpuInfo[2] & (1 << 28)) != 0;
+
+    bool bAvx2 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(cpuInfo, 7, 0);
+        bAvx2 = (cpuInfo[1] & (1 << 5)) != 0;
+    }
+
+    // The OS must also save the upper halves of the YMM registers on a context switch.
+    const bool bYmmEnabled = bOsXsave && (_xgetbv(0) & 0x6) == 0x6;
+
+    if (bAvx && bAvx2 && bYmmEnabled)
+    {
+        return PkSimdInstructionSet::Avx2;
+    }
+#else
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return PkSimdInstructionSet::Avx2;
+    }
+#endif
+    return PkSimdInstructionSet::Sse;
+#else
+    return PkSimdInstructionSet::Scalar;
+#endif
+}
+
+/*static*/ PkSimdInstructionSet PkGraphicsSimd::GetInstructionSet()
+{
+    static const PkSimdInstructionSet s_instructionSet = detectInstructionSet();
+    return s_instructionSet;
+}
+
+/*static*/ const char* PkGraphicsSimd::GetInstructionSetName()
+{
+    switch (GetInstructionSet())
+    {
+    case PkSimdInstructionSet::Avx2:
+        return "AVX2";
+    case PkSimdInstructionSet::Sse:
+        return "SSE";
+    default:
+        return "scalar";
+    }
+}
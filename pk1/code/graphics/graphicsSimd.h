@@ -0,0 +1,34 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PK_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define PK_SIMD_X86 0
+#endif
+
+// MSVC compiles AVX intrinsics without /arch:AVX2; GCC and Clang need the function marked for the target instead.
+#if PK_SIMD_X86 && !defined(_MSC_VER)
+#define PK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PK_TARGET_AVX2
+#endif
+
+enum class PkSimdInstructionSet
+{
+    Scalar,
+    Sse,
+    Avx2
+};
+
+class PkGraphicsSimd
+{
+public:
+    PkGraphicsSimd() = delete;
+
+    // The widest instruction set the CPU and OS support, detected once.
+    static PkSimdInstructionSet GetInstructionSet();
+
+    // "AVX2", "SSE" or "scalar".
+    static const char* GetInstructionSetName();
+};
@@ -3,12 +3,18 @@
 #include "graphics/graphicsCore.h"
 #include "graphics/graphicsUtils.h"
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
+#include <algorithm>
 #include <iostream>
 #include <array>
 
+// A swap chain replaced by a resize. Presents queued to it may still be pending, so it lives on for a few frames.
+struct PkGraphicsRetiredSwapChain
+{
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    std::vector<VkImageView> swapChainImageViews;
+    uint64_t retiredFrameNumber = 0;
+};
+
 struct PkGraphicsSwapChainData
 {
     VkSwapchainKHR swapChain = VK_NULL_HANDLE;
@@ -17,6 +23,17 @@ struct PkGraphicsSwapChainData
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
     VkFormat swapChainImageFormat = VK_FORMAT_UNDEFINED;
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+    std::vector<VkPresentModeKHR> availablePresentModes;
+    uint32_t minImageCount = 0;
+    uint32_t maxImageCount = 0;
+
+    VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    uint32_t requestedImageCount = 0;
+    bool bRecreationRequested = false;
+
+    std::vector<PkGraphicsRetiredSwapChain> retiredSwapChains;
 };
 
 static PkGraphicsSwapChainData* s_pData = nullptr;
@@ -36,17 +53,33 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
 
 VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
-    for (const auto& availablePresentMode : availablePresentModes)
+    for (const VkPresentModeKHR preferredPresentMode : { s_pData->requestedPresentMode, VK_PRESENT_MODE_MAILBOX_KHR })
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        for (const auto& availablePresentMode : availablePresentModes)
         {
-            return availablePresentMode;
+            if (availablePresentMode == preferredPresentMode)
+            {
+                return availablePresentMode;
+            }
         }
     }
 
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t chooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities)
+{
+    uint32_t imageCount = s_pData->requestedImageCount > 0 ? s_pData->requestedImageCount : capabilities.minImageCount + 1;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
+    {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 {
     if (capabilities.currentExtent.width != UINT32_MAX)
@@ -55,14 +88,7 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
     }
     else
     {
-        int width, height;
-        glfwGetFramebufferSize(PkGraphicsCore::GetWindow(), &width, &height);
-
-        VkExtent2D actualExtent =
-        {
-            static_cast<uint32_t>(width),
-            static_cast<uint32_t>(height)
-        };
+        VkExtent2D actualExtent = PkGraphicsCore::GetFramebufferExtent();
 
         actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
         actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
@@ -86,6 +112,11 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
     return static_cast<uint32_t>(s_pData->swapChainImageViews.size());
 }
 
+/*static*/ VkImage PkGraphicsSwapChain::GetSwapChainImage(const uint32_t imageIndex)
+{
+    return s_pData->swapChainImages[imageIndex];
+}
+
 /*static*/ VkImageView PkGraphicsSwapChain::GetSwapChainImageView(const uint32_t imageIndex)
 {
     return s_pData->swapChainImageViews[imageIndex];
@@ -96,21 +127,73 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
     return s_pData->swapChainImageFormat;
 }
 
-/*static*/ void PkGraphicsSwapChain::InitialiseGraphicsSwapChain()
+/*static*/ VkPresentModeKHR PkGraphicsSwapChain::GetPresentMode()
 {
-    s_pData = new PkGraphicsSwapChainData();
+    return s_pData->presentMode;
+}
+
+/*static*/ const std::vector<VkPresentModeKHR>& PkGraphicsSwapChain::GetAvailablePresentModes()
+{
+    return s_pData->availablePresentModes;
+}
+
+/*static*/ uint32_t PkGraphicsSwapChain::GetMinImageCount()
+{
+    return s_pData->minImageCount;
+}
+
+/*static*/ uint32_t PkGraphicsSwapChain::GetMaxImageCount()
+{
+    return s_pData->maxImageCount;
+}
+
+/*static*/ VkPresentModeKHR PkGraphicsSwapChain::GetRequestedPresentMode()
+{
+    return s_pData->requestedPresentMode;
+}
+
+/*static*/ void PkGraphicsSwapChain::SetRequestedPresentMode(const VkPresentModeKHR presentMode)
+{
+    if (presentMode != s_pData->requestedPresentMode)
+    {
+        s_pData->requestedPresentMode = presentMode;
+        s_pData->bRecreationRequested = true;
+    }
+}
 
+/*static*/ uint32_t PkGraphicsSwapChain::GetRequestedImageCount()
+{
+    return s_pData->requestedImageCount;
+}
+
+/*static*/ void PkGraphicsSwapChain::SetRequestedImageCount(const uint32_t imageCount)
+{
+    if (imageCount != s_pData->requestedImageCount)
+    {
+        s_pData->requestedImageCount = imageCount;
+        s_pData->bRecreationRequested = true;
+    }
+}
+
+/*static*/ bool PkGraphicsSwapChain::IsRecreationRequested()
+{
+    return s_pData->bRecreationRequested;
+}
+
+static void createSwapChain(VkSwapchainKHR oldSwapChain)
+{
     PkGraphicsSwapChainSupport swapChainSupport = PkGraphicsUtils::QuerySwapChainSupport(PkGraphicsCore::GetPhysicalDevice(), PkGraphicsCore::GetSurface());
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount)
-    {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    uint32_t imageCount = chooseSwapImageCount(swapChainSupport.capabilities);
+
+    s_pData->availablePresentModes = swapChainSupport.presentModes;
+    s_pData->minImageCount = swapChainSupport.capabilities.minImageCount;
+    s_pData->maxImageCount = swapChainSupport.capabilities.maxImageCount;
+    s_pData->bRecreationRequested = false;
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -141,6 +224,7 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = oldSwapChain;
 
     if (vkCreateSwapchainKHR(PkGraphicsCore::GetDevice(), &createInfo, nullptr, &s_pData->swapChain) != VK_SUCCESS)
     {
@@ -153,6 +237,7 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
 
     s_pData->swapChainImageFormat = surfaceFormat.format;
     s_pData->swapChainExtent = extent;
+    s_pData->presentMode = presentMode;
 
     s_pData->swapChainImageViews.resize(s_pData->swapChainImages.size());
     for (uint32_t i = 0; i < s_pData->swapChainImages.size(); i++)
@@ -161,14 +246,56 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
     }
 }
 
-/*static*/ void PkGraphicsSwapChain::CleanupGraphicsSwapChain()
+static void destroySwapChain(VkSwapchainKHR swapChain, const std::vector<VkImageView>& rSwapChainImageViews)
 {
-    for (VkImageView imageView : s_pData->swapChainImageViews)
+    for (VkImageView imageView : rSwapChainImageViews)
     {
         vkDestroyImageView(PkGraphicsCore::GetDevice(), imageView, nullptr);
     }
 
-    vkDestroySwapchainKHR(PkGraphicsCore::GetDevice(), s_pData->swapChain, nullptr);
+    vkDestroySwapchainKHR(PkGraphicsCore::GetDevice(), swapChain, nullptr);
+}
+
+/*static*/ void PkGraphicsSwapChain::RecreateGraphicsSwapChain(const uint64_t frameNumber)
+{
+    PkGraphicsRetiredSwapChain retired{};
+    retired.swapChain = s_pData->swapChain;
+    retired.swapChainImageViews = s_pData->swapChainImageViews;
+    retired.retiredFrameNumber = frameNumber;
+
+    createSwapChain(retired.swapChain);
+
+    s_pData->retiredSwapChains.push_back(retired);
+}
+
+/*static*/ void PkGraphicsSwapChain::DestroyRetiredSwapChains(const uint64_t completedFrameNumber)
+{
+    auto it = s_pData->retiredSwapChains.begin();
+
+    while (it != s_pData->retiredSwapChains.end())
+    {
+        if (it->retiredFrameNumber <= completedFrameNumber)
+        {
+            destroySwapChain(it->swapChain, it->swapChainImageViews);
+            it = s_pData->retiredSwapChains.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/*static*/ void PkGraphicsSwapChain::InitialiseGraphicsSwapChain()
+{
+    s_pData = new PkGraphicsSwapChainData();
+    createSwapChain(VK_NULL_HANDLE);
+}
+
+/*static*/ void PkGraphicsSwapChain::CleanupGraphicsSwapChain()
+{
+    DestroyRetiredSwapChains(UINT64_MAX);
+    destroySwapChain(s_pData->swapChain, s_pData->swapChainImageViews);
 
     delete s_pData;
 }
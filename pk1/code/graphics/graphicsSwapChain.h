@@ -2,6 +2,8 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <vector>
+
 class PkGraphicsSwapChain
 {
 public:
@@ -11,8 +13,30 @@ public:
 	static VkExtent2D GetSwapChainExtent();
 
 	static uint32_t GetNumSwapChainImages();
+	static VkImage GetSwapChainImage(const uint32_t imageIndex);
 	static VkImageView GetSwapChainImageView(const uint32_t imageIndex);
 	static VkFormat GetSwapChainImageFormat();
+	static VkPresentModeKHR GetPresentMode();
+
+	// What the surface allows, as of the last time the swap chain was created.
+	static const std::vector<VkPresentModeKHR>& GetAvailablePresentModes();
+	static uint32_t GetMinImageCount();
+	static uint32_t GetMaxImageCount();
+
+	// Settings for the swap chains created from now on. An unavailable present mode falls back to MAILBOX and then FIFO;
+	// an image count of 0 asks for one more than the minimum. A change asks for the swap chain to be recreated.
+	static VkPresentModeKHR GetRequestedPresentMode();
+	static void SetRequestedPresentMode(const VkPresentModeKHR presentMode);
+	static uint32_t GetRequestedImageCount();
+	static void SetRequestedImageCount(const uint32_t imageCount);
+	static bool IsRecreationRequested();
+
+	// Creates a new swap chain from the current one, which is retired rather than destroyed: presents to it may still be
+	// queued. Every image view handed out before the call belongs to the retired swap chain.
+	static void RecreateGraphicsSwapChain(const uint64_t frameNumber);
+
+	// Destroys swap chains retired on or before the given frame, once the caller knows their presents are done with.
+	static void DestroyRetiredSwapChains(const uint64_t completedFrameNumber);
 
 	static void InitialiseGraphicsSwapChain();
 	static void CleanupGraphicsSwapChain();
@@ -1,6 +1,7 @@
 #include "graphicsUtils.h"
 
 #include <iostream>
+#include <fstream>
 
 /*static*/ PkGraphicsSwapChainSupport PkGraphicsUtils::QuerySwapChainSupport(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
 {
@@ -122,3 +123,81 @@
 
     vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
+
+/*static*/ void PkGraphicsUtils::CreateBuffer(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? VMA_MEMORY_USAGE_CPU_TO_GPU : VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = properties;
+
+    if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, pBuffer, pBufferAllocation, nullptr) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create buffer!");
+    }
+}
+
+/*static*/ void PkGraphicsUtils::CreateDeviceLocalBuffer(VkDevice device, VmaAllocator allocator, VkQueue queue, VkCommandPool commandPool, const void* pData, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation)
+{
+    VkBuffer stagingBuffer;
+    VmaAllocation stagingBufferAllocation;
+    CreateBuffer(allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferAllocation);
+
+    void* data;
+    vmaMapMemory(allocator, stagingBufferAllocation, &data);
+    memcpy(data, pData, static_cast<size_t>(size));
+    vmaUnmapMemory(allocator, stagingBufferAllocation);
+
+    CreateBuffer(allocator, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pBuffer, pBufferAllocation);
+
+    VkCommandBuffer commandBuffer = BeginSingleTimeCommands(device, commandPool);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, *pBuffer, 1, &copyRegion);
+
+    EndSingleTimeCommands(device, queue, commandPool, commandBuffer);
+
+    vmaDestroyBuffer(allocator, stagingBuffer, stagingBufferAllocation);
+}
+
+/*static*/ std::vector<char> PkGraphicsUtils::ReadFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open file!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+
+    file.close();
+
+    return buffer;
+}
+
+/*static*/ VkShaderModule PkGraphicsUtils::CreateShaderModule(VkDevice device, const std::vector<char>& code)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    return shaderModule;
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <vulkan/vulkan_core.h>
+#include <vk_mem_alloc.h>
 
+#include <string>
 #include <vector>
 #include <optional>
 
@@ -36,4 +38,10 @@ public:
 
     static VkCommandBuffer BeginSingleTimeCommands(VkDevice device, VkCommandPool commandPool);
     static void EndSingleTimeCommands(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkCommandBuffer commandBuffer);
+
+    static void CreateBuffer(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation);
+    static void CreateDeviceLocalBuffer(VkDevice device, VmaAllocator allocator, VkQueue queue, VkCommandPool commandPool, const void* pData, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* pBuffer, VmaAllocation* pBufferAllocation);
+
+    static std::vector<char> ReadFile(const std::string& filename);
+    static VkShaderModule CreateShaderModule(VkDevice device, const std::vector<char>& code);
 };
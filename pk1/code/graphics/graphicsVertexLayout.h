@@ -0,0 +1,227 @@
+#pragma once
+
+#include "graphics/graphicsHash.h"
+
+#include <vulkan/vulkan_core.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <array>
+#include <cstddef>
+#include <stdint.h>
+
+// One field of a vertex struct: where it is, how the GPU reads it, and how many shader locations it takes.
+struct PkGraphicsVertexField
+{
+    uint32_t offset;
+    VkFormat format;
+    uint32_t locationCount;
+};
+
+// One vertex buffer binding and the attributes read from it, with locations counted from the stream's first.
+struct PkGraphicsVertexStream
+{
+    uint32_t stride;
+    VkVertexInputRate inputRate;
+    const VkVertexInputAttributeDescription* pAttributes;
+    uint32_t attributeCount;
+    uint64_t layoutHash;
+};
+
+// 0 for formats vertex input doesn't use.
+constexpr uint32_t pkGraphicsGetVertexFormatSize(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SNORM:
+    case VK_FORMAT_R16G16_UINT:
+    case VK_FORMAT_R16G16_SINT:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_UINT:
+        return 4;
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SNORM:
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT:
+    case VK_FORMAT_R32G32B32_SINT:
+    case VK_FORMAT_R32G32B32_UINT:
+        return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// The format a field of type T is read with. Types without a specialisation can't be used in a vertex layout.
+template<typename T>
+struct PkGraphicsVertexFormat;
+
+template<VkFormat Format, uint32_t LocationCount = 1>
+struct PkGraphicsVertexFormatOf
+{
+    static constexpr VkFormat format = Format;
+    static constexpr uint32_t locationCount = LocationCount;
+};
+
+template<> struct PkGraphicsVertexFormat<float> : PkGraphicsVertexFormatOf<VK_FORMAT_R32_SFLOAT> {};
+template<> struct PkGraphicsVertexFormat<glm::vec2> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32_SFLOAT> {};
+template<> struct PkGraphicsVertexFormat<glm::vec3> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32_SFLOAT> {};
+template<> struct PkGraphicsVertexFormat<glm::vec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32A32_SFLOAT> {};
+template<> struct PkGraphicsVertexFormat<int32_t> : PkGraphicsVertexFormatOf<VK_FORMAT_R32_SINT> {};
+template<> struct PkGraphicsVertexFormat<glm::ivec2> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32_SINT> {};
+template<> struct PkGraphicsVertexFormat<glm::ivec3> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32_SINT> {};
+template<> struct PkGraphicsVertexFormat<glm::ivec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32A32_SINT> {};
+template<> struct PkGraphicsVertexFormat<uint32_t> : PkGraphicsVertexFormatOf<VK_FORMAT_R32_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::uvec2> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::uvec3> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::uvec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32A32_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::u8vec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R8G8B8A8_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::i8vec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R8G8B8A8_SINT> {};
+template<> struct PkGraphicsVertexFormat<glm::u16vec2> : PkGraphicsVertexFormatOf<VK_FORMAT_R16G16_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::i16vec2> : PkGraphicsVertexFormatOf<VK_FORMAT_R16G16_SINT> {};
+template<> struct PkGraphicsVertexFormat<glm::u16vec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R16G16B16A16_UINT> {};
+template<> struct PkGraphicsVertexFormat<glm::i16vec4> : PkGraphicsVertexFormatOf<VK_FORMAT_R16G16B16A16_SINT> {};
+// A matrix takes one location per column.
+template<> struct PkGraphicsVertexFormat<glm::mat3> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32_SFLOAT, 3> {};
+template<> struct PkGraphicsVertexFormat<glm::mat4> : PkGraphicsVertexFormatOf<VK_FORMAT_R32G32B32A32_SFLOAT, 4> {};
+
+// The fields of a vertex struct, in shader location order. Specialised with PK_VERTEX_LAYOUT or PK_VERTEX_LAYOUT_PACKED.
+template<typename T>
+struct PkGraphicsVertexFields;
+
+template<typename... Fields>
+constexpr std::array<PkGraphicsVertexField, sizeof...(Fields)> pkGraphicsMakeVertexFields(const Fields&... rFields)
+{
+    return { { rFields... } };
+}
+
+#define PK_VERTEX_EXPAND(x) x
+#define PK_VERTEX_FIELD(Type, field) PkGraphicsVertexField{ static_cast<uint32_t>(offsetof(Type, field)), PkGraphicsVertexFormat<decltype(Type::field)>::format, PkGraphicsVertexFormat<decltype(Type::field)>::locationCount }
+#define PK_VERTEX_FIELDS_1(Type, a) PK_VERTEX_FIELD(Type, a)
+#define PK_VERTEX_FIELDS_2(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_1(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_3(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_2(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_4(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_3(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_5(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_4(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_6(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_5(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_7(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_6(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_8(Type, a, ...) PK_VERTEX_FIELD(Type, a), PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_7(Type, __VA_ARGS__))
+#define PK_VERTEX_FIELDS_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, NAME, ...) NAME
+#define PK_VERTEX_FIELDS(Type, ...) PK_VERTEX_EXPAND(PK_VERTEX_FIELDS_SELECT(__VA_ARGS__, PK_VERTEX_FIELDS_8, PK_VERTEX_FIELDS_7, PK_VERTEX_FIELDS_6, PK_VERTEX_FIELDS_5, PK_VERTEX_FIELDS_4, PK_VERTEX_FIELDS_3, PK_VERTEX_FIELDS_2, PK_VERTEX_FIELDS_1)(Type, __VA_ARGS__))
+
+// Declares a struct's vertex layout from up to eight of its fields, each read as its type's PkGraphicsVertexFormat.
+// Use at global scope after the struct: PK_VERTEX_LAYOUT(Vertex, pos, color, texCoord);
+#define PK_VERTEX_LAYOUT(Type, ...) \
+    template<> struct PkGraphicsVertexFields<Type> \
+    { \
+        static constexpr auto fields = pkGraphicsMakeVertexFields(PK_VERTEX_FIELDS(Type, __VA_ARGS__)); \
+    }
+
+// Declares a struct of quantised values as a single attribute of the given format, e.g. four 16 bit values read as a
+// normalised vec4. The format has to be exactly the struct's size.
+#define PK_VERTEX_LAYOUT_PACKED(Type, Format) \
+    static_assert(pkGraphicsGetVertexFormatSize(Format) == sizeof(Type), "packed vertex format must match the struct's size"); \
+    template<> struct PkGraphicsVertexFields<Type> \
+    { \
+        static constexpr auto fields = pkGraphicsMakeVertexFields(PkGraphicsVertexField{ 0, Format, 1 }); \
+    }
+
+// Everything derived from a vertex layout is worked out at compile time.
+class PkGraphicsVertexLayout
+{
+public:
+    PkGraphicsVertexLayout() = delete;
+
+    template<typename T>
+    static constexpr uint32_t GetLocationCount()
+    {
+        uint32_t locationCount = 0;
+        for (const PkGraphicsVertexField& rField : PkGraphicsVertexFields<T>::fields)
+        {
+            locationCount += rField.locationCount;
+        }
+        return locationCount;
+    }
+
+    // One description per location; fields that take several locations are split into columns.
+    template<typename T>
+    static constexpr std::array<VkVertexInputAttributeDescription, GetLocationCount<T>()> GetAttributeDescriptions(const uint32_t binding, const uint32_t firstLocation)
+    {
+        std::array<VkVertexInputAttributeDescription, GetLocationCount<T>()> attributeDescriptions{};
+
+        uint32_t location = 0;
+        for (const PkGraphicsVertexField& rField : PkGraphicsVertexFields<T>::fields)
+        {
+            for (uint32_t column = 0; column < rField.locationCount; column++)
+            {
+                attributeDescriptions[location].location = firstLocation + location;
+                attributeDescriptions[location].binding = binding;
+                attributeDescriptions[location].format = rField.format;
+                attributeDescriptions[location].offset = rField.offset + column * pkGraphicsGetVertexFormatSize(rField.format);
+                location++;
+            }
+        }
+
+        return attributeDescriptions;
+    }
+
+    // FNV-1a over the stride and every attribute, for pipeline keys.
+    template<typename T>
+    static constexpr uint64_t GetHash()
+    {
+        uint64_t hash = PK_HASH_OFFSET_BASIS;
+        hash = PkHashWord(hash, sizeof(T));
+
+        for (const PkGraphicsVertexField& rField : PkGraphicsVertexFields<T>::fields)
+        {
+            hash = PkHashWord(hash, rField.offset);
+            hash = PkHashWord(hash, static_cast<uint64_t>(rField.format));
+            hash = PkHashWord(hash, rField.locationCount);
+        }
+
+        return hash;
+    }
+
+    // Every field inside the struct and read with a format vertex input supports.
+    template<typename T>
+    static constexpr bool IsValid()
+    {
+        for (const PkGraphicsVertexField& rField : PkGraphicsVertexFields<T>::fields)
+        {
+            const uint32_t size = pkGraphicsGetVertexFormatSize(rField.format) * rField.locationCount;
+            if (size == 0 || rField.offset + size > sizeof(T))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    static PkGraphicsVertexStream GetStream(const VkVertexInputRate inputRate)
+    {
+        static_assert(IsValid<T>(), "vertex layout fields must lie within the struct");
+
+        return { static_cast<uint32_t>(sizeof(T)), inputRate, s_attributeDescriptions<T>.data(), static_cast<uint32_t>(s_attributeDescriptions<T>.size()), GetHash<T>() };
+    }
+
+private:
+    // Storage for the descriptions streams point to, relative to binding 0 and location 0.
+    template<typename T>
+    static constexpr std::array<VkVertexInputAttributeDescription, GetLocationCount<T>()> s_attributeDescriptions = GetAttributeDescriptions<T>(0, 0);
+};
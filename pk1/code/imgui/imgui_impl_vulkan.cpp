@@ -22,6 +22,8 @@
 
 // CHANGELOG
 // (minor and older changes stripped away, please see git history for details)
+//  (local)   Vulkan: Added ImGui_ImplVulkan_CreateMainPipeline() to rebuild the pipeline for a new render pass or attachment formats, following later upstream releases.
+//  (local)   Vulkan: Added support for VK_KHR_dynamic_rendering, following later upstream releases. Set ImGui_ImplVulkan_InitInfo::UseDynamicRendering and fill PipelineRenderingCreateInfo.
 //  2020-11-11: Vulkan: Added support for specifying which subpass to reference during VkPipeline creation.
 //  2020-09-07: Vulkan: Added VkPipeline parameter to ImGui_ImplVulkan_RenderDrawData (default to one passed to ImGui_ImplVulkan_Init).
 //  2020-05-04: Vulkan: Fixed crash if initial frame has no vertices.
@@ -778,6 +780,12 @@ static void ImGui_ImplVulkan_CreatePipeline(VkDevice device, const VkAllocationC
     info.layout = g_PipelineLayout;
     info.renderPass = renderPass;
     info.subpass = subpass;
+    if (g_VulkanInitInfo.UseDynamicRendering)
+    {
+        IM_ASSERT(g_VulkanInitInfo.PipelineRenderingCreateInfo.sType == VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR && "PipelineRenderingCreateInfo sType must be VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR");
+        info.pNext = &g_VulkanInitInfo.PipelineRenderingCreateInfo;
+        info.renderPass = VK_NULL_HANDLE; // Just make sure it's actually nullptr.
+    }
     VkResult err = vkCreateGraphicsPipelines(device, pipelineCache, 1, &info, allocator, pipeline);
     check_vk_result(err);
 }
@@ -900,7 +908,8 @@ bool    ImGui_ImplVulkan_Init(ImGui_ImplVulkan_InitInfo* info, VkRenderPass rend
     IM_ASSERT(info->DescriptorPool != VK_NULL_HANDLE);
     IM_ASSERT(info->MinImageCount >= 2);
     IM_ASSERT(info->ImageCount >= info->MinImageCount);
-    IM_ASSERT(render_pass != VK_NULL_HANDLE);
+    if (!info->UseDynamicRendering)
+        IM_ASSERT(render_pass != VK_NULL_HANDLE);
 
     g_VulkanInitInfo = *info;
     g_RenderPass = render_pass;
@@ -920,6 +929,27 @@ void ImGui_ImplVulkan_NewFrame()
 {
 }
 
+void ImGui_ImplVulkan_CreateMainPipeline(const ImGui_ImplVulkan_MainPipelineCreateInfo& info)
+{
+    ImGui_ImplVulkan_InitInfo* v = &g_VulkanInitInfo;
+    if (!v->UseDynamicRendering)
+        IM_ASSERT(info.RenderPass != VK_NULL_HANDLE);
+
+    if (g_Pipeline)
+    {
+        vkDestroyPipeline(v->Device, g_Pipeline, v->Allocator);
+        g_Pipeline = VK_NULL_HANDLE;
+    }
+
+    g_RenderPass = info.RenderPass;
+    g_Subpass = info.Subpass;
+    v->Subpass = info.Subpass;
+    v->MSAASamples = info.MSAASamples;
+    v->PipelineRenderingCreateInfo = info.PipelineRenderingCreateInfo;
+
+    ImGui_ImplVulkan_CreatePipeline(v->Device, v->Allocator, v->PipelineCache, g_RenderPass, v->MSAASamples, &g_Pipeline, g_Subpass);
+}
+
 void ImGui_ImplVulkan_SetMinImageCount(uint32_t min_image_count)
 {
     IM_ASSERT(min_image_count >= 2);
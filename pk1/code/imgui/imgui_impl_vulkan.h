@@ -41,6 +41,11 @@ struct ImGui_ImplVulkan_InitInfo
     VkSampleCountFlagBits        MSAASamples;   // >= VK_SAMPLE_COUNT_1_BIT
     const VkAllocationCallbacks* Allocator;
     void                (*CheckVkResultFn)(VkResult err);
+
+    // Dynamic Rendering (Optional, VK_KHR_dynamic_rendering): pass VK_NULL_HANDLE as the render pass, and describe the attachments the pipeline is drawn into.
+    // PipelineRenderingCreateInfo and the formats it points to must stay valid until ImGui_ImplVulkan_Shutdown().
+    bool                UseDynamicRendering;
+    VkPipelineRenderingCreateInfoKHR PipelineRenderingCreateInfo;
 };
 
 // Called by user code
@@ -52,6 +57,17 @@ IMGUI_IMPL_API bool     ImGui_ImplVulkan_CreateFontsTexture(VkCommandBuffer comm
 IMGUI_IMPL_API void     ImGui_ImplVulkan_DestroyFontUploadObjects();
 IMGUI_IMPL_API void     ImGui_ImplVulkan_SetMinImageCount(uint32_t min_image_count); // To override MinImageCount after initialization (e.g. if swap chain is recreated)
 
+// (Advanced) Recreate the main pipeline without reinitializing the backend, e.g. when the swap chain format changes. The old pipeline is destroyed, so it must no longer be in use.
+// With dynamic rendering, PipelineRenderingCreateInfo and the formats it points to must stay valid until ImGui_ImplVulkan_Shutdown().
+struct ImGui_ImplVulkan_MainPipelineCreateInfo
+{
+    VkRenderPass                        RenderPass;
+    uint32_t                            Subpass;
+    VkSampleCountFlagBits               MSAASamples;
+    VkPipelineRenderingCreateInfoKHR    PipelineRenderingCreateInfo;
+};
+IMGUI_IMPL_API void     ImGui_ImplVulkan_CreateMainPipeline(const ImGui_ImplVulkan_MainPipelineCreateInfo& info);
+
 
 //-------------------------------------------------------------------------
 // Internal / Miscellaneous Vulkan Helpers
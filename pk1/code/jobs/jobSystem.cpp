@@ -0,0 +1,666 @@
+#include "jobSystem.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Batches one thread can have queued at once; past this, a thread runs the batch it was about to queue itself.
+static const int64_t DEQUE_CAPACITY = 1024;
+
+// Threads besides the workers and the initialising thread that may register to use the job system.
+static const uint32_t MAX_REGISTERED_THREADS = 2;
+
+// How often the debug UI recalculates utilisation.
+static const float UTILISATION_INTERVAL_SECONDS = 0.5f;
+
+static const uint32_t BENCHMARK_ITEM_COUNT = 1 << 22;
+
+typedef std::chrono::time_point<std::chrono::high_resolution_clock> PkJobTime;
+
+struct PkJob
+{
+    const PkJobParallelForFunc* pFunc = nullptr;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    PkJobCounter* pCounter = nullptr;
+};
+
+// A thief may read a slot while its owner overwrites it, but then always loses the race for it and discards what it
+// read; the fields are atomic only so that read is well defined.
+struct PkJobSlot
+{
+    std::atomic<const PkJobParallelForFunc*> pFunc{ nullptr };
+    std::atomic<uint32_t> begin{ 0 };
+    std::atomic<uint32_t> end{ 0 };
+    std::atomic<PkJobCounter*> pCounter{ nullptr };
+};
+
+// Chase-Lev work-stealing deque, in the fixed-size form of Le et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models". The owner pushes and pops at the bottom; any other thread steals from the top.
+struct PkJobDeque
+{
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+    PkJobSlot slots[DEQUE_CAPACITY];
+};
+
+struct alignas(64) PkJobWorker
+{
+    PkJobDeque deque;
+    // Set by the thread that owns the slot; read by the debug UI.
+    std::atomic<const char*> pName{ nullptr };
+
+    std::atomic<uint64_t> busyNanoseconds{ 0 };
+    std::atomic<uint32_t> executedCount{ 0 };
+    std::atomic<uint32_t> stolenCount{ 0 };
+
+    // Debug UI only: the counts at the last sample, and what was shown from them.
+    uint64_t sampledBusyNanoseconds = 0;
+    uint32_t sampledExecutedCount = 0;
+    uint32_t sampledStolenCount = 0;
+    float utilisation = 0.0f;
+    uint32_t executedPerSecond = 0;
+    uint32_t stolenPerSecond = 0;
+};
+
+struct PkJobBenchmarkResult
+{
+    uint32_t threadCount = 0;
+    float milliseconds = 0.0f;
+    // Kept so the workload can't be optimised away, and shown so a wrong answer from a broken dependency shows up.
+    float sum = 0.0f;
+};
+
+struct PkJobSystemData
+{
+    std::vector<std::thread> workers;
+
+    // The initialising thread, then the worker threads, then any registered threads.
+    PkJobWorker* pWorkers = nullptr;
+    uint32_t workerCount = 0;
+    // Slots claimed by registered threads; can pass MAX_REGISTERED_THREADS when registration fails.
+    std::atomic<uint32_t> registeredCount{ 0 };
+
+    // Batches queued on any deque and not yet taken; idle workers only sleep while it is zero.
+    std::atomic<uint32_t> queuedCount{ 0 };
+    std::atomic<uint32_t> sleepingCount{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<bool> quit{ false };
+
+    PkJobTime sampleTime;
+    // Debug UI only. The benchmark is only run once the game has made sure nothing else is using the job system.
+    bool bBenchmarkRequested = false;
+    std::vector<PkJobBenchmarkResult> benchmarkResults;
+};
+
+static PkJobSystemData* s_pData = nullptr;
+
+static const uint32_t UNREGISTERED_WORKER_INDEX = UINT32_MAX;
+
+// Each deque may only be pushed to and popped from by its owner, so every thread using the job system needs its own.
+static thread_local uint32_t s_workerIndex = UNREGISTERED_WORKER_INDEX;
+static thread_local uint32_t s_stealSeed = 0;
+
+static bool tryPush(PkJobDeque& rDeque, const PkJob& rJob)
+{
+    const int64_t bottom = rDeque.bottom.load(std::memory_order_relaxed);
+    const int64_t top = rDeque.top.load(std::memory_order_acquire);
+
+    if (bottom - top >= DEQUE_CAPACITY)
+    {
+        return false;
+    }
+
+    PkJobSlot& rSlot = rDeque.slots[bottom % DEQUE_CAPACITY];
+    rSlot.pFunc.store(rJob.pFunc, std::memory_order_relaxed);
+    rSlot.begin.store(rJob.begin, std::memory_order_relaxed);
+    rSlot.end.store(rJob.end, std::memory_order_relaxed);
+    rSlot.pCounter.store(rJob.pCounter, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    rDeque.bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+static void readSlot(const PkJobSlot& rSlot, PkJob& rJob)
+{
+    rJob.pFunc = rSlot.pFunc.load(std::memory_order_relaxed);
+    rJob.begin = rSlot.begin.load(std::memory_order_relaxed);
+    rJob.end = rSlot.end.load(std::memory_order_relaxed);
+    rJob.pCounter = rSlot.pCounter.load(std::memory_order_relaxed);
+}
+
+static bool tryPop(PkJobDeque& rDeque, PkJob& rJob)
+{
+    const int64_t bottom = rDeque.bottom.load(std::memory_order_relaxed) - 1;
+    rDeque.bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = rDeque.top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        rDeque.bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    readSlot(rDeque.slots[bottom % DEQUE_CAPACITY], rJob);
+
+    if (top == bottom)
+    {
+        // The last batch: a thief may be taking it too.
+        const bool bWon = rDeque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        rDeque.bottom.store(bottom + 1, std::memory_order_relaxed);
+        return bWon;
+    }
+
+    return true;
+}
+
+static bool trySteal(PkJobDeque& rDeque, PkJob& rJob)
+{
+    int64_t top = rDeque.top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = rDeque.bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return false;
+    }
+
+    readSlot(rDeque.slots[top % DEQUE_CAPACITY], rJob);
+
+    return rDeque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+static uint32_t getWorkerIndexCount()
+{
+    return s_pData->workerCount + std::min(s_pData->registeredCount.load(), MAX_REGISTERED_THREADS);
+}
+
+static uint32_t getWorkerIndex()
+{
+    assert(s_workerIndex != UNREGISTERED_WORKER_INDEX && "threads must call PkJobSystem::RegisterThread before using the job system");
+    return s_workerIndex;
+}
+
+static float getSeconds(const PkJobTime& rStart, const PkJobTime& rEnd)
+{
+    return std::chrono::duration<float>(rEnd - rStart).count();
+}
+
+static void queueDeferredDispatches(const std::vector<PkJobDeferredDispatch>& rDeferredDispatches);
+
+static void executeJob(const PkJob& rJob)
+{
+    const uint32_t workerIndex = getWorkerIndex();
+    PkJobWorker& rWorker = s_pData->pWorkers[workerIndex];
+    const PkJobTime startTime = std::chrono::high_resolution_clock::now();
+
+    (*rJob.pFunc)(workerIndex, rJob.begin, rJob.end);
+
+    const PkJobTime endTime = std::chrono::high_resolution_clock::now();
+    rWorker.busyNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count(), std::memory_order_relaxed);
+    rWorker.executedCount.fetch_add(1, std::memory_order_relaxed);
+
+    // The counter may be destroyed as soon as pendingCount reaches zero, so the dispatches waiting on it are taken out
+    // first and only queued once it is no longer touched.
+    std::vector<PkJobDeferredDispatch> deferredDispatches;
+
+    if (rJob.pCounter->unfinishedCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(rJob.pCounter->deferredMutex);
+        deferredDispatches.swap(rJob.pCounter->deferredDispatches);
+    }
+    rJob.pCounter->pendingCount.fetch_sub(1, std::memory_order_release);
+
+    queueDeferredDispatches(deferredDispatches);
+}
+
+// Wakes a sleeping worker, if there is one, to take a newly queued batch. Either this sees the worker going to sleep
+// or the worker sees the batch, as both sides change their own count before reading the other's.
+static void wakeWorker()
+{
+    if (s_pData->sleepingCount.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_pData->sleepMutex);
+        }
+        s_pData->sleepCondition.notify_one();
+    }
+}
+
+static void queueJob(const PkJob& rJob)
+{
+    s_pData->queuedCount.fetch_add(1);
+
+    if (!tryPush(s_pData->pWorkers[getWorkerIndex()].deque, rJob))
+    {
+        s_pData->queuedCount.fetch_sub(1);
+        executeJob(rJob);
+        return;
+    }
+
+    wakeWorker();
+}
+
+// Own batches come newest first, as they are most likely still in cache; otherwise the oldest batch of another
+// thread is stolen, starting from a random one so thieves spread out.
+static bool tryTakeJob(PkJob& rJob)
+{
+    const uint32_t workerIndex = getWorkerIndex();
+    PkJobWorker& rWorker = s_pData->pWorkers[workerIndex];
+
+    if (tryPop(rWorker.deque, rJob))
+    {
+        s_pData->queuedCount.fetch_sub(1);
+        return true;
+    }
+
+    if (s_pData->queuedCount.load() == 0)
+    {
+        return false;
+    }
+
+    const uint32_t workerIndexCount = getWorkerIndexCount();
+
+    s_stealSeed ^= s_stealSeed << 13;
+    s_stealSeed ^= s_stealSeed >> 17;
+    s_stealSeed ^= s_stealSeed << 5;
+
+    for (uint32_t i = 0; i < workerIndexCount; i++)
+    {
+        const uint32_t victimIndex = (s_stealSeed + i) % workerIndexCount;
+
+        if (victimIndex != workerIndex && trySteal(s_pData->pWorkers[victimIndex].deque, rJob))
+        {
+            s_pData->queuedCount.fetch_sub(1);
+            rWorker.stolenCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void workerMain(const uint32_t workerIndex)
+{
+    s_workerIndex = workerIndex;
+    s_stealSeed = workerIndex * 2654435761u + 1;
+
+    while (true)
+    {
+        PkJob job;
+
+        if (tryTakeJob(job))
+        {
+            executeJob(job);
+            continue;
+        }
+
+        // A batch was queued but lost to another thief; try again rather than sleep.
+        if (s_pData->queuedCount.load() > 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(s_pData->sleepMutex);
+        s_pData->sleepingCount.fetch_add(1);
+        s_pData->sleepCondition.wait(lock, [] { return s_pData->quit.load() || s_pData->queuedCount.load() > 0; });
+        s_pData->sleepingCount.fetch_sub(1);
+
+        if (s_pData->quit.load() && s_pData->queuedCount.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+/*static*/ uint32_t PkJobSystem::GetNumWorkers()
+{
+    return s_pData->workerCount;
+}
+
+/*static*/ uint32_t PkJobSystem::GetNumWorkerIndices()
+{
+    return s_pData->workerCount + MAX_REGISTERED_THREADS;
+}
+
+/*static*/ uint32_t PkJobSystem::GetCurrentWorkerIndex()
+{
+    return getWorkerIndex();
+}
+
+/*static*/ void PkJobSystem::RegisterThread(const char* pName)
+{
+    if (s_workerIndex != UNREGISTERED_WORKER_INDEX)
+    {
+        throw std::runtime_error("thread already registered with the job system!");
+    }
+
+    // Thieves may look at a claimed slot before its owner has set it up, but its deque is empty until the owner pushes.
+    const uint32_t registeredIndex = s_pData->registeredCount.fetch_add(1);
+
+    if (registeredIndex >= MAX_REGISTERED_THREADS)
+    {
+        throw std::runtime_error("too many threads registered with the job system!");
+    }
+
+    s_workerIndex = s_pData->workerCount + registeredIndex;
+    s_stealSeed = s_workerIndex * 2654435761u + 1;
+    s_pData->pWorkers[s_workerIndex].pName = pName;
+}
+
+// Queues batches firstBatch onwards of a [0, count) range split into batches of size. Batches already counted, as
+// those of a deferred dispatch are, aren't added to the counter again.
+static void queueBatches(const uint32_t count, const uint32_t size, const uint32_t firstBatch, const PkJobParallelForFunc& rFunc, PkJobCounter& rCounter, const bool bCounted)
+{
+    const uint32_t numBatches = (count + size - 1) / size;
+
+    if (!bCounted)
+    {
+        rCounter.pendingCount.fetch_add(numBatches - firstBatch, std::memory_order_relaxed);
+        rCounter.unfinishedCount.fetch_add(numBatches - firstBatch, std::memory_order_relaxed);
+    }
+
+    for (uint32_t batch = firstBatch; batch < numBatches; batch++)
+    {
+        PkJob job;
+        job.pFunc = &rFunc;
+        job.begin = batch * size;
+        job.end = std::min(job.begin + size, count);
+        job.pCounter = &rCounter;
+        queueJob(job);
+    }
+}
+
+static void queueDeferredDispatches(const std::vector<PkJobDeferredDispatch>& rDeferredDispatches)
+{
+    for (const PkJobDeferredDispatch& rDispatch : rDeferredDispatches)
+    {
+        queueBatches(rDispatch.count, rDispatch.batchSize, 0, *rDispatch.pFunc, *rDispatch.pCounter, true);
+    }
+}
+
+static void waitForPendingCount(const std::atomic<uint32_t>& rPendingCount)
+{
+    while (rPendingCount.load(std::memory_order_acquire) > 0)
+    {
+        PkJob job;
+        if (tryTakeJob(job))
+        {
+            executeJob(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/*static*/ void PkJobSystem::ParallelFor(const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const uint32_t size = std::max(batchSize, 1u);
+    const uint32_t numBatches = (count + size - 1) / size;
+
+    if (numBatches == 1 || s_pData->workers.empty())
+    {
+        for (uint32_t begin = 0; begin < count; begin += size)
+        {
+            rFunc(getWorkerIndex(), begin, std::min(begin + size, count));
+        }
+        return;
+    }
+
+    PkJobCounter counter;
+    queueBatches(count, size, 1, rFunc, counter, false);
+
+    // The calling thread takes the first batch itself and then helps out until every batch has finished.
+    rFunc(getWorkerIndex(), 0, std::min(size, count));
+
+    waitForPendingCount(counter.pendingCount);
+}
+
+/*static*/ void PkJobSystem::Dispatch(const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc, PkJobCounter& rCounter)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const uint32_t size = std::max(batchSize, 1u);
+
+    if (s_pData->workers.empty())
+    {
+        for (uint32_t begin = 0; begin < count; begin += size)
+        {
+            rFunc(getWorkerIndex(), begin, std::min(begin + size, count));
+        }
+        return;
+    }
+
+    queueBatches(count, size, 0, rFunc, rCounter, false);
+}
+
+/*static*/ void PkJobSystem::DispatchAfter(PkJobCounter& rDependency, const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc, PkJobCounter& rCounter)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const uint32_t size = std::max(batchSize, 1u);
+
+    {
+        // The dependency's last batch takes this lock after it finishes, so either it finds this dispatch or this
+        // sees that it has already finished.
+        std::lock_guard<std::mutex> lock(rDependency.deferredMutex);
+
+        if (rDependency.unfinishedCount.load(std::memory_order_acquire) > 0)
+        {
+            const uint32_t numBatches = (count + size - 1) / size;
+            rCounter.pendingCount.fetch_add(numBatches, std::memory_order_relaxed);
+            rCounter.unfinishedCount.fetch_add(numBatches, std::memory_order_relaxed);
+
+            PkJobDeferredDispatch dispatch;
+            dispatch.count = count;
+            dispatch.batchSize = size;
+            dispatch.pFunc = &rFunc;
+            dispatch.pCounter = &rCounter;
+            rDependency.deferredDispatches.push_back(dispatch);
+            return;
+        }
+    }
+
+    // The dependency's last batch may not have dropped its pendingCount yet; once it has, nothing touches the
+    // dependency again, so waiting on rCounter is enough for the caller to destroy it.
+    waitForPendingCount(rDependency.pendingCount);
+    Dispatch(count, size, rFunc, rCounter);
+}
+
+/*static*/ bool PkJobSystem::IsComplete(const PkJobCounter& rCounter)
+{
+    return rCounter.pendingCount.load(std::memory_order_acquire) == 0;
+}
+
+/*static*/ void PkJobSystem::Wait(PkJobCounter& rCounter)
+{
+    waitForPendingCount(rCounter.pendingCount);
+}
+
+static PkJobBenchmarkResult runBenchmarkWorkload(const uint32_t threadCount)
+{
+    // One batch per thread, so no more than threadCount threads can be working on it at once.
+    const uint32_t batchSize = (BENCHMARK_ITEM_COUNT + threadCount - 1) / threadCount;
+    std::vector<float> batchSums(threadCount, 0.0f);
+    float totalSum = 0.0f;
+
+    PkJobParallelForFunc sumFunc = [&batchSums, batchSize](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        float sum = 0.0f;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const float x = static_cast<float>(i) * 0.001f;
+            sum += std::sqrt(x) * std::sin(x);
+        }
+        batchSums[begin / batchSize] = sum;
+    };
+
+    PkJobParallelForFunc totalFunc = [&batchSums, &totalSum](const uint32_t workerIndex, const uint32_t begin, const uint32_t end)
+    {
+        for (float sum : batchSums)
+        {
+            totalSum += sum;
+        }
+    };
+
+    PkJobCounter sumCounter;
+    PkJobCounter totalCounter;
+
+    const PkJobTime startTime = std::chrono::high_resolution_clock::now();
+    PkJobSystem::Dispatch(BENCHMARK_ITEM_COUNT, batchSize, sumFunc, sumCounter);
+    PkJobSystem::DispatchAfter(sumCounter, 1, 1, totalFunc, totalCounter);
+    PkJobSystem::Wait(totalCounter);
+    const PkJobTime endTime = std::chrono::high_resolution_clock::now();
+
+    PkJobBenchmarkResult result;
+    result.threadCount = threadCount;
+    result.milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count();
+    result.sum = totalSum;
+    return result;
+}
+
+/*static*/ bool PkJobSystem::IsBenchmarkRequested()
+{
+    return s_pData->bBenchmarkRequested;
+}
+
+/*static*/ void PkJobSystem::RunBenchmark()
+{
+    s_pData->bBenchmarkRequested = false;
+    s_pData->benchmarkResults.clear();
+
+    for (uint32_t threadCount = 1; threadCount <= GetNumWorkers(); threadCount++)
+    {
+        s_pData->benchmarkResults.push_back(runBenchmarkWorkload(threadCount));
+    }
+}
+
+static void sampleUtilisation()
+{
+    const PkJobTime now = std::chrono::high_resolution_clock::now();
+    const float seconds = getSeconds(s_pData->sampleTime, now);
+
+    if (seconds < UTILISATION_INTERVAL_SECONDS)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < getWorkerIndexCount(); i++)
+    {
+        PkJobWorker& rWorker = s_pData->pWorkers[i];
+
+        const uint64_t busyNanoseconds = rWorker.busyNanoseconds.load(std::memory_order_relaxed);
+        const uint32_t executedCount = rWorker.executedCount.load(std::memory_order_relaxed);
+        const uint32_t stolenCount = rWorker.stolenCount.load(std::memory_order_relaxed);
+
+        rWorker.utilisation = static_cast<float>(busyNanoseconds - rWorker.sampledBusyNanoseconds) / (seconds * 1000000000.0f);
+        rWorker.executedPerSecond = static_cast<uint32_t>((executedCount - rWorker.sampledExecutedCount) / seconds);
+        rWorker.stolenPerSecond = static_cast<uint32_t>((stolenCount - rWorker.sampledStolenCount) / seconds);
+
+        rWorker.sampledBusyNanoseconds = busyNanoseconds;
+        rWorker.sampledExecutedCount = executedCount;
+        rWorker.sampledStolenCount = stolenCount;
+    }
+
+    s_pData->sampleTime = now;
+}
+
+/*static*/ void PkJobSystem::ShowDebugUi()
+{
+    sampleUtilisation();
+
+    if (ImGui::Begin("Jobs"))
+    {
+        ImGui::Text("Workers: %u, queued batches: %u", GetNumWorkers(), s_pData->queuedCount.load());
+
+        if (ImGui::CollapsingHeader("Utilisation", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            for (uint32_t i = 0; i < getWorkerIndexCount(); i++)
+            {
+                const PkJobWorker& rWorker = s_pData->pWorkers[i];
+
+                const char* pName = rWorker.pName.load();
+                ImGui::Text("%2u %-8s %5.1f%% busy, %u batches/s, %u stolen/s", i, pName != nullptr ? pName : "", rWorker.utilisation * 100.0f, rWorker.executedPerSecond, rWorker.stolenPerSecond);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Scaling benchmark"))
+        {
+            if (ImGui::Button("Run benchmark"))
+            {
+                s_pData->bBenchmarkRequested = true;
+            }
+
+            for (const PkJobBenchmarkResult& rResult : s_pData->benchmarkResults)
+            {
+                const float speedup = s_pData->benchmarkResults[0].milliseconds / std::max(rResult.milliseconds, 0.001f);
+                ImGui::Text("%2u threads: %.2f ms (%.2fx), sum %.1f", rResult.threadCount, rResult.milliseconds, speedup, rResult.sum);
+            }
+        }
+    }
+    ImGui::End();
+}
+
+/*static*/ void PkJobSystem::InitialiseJobSystem()
+{
+    s_pData = new PkJobSystemData();
+
+    const uint32_t numCores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    s_pData->workerCount = numCores;
+    s_pData->pWorkers = new PkJobWorker[numCores + MAX_REGISTERED_THREADS];
+    s_pData->pWorkers[0].pName = "Main";
+    s_pData->sampleTime = std::chrono::high_resolution_clock::now();
+
+    s_workerIndex = 0;
+    s_stealSeed = 1;
+
+    for (uint32_t i = 1; i < numCores; i++)
+    {
+        s_pData->pWorkers[i].pName = "Worker";
+        s_pData->workers.emplace_back(workerMain, i);
+    }
+}
+
+/*static*/ void PkJobSystem::CleanupJobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_pData->sleepMutex);
+        s_pData->quit = true;
+    }
+    s_pData->sleepCondition.notify_all();
+
+    for (std::thread& rWorker : s_pData->workers)
+    {
+        rWorker.join();
+    }
+
+    delete[] s_pData->pWorkers;
+    delete s_pData;
+}
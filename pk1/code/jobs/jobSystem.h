@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <stdint.h>
+
+// Called with the index of the worker running the batch (0 is the calling thread) and the [begin, end) range to process.
+typedef std::function<void(const uint32_t workerIndex, const uint32_t begin, const uint32_t end)> PkJobParallelForFunc;
+
+struct PkJobCounter;
+
+// A dispatch held back until another has finished; see DispatchAfter.
+struct PkJobDeferredDispatch
+{
+    uint32_t count = 0;
+    uint32_t batchSize = 0;
+    const PkJobParallelForFunc* pFunc = nullptr;
+    PkJobCounter* pCounter = nullptr;
+};
+
+// Tracks the batches of a Dispatch that have not finished yet.
+struct PkJobCounter
+{
+    std::atomic<uint32_t> pendingCount{ 0 };
+
+    // Falls to zero just before pendingCount does, so the last batch can take the dispatches waiting on this counter
+    // while the counter is still guaranteed to be alive; it queues them once it has dropped pendingCount.
+    std::atomic<uint32_t> unfinishedCount{ 0 };
+    std::mutex deferredMutex;
+    std::vector<PkJobDeferredDispatch> deferredDispatches;
+};
+
+// Runs batches of work on one worker per core. Each thread queues onto its own deque and takes its newest batch back
+// first; idle threads steal the oldest batches from the others.
+class PkJobSystem
+{
+public:
+    PkJobSystem() = delete;
+
+    // How many threads run batches at once, to split work between.
+    static uint32_t GetNumWorkers();
+    // Per-thread data indexed by GetCurrentWorkerIndex needs this many entries; registered threads are included.
+    static uint32_t GetNumWorkerIndices();
+    static uint32_t GetCurrentWorkerIndex();
+
+    // Threads other than the one that initialised the job system must register before they queue or wait on work.
+    // Throws once more threads have registered than there are slots for.
+    static void RegisterThread(const char* pName);
+
+    static void ParallelFor(const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc);
+
+    // Like ParallelFor but returns straight away; rFunc and rCounter must stay alive until Wait returns.
+    // Without worker threads the batches run before Dispatch returns.
+    static void Dispatch(const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc, PkJobCounter& rCounter);
+
+    // Like Dispatch, but the batches are only queued once every batch counted by rDependency has finished and the job
+    // system is done with rDependency. rCounter counts them from now, so once Wait(rCounter) returns rDependency may be
+    // destroyed without waiting on it too. rDependency must not be dispatched to again until it has been waited on.
+    static void DispatchAfter(PkJobCounter& rDependency, const uint32_t count, const uint32_t batchSize, const PkJobParallelForFunc& rFunc, PkJobCounter& rCounter);
+
+    static bool IsComplete(const PkJobCounter& rCounter);
+
+    // Runs queued batches on the calling thread until every batch of the dispatch has finished.
+    static void Wait(PkJobCounter& rCounter);
+
+    // Per-worker utilisation, and a benchmark of how a fixed workload scales with the number of threads.
+    static void ShowDebugUi();
+
+    // The debug UI only asks for the benchmark. The game runs it once nothing else is using the job system, as other
+    // work would be counted in its timings.
+    static bool IsBenchmarkRequested();
+    static void RunBenchmark();
+
+    static void InitialiseJobSystem();
+    static void CleanupJobSystem();
+};
@@ -0,0 +1,51 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform CameraBufferObject {
+    mat4 view;
+    mat4 proj;
+} camera;
+
+// One chunk of the board: its corner as a matrix, and the scale from 0 to 1 tile fields back to chunk space.
+layout(push_constant) uniform ChunkConstants {
+    mat4 matrix;
+    vec4 dequantise;
+} chunk;
+
+// Matches PkGraphicsBoardTileRotation: 0 when every tile is turned by whole quarter turns, 1 for any angle. The
+// pipeline is specialised, so only the mode in use is compiled in.
+layout(constant_id = 0) const uint TILE_ROTATION = 1;
+
+// Vertex attributes
+layout(location = 0) in vec3 inVertexPosition;
+layout(location = 1) in vec3 inVertexColor;
+layout(location = 2) in vec2 inVertexTexCoord;
+
+// Tile attributes: x, y and height within the chunk, and rotation, each 16 bit unorm.
+layout(location = 3) in vec4 inTile;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    float c;
+    float s;
+
+    if (TILE_ROTATION == 0) {
+        // The rotation's top two bits count the quarter turns.
+        uint quarterTurns = uint(inTile.w * 65535.0 + 0.5) >> 14;
+        c = quarterTurns == 0 ? 1.0 : (quarterTurns == 2 ? -1.0 : 0.0);
+        s = quarterTurns == 1 ? 1.0 : (quarterTurns == 3 ? -1.0 : 0.0);
+    } else {
+        float angle = inTile.w * chunk.dequantise.w;
+        c = cos(angle);
+        s = sin(angle);
+    }
+
+    vec3 position = vec3(c * inVertexPosition.x - s * inVertexPosition.y, s * inVertexPosition.x + c * inVertexPosition.y, inVertexPosition.z);
+    position += vec3(inTile.xy * chunk.dequantise.xy, inTile.z * chunk.dequantise.z);
+
+    gl_Position = camera.proj * camera.view * chunk.matrix * vec4(position, 1.0);
+    fragColor = inVertexColor;
+    fragTexCoord = inVertexTexCoord;
+}
@@ -1,7 +1,11 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 1) uniform sampler2D texSampler;
+layout(set = 1, binding = 0) uniform sampler2D texSampler;
+
+// Matches PkGraphicsSceneFragConstant. Each pipeline is specialised, so untaken paths are compiled out.
+layout(constant_id = 0) const uint TEXTURE_COUNT = 1;
+layout(constant_id = 1) const bool ALPHA_TEST = false;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -9,5 +13,13 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    if (TEXTURE_COUNT == 0) {
+        outColor = vec4(fragColor, 1.0);
+    } else {
+        outColor = texture(texSampler, fragTexCoord);
+    }
+
+    if (ALPHA_TEST && outColor.a < 0.5) {
+        discard;
+    }
 }
\ No newline at end of file